@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Stand-in for the TinyUSB board support, implemented by sim_hw.c
+ */
+#ifndef _PICOPORTS_SIM_BSP_BOARD_API_H_
+#define _PICOPORTS_SIM_BSP_BOARD_API_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+void board_init(void);
+// Not implemented, the firmware checks for it
+void board_init_after_tusb(void) __attribute__((weak));
+// The button is never pressed
+uint32_t board_button_read(void);
+size_t board_get_unique_id(uint8_t id[], size_t max_len);
+
+#endif /* _PICOPORTS_SIM_BSP_BOARD_API_H_ */
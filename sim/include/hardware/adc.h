@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Each channel reads a fixed value, see sim_hw.c
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_ADC_H_
+#define _PICOPORTS_SIM_HARDWARE_ADC_H_
+
+#include "pico.h"
+
+void adc_init(void);
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+uint16_t adc_read(void);
+void adc_set_temp_sensor_enabled(bool enable);
+
+#endif /* _PICOPORTS_SIM_HARDWARE_ADC_H_ */
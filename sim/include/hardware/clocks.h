@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_CLOCKS_H_
+#define _PICOPORTS_SIM_HARDWARE_CLOCKS_H_
+
+#include "pico.h"
+
+enum clock_index {
+	clk_gpout0 = 0,
+	clk_gpout1,
+	clk_gpout2,
+	clk_gpout3,
+	clk_ref,
+	clk_sys,
+	clk_peri,
+	clk_usb,
+	clk_adc,
+	clk_rtc,
+};
+
+// The default clocks: 125 MHz system and peripheral clock
+uint32_t clock_get_hz(enum clock_index clk_index);
+
+#endif /* _PICOPORTS_SIM_HARDWARE_CLOCKS_H_ */
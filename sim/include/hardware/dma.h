@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Transfers complete when they're started. A channel paced by a SPI TX DREQ
+ * feeds its data to the channel paced by the RX DREQ of the same port, all
+ * other channels copy memory.
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_DMA_H_
+#define _PICOPORTS_SIM_HARDWARE_DMA_H_
+
+#include "pico.h"
+
+enum dma_channel_transfer_size {
+	DMA_SIZE_8 = 0,
+	DMA_SIZE_16 = 1,
+	DMA_SIZE_32 = 2
+};
+
+typedef struct {
+	enum dma_channel_transfer_size size;
+	bool read_increment;
+	bool write_increment;
+	uint dreq;
+} dma_channel_config;
+
+#define DREQ_FORCE 63
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+
+static inline void
+channel_config_set_transfer_data_size(dma_channel_config *c,
+				      enum dma_channel_transfer_size size)
+{
+	c->size = size;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c,
+						     bool incr)
+{
+	c->read_increment = incr;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c,
+						      bool incr)
+{
+	c->write_increment = incr;
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+	c->dreq = dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+			   volatile void *write_addr,
+			   const volatile void *read_addr,
+			   uint transfer_count, bool trigger);
+void dma_start_channel_mask(uint32_t chan_mask);
+
+static inline void dma_channel_wait_for_finish_blocking(uint channel)
+{
+	(void)channel;
+}
+
+#endif /* _PICOPORTS_SIM_HARDWARE_DMA_H_ */
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * A pin reads its output value while it's an output and the level driven by
+ * the simulator (see sim_gpio_drive()) or its pull otherwise. Edges of the
+ * read level raise the bank 0 interrupt.
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_GPIO_H_
+#define _PICOPORTS_SIM_HARDWARE_GPIO_H_
+
+#include "pico.h"
+#include "hardware/irq.h"
+
+enum gpio_function_rp2040 {
+	GPIO_FUNC_XIP = 0,
+	GPIO_FUNC_SPI = 1,
+	GPIO_FUNC_UART = 2,
+	GPIO_FUNC_I2C = 3,
+	GPIO_FUNC_PWM = 4,
+	GPIO_FUNC_SIO = 5,
+	GPIO_FUNC_PIO0 = 6,
+	GPIO_FUNC_PIO1 = 7,
+	GPIO_FUNC_GPCK = 8,
+	GPIO_FUNC_USB = 9,
+	GPIO_FUNC_NULL = 0x1f,
+};
+typedef enum gpio_function_rp2040 gpio_function_t;
+
+enum gpio_irq_level {
+	GPIO_IRQ_LEVEL_LOW = 0x1u,
+	GPIO_IRQ_LEVEL_HIGH = 0x2u,
+	GPIO_IRQ_EDGE_FALL = 0x4u,
+	GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+typedef struct {
+	io_ro_32 cpuid;
+	io_ro_32 gpio_in;
+	io_ro_32 gpio_hi_in;
+	uint32_t _pad0;
+	io_rw_32 gpio_out;
+	io_rw_32 gpio_set;
+	io_rw_32 gpio_clr;
+	io_rw_32 gpio_togl;
+	io_rw_32 gpio_oe;
+} sio_hw_t;
+
+extern sio_hw_t sim_sio_hw;
+#define sio_hw (&sim_sio_hw)
+
+void gpio_init(uint gpio);
+void gpio_set_function(uint gpio, gpio_function_t fn);
+void gpio_pull_up(uint gpio);
+void gpio_pull_down(uint gpio);
+void gpio_disable_pulls(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+
+static inline bool gpio_get(uint gpio)
+{
+	return sio_hw->gpio_in & (1u << gpio);
+}
+
+static inline uint32_t gpio_get_all(void)
+{
+	return sio_hw->gpio_in;
+}
+
+static inline uint gpio_get_dir(uint gpio)
+{
+	return !!(sio_hw->gpio_oe & (1u << gpio));
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void gpio_set_irq_callback(gpio_irq_callback_t callback);
+
+#endif /* _PICOPORTS_SIM_HARDWARE_GPIO_H_ */
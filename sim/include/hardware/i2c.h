@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * The bus has a 24C02 style EEPROM at SIM_I2C_EEPROM_ADDR, with a one byte
+ * address that wraps around. All other addresses don't acknowledge.
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_I2C_H_
+#define _PICOPORTS_SIM_HARDWARE_I2C_H_
+
+#include "pico.h"
+
+#define SIM_I2C_EEPROM_ADDR 0x50
+
+typedef struct i2c_inst {
+	uint8_t eeprom[256];
+	uint8_t eeprom_addr;
+} i2c_inst_t;
+
+extern i2c_inst_t sim_i2c_inst[2];
+#define i2c0 (&sim_i2c_inst[0])
+#define i2c1 (&sim_i2c_inst[1])
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+// The bus never stalls, so the timeouts are ignored
+int i2c_write_timeout_per_char_us(i2c_inst_t *i2c, uint8_t addr,
+				  const uint8_t *src, size_t len, bool nostop,
+				  uint timeout_per_char_us);
+int i2c_read_timeout_per_char_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+				 size_t len, bool nostop,
+				 uint timeout_per_char_us);
+
+#endif /* _PICOPORTS_SIM_HARDWARE_I2C_H_ */
@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Interrupts are delivered while the firmware sleeps in __wfe() or disables
+ * interrupts (see hardware/sync.h), and only while they're enabled.
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_IRQ_H_
+#define _PICOPORTS_SIM_HARDWARE_IRQ_H_
+
+#include "pico.h"
+
+enum irq_num_rp2040 {
+	IO_IRQ_BANK0 = 13,
+	UART0_IRQ = 20,
+	UART1_IRQ = 21,
+	NUM_IRQS = 32,
+};
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_enabled(uint num, bool enabled);
+bool irq_is_enabled(uint num);
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+
+#endif /* _PICOPORTS_SIM_HARDWARE_IRQ_H_ */
@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * The slices are configured, but don't drive their pins
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_PWM_H_
+#define _PICOPORTS_SIM_HARDWARE_PWM_H_
+
+#include "pico.h"
+
+static inline uint pwm_gpio_to_slice_num(uint gpio)
+{
+	return (gpio >> 1u) & 7u;
+}
+
+static inline uint pwm_gpio_to_channel(uint gpio)
+{
+	return gpio & 1u;
+}
+
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract);
+void pwm_set_wrap(uint slice_num, uint16_t wrap);
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level);
+void pwm_set_enabled(uint slice_num, bool enabled);
+
+#endif /* _PICOPORTS_SIM_HARDWARE_PWM_H_ */
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * MISO is connected to MOSI. Transfers are made by the DMA stand-in, see
+ * dma_start_channel_mask().
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_SPI_H_
+#define _PICOPORTS_SIM_HARDWARE_SPI_H_
+
+#include "pico.h"
+
+typedef struct {
+	io_rw_32 cr0;
+	io_rw_32 cr1;
+	io_rw_32 dr;
+	io_ro_32 sr;
+	io_rw_32 cpsr;
+	io_rw_32 imsc;
+	io_ro_32 ris;
+	io_ro_32 mis;
+	io_rw_32 icr;
+	io_rw_32 dmacr;
+} spi_hw_t;
+
+typedef struct spi_inst spi_inst_t;
+
+extern spi_hw_t sim_spi_hw[2];
+#define spi0 ((spi_inst_t *)&sim_spi_hw[0])
+#define spi1 ((spi_inst_t *)&sim_spi_hw[1])
+
+#define SPI_SSPCR1_SSE_BITS 0x00000002u
+#define SPI_SSPSR_RNE_BITS 0x00000004u
+
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi)
+{
+	return (spi_hw_t *)spi;
+}
+
+static inline uint spi_get_index(const spi_inst_t *spi)
+{
+	return (const spi_hw_t *)spi == &sim_spi_hw[1];
+}
+
+static inline bool spi_is_readable(const spi_inst_t *spi)
+{
+	return ((const spi_hw_t *)spi)->sr & SPI_SSPSR_RNE_BITS;
+}
+
+// DREQ_SPI0_TX, DREQ_SPI0_RX, DREQ_SPI1_TX, DREQ_SPI1_RX
+static inline uint spi_get_dreq(spi_inst_t *spi, bool is_tx)
+{
+	return 16 + spi_get_index(spi) * 2 + !is_tx;
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate);
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol,
+		    spi_cpha_t cpha, spi_order_t order);
+
+#endif /* _PICOPORTS_SIM_HARDWARE_SPI_H_ */
@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * The frame number register, set by the simulated start of frame (see
+ * sim_usb.c).
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_STRUCTS_USB_H_
+#define _PICOPORTS_SIM_HARDWARE_STRUCTS_USB_H_
+
+#include "pico.h"
+
+#define USB_SOF_RD_BITS 0x000007ff
+
+typedef struct {
+	io_ro_32 sof_rd;
+} usb_hw_t;
+
+extern usb_hw_t sim_usb_hw;
+#define usb_hw (&sim_usb_hw)
+
+#endif /* _PICOPORTS_SIM_HARDWARE_STRUCTS_USB_H_ */
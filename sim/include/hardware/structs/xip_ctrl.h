@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * The simulator has no XIP cache, the counters stay 0.
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_STRUCTS_XIP_CTRL_H_
+#define _PICOPORTS_SIM_HARDWARE_STRUCTS_XIP_CTRL_H_
+
+#include "pico.h"
+
+typedef struct {
+	io_rw_32 ctr_hit;
+	io_rw_32 ctr_acc;
+} xip_ctrl_hw_t;
+
+extern xip_ctrl_hw_t sim_xip_ctrl_hw;
+#define xip_ctrl_hw (&sim_xip_ctrl_hw)
+
+#endif /* _PICOPORTS_SIM_HARDWARE_STRUCTS_XIP_CTRL_H_ */
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Interrupts are only delivered at the points below (see hardware/irq.h), so
+ * there is nothing to mask.
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_SYNC_H_
+#define _PICOPORTS_SIM_HARDWARE_SYNC_H_
+
+#include "pico.h"
+
+// Delivers the pending interrupts if the last delivery is at least a
+// millisecond ago, so a main loop that never sleeps still gets them
+void sim_irq_point(void);
+
+static inline uint32_t save_and_disable_interrupts(void)
+{
+	sim_irq_point();
+	return 0;
+}
+
+static inline void restore_interrupts(uint32_t status)
+{
+	(void)status;
+}
+
+// Waits for the host, the next timer or toggle, then delivers the interrupts
+void __wfe(void);
+void __sev(void);
+
+#endif /* _PICOPORTS_SIM_HARDWARE_SYNC_H_ */
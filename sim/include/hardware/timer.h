@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Microseconds since the simulator was started, from CLOCK_MONOTONIC
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_TIMER_H_
+#define _PICOPORTS_SIM_HARDWARE_TIMER_H_
+
+#include "pico.h"
+
+uint64_t time_us_64(void);
+
+static inline uint32_t time_us_32(void)
+{
+	return (uint32_t)time_us_64();
+}
+
+void busy_wait_us(uint64_t delay_us);
+
+static inline void busy_wait_us_32(uint32_t delay_us)
+{
+	busy_wait_us(delay_us);
+}
+
+#endif /* _PICOPORTS_SIM_HARDWARE_TIMER_H_ */
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * The UARTs send into the void and never receive: the TX FIFO is always empty
+ * and so is the RX FIFO.
+ */
+#ifndef _PICOPORTS_SIM_HARDWARE_UART_H_
+#define _PICOPORTS_SIM_HARDWARE_UART_H_
+
+#include "pico.h"
+
+typedef struct {
+	io_rw_32 dr;
+	io_rw_32 rsr;
+	uint32_t _pad0[4];
+	io_ro_32 fr;
+	uint32_t _pad1;
+	io_rw_32 ilpr;
+	io_rw_32 ibrd;
+	io_rw_32 fbrd;
+	io_rw_32 lcr_h;
+	io_rw_32 cr;
+	io_rw_32 ifls;
+	io_rw_32 imsc;
+	io_ro_32 ris;
+	io_ro_32 mis;
+	io_rw_32 icr;
+	io_rw_32 dmacr;
+} uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_hw_t sim_uart_hw[2];
+#define uart0 ((uart_inst_t *)&sim_uart_hw[0])
+#define uart1 ((uart_inst_t *)&sim_uart_hw[1])
+
+#define UART_UARTFR_BUSY_BITS 0x00000008u
+#define UART_UARTFR_RXFE_BITS 0x00000010u
+#define UART_UARTFR_TXFF_BITS 0x00000020u
+#define UART_UARTFR_TXFE_BITS 0x00000080u
+#define UART_UARTDR_FE_BITS 0x00000100u
+#define UART_UARTDR_PE_BITS 0x00000200u
+#define UART_UARTDR_BE_BITS 0x00000400u
+#define UART_UARTDR_OE_BITS 0x00000800u
+#define UART_UARTIFLS_RXIFLSEL_LSB 3u
+#define UART_UARTIFLS_RXIFLSEL_BITS 0x00000038u
+#define UART_UARTIMSC_RXIM_BITS 0x00000010u
+#define UART_UARTIMSC_TXIM_BITS 0x00000020u
+#define UART_UARTIMSC_RTIM_BITS 0x00000040u
+
+typedef enum {
+	UART_PARITY_NONE,
+	UART_PARITY_EVEN,
+	UART_PARITY_ODD
+} uart_parity_t;
+
+static inline uart_hw_t *uart_get_hw(uart_inst_t *uart)
+{
+	return (uart_hw_t *)uart;
+}
+
+static inline bool uart_is_readable(uart_inst_t *uart)
+{
+	return !(uart_get_hw(uart)->fr & UART_UARTFR_RXFE_BITS);
+}
+
+static inline bool uart_is_writable(uart_inst_t *uart)
+{
+	return !(uart_get_hw(uart)->fr & UART_UARTFR_TXFF_BITS);
+}
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate);
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits,
+		     uart_parity_t parity);
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data,
+			  bool tx_needs_data);
+
+#endif /* _PICOPORTS_SIM_HARDWARE_UART_H_ */
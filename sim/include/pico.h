@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Stand-ins for the parts of the pico-sdk the firmware uses, implemented by
+ * sim_hw.c. Register blocks are plain memory, so the firmware's register
+ * accesses work but have no side effects.
+ */
+#ifndef _PICOPORTS_SIM_PICO_H_
+#define _PICOPORTS_SIM_PICO_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef volatile uint32_t io_rw_32;
+typedef volatile uint32_t io_ro_32;
+
+// The simulated chip, see pp_platform.h
+#define PICO_RP2040 1
+
+#define NUM_BANK0_GPIOS 30
+#define NUM_ADC_CHANNELS 5
+#define NUM_DMA_CHANNELS 12
+#define NUM_PWM_SLICES 8
+
+enum pico_error_codes {
+	PICO_OK = 0,
+	PICO_ERROR_GENERIC = -1,
+	PICO_ERROR_TIMEOUT = -2,
+};
+
+static inline void hw_set_bits(io_rw_32 *addr, uint32_t mask)
+{
+	*addr |= mask;
+}
+
+static inline void hw_clear_bits(io_rw_32 *addr, uint32_t mask)
+{
+	*addr &= ~mask;
+}
+
+static inline void hw_write_masked(io_rw_32 *addr, uint32_t values,
+				   uint32_t write_mask)
+{
+	*addr = (*addr & ~write_mask) | (values & write_mask);
+}
+
+static inline void tight_loop_contents(void)
+{
+}
+
+#endif /* _PICOPORTS_SIM_PICO_H_ */
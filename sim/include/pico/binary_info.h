@@ -0,0 +1,12 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * There is no picotool for the simulator
+ */
+#ifndef _PICOPORTS_SIM_PICO_BINARY_INFO_H_
+#define _PICOPORTS_SIM_PICO_BINARY_INFO_H_
+
+#define bi_decl(...)
+
+#endif /* _PICOPORTS_SIM_PICO_BINARY_INFO_H_ */
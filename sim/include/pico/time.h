@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Repeating timers are run when interrupts are delivered, see hardware/sync.h
+ */
+#ifndef _PICOPORTS_SIM_PICO_TIME_H_
+#define _PICOPORTS_SIM_PICO_TIME_H_
+
+#include "hardware/timer.h"
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+
+struct repeating_timer {
+	int64_t delay_us;
+	repeating_timer_callback_t callback;
+	void *user_data;
+	uint64_t next_us;
+};
+
+bool add_repeating_timer_us(int64_t delay_us,
+			    repeating_timer_callback_t callback,
+			    void *user_data, repeating_timer_t *out);
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+#endif /* _PICOPORTS_SIM_PICO_TIME_H_ */
@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Stand-in for the parts of TinyUSB the firmware uses, implemented by
+ * sim_usb.c. The vendor interfaces and EP0 are Unix sockets, the CDC
+ * interfaces have no host attached.
+ */
+#ifndef _PICOPORTS_SIM_TUSB_H_
+#define _PICOPORTS_SIM_TUSB_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// The simulator stands in for an RP2040
+#define OPT_MCU_RP2040 1
+#define CFG_TUSB_MCU OPT_MCU_RP2040
+
+#include "tusb_config.h"
+
+//--------------------------------------------------------------------+
+// Common
+//--------------------------------------------------------------------+
+
+#define TU_ARRAY_SIZE(_arr) (sizeof(_arr) / sizeof(_arr[0]))
+#define TU_MIN(_x, _y) (((_x) < (_y)) ? (_x) : (_y))
+#define TU_MAX(_x, _y) (((_x) > (_y)) ? (_x) : (_y))
+#define TU_ATTR_UNUSED __attribute__((unused))
+#define TU_ATTR_WEAK __attribute__((weak))
+#define TU_VERIFY_STATIC _Static_assert
+
+// Set from the command line, see sim_main.c
+extern int sim_log_level;
+
+void sim_log_buf(const uint8_t *buf, uint32_t len);
+
+#define TU_LOG(n, ...)                                                         \
+	do {                                                                   \
+		if (sim_log_level >= (n))                                      \
+			fprintf(stderr, __VA_ARGS__);                          \
+	} while (0)
+#define TU_LOG1(...) TU_LOG(1, __VA_ARGS__)
+#define TU_LOG2(...) TU_LOG(2, __VA_ARGS__)
+#define TU_LOG3(...) TU_LOG(3, __VA_ARGS__)
+#define TU_LOG_BUF(n, _buf, _len)                                              \
+	do {                                                                   \
+		if (sim_log_level >= (n))                                      \
+			sim_log_buf((const uint8_t *)(_buf), (_len));          \
+	} while (0)
+#define TU_LOG1_BUF(_buf, _len) TU_LOG_BUF(1, _buf, _len)
+#define TU_LOG2_BUF(_buf, _len) TU_LOG_BUF(2, _buf, _len)
+#define TU_LOG3_BUF(_buf, _len) TU_LOG_BUF(3, _buf, _len)
+
+#define TU_GET_3RD_ARG(_1, _2, _3, ...) _3
+
+// TU_VERIFY(cond) returns false, TU_VERIFY(cond, ret) returns ret
+#define TU_VERIFY_1ARGS(_cond) TU_VERIFY_2ARGS(_cond, false)
+#define TU_VERIFY_2ARGS(_cond, _ret)                                           \
+	do {                                                                   \
+		if (!(_cond))                                                  \
+			return _ret;                                           \
+	} while (0)
+#define TU_VERIFY(...)                                                         \
+	TU_GET_3RD_ARG(__VA_ARGS__, TU_VERIFY_2ARGS, TU_VERIFY_1ARGS,          \
+		       _unused)(__VA_ARGS__)
+
+// Like TU_VERIFY, but logs the failure
+#define TU_ASSERT_1ARGS(_cond) TU_ASSERT_2ARGS(_cond, false)
+#define TU_ASSERT_2ARGS(_cond, _ret)                                           \
+	do {                                                                   \
+		if (!(_cond)) {                                                \
+			TU_LOG1("%s %d: ASSERT FAILED\r\n", __func__,          \
+				__LINE__);                                     \
+			return _ret;                                           \
+		}                                                              \
+	} while (0)
+#define TU_ASSERT(...)                                                         \
+	TU_GET_3RD_ARG(__VA_ARGS__, TU_ASSERT_2ARGS, TU_ASSERT_1ARGS,          \
+		       _unused)(__VA_ARGS__)
+
+//--------------------------------------------------------------------+
+// Device stack
+//--------------------------------------------------------------------+
+
+typedef enum {
+	TUSB_ROLE_INVALID = 0,
+	TUSB_ROLE_DEVICE = 1,
+	TUSB_ROLE_HOST = 2,
+} tusb_role_t;
+
+typedef enum {
+	TUSB_SPEED_FULL = 0,
+	TUSB_SPEED_LOW = 1,
+	TUSB_SPEED_HIGH = 2,
+	TUSB_SPEED_AUTO = 0xff,
+} tusb_speed_t;
+
+typedef struct {
+	tusb_role_t role;
+	tusb_speed_t speed;
+} tusb_rhport_init_t;
+
+typedef enum { TUSB_DIR_OUT = 0, TUSB_DIR_IN = 1 } tusb_dir_t;
+
+typedef enum {
+	TUSB_REQ_TYPE_STANDARD = 0,
+	TUSB_REQ_TYPE_CLASS,
+	TUSB_REQ_TYPE_VENDOR,
+	TUSB_REQ_TYPE_INVALID
+} tusb_request_type_t;
+
+typedef struct __attribute__((packed)) {
+	union {
+		struct __attribute__((packed)) {
+			uint8_t recipient : 5;
+			uint8_t type : 2;
+			uint8_t direction : 1;
+		} bmRequestType_bit;
+		uint8_t bmRequestType;
+	};
+	uint8_t bRequest;
+	uint16_t wValue;
+	uint16_t wIndex;
+	uint16_t wLength;
+} tusb_control_request_t;
+
+enum {
+	CONTROL_STAGE_IDLE,
+	CONTROL_STAGE_SETUP,
+	CONTROL_STAGE_DATA,
+	CONTROL_STAGE_ACK
+};
+
+bool tusb_init(uint8_t rhport, const tusb_rhport_init_t *rh_init);
+// Handles what arrived from the host, doesn't wait
+void tud_task(void);
+// Called by the simulator when the host sent something, like TinyUSB does when
+// it queues an event
+void tud_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr);
+
+// Event ids of tud_event_hook_cb(), the ones the simulator raises
+enum {
+	DCD_EVENT_INVALID = 0,
+	DCD_EVENT_SOF = 3,
+	DCD_EVENT_XFER_COMPLETE = 7,
+};
+// While enabled, a start of frame event is sent for every millisecond of the
+// host's monotonic clock
+void tud_sof_cb_enable(bool en);
+
+bool tud_control_xfer(uint8_t rhport, const tusb_control_request_t *request,
+		      void *buffer, uint16_t len);
+
+//--------------------------------------------------------------------+
+// Vendor class
+//--------------------------------------------------------------------+
+
+uint32_t tud_vendor_n_available(uint8_t itf);
+uint32_t tud_vendor_n_read(uint8_t itf, void *buffer, uint32_t bufsize);
+void tud_vendor_n_read_flush(uint8_t itf);
+uint32_t tud_vendor_n_write_available(uint8_t itf);
+uint32_t tud_vendor_n_write(uint8_t itf, const void *buffer, uint32_t bufsize);
+uint32_t tud_vendor_n_write_flush(uint8_t itf);
+
+// Implemented by the firmware
+void tud_vendor_rx_cb(uint8_t itf, const uint8_t *buffer, uint16_t bufsize);
+bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
+				const tusb_control_request_t *request);
+
+//--------------------------------------------------------------------+
+// CDC class
+//--------------------------------------------------------------------+
+
+typedef enum {
+	CDC_LINE_CODING_STOP_BITS_1 = 0,
+	CDC_LINE_CODING_STOP_BITS_1_5 = 1,
+	CDC_LINE_CODING_STOP_BITS_2 = 2,
+} cdc_line_coding_stopbits_t;
+
+typedef enum {
+	CDC_LINE_CODING_PARITY_NONE = 0,
+	CDC_LINE_CODING_PARITY_ODD = 1,
+	CDC_LINE_CODING_PARITY_EVEN = 2,
+	CDC_LINE_CODING_PARITY_MARK = 3,
+	CDC_LINE_CODING_PARITY_SPACE = 4,
+} cdc_line_coding_parity_t;
+
+typedef struct __attribute__((packed)) {
+	uint32_t bit_rate;
+	uint8_t stop_bits;
+	uint8_t parity;
+	uint8_t data_bits;
+} cdc_line_coding_t;
+
+uint32_t tud_cdc_n_available(uint8_t itf);
+uint32_t tud_cdc_n_read(uint8_t itf, void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_n_write(uint8_t itf, const void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_n_write_flush(uint8_t itf);
+
+// Implemented by the firmware
+void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts);
+void tud_cdc_line_coding_cb(uint8_t itf,
+			     const cdc_line_coding_t *p_line_coding);
+
+#endif /* _PICOPORTS_SIM_TUSB_H_ */
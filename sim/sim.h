@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Interface between the parts of the firmware simulator
+ */
+#ifndef _PICOPORTS_SIM_H_
+#define _PICOPORTS_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Socket names in the directory given to sim_usb_open()
+#define SIM_SOCK_DLN2 "dln2" // Kernel DLN2 interface, byte stream
+#define SIM_SOCK_USER "user" // User space DLN2 interface, byte stream
+#define SIM_SOCK_CTRL "ctrl" // EP0 vendor requests, packets
+
+// A packet on the control socket is the 8 byte setup packet as on the bus,
+// followed by wLength bytes for OUT requests. The reply is one status byte,
+// followed by the data for IN requests.
+#define SIM_CTRL_OK 0
+#define SIM_CTRL_STALL 1
+
+// Maximum time __wfe() sleeps, 0 to poll without sleeping
+extern int sim_wait_ms;
+
+bool sim_usb_open(const char *dir);
+// Only removes the sockets, so it can be called from a signal handler
+void sim_usb_unlink(void);
+// Waits up to timeout_us for the host, returns whether a socket has data or a
+// new client. Sockets whose data wasn't read by the firmware yet are skipped.
+bool sim_usb_wait(uint32_t timeout_us);
+// Sends a start of frame event if a new millisecond has begun, see
+// tud_sof_cb_enable()
+void sim_usb_sof(void);
+// Device time of the next start of frame, UINT64_MAX while disabled
+uint64_t sim_usb_next_sof_us(void);
+
+// Drives a GPIO input from outside, as a wire would
+void sim_gpio_drive(unsigned int gpio, bool level);
+// Connects two GPIOs like a wire, the level of from drives the input to
+bool sim_gpio_wire(unsigned int from, unsigned int to);
+// Toggles a GPIO input with the given frequency, 0 stops
+bool sim_gpio_toggle(unsigned int gpio, uint32_t freq_hz);
+// Runs the toggles and delivers pending GPIO and UART interrupts
+void sim_hw_task(void);
+
+#endif /* _PICOPORTS_SIM_H_ */
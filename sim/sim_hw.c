@@ -0,0 +1,757 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * pico-sdk stand-ins of the firmware simulator. The peripherals are simple
+ * models, just enough for the firmware to run its request handling against:
+ * GPIOs with pulls and edge interrupts, fixed ADC values, an I2C EEPROM, SPI
+ * with MISO connected to MOSI and UARTs without a line attached.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+
+#include "bsp/board_api.h"
+#include "hardware/adc.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/spi.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hardware/uart.h"
+#include "pico/time.h"
+
+#include "sim.h"
+
+#define SIM_SYS_CLOCK_HZ 125000000
+
+//--------------------------------------------------------------------+
+// Timer
+//--------------------------------------------------------------------+
+
+static uint64_t monotonic_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t boot_us;
+
+uint64_t time_us_64(void)
+{
+	// Booted a millisecond ago on the host's clock, so the simulated USB
+	// frames (see sim_usb_sof()) start on device milliseconds as well
+	if (!boot_us)
+		boot_us = monotonic_us() / 1000 * 1000 - 1000;
+	return monotonic_us() - boot_us;
+}
+
+void busy_wait_us(uint64_t delay_us)
+{
+	uint64_t end = time_us_64() + delay_us;
+
+	while (time_us_64() < end)
+		tight_loop_contents();
+}
+
+void sleep_us(uint64_t us)
+{
+	struct timespec ts = { .tv_sec = us / 1000000,
+			       .tv_nsec = (us % 1000000) * 1000 };
+
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+		;
+}
+
+void sleep_ms(uint32_t ms)
+{
+	sleep_us((uint64_t)ms * 1000);
+}
+
+#define SIM_MAX_TIMERS 4
+
+static repeating_timer_t *timers[SIM_MAX_TIMERS];
+
+bool add_repeating_timer_us(int64_t delay_us,
+			    repeating_timer_callback_t callback,
+			    void *user_data, repeating_timer_t *out)
+{
+	for (uint i = 0; i < SIM_MAX_TIMERS; i++) {
+		if (timers[i])
+			continue;
+		out->delay_us = delay_us;
+		out->callback = callback;
+		out->user_data = user_data;
+		out->next_us = time_us_64() + (uint64_t)llabs(delay_us);
+		timers[i] = out;
+		return true;
+	}
+	return false;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer)
+{
+	for (uint i = 0; i < SIM_MAX_TIMERS; i++) {
+		if (timers[i] == timer) {
+			timers[i] = NULL;
+			return true;
+		}
+	}
+	return false;
+}
+
+// A timer that is late fires once and starts over, like the SDK's alarm pool
+// does when it misses a target.
+static void timers_task(void)
+{
+	uint64_t now = time_us_64();
+
+	for (uint i = 0; i < SIM_MAX_TIMERS; i++) {
+		repeating_timer_t *t = timers[i];
+
+		if (!t || now < t->next_us)
+			continue;
+		if (!t->callback(t)) {
+			timers[i] = NULL;
+			continue;
+		}
+		t->next_us = (t->delay_us < 0 ? t->next_us : now) +
+			     (uint64_t)llabs(t->delay_us);
+		if (t->next_us <= now)
+			t->next_us = now + (uint64_t)llabs(t->delay_us);
+	}
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index)
+{
+	(void)clk_index;
+	return SIM_SYS_CLOCK_HZ;
+}
+
+//--------------------------------------------------------------------+
+// Interrupts
+//--------------------------------------------------------------------+
+
+static uint32_t irq_enabled;
+static irq_handler_t irq_handlers[NUM_IRQS];
+
+void irq_set_enabled(uint num, bool enabled)
+{
+	if (enabled)
+		irq_enabled |= 1u << num;
+	else
+		irq_enabled &= ~(1u << num);
+}
+
+bool irq_is_enabled(uint num)
+{
+	return irq_enabled & (1u << num);
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+	irq_handlers[num] = handler;
+}
+
+// Interrupts are delivered in one go at the points below. An interrupt
+// handler that disables interrupts doesn't start another delivery.
+static uint64_t irq_point_us;
+static bool in_irq;
+static bool sev_pending;
+
+static void deliver_irqs(void)
+{
+	in_irq = true;
+	irq_point_us = time_us_64();
+	sim_hw_task();
+	timers_task();
+	sim_usb_sof();
+	if (sim_usb_wait(0))
+		tud_event_hook_cb(0, 0, true);
+	in_irq = false;
+}
+
+void sim_irq_point(void)
+{
+	if (!in_irq && time_us_64() - irq_point_us >= 1000)
+		deliver_irqs();
+}
+
+void __sev(void)
+{
+	sev_pending = true;
+}
+
+static uint64_t next_deadline_us(void);
+
+void __wfe(void)
+{
+	if (!sev_pending) {
+		uint64_t now = time_us_64();
+		uint64_t timeout = (uint64_t)sim_wait_ms * 1000;
+		uint64_t deadline = next_deadline_us();
+
+		if (deadline < now + timeout)
+			timeout = deadline > now ? deadline - now : 0;
+		sim_usb_wait((uint32_t)timeout);
+		deliver_irqs();
+	}
+	sev_pending = false;
+}
+
+//--------------------------------------------------------------------+
+// GPIO
+//--------------------------------------------------------------------+
+
+sio_hw_t sim_sio_hw;
+
+static struct {
+	bool pull_up;
+	bool pull_down;
+	bool driven;
+	bool drive_level;
+	gpio_function_t fn;
+	uint32_t irq_mask;
+	// Edges latched for the interrupt, like the INTR registers
+	uint32_t irq_events;
+	uint32_t toggle_half_period_us;
+	uint64_t toggle_next_us;
+	// GPIO number + 1 of the input this pin drives, see sim_gpio_wire()
+	uint8_t wire_to;
+} pins[NUM_BANK0_GPIOS];
+
+static gpio_irq_callback_t gpio_irq_callback;
+
+// Updates the input level after a change of the pin or its surroundings
+static void gpio_update(uint gpio)
+{
+	uint32_t bit = 1u << gpio;
+	bool level;
+
+	if (sio_hw->gpio_oe & bit)
+		level = sio_hw->gpio_out & bit;
+	else if (pins[gpio].driven)
+		level = pins[gpio].drive_level;
+	else
+		level = pins[gpio].pull_up;
+
+	bool old = sio_hw->gpio_in & bit;
+	if (level == old)
+		return;
+
+	if (level)
+		sio_hw->gpio_in |= bit;
+	else
+		sio_hw->gpio_in &= ~bit;
+	pins[gpio].irq_events |= pins[gpio].irq_mask &
+				 (level ? GPIO_IRQ_EDGE_RISE :
+					  GPIO_IRQ_EDGE_FALL);
+
+	if (pins[gpio].wire_to)
+		sim_gpio_drive(pins[gpio].wire_to - 1, level);
+}
+
+void gpio_init(uint gpio)
+{
+	sio_hw->gpio_oe &= ~(1u << gpio);
+	sio_hw->gpio_out &= ~(1u << gpio);
+	pins[gpio].fn = GPIO_FUNC_SIO;
+	gpio_update(gpio);
+}
+
+void gpio_set_function(uint gpio, gpio_function_t fn)
+{
+	pins[gpio].fn = fn;
+}
+
+void gpio_pull_up(uint gpio)
+{
+	pins[gpio].pull_up = true;
+	pins[gpio].pull_down = false;
+	gpio_update(gpio);
+}
+
+void gpio_pull_down(uint gpio)
+{
+	pins[gpio].pull_up = false;
+	pins[gpio].pull_down = true;
+	gpio_update(gpio);
+}
+
+void gpio_disable_pulls(uint gpio)
+{
+	pins[gpio].pull_up = false;
+	pins[gpio].pull_down = false;
+	gpio_update(gpio);
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+	if (out)
+		sio_hw->gpio_oe |= 1u << gpio;
+	else
+		sio_hw->gpio_oe &= ~(1u << gpio);
+	gpio_update(gpio);
+}
+
+void gpio_put(uint gpio, bool value)
+{
+	if (value)
+		sio_hw->gpio_out |= 1u << gpio;
+	else
+		sio_hw->gpio_out &= ~(1u << gpio);
+	gpio_update(gpio);
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled)
+{
+	// Stale edges are acknowledged, like the SDK does
+	pins[gpio].irq_events &= ~event_mask;
+	if (enabled)
+		pins[gpio].irq_mask |= event_mask;
+	else
+		pins[gpio].irq_mask &= ~event_mask;
+}
+
+void gpio_set_irq_callback(gpio_irq_callback_t callback)
+{
+	gpio_irq_callback = callback;
+}
+
+void sim_gpio_drive(unsigned int gpio, bool level)
+{
+	pins[gpio].driven = true;
+	pins[gpio].drive_level = level;
+	gpio_update(gpio);
+}
+
+bool sim_gpio_wire(unsigned int from, unsigned int to)
+{
+	if (from >= NUM_BANK0_GPIOS || to >= NUM_BANK0_GPIOS || from == to)
+		return false;
+
+	pins[from].wire_to = to + 1;
+	sim_gpio_drive(to, gpio_get(from));
+	return true;
+}
+
+bool sim_gpio_toggle(unsigned int gpio, uint32_t freq_hz)
+{
+	if (gpio >= NUM_BANK0_GPIOS || freq_hz > 500000)
+		return false;
+
+	pins[gpio].toggle_half_period_us = freq_hz ? 500000 / freq_hz : 0;
+	pins[gpio].toggle_next_us = time_us_64();
+	return true;
+}
+
+// The next toggle or timer, the latest time __wfe() may sleep until
+static uint64_t next_deadline_us(void)
+{
+	uint64_t deadline = UINT64_MAX;
+
+	for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+		if (pins[gpio].toggle_half_period_us)
+			deadline = TU_MIN(deadline, pins[gpio].toggle_next_us);
+	}
+	for (uint i = 0; i < SIM_MAX_TIMERS; i++) {
+		if (timers[i])
+			deadline = TU_MIN(deadline, timers[i]->next_us);
+	}
+	return TU_MIN(deadline, sim_usb_next_sof_us());
+}
+
+void sim_hw_task(void)
+{
+	uint64_t now = time_us_64();
+
+	// A toggle that is late catches up, so the edge rate stays right even
+	// if the main loop is slower than the toggle frequency.
+	for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+		if (!pins[gpio].toggle_half_period_us)
+			continue;
+		while (now >= pins[gpio].toggle_next_us) {
+			sim_gpio_drive(gpio, !gpio_get(gpio));
+			pins[gpio].toggle_next_us +=
+				pins[gpio].toggle_half_period_us;
+		}
+	}
+
+	if (irq_is_enabled(IO_IRQ_BANK0) && gpio_irq_callback) {
+		for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+			uint32_t events = pins[gpio].irq_events;
+
+			if (!events)
+				continue;
+			pins[gpio].irq_events = 0;
+			gpio_irq_callback(gpio, events);
+		}
+	}
+
+	// The TX interrupt of a UART fires while it's enabled, the TX FIFO is
+	// always empty.
+	for (uint i = 0; i < TU_ARRAY_SIZE(sim_uart_hw); i++) {
+		uint irq = i ? UART1_IRQ : UART0_IRQ;
+
+		if ((sim_uart_hw[i].imsc & UART_UARTIMSC_TXIM_BITS) &&
+		    irq_is_enabled(irq) && irq_handlers[irq])
+			irq_handlers[irq]();
+	}
+}
+
+//--------------------------------------------------------------------+
+// PWM
+//--------------------------------------------------------------------+
+
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract)
+{
+	(void)slice_num;
+	(void)integer;
+	(void)fract;
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap)
+{
+	(void)slice_num;
+	(void)wrap;
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level)
+{
+	(void)slice_num;
+	(void)chan;
+	(void)level;
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+	(void)slice_num;
+	(void)enabled;
+}
+
+//--------------------------------------------------------------------+
+// ADC
+//--------------------------------------------------------------------+
+
+// 12 bit values at 3.3 V: GP26-GP28 at 0.825, 1.65 and 2.475 V, VSYS at 5 V
+// (1/3 divider) and the temperature sensor at 27 °C (0.706 V)
+static const uint16_t adc_values[NUM_ADC_CHANNELS] = { 1024, 2048, 3072, 2068,
+						       876 };
+static uint adc_input;
+
+void adc_init(void)
+{
+}
+
+void adc_gpio_init(uint gpio)
+{
+	gpio_set_function(gpio, GPIO_FUNC_NULL);
+	gpio_disable_pulls(gpio);
+}
+
+void adc_select_input(uint input)
+{
+	adc_input = input;
+}
+
+uint16_t adc_read(void)
+{
+	return adc_input < NUM_ADC_CHANNELS ? adc_values[adc_input] : 0;
+}
+
+void adc_set_temp_sensor_enabled(bool enable)
+{
+	(void)enable;
+}
+
+//--------------------------------------------------------------------+
+// I2C
+//--------------------------------------------------------------------+
+
+i2c_inst_t sim_i2c_inst[2];
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+	memset(i2c->eeprom, 0xff, sizeof(i2c->eeprom));
+	return baudrate;
+}
+
+// The first byte sets the EEPROM address, the others are written from there
+int i2c_write_timeout_per_char_us(i2c_inst_t *i2c, uint8_t addr,
+				  const uint8_t *src, size_t len, bool nostop,
+				  uint timeout_per_char_us)
+{
+	(void)nostop;
+	(void)timeout_per_char_us;
+
+	if (addr != SIM_I2C_EEPROM_ADDR)
+		return PICO_ERROR_GENERIC;
+	for (size_t i = 0; i < len; i++) {
+		if (i == 0)
+			i2c->eeprom_addr = src[0];
+		else
+			i2c->eeprom[i2c->eeprom_addr++] = src[i];
+	}
+	return (int)len;
+}
+
+int i2c_read_timeout_per_char_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+				 size_t len, bool nostop,
+				 uint timeout_per_char_us)
+{
+	(void)nostop;
+	(void)timeout_per_char_us;
+
+	if (addr != SIM_I2C_EEPROM_ADDR)
+		return PICO_ERROR_GENERIC;
+	for (size_t i = 0; i < len; i++)
+		dst[i] = i2c->eeprom[i2c->eeprom_addr++];
+	return (int)len;
+}
+
+//--------------------------------------------------------------------+
+// UART
+//--------------------------------------------------------------------+
+
+uart_hw_t sim_uart_hw[2];
+
+uint uart_init(uart_inst_t *uart, uint baudrate)
+{
+	uart_get_hw(uart)->fr = UART_UARTFR_RXFE_BITS | UART_UARTFR_TXFE_BITS;
+	return baudrate;
+}
+
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate)
+{
+	(void)uart;
+	return baudrate;
+}
+
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits,
+		     uart_parity_t parity)
+{
+	(void)uart;
+	(void)data_bits;
+	(void)stop_bits;
+	(void)parity;
+}
+
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts)
+{
+	(void)uart;
+	(void)cts;
+	(void)rts;
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled)
+{
+	(void)uart;
+	(void)enabled;
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data,
+			  bool tx_needs_data)
+{
+	uart_hw_t *hw = uart_get_hw(uart);
+
+	hw->imsc = (rx_has_data ? UART_UARTIMSC_RXIM_BITS |
+					  UART_UARTIMSC_RTIM_BITS :
+				  0) |
+		   (tx_needs_data ? UART_UARTIMSC_TXIM_BITS : 0);
+}
+
+//--------------------------------------------------------------------+
+// SPI and DMA
+//--------------------------------------------------------------------+
+
+spi_hw_t sim_spi_hw[2];
+
+// Same dividers as the PL022: an even prescaler of 2..254 and 1..256
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate)
+{
+	uint32_t freq_in = clock_get_hz(clk_peri);
+	uint prescale, postdiv;
+
+	for (prescale = 2; prescale <= 254; prescale += 2) {
+		if (freq_in < prescale * 256 * (uint64_t)baudrate)
+			break;
+	}
+	if (prescale > 254)
+		prescale = 254;
+
+	for (postdiv = 256; postdiv > 1; --postdiv) {
+		if (freq_in / (prescale * (postdiv - 1)) > baudrate)
+			break;
+	}
+
+	spi_get_hw(spi)->cpsr = prescale;
+	return freq_in / (prescale * postdiv);
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate)
+{
+	memset(spi_get_hw(spi), 0, sizeof(spi_hw_t));
+	return spi_set_baudrate(spi, baudrate);
+}
+
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol,
+		    spi_cpha_t cpha, spi_order_t order)
+{
+	(void)order;
+	spi_get_hw(spi)->cr0 = (data_bits - 1) | (cpol << 6) | (cpha << 7);
+}
+
+static struct {
+	dma_channel_config config;
+	volatile void *write_addr;
+	const volatile void *read_addr;
+	uint count;
+} dma_channels[NUM_DMA_CHANNELS];
+static uint32_t dma_claimed;
+
+int dma_claim_unused_channel(bool required)
+{
+	for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+		if (!(dma_claimed & (1u << i))) {
+			dma_claimed |= 1u << i;
+			return i;
+		}
+	}
+	(void)required;
+	return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+	dma_channel_config c = {
+		.size = DMA_SIZE_32,
+		.read_increment = true,
+		.write_increment = false,
+		.dreq = DREQ_FORCE,
+	};
+
+	(void)channel;
+	return c;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+			   volatile void *write_addr,
+			   const volatile void *read_addr,
+			   uint transfer_count, bool trigger)
+{
+	dma_channels[channel].config = *config;
+	dma_channels[channel].write_addr = write_addr;
+	dma_channels[channel].read_addr = read_addr;
+	dma_channels[channel].count = transfer_count;
+	if (trigger)
+		dma_start_channel_mask(1u << channel);
+}
+
+static uint32_t dma_read(uint channel, uint i)
+{
+	const volatile uint8_t *addr = dma_channels[channel].read_addr;
+	enum dma_channel_transfer_size size = dma_channels[channel].config.size;
+
+	if (dma_channels[channel].config.read_increment)
+		addr += i << size;
+	switch (size) {
+	case DMA_SIZE_8:
+		return *addr;
+	case DMA_SIZE_16:
+		return *(const volatile uint16_t *)addr;
+	default:
+		return *(const volatile uint32_t *)addr;
+	}
+}
+
+static void dma_write(uint channel, uint i, uint32_t value)
+{
+	volatile uint8_t *addr = dma_channels[channel].write_addr;
+	enum dma_channel_transfer_size size = dma_channels[channel].config.size;
+
+	if (dma_channels[channel].config.write_increment)
+		addr += i << size;
+	switch (size) {
+	case DMA_SIZE_8:
+		*addr = (uint8_t)value;
+		break;
+	case DMA_SIZE_16:
+		*(volatile uint16_t *)addr = (uint16_t)value;
+		break;
+	default:
+		*(volatile uint32_t *)addr = value;
+		break;
+	}
+}
+
+static bool is_spi_tx_dreq(uint dreq)
+{
+	return dreq == spi_get_dreq(spi0, true) ||
+	       dreq == spi_get_dreq(spi1, true);
+}
+
+void dma_start_channel_mask(uint32_t chan_mask)
+{
+	for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+		uint dreq = dma_channels[ch].config.dreq;
+		uint rx = ch;
+
+		if (!(chan_mask & (1u << ch)))
+			continue;
+
+		if (is_spi_tx_dreq(dreq)) {
+			// Loop back into the RX channel of the same port
+			for (rx = 0; rx < NUM_DMA_CHANNELS; rx++) {
+				if ((chan_mask & (1u << rx)) &&
+				    dma_channels[rx].config.dreq == dreq + 1)
+					break;
+			}
+			if (rx == NUM_DMA_CHANNELS)
+				continue;
+			chan_mask &= ~(1u << rx);
+		} else if (dreq != DREQ_FORCE) {
+			// The RX channel of a SPI port without a TX channel
+			continue;
+		}
+
+		for (uint i = 0; i < dma_channels[ch].count; i++)
+			dma_write(rx, i, dma_read(ch, i));
+	}
+}
+
+//--------------------------------------------------------------------+
+// Board
+//--------------------------------------------------------------------+
+
+void board_init(void)
+{
+	time_us_64();
+	for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++)
+		pins[gpio].fn = GPIO_FUNC_NULL;
+}
+
+uint32_t board_button_read(void)
+{
+	return 0;
+}
+
+size_t board_get_unique_id(uint8_t id[], size_t max_len)
+{
+	static const uint8_t sim_id[] = { 'P', 'P', 'S', 'I', 'M', 0, 0, 1 };
+	size_t len = TU_MIN(max_len, sizeof(sim_id));
+
+	memcpy(id, sim_id, len);
+	return len;
+}
+
+xip_ctrl_hw_t sim_xip_ctrl_hw;
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Runs the firmware on the host, see "Simulator" in README.md
+ */
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tusb.h"
+
+#include "sim.h"
+
+int pp_firmware_main(void);
+
+int sim_log_level = 1;
+
+void sim_log_buf(const uint8_t *buf, uint32_t len)
+{
+	for (uint32_t i = 0; i < len; i++)
+		fprintf(stderr, "%02x%s", buf[i], i + 1 < len ? " " : "\n");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-d DIR] [-t GPIO:HZ]... [-w FROM:TO]... [-b] [-v]...\n"
+		"  -d DIR      Directory of the sockets (default /tmp/pp-sim)\n"
+		"  -t GPIO:HZ  Toggle an input with the given frequency\n"
+		"  -w FROM:TO  Connect two GPIOs, FROM drives the input TO\n"
+		"  -b          Busy poll instead of sleeping between tasks\n"
+		"  -v          More log output, repeat for more\n",
+		prog);
+}
+
+static void handle_signal(int sig)
+{
+	(void)sig;
+	sim_usb_unlink();
+	_exit(0);
+}
+
+int main(int argc, char **argv)
+{
+	const char *dir = "/tmp/pp-sim";
+	unsigned int gpio, to;
+	uint32_t hz;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:t:w:bvh")) != -1) {
+		switch (opt) {
+		case 'd':
+			dir = optarg;
+			break;
+		case 't':
+			if (sscanf(optarg, "%u:%u", &gpio, &hz) != 2 ||
+			    !sim_gpio_toggle(gpio, hz)) {
+				fprintf(stderr, "Invalid toggle: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'w':
+			if (sscanf(optarg, "%u:%u", &gpio, &to) != 2 ||
+			    !sim_gpio_wire(gpio, to)) {
+				fprintf(stderr, "Invalid wire: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'b':
+			sim_wait_ms = 0;
+			break;
+		case 'v':
+			sim_log_level++;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "Failed to create %s: %s\n", dir,
+			strerror(errno));
+		return 1;
+	}
+	if (!sim_usb_open(dir)) {
+		sim_usb_unlink();
+		return 1;
+	}
+
+	signal(SIGINT, handle_signal);
+	signal(SIGTERM, handle_signal);
+	fprintf(stderr, "pp-sim: Listening in %s\n", dir);
+
+	return pp_firmware_main();
+}
@@ -0,0 +1,417 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * TinyUSB stand-in of the firmware simulator. Each DLN2 vendor interface is a
+ * Unix stream socket carrying what its bulk endpoints would, EP0 vendor
+ * requests are packets on a third socket (see sim.h). One client per socket
+ * is served at a time. Without a client, the device behaves as if the host
+ * didn't read the IN endpoint.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tusb.h"
+
+#include "hardware/structs/usb.h"
+#include "hardware/timer.h"
+
+#include "sim.h"
+
+struct sim_socket {
+	const char *name;
+	int type;
+	int listen_fd;
+	int fd;
+	char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+};
+
+struct sim_vendor_itf {
+	struct sim_socket sock;
+
+	// Received from the host, not read by the firmware yet
+	uint8_t rx[CFG_TUD_VENDOR_RX_BUFSIZE];
+	uint32_t rx_len;
+	uint32_t rx_pos;
+
+	// Written by the firmware, sent on flush
+	uint8_t tx[CFG_TUD_VENDOR_TX_BUFSIZE];
+	uint32_t tx_len;
+};
+
+static struct sim_vendor_itf vendor_itfs[PP_NUM_DLN2_ITFS] = {
+	[PP_VENDOR_ITF_DLN2] = { .sock = { .name = SIM_SOCK_DLN2,
+					   .type = SOCK_STREAM } },
+	[PP_VENDOR_ITF_USER] = { .sock = { .name = SIM_SOCK_USER,
+					   .type = SOCK_STREAM } },
+};
+
+static struct sim_socket ctrl_sock = { .name = SIM_SOCK_CTRL,
+				       .type = SOCK_SEQPACKET };
+
+int sim_wait_ms = 1;
+
+static bool sock_open(struct sim_socket *s, const char *dir)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/%s", dir,
+			   s->name);
+
+	s->fd = -1;
+	if (len < 0 || (size_t)len >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s/%s\n", dir, s->name);
+		return false;
+	}
+
+	s->listen_fd = socket(AF_UNIX, s->type | SOCK_CLOEXEC, 0);
+	if (s->listen_fd < 0) {
+		perror("socket");
+		return false;
+	}
+
+	unlink(addr.sun_path);
+	if (bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(s->listen_fd, 1) < 0) {
+		fprintf(stderr, "Failed to listen on %s: %s\n", addr.sun_path,
+			strerror(errno));
+		close(s->listen_fd);
+		s->listen_fd = -1;
+		return false;
+	}
+	memcpy(s->path, addr.sun_path, sizeof(s->path));
+	return true;
+}
+
+static void sock_accept(struct sim_socket *s)
+{
+	s->fd = accept4(s->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (s->fd >= 0)
+		TU_LOG1("sim: Host connected to %s\r\n", s->name);
+}
+
+static void sock_disconnect(struct sim_socket *s)
+{
+	close(s->fd);
+	s->fd = -1;
+	TU_LOG1("sim: Host disconnected from %s\r\n", s->name);
+}
+
+bool sim_usb_open(const char *dir)
+{
+	for (size_t i = 0; i < TU_ARRAY_SIZE(vendor_itfs); i++) {
+		TU_VERIFY(sock_open(&vendor_itfs[i].sock, dir));
+	}
+	return sock_open(&ctrl_sock, dir);
+}
+
+void sim_usb_unlink(void)
+{
+	for (size_t i = 0; i < TU_ARRAY_SIZE(vendor_itfs); i++) {
+		if (vendor_itfs[i].sock.path[0])
+			unlink(vendor_itfs[i].sock.path);
+	}
+	if (ctrl_sock.path[0])
+		unlink(ctrl_sock.path);
+}
+
+//--------------------------------------------------------------------+
+// Device stack
+//--------------------------------------------------------------------+
+
+bool tusb_init(uint8_t rhport, const tusb_rhport_init_t *rh_init)
+{
+	(void)rhport;
+	(void)rh_init;
+	return true;
+}
+
+usb_hw_t sim_usb_hw;
+
+static bool sof_enabled;
+static uint64_t sof_ms;
+
+void tud_sof_cb_enable(bool en)
+{
+	sof_enabled = en;
+}
+
+// The frames are the milliseconds of the host's monotonic clock. They are
+// delivered with the other interrupts, so the device timestamps them late by
+// the time the host takes to wake the simulator, or up to a millisecond while
+// the main loop is busy. Missed frames are skipped, as TinyUSB drops events
+// when its queue is full.
+void sim_usb_sof(void)
+{
+	struct timespec ts;
+
+	if (!sof_enabled)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t ms = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+	if (ms == sof_ms)
+		return;
+
+	sof_ms = ms;
+	sim_usb_hw.sof_rd = ms & USB_SOF_RD_BITS;
+	tud_event_hook_cb(0, DCD_EVENT_SOF, true);
+}
+
+uint64_t sim_usb_next_sof_us(void)
+{
+	if (!sof_enabled)
+		return UINT64_MAX;
+	return (time_us_64() / 1000 + 1) * 1000;
+}
+
+// Data stage of the current control request, see tud_control_xfer()
+static uint8_t *ctrl_buf;
+static uint16_t ctrl_len;
+static bool ctrl_xfer;
+
+bool tud_control_xfer(uint8_t rhport, const tusb_control_request_t *request,
+		      void *buffer, uint16_t len)
+{
+	(void)rhport;
+	(void)request;
+	ctrl_buf = buffer;
+	ctrl_len = len;
+	ctrl_xfer = true;
+	return true;
+}
+
+// Runs a request through the same stages as TinyUSB does for a vendor request
+static bool handle_control(const uint8_t *pkt, ssize_t len, uint8_t *reply,
+			   uint16_t *reply_len)
+{
+	tusb_control_request_t request;
+
+	*reply_len = 0;
+	TU_VERIFY(len >= (ssize_t)sizeof(request));
+	memcpy(&request, pkt, sizeof(request));
+	// Descriptors and the other standard requests aren't simulated
+	TU_VERIFY(request.bmRequestType_bit.type == TUSB_REQ_TYPE_VENDOR);
+
+	bool dir_in = request.bmRequestType_bit.direction == TUSB_DIR_IN;
+	const uint8_t *data = &pkt[sizeof(request)];
+	ssize_t data_len = len - (ssize_t)sizeof(request);
+	TU_VERIFY(data_len == (dir_in ? 0 : request.wLength));
+
+	ctrl_xfer = false;
+	TU_VERIFY(tud_vendor_control_xfer_cb(0, CONTROL_STAGE_SETUP, &request));
+	TU_VERIFY(ctrl_xfer);
+
+	if (request.wLength > 0) {
+		if (dir_in) {
+			*reply_len = TU_MIN(ctrl_len, request.wLength);
+			memcpy(reply, ctrl_buf, *reply_len);
+		} else {
+			TU_VERIFY(ctrl_len == request.wLength);
+			memcpy(ctrl_buf, data, ctrl_len);
+		}
+		TU_VERIFY(tud_vendor_control_xfer_cb(0, CONTROL_STAGE_DATA,
+						     &request));
+	}
+
+	return tud_vendor_control_xfer_cb(0, CONTROL_STAGE_ACK, &request);
+}
+
+static void ctrl_task(void)
+{
+	uint8_t pkt[sizeof(tusb_control_request_t) + UINT16_MAX];
+	uint8_t reply[1 + UINT16_MAX];
+	uint16_t reply_len;
+
+	ssize_t n = recv(ctrl_sock.fd, pkt, sizeof(pkt), MSG_DONTWAIT);
+	if (n <= 0) {
+		if (n == 0 || (errno != EAGAIN && errno != EINTR))
+			sock_disconnect(&ctrl_sock);
+		return;
+	}
+
+	bool ok = handle_control(pkt, n, &reply[1], &reply_len);
+	reply[0] = ok ? SIM_CTRL_OK : SIM_CTRL_STALL;
+	if (!ok)
+		reply_len = 0;
+	if (send(ctrl_sock.fd, reply, 1 + reply_len, MSG_NOSIGNAL) < 0)
+		sock_disconnect(&ctrl_sock);
+}
+
+static void vendor_task(uint8_t itf)
+{
+	struct sim_vendor_itf *v = &vendor_itfs[itf];
+
+	if (v->rx_pos == v->rx_len) {
+		ssize_t n = recv(v->sock.fd, v->rx, sizeof(v->rx),
+				 MSG_DONTWAIT);
+		if (n <= 0) {
+			if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+				sock_disconnect(&v->sock);
+				v->tx_len = 0;
+			}
+			return;
+		}
+		v->rx_len = (uint32_t)n;
+		v->rx_pos = 0;
+	}
+
+	tud_vendor_rx_cb(itf, &v->rx[v->rx_pos], v->rx_len - v->rx_pos);
+}
+
+bool sim_usb_wait(uint32_t timeout_us)
+{
+	struct timespec ts = { .tv_sec = timeout_us / 1000000,
+			       .tv_nsec = (timeout_us % 1000000) * 1000 };
+	struct pollfd fds[PP_NUM_DLN2_ITFS + 1];
+	int n = 0;
+
+	for (size_t i = 0; i < TU_ARRAY_SIZE(vendor_itfs); i++) {
+		struct sim_vendor_itf *v = &vendor_itfs[i];
+
+		// Retried by tud_task() once the firmware has room
+		if (v->sock.fd >= 0 && v->rx_pos != v->rx_len)
+			continue;
+		fds[n].fd = v->sock.fd >= 0 ? v->sock.fd : v->sock.listen_fd;
+		fds[n++].events = POLLIN;
+	}
+	fds[n].fd = ctrl_sock.fd >= 0 ? ctrl_sock.fd : ctrl_sock.listen_fd;
+	fds[n++].events = POLLIN;
+
+	return ppoll(fds, n, &ts, NULL) > 0;
+}
+
+void tud_task(void)
+{
+	struct pollfd fds[PP_NUM_DLN2_ITFS + 1];
+	struct sim_socket *socks[PP_NUM_DLN2_ITFS + 1];
+	int n = 0;
+
+	for (size_t i = 0; i < TU_ARRAY_SIZE(vendor_itfs); i++)
+		socks[n++] = &vendor_itfs[i].sock;
+	socks[n++] = &ctrl_sock;
+
+	for (int i = 0; i < n; i++) {
+		fds[i].fd = socks[i]->fd >= 0 ? socks[i]->fd :
+						socks[i]->listen_fd;
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+	}
+
+	if (poll(fds, n, 0) <= 0)
+		return;
+
+	for (int i = 0; i < n; i++) {
+		if (!fds[i].revents)
+			continue;
+		if (socks[i]->fd < 0)
+			sock_accept(socks[i]);
+		else if (socks[i] == &ctrl_sock)
+			ctrl_task();
+		else
+			vendor_task(i);
+	}
+}
+
+//--------------------------------------------------------------------+
+// Vendor class
+//--------------------------------------------------------------------+
+
+uint32_t tud_vendor_n_available(uint8_t itf)
+{
+	TU_VERIFY(itf < PP_NUM_DLN2_ITFS, 0);
+	return vendor_itfs[itf].rx_len - vendor_itfs[itf].rx_pos;
+}
+
+uint32_t tud_vendor_n_read(uint8_t itf, void *buffer, uint32_t bufsize)
+{
+	TU_VERIFY(itf < PP_NUM_DLN2_ITFS, 0);
+	struct sim_vendor_itf *v = &vendor_itfs[itf];
+	uint32_t n = TU_MIN(bufsize, v->rx_len - v->rx_pos);
+
+	memcpy(buffer, &v->rx[v->rx_pos], n);
+	v->rx_pos += n;
+	return n;
+}
+
+void tud_vendor_n_read_flush(uint8_t itf)
+{
+	TU_VERIFY(itf < PP_NUM_DLN2_ITFS, );
+	vendor_itfs[itf].rx_pos = vendor_itfs[itf].rx_len;
+}
+
+uint32_t tud_vendor_n_write_available(uint8_t itf)
+{
+	TU_VERIFY(itf < PP_NUM_DLN2_ITFS, 0);
+	struct sim_vendor_itf *v = &vendor_itfs[itf];
+
+	return v->sock.fd >= 0 ? sizeof(v->tx) - v->tx_len : 0;
+}
+
+uint32_t tud_vendor_n_write(uint8_t itf, const void *buffer, uint32_t bufsize)
+{
+	TU_VERIFY(itf < PP_NUM_DLN2_ITFS, 0);
+	struct sim_vendor_itf *v = &vendor_itfs[itf];
+	uint32_t n = TU_MIN(bufsize, tud_vendor_n_write_available(itf));
+
+	memcpy(&v->tx[v->tx_len], buffer, n);
+	v->tx_len += n;
+	return n;
+}
+
+uint32_t tud_vendor_n_write_flush(uint8_t itf)
+{
+	TU_VERIFY(itf < PP_NUM_DLN2_ITFS, 0);
+	struct sim_vendor_itf *v = &vendor_itfs[itf];
+	uint32_t n = v->tx_len;
+
+	if (!n)
+		return 0;
+	v->tx_len = 0;
+	// Blocks like a host that is slow to read, the socket buffer holds
+	// many messages.
+	if (send(v->sock.fd, v->tx, n, MSG_NOSIGNAL) != (ssize_t)n) {
+		sock_disconnect(&v->sock);
+		return 0;
+	}
+	// The transfer completes right away. Like the DCD, signal it, so the
+	// main loop sends the next queued message without waiting for a tick.
+	tud_event_hook_cb(0, DCD_EVENT_XFER_COMPLETE, true);
+	return n;
+}
+
+//--------------------------------------------------------------------+
+// CDC class, no host attached
+//--------------------------------------------------------------------+
+
+uint32_t tud_cdc_n_available(uint8_t itf)
+{
+	(void)itf;
+	return 0;
+}
+
+uint32_t tud_cdc_n_read(uint8_t itf, void *buffer, uint32_t bufsize)
+{
+	(void)itf;
+	(void)buffer;
+	(void)bufsize;
+	return 0;
+}
+
+uint32_t tud_cdc_n_write(uint8_t itf, const void *buffer, uint32_t bufsize)
+{
+	(void)itf;
+	(void)buffer;
+	return bufsize;
+}
+
+uint32_t tud_cdc_n_write_flush(uint8_t itf)
+{
+	(void)itf;
+	return 0;
+}
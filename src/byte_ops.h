@@ -29,4 +29,15 @@ static inline void u32_to_buf_le(uint8_t *buf, uint32_t value)
 	buf[3] = (uint8_t)(value >> 24);
 }
 
+static inline uint64_t u64_from_buf_le(const uint8_t *buf)
+{
+	return (uint64_t)u32_from_buf_le(&buf[4]) << 32 | u32_from_buf_le(buf);
+}
+
+static inline void u64_to_buf_le(uint8_t *buf, uint64_t value)
+{
+	u32_to_buf_le(&buf[0], (uint32_t)value);
+	u32_to_buf_le(&buf[4], (uint32_t)(value >> 32));
+}
+
 #endif /* _PICOPORTS_BYTE_OPS_H_ */
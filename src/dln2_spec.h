@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_DLN2_SPEC_H_
+#define _PICOPORTS_DLN2_SPEC_H_
+
+// The DLN2 commands of each handle with the length of their request data.
+// Dispatch and length checks (main.c), log and trace names (dln2_str.h) and
+// the host tools' request checks are generated from these lists, so a new
+// command is added here and handled in its module. This header is shared
+// with the host tools in tools/.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dln2.h"
+#include "pp_vendor.h"
+
+// Commands PicoPorts doesn't implement and events only have a name, their
+// requests are passed on to the module, which fails them.
+#define DLN2_LEN_ANY UINT16_MAX
+
+// X(cmd, name, min_len, max_len)
+// clang-format off
+#define DLN2_CTRL_COMMANDS(X) \
+	X(CMD_GET_DEVICE_VER, GET_DEVICE_VER, 0, 0) \
+	X(CMD_GET_DEVICE_SN, GET_DEVICE_SN, 0, 0) \
+	X(PP_CMD_GET_TIME, GET_TIME, 0, 0)
+
+#define DLN2_GPIO_COMMANDS(X) \
+	X(DLN2_GPIO_GET_PIN_COUNT, GET_PIN_COUNT, 0, 0) \
+	X(DLN2_GPIO_SET_DEBOUNCE, SET_DEBOUNCE, 0, DLN2_LEN_ANY) \
+	X(DLN2_GPIO_GET_DEBOUNCE, GET_DEBOUNCE, 0, DLN2_LEN_ANY) \
+	X(DLN2_GPIO_PORT_GET_VAL, PORT_GET_VAL, 0, DLN2_LEN_ANY) \
+	X(DLN2_GPIO_PIN_GET_VAL, PIN_GET_VAL, 2, 2) \
+	X(DLN2_GPIO_PIN_SET_OUT_VAL, PIN_SET_OUT_VAL, 3, 3) \
+	X(DLN2_GPIO_PIN_GET_OUT_VAL, PIN_GET_OUT_VAL, 0, DLN2_LEN_ANY) \
+	X(DLN2_GPIO_CONDITION_MET_EV, CONDITION_MET_EV, 0, DLN2_LEN_ANY) \
+	X(DLN2_GPIO_PIN_ENABLE, PIN_ENABLE, 2, 2) \
+	X(DLN2_GPIO_PIN_DISABLE, PIN_DISABLE, 2, 2) \
+	X(DLN2_GPIO_PIN_SET_DIRECTION, PIN_SET_DIRECTION, 3, 3) \
+	X(DLN2_GPIO_PIN_GET_DIRECTION, PIN_GET_DIRECTION, 2, 2) \
+	/* u16 pin, u8 type, u16 period (ignored) */ \
+	X(DLN2_GPIO_PIN_SET_EVENT_CFG, PIN_SET_EVENT_CFG, 3, 5) \
+	X(DLN2_GPIO_PIN_GET_EVENT_CFG, PIN_GET_EVENT_CFG, 0, DLN2_LEN_ANY)
+
+#define DLN2_I2C_COMMANDS(X) \
+	X(DLN2_I2C_GET_PORT_COUNT, GET_PORT_COUNT, 0, DLN2_LEN_ANY) \
+	X(DLN2_I2C_ENABLE, ENABLE, 1, 1) \
+	X(DLN2_I2C_DISABLE, DISABLE, 1, 1) \
+	X(DLN2_I2C_IS_ENABLED, IS_ENABLED, 0, DLN2_LEN_ANY) \
+	X(DLN2_I2C_WRITE, WRITE, 9, 9 + DLN2_I2C_MAX_XFER_SIZE) \
+	X(DLN2_I2C_READ, READ, 9, 9) \
+	X(DLN2_I2C_SCAN_DEVICES, SCAN_DEVICES, 0, DLN2_LEN_ANY) \
+	X(DLN2_I2C_PULLUP_ENABLE, PULLUP_ENABLE, 0, DLN2_LEN_ANY) \
+	X(DLN2_I2C_PULLUP_DISABLE, PULLUP_DISABLE, 0, DLN2_LEN_ANY) \
+	X(DLN2_I2C_PULLUP_IS_ENABLED, PULLUP_IS_ENABLED, 0, DLN2_LEN_ANY) \
+	X(DLN2_I2C_TRANSFER, TRANSFER, 0, DLN2_LEN_ANY) \
+	X(DLN2_I2C_SET_MAX_REPLY_COUNT, SET_MAX_REPLY_COUNT, 0, DLN2_LEN_ANY) \
+	X(DLN2_I2C_GET_MAX_REPLY_COUNT, GET_MAX_REPLY_COUNT, 0, DLN2_LEN_ANY)
+
+#define DLN2_SPI_COMMANDS(X) \
+	X(DLN2_SPI_GET_PORT_COUNT, GET_PORT_COUNT, 0, 1) \
+	X(DLN2_SPI_ENABLE, ENABLE, 1, 1) \
+	/* u8 port, u8 wait_for_completion */ \
+	X(DLN2_SPI_DISABLE, DISABLE, 1, 2) \
+	X(DLN2_SPI_IS_ENABLED, IS_ENABLED, 1, 1) \
+	X(DLN2_SPI_SET_MODE, SET_MODE, 2, 2) \
+	X(DLN2_SPI_GET_MODE, GET_MODE, 1, 1) \
+	X(DLN2_SPI_SET_FRAME_SIZE, SET_FRAME_SIZE, 2, 2) \
+	X(DLN2_SPI_GET_FRAME_SIZE, GET_FRAME_SIZE, 1, 1) \
+	X(DLN2_SPI_SET_FREQUENCY, SET_FREQUENCY, 5, 5) \
+	X(DLN2_SPI_GET_FREQUENCY, GET_FREQUENCY, 1, 1) \
+	/* u8 port, u16 size, u8 attr, u8 buf[size] */ \
+	X(DLN2_SPI_READ_WRITE, READ_WRITE, 4, 4 + DLN2_SPI_MAX_XFER_SIZE) \
+	X(DLN2_SPI_READ, READ, 4, 4) \
+	X(DLN2_SPI_WRITE, WRITE, 4, 4 + DLN2_SPI_MAX_XFER_SIZE) \
+	X(DLN2_SPI_SET_SS, SET_SS, 2, 2) \
+	X(DLN2_SPI_GET_SS, GET_SS, 1, 1) \
+	X(DLN2_SPI_RELEASE_SS, RELEASE_SS, 1, 1) \
+	X(DLN2_SPI_SS_MULTI_ENABLE, SS_MULTI_ENABLE, 2, 2) \
+	X(DLN2_SPI_SS_MULTI_DISABLE, SS_MULTI_DISABLE, 2, 2) \
+	X(DLN2_SPI_SS_MULTI_IS_ENABLED, SS_MULTI_IS_ENABLED, 1, 1) \
+	X(DLN2_SPI_GET_SUPPORTED_FRAME_SIZES, GET_SUPPORTED_FRAME_SIZES, 1, 1) \
+	X(DLN2_SPI_GET_SS_COUNT, GET_SS_COUNT, 1, 1) \
+	X(DLN2_SPI_GET_MIN_FREQUENCY, GET_MIN_FREQUENCY, 1, 1) \
+	X(DLN2_SPI_GET_MAX_FREQUENCY, GET_MAX_FREQUENCY, 1, 1)
+
+#define DLN2_ADC_COMMANDS(X) \
+	X(DLN2_ADC_GET_CHANNEL_COUNT, GET_CHANNEL_COUNT, 1, 1) \
+	X(DLN2_ADC_ENABLE, ENABLE, 1, 1) \
+	X(DLN2_ADC_DISABLE, DISABLE, 1, 1) \
+	X(DLN2_ADC_CHANNEL_ENABLE, CHANNEL_ENABLE, 2, 2) \
+	X(DLN2_ADC_CHANNEL_DISABLE, CHANNEL_DISABLE, 2, 2) \
+	X(DLN2_ADC_SET_RESOLUTION, SET_RESOLUTION, 2, 2) \
+	X(DLN2_ADC_CHANNEL_GET_VAL, CHANNEL_GET_VAL, 2, 2) \
+	X(DLN2_ADC_CHANNEL_GET_ALL_VAL, CHANNEL_GET_ALL_VAL, 0, DLN2_LEN_ANY) \
+	X(DLN2_ADC_CHANNEL_SET_CFG, CHANNEL_SET_CFG, 0, DLN2_LEN_ANY) \
+	X(DLN2_ADC_CHANNEL_GET_CFG, CHANNEL_GET_CFG, 0, DLN2_LEN_ANY) \
+	X(DLN2_ADC_CONDITION_MET_EV, CONDITION_MET_EV, 0, DLN2_LEN_ANY)
+
+// The handles taking requests. The module id is the upper byte of their
+// commands.
+// X(NAME, name, module_id, commands), the handle is DLN2_HANDLE_<NAME> and
+// the firmware's request handler pp_<name>_handle_request()
+#define DLN2_HANDLE_SPECS(X) \
+	X(CTRL, ctrl, DLN2_GENERIC_MODULE_ID, DLN2_CTRL_COMMANDS) \
+	X(GPIO, gpio, DLN2_GPIO_ID, DLN2_GPIO_COMMANDS) \
+	X(I2C, i2c, DLN2_I2C_MODULE_ID, DLN2_I2C_COMMANDS) \
+	X(SPI, spi, DLN2_SPI_MODULE_ID, DLN2_SPI_COMMANDS) \
+	X(ADC, adc, DLN2_ADC_ID, DLN2_ADC_COMMANDS)
+// clang-format on
+
+struct dln2_cmd_spec {
+	const char *name;
+	uint16_t min_len;
+	uint16_t max_len;
+};
+
+struct dln2_handle_spec {
+	uint8_t module_id;
+	uint8_t num_cmds;
+	// Indexed by the lower byte of the command, unused entries have no name
+	const struct dln2_cmd_spec *cmds;
+};
+
+// The firmware's tables are on the request path, see PP_HOT_DATA
+#ifdef PP_RAM_HOT_PATHS
+#include "pico.h"
+#define DLN2_SPEC_DATA __not_in_flash("pp_hot_data")
+#else
+#define DLN2_SPEC_DATA
+#endif
+
+#define DLN2_SPEC_CMD(cmd, name, min_len, max_len) \
+	[(cmd) & 0xff] = { #name, min_len, max_len },
+#define DLN2_SPEC_CMDS(NAME, name, module_id, commands) \
+	static const struct dln2_cmd_spec name##_cmds[] DLN2_SPEC_DATA = { \
+		commands(DLN2_SPEC_CMD)                                    \
+	};
+#define DLN2_SPEC_HANDLE(NAME, name, module_id, commands)                 \
+	[DLN2_HANDLE_##NAME] = { module_id,                                \
+				 sizeof(name##_cmds) / sizeof(name##_cmds[0]), \
+				 name##_cmds },
+
+// Returns the handle's table, NULL for handles without requests
+static inline const struct dln2_handle_spec *
+dln2_handle_spec(uint16_t handle)
+{
+	DLN2_HANDLE_SPECS(DLN2_SPEC_CMDS)
+	static const struct dln2_handle_spec handles[DLN2_HANDLES]
+		DLN2_SPEC_DATA = { DLN2_HANDLE_SPECS(DLN2_SPEC_HANDLE) };
+
+	if (handle >= DLN2_HANDLES || !handles[handle].cmds)
+		return NULL;
+	return &handles[handle];
+}
+
+// Returns the spec of a command of the handle, NULL if it has no such command
+static inline const struct dln2_cmd_spec *dln2_cmd_spec(uint16_t handle,
+							uint16_t cmd)
+{
+	const struct dln2_handle_spec *h = dln2_handle_spec(handle);
+
+	if (!h || cmd >> 8 != h->module_id || (cmd & 0xff) >= h->num_cmds ||
+	    !h->cmds[cmd & 0xff].name)
+		return NULL;
+	return &h->cmds[cmd & 0xff];
+}
+
+// Whether the firmware would pass a request on to the handle's module
+static inline bool dln2_request_valid(uint16_t handle, uint16_t cmd,
+				      uint16_t len)
+{
+	const struct dln2_cmd_spec *spec = dln2_cmd_spec(handle, cmd);
+
+	return spec && len >= spec->min_len && len <= spec->max_len;
+}
+
+#endif /* _PICOPORTS_DLN2_SPEC_H_ */
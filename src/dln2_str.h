@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_DLN2_STR_H_
+#define _PICOPORTS_DLN2_STR_H_
+
+// Names of the DLN2 handles and commands for log messages, from the tables in
+// dln2_spec.h. This header is shared with the host tools in tools/, which
+// decode traces with it.
+
+#include <stdint.h>
+
+#include "dln2.h"
+#include "dln2_spec.h"
+
+static inline const char *handle2str(uint16_t handle)
+{
+#define DLN2_STR_HANDLE(NAME, name, module_id, commands) \
+	case DLN2_HANDLE_##NAME:                          \
+		return #NAME;
+
+	switch (handle) {
+	case DLN2_HANDLE_EVENT:
+		return "EVENT";
+	DLN2_HANDLE_SPECS(DLN2_STR_HANDLE)
+	default:
+		return "???";
+	}
+#undef DLN2_STR_HANDLE
+}
+
+// The module id in the upper byte makes the commands unique across handles
+static inline const char *cmd2str(uint16_t cmd)
+{
+	for (uint16_t handle = 0; handle < DLN2_HANDLES; handle++) {
+		const struct dln2_handle_spec *h = dln2_handle_spec(handle);
+
+		if (h && h->module_id == cmd >> 8) {
+			const struct dln2_cmd_spec *spec =
+				dln2_cmd_spec(handle, cmd);
+
+			return spec ? spec->name : "???";
+		}
+	}
+	return "???";
+}
+
+#endif /* _PICOPORTS_DLN2_STR_H_ */
@@ -6,13 +6,30 @@
 
 #include "bsp/board_api.h"
 
+#include "hardware/timer.h"
+
 #include "byte_ops.h"
 #include "dln2.h"
+#include "dln2_spec.h"
+#include "dln2_str.h"
 #include "pp_adc.h"
+#include "pp_clock.h"
+#include "pp_counter.h"
 #include "pp_ctrl.h"
 #include "pp_gpio.h"
 #include "pp_i2c.h"
+#include "pp_la.h"
+#include "pp_platform.h"
+#include "pp_quad.h"
+#include "pp_sched.h"
+#include "pp_script.h"
+#include "pp_seq.h"
+#include "pp_spi.h"
+#include "pp_state.h"
+#include "pp_stats.h"
+#include "pp_trace.h"
 #include "pp_uart.h"
+#include "pp_vendor.h"
 
 static void send_delayed_messages(void);
 
@@ -31,74 +48,217 @@ int main(void)
 	pp_gpio_init();
 	pp_adc_init();
 	pp_i2c_init();
+	pp_spi_init();
 	pp_uart_init();
+	pp_la_init();
+	pp_quad_init();
+	pp_seq_init();
+	pp_sched_init();
 
 	while (1) {
-		tud_task();
-		pp_gpio_task();
-		pp_uart_task();
+		uint32_t events = pp_sched_wait();
+		// Without the sleep, for the longest pass
+		uint32_t start_us = time_us_32();
+		bool tick = events & PP_SCHED_TICK;
+
+		// TinyUSB events are processed with the tick as well, which
+		// doesn't cost anything on the device and lets the simulator
+		// poll its sockets while tasks are busy.
+		if (tick || (events & PP_SCHED_USB))
+			tud_task();
+		// Transfers free TX slots for pending GPIO events
+		if (events & (PP_SCHED_GPIO | PP_SCHED_USB | PP_SCHED_TICK))
+			pp_gpio_task();
+		if (events & (PP_SCHED_UART | PP_SCHED_USB | PP_SCHED_TICK))
+			pp_uart_task();
+		if (tick || (events & PP_SCHED_USB))
+			pp_la_task();
+		if (tick) {
+			pp_seq_task();
+			pp_counter_task();
+			pp_quad_task();
+			pp_state_task();
+		}
+		if (events & (PP_SCHED_BUSY | PP_SCHED_TICK))
+			pp_script_task();
 		send_delayed_messages();
+		pp_stats_task(start_us);
 	}
 }
 
-bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
-				const tusb_control_request_t *request)
+// Called by TinyUSB whenever it queues an event, mostly from the USB
+// interrupt. SOF events are only queued once pp_clock.c enabled them.
+void PP_HOT_FUNC(tud_event_hook_cb)(uint8_t rhport, uint32_t eventid,
+				     bool in_isr)
 {
 	(void)rhport;
-	(void)stage;
-	(void)request;
+	if (eventid == DCD_EVENT_SOF && in_isr)
+		pp_clock_sof();
+	pp_sched_wake(PP_SCHED_USB);
+}
 
-	/* Is this called at some point? */
-	TU_LOG1("==> tud_vendor_control_xfer_cb %u %u: ", rhport, stage);
-	TU_LOG1_BUF((const uint8_t *)request, sizeof(request));
+static bool handle_control_request(const tusb_control_request_t *request,
+				   const uint8_t *data_in, uint16_t data_in_len,
+				   uint8_t *data_out, uint16_t *data_out_len)
+{
+	TU_LOG3("main: Vendor request 0x%02x (wValue=%u, wIndex=%u, "
+		"wLength=%u)\r\n",
+		request->bRequest, request->wValue, request->wIndex,
+		request->wLength);
+
+	switch (request->bRequest & PP_VREQ_MODULE_MASK) {
+	case PP_VREQ_MODULE_UART:
+		return pp_uart_handle_control_request(request, data_in,
+						      data_in_len, data_out,
+						      data_out_len);
+
+	case PP_VREQ_MODULE_LA:
+		return pp_la_handle_control_request(request, data_in,
+						    data_in_len, data_out,
+						    data_out_len);
+
+	case PP_VREQ_MODULE_SEQ:
+		return pp_seq_handle_control_request(request, data_in,
+						     data_in_len, data_out,
+						     data_out_len);
+
+	case PP_VREQ_MODULE_COUNTER:
+		return pp_counter_handle_control_request(request, data_in,
+							 data_in_len, data_out,
+							 data_out_len);
+
+	case PP_VREQ_MODULE_QUAD:
+		return pp_quad_handle_control_request(request, data_in,
+						      data_in_len, data_out,
+						      data_out_len);
+
+	case PP_VREQ_MODULE_SCRIPT:
+		return pp_script_handle_control_request(request, data_in,
+							data_in_len, data_out,
+							data_out_len);
+
+	case PP_VREQ_MODULE_STATE:
+		return pp_state_handle_control_request(request, data_in,
+						       data_in_len, data_out,
+						       data_out_len);
+
+	case PP_VREQ_MODULE_STATS:
+		return pp_stats_handle_control_request(request, data_in,
+						       data_in_len, data_out,
+						       data_out_len);
+
+	case PP_VREQ_MODULE_TRACE:
+		return pp_trace_handle_control_request(request, data_in,
+						       data_in_len, data_out,
+						       data_out_len);
+
+	case PP_VREQ_MODULE_GPIO:
+		return pp_gpio_handle_control_request(request, data_in,
+						      data_in_len, data_out,
+						      data_out_len);
 
-	return false; /* stall */
+	default:
+		TU_LOG1("main: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
 }
 
-TU_ATTR_UNUSED static const char *handle2str(uint16_t handle)
+// Vendor requests on EP0 (see pp_vendor.h). Requests with data from the host
+// are handled once the data stage is complete, all others in the setup stage.
+// Returning false stalls the request.
+bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
+				const tusb_control_request_t *request)
 {
-	// clang-format off
-	switch (handle) {
-	case DLN2_HANDLE_EVENT: return "EVENT";
-	case DLN2_HANDLE_CTRL: return "CTRL";
-	case DLN2_HANDLE_GPIO: return "GPIO";
-	case DLN2_HANDLE_I2C: return "I2C";
-	case DLN2_HANDLE_SPI: return "SPI";
-	case DLN2_HANDLE_ADC: return "ADC";
-	default: return "???";
+	static uint8_t ctrl_buf[PP_VREQ_MAX_DATA_LEN];
+	bool dir_in = request->bmRequestType_bit.direction == TUSB_DIR_IN;
+	uint16_t len;
+
+	TU_VERIFY(request->bmRequestType_bit.type == TUSB_REQ_TYPE_VENDOR);
+
+	switch (stage) {
+	case CONTROL_STAGE_SETUP:
+		TU_VERIFY(request->wLength <= sizeof(ctrl_buf));
+		if (!dir_in && request->wLength > 0)
+			return tud_control_xfer(rhport, request, ctrl_buf,
+						request->wLength);
+
+		len = dir_in ? request->wLength : 0;
+		TU_VERIFY(handle_control_request(request, NULL, 0, ctrl_buf,
+						 &len));
+		// A zero length OUT transfer only sends the status stage
+		return tud_control_xfer(rhport, request, ctrl_buf, len);
+
+	case CONTROL_STAGE_DATA:
+		if (dir_in)
+			return true;
+
+		len = 0;
+		return handle_control_request(request, ctrl_buf,
+					      request->wLength, NULL, &len);
+
+	default:
+		return true;
 	}
-	// clang-format on
 }
 
+// The kernel driver only binds the first DLN2 interface, the second one is for
+// user space tools using libusb. Both speak the same protocol.
 #define MAX_NUM_BUF_MSGS 16
+#define MAX_NUM_USER_BUF_MSGS 8
+
+// Each interface has its own queue, so responses for a user space tool that
+// isn't reading don't block the kernel driver.
+struct message_queue {
+	uint8_t *buf;
+	size_t size;
+	size_t r_id;
+	size_t w_id;
+	// Messages dropped because the queue was full
+	uint32_t dropped;
+	// Most messages queued at once
+	uint16_t max_used;
+	// Most bytes waiting in the RX FIFO of the interface
+	uint16_t rx_max_bytes;
+};
+
 static uint8_t message_buffer[MAX_NUM_BUF_MSGS * CFG_TUD_VENDOR_TX_BUFSIZE];
-static size_t r_id;
-static size_t w_id;
+static uint8_t
+	user_message_buffer[MAX_NUM_USER_BUF_MSGS * CFG_TUD_VENDOR_TX_BUFSIZE];
 
-static void send_delayed_messages(void)
+static struct message_queue message_queues[PP_NUM_DLN2_ITFS] = {
+	[PP_VENDOR_ITF_DLN2] = { message_buffer, sizeof(message_buffer) },
+	[PP_VENDOR_ITF_USER] = { user_message_buffer,
+				 sizeof(user_message_buffer) },
+};
+
+static void PP_HOT_FUNC(send_delayed_messages)(void)
 {
-	if (r_id == w_id)
-		return;
+	for (uint8_t itf = 0; itf < PP_NUM_DLN2_ITFS; itf++) {
+		struct message_queue *q = &message_queues[itf];
 
-	uint32_t bytes_avail = tud_vendor_write_available();
-	if (bytes_avail != CFG_TUD_VENDOR_TX_BUFSIZE)
-		return;
+		if (q->r_id == q->w_id)
+			continue;
 
-	uint8_t *message = &message_buffer[r_id];
-	uint16_t size = u16_from_buf_le(&message[0]);
+		uint32_t bytes_avail = tud_vendor_n_write_available(itf);
+		if (bytes_avail != CFG_TUD_VENDOR_TX_BUFSIZE)
+			continue;
 
-	uint32_t bytes_written = tud_vendor_write(message, size);
-	uint32_t bytes_flushed = tud_vendor_write_flush();
+		uint8_t *message = &q->buf[q->r_id];
+		uint16_t size = u16_from_buf_le(&message[0]);
 
-	TU_LOG3("main: sent message (%" PRIu32 "-%" PRIu32 "-%" PRIu32 ") = ",
-		bytes_avail, bytes_written, bytes_flushed);
-	(void)bytes_written;
-	(void)bytes_flushed;
-	TU_LOG3_BUF(message, size);
+		tud_vendor_n_write(itf, message, size);
+		tud_vendor_n_write_flush(itf);
+		pp_trace(PP_TRACE_SENT, itf, size);
 
-	r_id += CFG_TUD_VENDOR_TX_BUFSIZE;
-	if (r_id >= sizeof(message_buffer))
-		r_id = 0;
+		q->r_id += CFG_TUD_VENDOR_TX_BUFSIZE;
+		if (q->r_id >= q->size)
+			q->r_id = 0;
+
+		// Requests left in the RX FIFO for lack of a slot
+		if (tud_vendor_n_available(itf))
+			tud_vendor_rx_cb(itf, NULL, 0);
+	}
 }
 
 // Header:
@@ -114,12 +274,34 @@ static void send_delayed_messages(void)
 #define RESPONSE_CODE_OK 0
 #define RESPONSE_CODE_FAILED 0xFFFF
 
-void send_message_delayed(uint16_t cmd, uint16_t echo, enum dln2_handle handle,
-			  uint8_t *data, uint16_t data_len)
+static uint16_t PP_HOT_FUNC(queue_used_slots)(const struct message_queue *q)
+{
+	size_t used = (q->w_id + q->size - q->r_id) % q->size;
+
+	return used / CFG_TUD_VENDOR_TX_BUFSIZE;
+}
+
+static void PP_HOT_FUNC(queue_message)(uint8_t itf, uint16_t cmd,
+				       uint16_t echo, enum dln2_handle handle,
+				       uint8_t *data, uint16_t data_len)
 {
 	TU_ASSERT(data_len <= CFG_TUD_VENDOR_TX_BUFSIZE - MSG_HDR_SZ, );
 
-	uint8_t *buf = &message_buffer[w_id];
+	struct message_queue *q = &message_queues[itf];
+	uint8_t *buf = &q->buf[q->w_id];
+
+	size_t w_id = q->w_id + CFG_TUD_VENDOR_TX_BUFSIZE;
+	if (w_id >= q->size)
+		w_id = 0;
+	// Would look empty afterwards
+	if (w_id == q->r_id) {
+		q->dropped++;
+		pp_trace(PP_TRACE_QUEUE_FULL, itf,
+			 cmd | (uint32_t)handle << 16);
+		TU_LOG1("main: Queue of itf %u full, dropped %s message\r\n",
+			itf, handle2str(handle));
+		return;
+	}
 
 	uint16_t size = MSG_HDR_SZ + data_len;
 	u16_to_buf_le(&buf[0], size);
@@ -128,15 +310,83 @@ void send_message_delayed(uint16_t cmd, uint16_t echo, enum dln2_handle handle,
 	u16_to_buf_le(&buf[6], handle);
 	memcpy(&buf[MSG_HDR_SZ], data, data_len);
 
-	TU_LOG3("main: Request to send %u byte from %s\r\n", data_len,
-		handle2str(handle));
+	q->w_id = w_id;
 
-	w_id += CFG_TUD_VENDOR_TX_BUFSIZE;
-	if (w_id >= sizeof(message_buffer))
-		w_id = 0;
+	uint16_t used = queue_used_slots(q);
+	if (used > q->max_used)
+		q->max_used = used;
+}
+
+static unsigned int
+PP_HOT_FUNC(queue_free_slots)(const struct message_queue *q)
+{
+	// One slot always stays empty
+	return q->size / CFG_TUD_VENDOR_TX_BUFSIZE - queue_used_slots(q) - 1;
 }
 
-static bool handle_rx_data(const uint8_t *buf_in, uint16_t buf_in_size)
+void get_message_queue_stats(uint8_t itf, uint16_t *max_used,
+			     uint32_t *dropped, uint16_t *rx_max_bytes)
+{
+	const struct message_queue *q = &message_queues[itf];
+
+	*max_used = q->max_used;
+	*dropped = q->dropped;
+	*rx_max_bytes = q->rx_max_bytes;
+}
+
+unsigned int free_message_slots(void)
+{
+	return queue_free_slots(&message_queues[PP_VENDOR_ITF_DLN2]);
+}
+
+void PP_HOT_FUNC(send_message_delayed)(uint16_t cmd, uint16_t echo,
+				       enum dln2_handle handle, uint8_t *data,
+				       uint16_t data_len)
+{
+	queue_message(PP_VENDOR_ITF_DLN2, cmd, echo, handle, data, data_len);
+}
+
+void PP_HOT_FUNC(send_user_message_delayed)(uint16_t cmd, uint16_t echo,
+					    enum dln2_handle handle,
+					    uint8_t *data, uint16_t data_len)
+{
+	queue_message(PP_VENDOR_ITF_USER, cmd, echo, handle, data, data_len);
+}
+
+typedef bool (*dln2_request_handler_t)(uint16_t cmd, const uint8_t *data_in,
+				       uint16_t data_in_len, uint8_t *data_out,
+				       uint16_t *data_out_len);
+
+#define DLN2_REQUEST_HANDLER(NAME, name, module_id, commands) \
+	[DLN2_HANDLE_##NAME] = pp_##name##_handle_request,
+
+static const dln2_request_handler_t
+	request_handlers[DLN2_HANDLES] PP_HOT_DATA = {
+	DLN2_HANDLE_SPECS(DLN2_REQUEST_HANDLER)
+};
+
+bool PP_HOT_FUNC(handle_dln2_request)(uint16_t handle, uint16_t cmd,
+				      const uint8_t *data_in,
+				      uint16_t data_in_len, uint8_t *data_out,
+				      uint16_t *data_out_len)
+{
+	// The handle and command are checked against dln2_spec.h and the
+	// lengths of fixed size requests, the modules check the rest.
+	const struct dln2_cmd_spec *spec = dln2_cmd_spec(handle, cmd);
+	if (!spec) {
+		TU_LOG1("main: %s command 0x%04x not implemented\r\n",
+			handle2str(handle), cmd);
+		return false;
+	}
+	TU_VERIFY(data_in_len >= spec->min_len &&
+		  data_in_len <= spec->max_len);
+
+	return request_handlers[handle](cmd, data_in, data_in_len, data_out,
+					data_out_len);
+}
+
+static bool PP_HOT_FUNC(handle_rx_data)(uint8_t itf, const uint8_t *buf_in,
+					uint16_t buf_in_size)
 {
 	TU_VERIFY(buf_in_size >= MSG_HDR_SZ);
 
@@ -147,9 +397,7 @@ static bool handle_rx_data(const uint8_t *buf_in, uint16_t buf_in_size)
 
 	TU_VERIFY(size == buf_in_size);
 
-	TU_LOG3("main: Request to handle %u (%s): command %u (size=%u, echo=%u)\r\n",
-		handle, handle2str(handle), id, size, echo);
-	(void)echo;
+	pp_trace(PP_TRACE_REQUEST, handle, id | (uint32_t)echo << 16);
 
 	const uint8_t *data_in = &buf_in[MSG_HDR_SZ];
 	uint16_t data_in_len = buf_in_size - MSG_HDR_SZ;
@@ -158,33 +406,10 @@ static bool handle_rx_data(const uint8_t *buf_in, uint16_t buf_in_size)
 	uint8_t *data_out = &buf_out[2];
 	uint16_t data_out_len = TU_ARRAY_SIZE(buf_out) - 2;
 
-	bool ok;
-	switch (handle) {
-	case DLN2_HANDLE_ADC:
-		ok = pp_adc_handle_request(id, data_in, data_in_len, data_out,
-					   &data_out_len);
-		break;
-
-	case DLN2_HANDLE_CTRL:
-		ok = pp_ctrl_handle_request(id, data_in, data_in_len, data_out,
-					    &data_out_len);
-		break;
-
-	case DLN2_HANDLE_GPIO:
-		ok = pp_gpio_handle_request(id, data_in, data_in_len, data_out,
-					    &data_out_len);
-		break;
-
-	case DLN2_HANDLE_I2C:
-		ok = pp_i2c_handle_request(id, data_in, data_in_len, data_out,
-					   &data_out_len);
-		break;
-
-	default:
-		TU_LOG1("main: Handle %u (%s) not implemented\r\n", handle,
-			handle2str(handle));
-		ok = false;
-	}
+	uint32_t start_us = time_us_32();
+	bool ok = handle_dln2_request(handle, id, data_in, data_in_len,
+				      data_out, &data_out_len);
+	pp_stats_request(handle, id, ok, time_us_32() - start_us);
 
 	if (!ok) {
 		TU_LOG2("main: Failed to handle %s request\r\n",
@@ -192,22 +417,70 @@ static bool handle_rx_data(const uint8_t *buf_in, uint16_t buf_in_size)
 		data_out_len = 0;
 	}
 
-	u16_to_buf_le(&buf_out[0],
-		      ok ? RESPONSE_CODE_OK : RESPONSE_CODE_FAILED);
+	uint16_t code = ok ? RESPONSE_CODE_OK : RESPONSE_CODE_FAILED;
+	u16_to_buf_le(&buf_out[0], code);
+	pp_trace(PP_TRACE_RESPONSE, handle, id | (uint32_t)code << 16);
 
-	send_message_delayed(id, echo, handle, buf_out, data_out_len + 2);
+	queue_message(itf, id, echo, handle, buf_out, data_out_len + 2);
 
 	return true;
 }
 
-void tud_vendor_rx_cb(uint8_t itf, const uint8_t *buf_in, uint16_t buf_in_size)
-{
-	(void)itf;
+// A request can span several USB packets and the callback is invoked for each
+// of them, so the requests are reassembled from the RX FIFO.
+static uint8_t rx_message[PP_NUM_DLN2_ITFS][CFG_TUD_VENDOR_RX_BUFSIZE];
+static uint16_t rx_message_len[PP_NUM_DLN2_ITFS];
 
-	TU_LOG3("main: buf_in = ");
-	TU_LOG3_BUF(buf_in, buf_in_size);
+void PP_HOT_FUNC(tud_vendor_rx_cb)(uint8_t itf, const uint8_t *buf_in,
+				   uint16_t buf_in_size)
+{
+	(void)buf_in;
+	(void)buf_in_size;
 
-	handle_rx_data(buf_in, buf_in_size);
+	// The logic analyzer interface only sends
+	if (itf >= PP_NUM_DLN2_ITFS) {
+		tud_vendor_n_read_flush(itf);
+		return;
+	}
 
-	tud_vendor_read_flush();
+	uint8_t *msg = rx_message[itf];
+	uint16_t *len = &rx_message_len[itf];
+	struct message_queue *q = &message_queues[itf];
+
+	uint32_t avail = tud_vendor_n_available(itf);
+	if (avail > q->rx_max_bytes)
+		q->rx_max_bytes = (uint16_t)TU_MIN(avail, UINT16_MAX);
+
+	while (tud_vendor_n_available(itf)) {
+		// Every request gets a response. Without a slot for it, the
+		// requests stay in the FIFO and the host is held off, until
+		// send_delayed_messages() makes room.
+		if (*len == 0 && !queue_free_slots(q)) {
+			pp_trace(PP_TRACE_RX_HELD, itf,
+				 tud_vendor_n_available(itf));
+			return;
+		}
+
+		uint16_t size = MSG_HDR_SZ;
+		if (*len >= MSG_HDR_SZ)
+			size = u16_from_buf_le(&msg[0]);
+
+		*len += tud_vendor_n_read(itf, &msg[*len], size - *len);
+		if (*len < MSG_HDR_SZ)
+			continue;
+
+		size = u16_from_buf_le(&msg[0]);
+		if (size < MSG_HDR_SZ || size > CFG_TUD_VENDOR_RX_BUFSIZE) {
+			TU_LOG1("main: Invalid message size %u on itf %u\r\n",
+				size, itf);
+			tud_vendor_n_read_flush(itf);
+			*len = 0;
+			return;
+		}
+
+		if (*len == size) {
+			handle_rx_data(itf, msg, size);
+			*len = 0;
+		}
+	}
 }
@@ -7,5 +7,21 @@
 
 void send_message_delayed(uint16_t cmd, uint16_t echo, enum dln2_handle handle,
 			  uint8_t *data, uint16_t data_len);
+// Same for the user space DLN2 interface, which the kernel driver doesn't bind
+void send_user_message_delayed(uint16_t cmd, uint16_t echo,
+			       enum dln2_handle handle, uint8_t *data,
+			       uint16_t data_len);
+// Messages that can still be queued for the kernel DLN2 interface. A message
+// is dropped if the queue is full.
+unsigned int free_message_slots(void);
+// Counters of the message queue of a DLN2 interface, see PP_VREQ_STATS_GET
+void get_message_queue_stats(uint8_t itf, uint16_t *max_used,
+			     uint32_t *dropped, uint16_t *rx_max_bytes);
+
+// Handles a request of the DLN2 interfaces, data_out_len is the size of
+// data_out on entry and the response length on return
+bool handle_dln2_request(uint16_t handle, uint16_t cmd, const uint8_t *data_in,
+			 uint16_t data_in_len, uint8_t *data_out,
+			 uint16_t *data_out_len);
 
 #endif /* _PP_MAIN_H_ */
@@ -9,59 +9,44 @@
 
 #include "byte_ops.h"
 #include "dln2.h"
+#include "dln2_str.h"
+#include "pp_platform.h"
 
 static const uint8_t adc_gpios[] = {
 #ifndef PP_GPIO_ONLY
-	26, 27, 28,
+	PP_PLATFORM_ADC_GPIO,
+	PP_PLATFORM_ADC_GPIO + 1,
+	PP_PLATFORM_ADC_GPIO + 2,
 #endif
-	29 // 1/3 voltage divider on VSYS
-	// Channel 5 is the internal temperature sensor.
+	PP_PLATFORM_VSYS_GPIO // 1/3 voltage divider on VSYS
+	// The last channel is the internal temperature sensor.
 };
 
 #define NUM_PP_ADC_CHANNELS (TU_ARRAY_SIZE(adc_gpios) + 1)
-#define ADC_OFFS (NUM_ADC_CHANNELS - NUM_PP_ADC_CHANNELS)
-
-static const char *adc_cmd2str(uint16_t cmd)
-{
-	// clang-format off
-	switch (cmd) {
-	case DLN2_ADC_GET_CHANNEL_COUNT: return "GET_CHANNEL_COUNT";
-	case DLN2_ADC_ENABLE: return "ENABLE";
-	case DLN2_ADC_DISABLE: return "DISABLE";
-	case DLN2_ADC_CHANNEL_ENABLE: return "CHANNEL_ENABLE";
-	case DLN2_ADC_CHANNEL_DISABLE: return "CHANNEL_DISABLE";
-	case DLN2_ADC_SET_RESOLUTION: return "SET_RESOLUTION";
-	case DLN2_ADC_CHANNEL_GET_VAL: return "CHANNEL_GET_VAL";
-	case DLN2_ADC_CHANNEL_GET_ALL_VAL: return "CHANNEL_GET_ALL_VAL";
-	case DLN2_ADC_CHANNEL_SET_CFG: return "CHANNEL_SET_CFG";
-	case DLN2_ADC_CHANNEL_GET_CFG: return "CHANNEL_GET_CFG";
-	case DLN2_ADC_CONDITION_MET_EV: return "CONDITION_MET_EV";
-	default: return "???";
-	}
-	// clang-format on
-}
+// The channels are the last ADC inputs, up to the temperature sensor
+#define ADC_OFFS (PP_PLATFORM_ADC_TEMP + 1 - NUM_PP_ADC_CHANNELS)
 
 bool pp_adc_handle_request(uint16_t cmd, uint8_t const *data_in,
 			   uint16_t data_in_len, uint8_t *data_out,
 			   uint16_t *data_out_len)
 {
+	// The lengths are checked by handle_dln2_request()
+	(void)data_in_len;
+
 	switch (cmd) {
 	case DLN2_ADC_GET_CHANNEL_COUNT:
 		TU_ASSERT(*data_out_len >= 1);
-		TU_VERIFY(data_in_len == 1);
 		TU_VERIFY(data_in[0] == 0);
 		TU_LOG3("ADC: Getting number of channels\r\n");
 		data_out[0] = NUM_PP_ADC_CHANNELS;
 		*data_out_len = 1;
 		break;
 	case DLN2_ADC_SET_RESOLUTION:
-		TU_VERIFY(data_in_len == 2);
 		TU_VERIFY(data_in[0] == 0 && data_in[1] == DLN2_ADC_DATA_BITS);
 		TU_LOG3("ADC: Setting resolution\r\n");
 		*data_out_len = 0;
 		break;
 	case DLN2_ADC_CHANNEL_ENABLE: {
-		TU_VERIFY(data_in_len == 2);
 		TU_VERIFY(data_in[0] == 0);
 		uint8_t chan = data_in[1] + ADC_OFFS;
 		TU_LOG3("ADC: Enabling channel %u\r\n", chan);
@@ -70,7 +55,6 @@ bool pp_adc_handle_request(uint16_t cmd, uint8_t const *data_in,
 		break;
 	}
 	case DLN2_ADC_CHANNEL_DISABLE: {
-		TU_VERIFY(data_in_len == 2);
 		TU_VERIFY(data_in[0] == 0);
 		uint8_t chan = data_in[1] + ADC_OFFS;
 		TU_LOG3("ADC: Disabling channel %u\r\n", chan);
@@ -80,7 +64,6 @@ bool pp_adc_handle_request(uint16_t cmd, uint8_t const *data_in,
 	}
 	case DLN2_ADC_ENABLE: {
 		TU_ASSERT(*data_out_len >= 2);
-		TU_VERIFY(data_in_len == 1);
 		TU_VERIFY(data_in[0] == 0);
 		TU_LOG3("ADC: Enabling\r\n");
 		u16_to_buf_le(&data_out[0], 0); // no conflict
@@ -89,7 +72,6 @@ bool pp_adc_handle_request(uint16_t cmd, uint8_t const *data_in,
 	}
 	case DLN2_ADC_DISABLE: {
 		TU_ASSERT(*data_out_len >= 2);
-		TU_VERIFY(data_in_len == 1);
 		TU_VERIFY(data_in[0] == 0);
 		TU_LOG3("ADC: Disabling\r\n");
 		u16_to_buf_le(&data_out[0], 0); // no conflict
@@ -98,7 +80,6 @@ bool pp_adc_handle_request(uint16_t cmd, uint8_t const *data_in,
 	}
 	case DLN2_ADC_CHANNEL_GET_VAL: {
 		TU_ASSERT(*data_out_len >= 2);
-		TU_VERIFY(data_in_len == 2);
 		TU_VERIFY(data_in[0] == 0);
 		uint8_t chan = data_in[1] + ADC_OFFS;
 		adc_select_input(chan);
@@ -112,13 +93,25 @@ bool pp_adc_handle_request(uint16_t cmd, uint8_t const *data_in,
 	}
 	default:
 		TU_LOG1("ADC: Command not implemented: %s (%u)\r\n",
-			adc_cmd2str(cmd), cmd);
+			cmd2str(cmd), cmd);
 		TU_VERIFY(false);
 	}
 
 	return true;
 }
 
+uint8_t pp_adc_read_all(uint16_t *vals, uint8_t max)
+{
+	uint8_t n = TU_MIN(NUM_PP_ADC_CHANNELS, max);
+
+	for (uint8_t i = 0; i < n; i++) {
+		adc_select_input(i + ADC_OFFS);
+		// Same resolution as DLN2_ADC_CHANNEL_GET_VAL
+		vals[i] = adc_read() >> 2;
+	}
+	return n;
+}
+
 void pp_adc_init(void)
 {
 	adc_init();
@@ -10,5 +10,7 @@ bool pp_adc_handle_request(uint16_t cmd, uint8_t const *data_in,
 			   uint16_t *data_out_len);
 
 void pp_adc_init(void);
+// Samples up to max channels in DLN2 resolution, returns the number of channels
+uint8_t pp_adc_read_all(uint16_t *vals, uint8_t max);
 
 #endif /* _PICOPORTS_PP_ADC_H_ */
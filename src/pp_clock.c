@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Device timer for the host's clock synchronization, see PP_CMD_GET_TIME.
+ * The USB interrupt timestamps each start of frame (SOF) and reads its frame
+ * number from the controller, so the SOF timestamps don't depend on the main
+ * loop.
+ */
+#include "tusb.h"
+
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#include "byte_ops.h"
+#include "pp_clock.h"
+#include "pp_platform.h"
+#include "pp_vendor.h"
+
+static volatile uint64_t sof_us;
+static volatile uint16_t sof_frame;
+
+void PP_HOT_FUNC(pp_clock_sof)(void)
+{
+	sof_us = time_us_64();
+	sof_frame = pp_platform_usb_frame();
+}
+
+void pp_clock_get_time(uint8_t *buf)
+{
+	// The 64 bit timestamp mustn't change halfway through
+	uint32_t irq = save_and_disable_interrupts();
+	uint64_t now = time_us_64();
+	uint64_t sof = sof_us;
+	uint16_t frame = sof_frame;
+	restore_interrupts(irq);
+
+	// TinyUSB only passes SOFs on while enabled and disables them again on
+	// a bus reset, so they're enabled by the first request after either.
+	if (now - sof > PP_TIME_SOF_MAX_AGE_US) {
+		tud_sof_cb_enable(true);
+		sof = 0;
+		frame = 0;
+	}
+
+	u64_to_buf_le(&buf[0], now);
+	u64_to_buf_le(&buf[8], sof);
+	u16_to_buf_le(&buf[16], frame);
+}
@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_PP_CLOCK_H_
+#define _PICOPORTS_PP_CLOCK_H_
+
+#include <stdint.h>
+
+// Timestamps a USB start of frame, called from the USB interrupt
+void pp_clock_sof(void);
+// Fills the PP_TIME_LEN bytes of the PP_CMD_GET_TIME response
+void pp_clock_get_time(uint8_t *buf);
+
+#endif /* _PICOPORTS_PP_CLOCK_H_ */
@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Frequency and edge counter. Each measured line gets a PIO state machine,
+ * which counts the rising edges and the high time in its X and Y registers
+ * without any CPU involvement. At the end of every gate period, the registers
+ * are read by executing instructions on the running state machine, and the
+ * differences are converted into frequency, period and duty cycle.
+ */
+#include "tusb.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+#include "main.h"
+#include "pp_counter.h"
+#include "pp_gpio.h"
+#include "pp_platform.h"
+#include "pp_vendor.h"
+
+#ifdef PP_COUNTER
+#include "hardware/clocks.h"
+#include "hardware/pio.h"
+#include "hardware/timer.h"
+
+#include "pp_counter.pio.h"
+
+// Cycles per count of the high time, see pp_counter.pio
+#define PP_COUNTER_CYCLES_PER_HIGH 2
+
+struct counter {
+	bool active;
+	uint16_t line;
+	uint16_t gate_ms;
+	uint16_t flags;
+	PIO pio;
+	uint sm;
+
+	uint64_t gate_start_us;
+	uint32_t x;
+	uint32_t y;
+	uint64_t total_edges;
+
+	bool valid;
+	uint8_t result[PP_COUNTER_RESULT_LEN];
+};
+
+static struct counter counters[PP_COUNTER_MAX_LINES];
+// The program is loaded into a PIO once a state machine is claimed there
+static bool program_loaded[NUM_PIOS];
+static uint program_offset[NUM_PIOS];
+
+static void counter_read(struct counter *c, uint32_t *x, uint32_t *y)
+{
+	pio_sm_exec(c->pio, c->sm, pio_encode_mov(pio_isr, pio_x));
+	pio_sm_exec(c->pio, c->sm, pio_encode_push(false, false));
+	pio_sm_exec(c->pio, c->sm, pio_encode_mov(pio_isr, pio_y));
+	pio_sm_exec(c->pio, c->sm, pio_encode_push(false, false));
+	*x = pio_sm_get(c->pio, c->sm);
+	*y = pio_sm_get(c->pio, c->sm);
+}
+
+// Claims a state machine, preferably on a PIO the logic analyzer doesn't use
+static bool counter_claim(struct counter *c)
+{
+	PIO pios[] = PP_PLATFORM_COUNTER_PIOS;
+
+	for (uint i = 0; i < TU_ARRAY_SIZE(pios); i++) {
+		uint index = pio_get_index(pios[i]);
+		int sm = pio_claim_unused_sm(pios[i], false);
+
+		if (sm < 0)
+			continue;
+		if (!program_loaded[index]) {
+			if (!pio_can_add_program(pios[i], &counter_program)) {
+				pio_sm_unclaim(pios[i], sm);
+				continue;
+			}
+			program_offset[index] =
+				pio_add_program(pios[i], &counter_program);
+			program_loaded[index] = true;
+		}
+
+		c->pio = pios[i];
+		c->sm = sm;
+		return true;
+	}
+
+	TU_LOG1("COUNTER: No free PIO state machine\r\n");
+	return false;
+}
+
+static bool counter_start(struct counter *c, uint16_t line, uint16_t gate_ms,
+			  uint16_t flags)
+{
+	uint gpio_id;
+
+	TU_VERIFY(pp_gpio_line_to_gpio(line, &gpio_id));
+	if (!c->active)
+		TU_VERIFY(counter_claim(c));
+
+	uint offset = program_offset[pio_get_index(c->pio)];
+	pio_sm_config cfg = counter_program_get_default_config(offset);
+	sm_config_set_jmp_pin(&cfg, gpio_id);
+	pio_sm_init(c->pio, c->sm, offset, &cfg);
+	pio_sm_set_enabled(c->pio, c->sm, true);
+
+	c->active = true;
+	c->line = line;
+	c->gate_ms = gate_ms;
+	c->flags = flags;
+	c->valid = false;
+	c->total_edges = 0;
+	c->gate_start_us = time_us_64();
+	counter_read(c, &c->x, &c->y);
+
+	TU_LOG2("COUNTER: Line %u, gate %u ms\r\n", line, gate_ms);
+	return true;
+}
+
+static void counter_stop(struct counter *c)
+{
+	if (!c->active)
+		return;
+	pio_sm_set_enabled(c->pio, c->sm, false);
+	pio_sm_unclaim(c->pio, c->sm);
+	c->active = false;
+	TU_LOG2("COUNTER: Line %u stopped\r\n", c->line);
+}
+
+static void counter_gate(struct counter *c, uint64_t now)
+{
+	uint32_t sys_hz = clock_get_hz(clk_sys);
+	uint32_t x, y;
+
+	counter_read(c, &x, &y);
+	uint64_t gate_us = now - c->gate_start_us;
+	// Both count down
+	uint32_t edges = c->x - x;
+	uint64_t high_cycles =
+		(uint64_t)(c->y - y) * PP_COUNTER_CYCLES_PER_HIGH;
+	c->x = x;
+	c->y = y;
+	c->gate_start_us = now;
+	c->total_edges += edges;
+
+	uint64_t freq_mhz = (uint64_t)edges * 1000000000 / gate_us;
+	uint32_t period_ns = 0, high_ns = 0;
+	if (edges) {
+		period_ns = (uint32_t)(gate_us * 1000 / edges);
+		high_ns = (uint32_t)(high_cycles * 1000000000 / sys_hz /
+				     edges);
+	}
+	uint64_t gate_cycles = gate_us * sys_hz / 1000000;
+	uint64_t duty = high_cycles * 0xffff / gate_cycles;
+
+	uint8_t *r = c->result;
+	memset(r, 0, PP_COUNTER_RESULT_LEN);
+	r[0] = 1;
+	u32_to_buf_le(&r[4], (uint32_t)gate_us);
+	u32_to_buf_le(&r[8], edges);
+	u32_to_buf_le(&r[12], freq_mhz > UINT32_MAX ? UINT32_MAX : freq_mhz);
+	u32_to_buf_le(&r[16], period_ns);
+	u32_to_buf_le(&r[20], high_ns);
+	u16_to_buf_le(&r[24], duty > 0xffff ? 0xffff : duty);
+	u16_to_buf_le(&r[26], c->line);
+	u64_to_buf_le(&r[28], c->total_edges);
+	c->valid = true;
+
+	if (c->flags & PP_COUNTER_FLAG_EVENT)
+		send_user_message_delayed(PP_COUNTER_EV, 0, DLN2_HANDLE_EVENT,
+					  r, PP_COUNTER_RESULT_LEN);
+}
+
+static struct counter *counter_find(uint16_t line)
+{
+	for (uint i = 0; i < PP_COUNTER_MAX_LINES; i++) {
+		if (counters[i].active && counters[i].line == line)
+			return &counters[i];
+	}
+	return NULL;
+}
+
+static struct counter *counter_find_free(void)
+{
+	for (uint i = 0; i < PP_COUNTER_MAX_LINES; i++) {
+		if (!counters[i].active)
+			return &counters[i];
+	}
+	return NULL;
+}
+#endif
+
+void pp_counter_task(void)
+{
+#ifdef PP_COUNTER
+	uint64_t now = time_us_64();
+
+	for (uint i = 0; i < PP_COUNTER_MAX_LINES; i++) {
+		struct counter *c = &counters[i];
+
+		if (c->active &&
+		    now - c->gate_start_us >= c->gate_ms * 1000ull)
+			counter_gate(c, now);
+	}
+#endif
+}
+
+bool pp_counter_handle_control_request(const tusb_control_request_t *request,
+				       uint8_t const *data_in,
+				       uint16_t data_in_len, uint8_t *data_out,
+				       uint16_t *data_out_len)
+{
+#ifndef PP_COUNTER
+	(void)request;
+	(void)data_in;
+	(void)data_in_len;
+	(void)data_out;
+	(void)data_out_len;
+	return false;
+#else
+	uint16_t line = request->wIndex;
+	struct counter *c = counter_find(line);
+
+	switch (request->bRequest) {
+	case PP_VREQ_COUNTER_SET: {
+		uint16_t gate_ms = request->wValue;
+
+		TU_VERIFY(data_in_len == 0 || data_in_len == 2);
+		*data_out_len = 0;
+		if (!gate_ms) {
+			if (c)
+				counter_stop(c);
+			return true;
+		}
+		if (!c)
+			c = counter_find_free();
+		TU_VERIFY(c);
+		return counter_start(c, line, gate_ms,
+				     data_in_len ? u16_from_buf_le(data_in) :
+						   0);
+	}
+
+	case PP_VREQ_COUNTER_GET:
+		TU_VERIFY(c);
+		TU_VERIFY(*data_out_len >= PP_COUNTER_RESULT_LEN);
+		memcpy(data_out, c->result, PP_COUNTER_RESULT_LEN);
+		if (!c->valid) {
+			memset(data_out, 0, PP_COUNTER_RESULT_LEN);
+			u16_to_buf_le(&data_out[26], line);
+		}
+		*data_out_len = PP_COUNTER_RESULT_LEN;
+		return true;
+
+	default:
+		TU_LOG1("COUNTER: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
+#endif
+}
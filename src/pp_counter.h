@@ -0,0 +1,14 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_PP_COUNTER_H_
+#define _PICOPORTS_PP_COUNTER_H_
+
+void pp_counter_task(void);
+bool pp_counter_handle_control_request(const tusb_control_request_t *request,
+				       uint8_t const *data_in,
+				       uint16_t data_in_len, uint8_t *data_out,
+				       uint16_t *data_out_len);
+
+#endif /* _PICOPORTS_PP_COUNTER_H_ */
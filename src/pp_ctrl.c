@@ -4,21 +4,12 @@
  */
 #include "tusb.h"
 
-#include "bsp/board_api.h"
-
 #include "byte_ops.h"
 #include "dln2.h"
-
-TU_ATTR_UNUSED static const char *ctrl_cmd2str(uint16_t cmd)
-{
-	// clang-format off
-	switch (cmd) {
-	case CMD_GET_DEVICE_VER: return "GET_DEVICE_VER";
-	case CMD_GET_DEVICE_SN: return "GET_DEVICE_SN";
-	default: return "???";
-	}
-	// clang-format on
-}
+#include "dln2_str.h"
+#include "pp_clock.h"
+#include "pp_platform.h"
+#include "pp_vendor.h"
 
 static bool handle_request(uint16_t cmd, uint32_t *value)
 {
@@ -26,13 +17,9 @@ static bool handle_request(uint16_t cmd, uint32_t *value)
 	case CMD_GET_DEVICE_VER:
 		*value = DLN2_HW_ID;
 		break;
-	case CMD_GET_DEVICE_SN: {
-		uint8_t uid[4];
-		size_t len = board_get_unique_id(uid, 4);
-		TU_ASSERT(len == 4); /* This should always work on RP2040. */
-		*value = u32_from_buf_le(uid);
+	case CMD_GET_DEVICE_SN:
+		TU_ASSERT(pp_platform_serial(value));
 		break;
-	}
 	default:
 		TU_VERIFY(false);
 	}
@@ -45,10 +32,17 @@ bool pp_ctrl_handle_request(uint16_t cmd, uint8_t const *data_in,
 			    uint16_t *data_out_len)
 {
 	(void)data_in;
+	(void)data_in_len;
 
-	TU_LOG3("CTRL: %s\r\n", ctrl_cmd2str(cmd));
+	TU_LOG3("CTRL: %s\r\n", cmd2str(cmd));
+
+	if (cmd == PP_CMD_GET_TIME) {
+		TU_ASSERT(*data_out_len >= PP_TIME_LEN);
+		pp_clock_get_time(data_out);
+		*data_out_len = PP_TIME_LEN;
+		return true;
+	}
 
-	TU_VERIFY(data_in_len == 0);
 	TU_ASSERT(*data_out_len >= 4);
 	*data_out_len = 0;
 
@@ -6,33 +6,55 @@
 
 #include "bsp/board_api.h"
 
+#include "hardware/clocks.h"
 #include "hardware/gpio.h"
+#include "hardware/pwm.h"
+#include "hardware/timer.h"
 
 #include "byte_ops.h"
 #include "dln2.h"
+#include "dln2_str.h"
 #include "main.h"
+#include "pp_platform.h"
+#include "pp_sched.h"
+#include "pp_trace.h"
+#include "pp_vendor.h"
 
 #ifdef PP_BTN_BOOTSEL
 #include "pico/bootrom.h"
 #endif
 
 static uint8_t gpio_pins[] = {
-#ifndef PP_LOG_ON_GP01
-	0,  1, // Debug log
+#if !defined(PP_LOG_ON_GP01) && !defined(PP_UART0_CDC)
+	0,  1, // Debug log or second UART
 #endif
-	2,  3,	4,  5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+#ifndef PP_SPI
+	2,  3,	4,  5, // SPI0
+#endif
+#ifndef PP_UART_FLOW_CONTROL
+	6,  7, // UART CTS/RTS
+#endif
+	8,  9,
+#ifndef PP_SPI1
+	10, 11, 12, 13, // SPI1
+#endif
+	14, 15,
 #ifdef PP_GPIO_ONLY
 	16, 17, // I2C
 #endif
-	18, 19,
+#ifndef PP_UART_DTR_RTS
+	18, 19, // UART DTR/RTS outputs
+#endif
 #ifdef PP_GPIO_ONLY
 	20, 21, // UART
 #endif
-	22,
+#ifndef PP_UART_RS485
+	22, // RS-485 DE
+#endif
 #ifdef PP_GPIO_ONLY
 	26, 27, 28, // ADC
 #endif
-	25 // Pico LED
+	PP_PLATFORM_LED_GPIO // Pico LED
 };
 
 #ifdef PP_BTN_BOOTSEL
@@ -41,29 +63,6 @@ static uint8_t gpio_pins[] = {
 #define NUM_GPIOS (TU_ARRAY_SIZE(gpio_pins) + 1)
 #endif
 
-TU_ATTR_UNUSED static const char *gpio_cmd2str(uint16_t cmd)
-{
-	// clang-format off
-	switch (cmd) {
-	case DLN2_GPIO_GET_PIN_COUNT: return "GET_PIN_COUNT";
-	case DLN2_GPIO_SET_DEBOUNCE: return "SET_DEBOUNCE";
-	case DLN2_GPIO_GET_DEBOUNCE: return "GET_DEBOUNCE"; /* Unused by kernel driver */
-	case DLN2_GPIO_PORT_GET_VAL: return "PORT_GET_VAL"; /* Unused by kernel driver */
-	case DLN2_GPIO_PIN_GET_VAL: return "PIN_GET_VAL";
-	case DLN2_GPIO_PIN_SET_OUT_VAL: return "PIN_SET_OUT_VAL";
-	case DLN2_GPIO_PIN_GET_OUT_VAL: return "PIN_GET_OUT_VAL";
-	case DLN2_GPIO_CONDITION_MET_EV: return "CONDITION_MET_EV";
-	case DLN2_GPIO_PIN_ENABLE: return "PIN_ENABLE";
-	case DLN2_GPIO_PIN_DISABLE: return "PIN_DISABLE";
-	case DLN2_GPIO_PIN_SET_DIRECTION: return "PIN_SET_DIRECTION";
-	case DLN2_GPIO_PIN_GET_DIRECTION: return "PIN_GET_DIRECTION";
-	case DLN2_GPIO_PIN_SET_EVENT_CFG: return "PIN_SET_EVENT_CFG";
-	case DLN2_GPIO_PIN_GET_EVENT_CFG: return "PIN_GET_EVENT_CFG"; /* Unused by kernel driver */
-	default: return "???";
-	}
-	// clang-format on
-}
-
 TU_ATTR_UNUSED static const char *gpio_type2str(uint8_t type)
 {
 	// clang-format off
@@ -114,10 +113,54 @@ void enable_gpio_button_event(bool enable)
 #endif
 }
 
+// Events are only queued with this many free TX slots, so they can't push
+// out responses
+#define PP_GPIO_EVENT_MIN_FREE_SLOTS 4
+
+// Changes counted by the interrupt and the time of the first one, by GPIO
+// number
+static volatile uint16_t gpio_changes[NUM_BANK0_GPIOS];
+static volatile uint32_t gpio_change_us[NUM_BANK0_GPIOS];
+
+// Event coalescing of each line, see PP_VREQ_GPIO_SET_COALESCE
+static struct {
+	uint16_t interval_ms;
+	uint16_t pending;
+	uint32_t changes;
+	uint32_t event_us;
+	// First pending change
+	uint32_t pending_us;
+} event_lines[TU_ARRAY_SIZE(gpio_pins)];
+
+static void clear_pin_events(uint16_t pin)
+{
+	irq_set_enabled(PP_PLATFORM_GPIO_IRQ, false);
+	gpio_changes[gpio_pins[pin]] = 0;
+	irq_set_enabled(PP_PLATFORM_GPIO_IRQ, true);
+	event_lines[pin].pending = 0;
+}
+
+// Lines in PWM mode, by GPIO number
+static uint32_t pwm_gpios;
+static uint16_t pwm_duty[NUM_BANK0_GPIOS];
+
+// The divider (in 1/16) and wrap of each slice, shared by its channels
+static struct {
+	uint16_t div16;
+	uint16_t top;
+} pwm_slices[NUM_PWM_SLICES];
+
+static bool is_pwm_pin(uint16_t pin)
+{
+	return pin < TU_ARRAY_SIZE(gpio_pins) &&
+	       (pwm_gpios & (1u << gpio_pins[pin]));
+}
+
 #define INVALID_PIN UINT16_MAX
 #define INVALID_VAL UINT8_MAX
 
-static bool handle_request(uint16_t cmd, uint16_t *pin, uint8_t *val)
+static bool PP_HOT_FUNC(handle_request)(uint16_t cmd, uint16_t *pin,
+					uint8_t *val)
 {
 	switch (cmd) {
 	case DLN2_GPIO_GET_PIN_COUNT:
@@ -139,6 +182,8 @@ static bool handle_request(uint16_t cmd, uint16_t *pin, uint8_t *val)
 		TU_VERIFY(*val != INVALID_VAL);
 		TU_LOG3("GPIO: Setting pin %u value: %u\r\n", *pin, *val);
 		TU_VERIFY(!is_gpio_button_pin(*pin));
+		// The value wouldn't be visible, report it
+		TU_VERIFY(!is_pwm_pin(*pin));
 		gpio_put(gpio_pins[*pin], *val);
 		break;
 	case DLN2_GPIO_PIN_ENABLE:
@@ -189,6 +234,8 @@ static bool handle_request(uint16_t cmd, uint16_t *pin, uint8_t *val)
 					     GPIO_IRQ_EDGE_RISE |
 						     GPIO_IRQ_EDGE_FALL,
 					     enable);
+			if (!enable)
+				clear_pin_events(*pin);
 		}
 		break;
 	}
@@ -199,11 +246,12 @@ static bool handle_request(uint16_t cmd, uint16_t *pin, uint8_t *val)
 	return true;
 }
 
-bool pp_gpio_handle_request(uint16_t cmd, uint8_t const *data_in,
-			    uint16_t data_in_len, uint8_t *data_out,
-			    uint16_t *data_out_len)
+bool PP_HOT_FUNC(pp_gpio_handle_request)(uint16_t cmd, uint8_t const *data_in,
+					 uint16_t data_in_len,
+					 uint8_t *data_out,
+					 uint16_t *data_out_len)
 {
-	TU_LOG3("GPIO: %s\r\n", gpio_cmd2str(cmd));
+	TU_LOG3("GPIO: %s\r\n", cmd2str(cmd));
 
 	TU_VERIFY(*data_out_len >= 3);
 	*data_out_len = 0;
@@ -236,39 +284,228 @@ bool pp_gpio_handle_request(uint16_t cmd, uint8_t const *data_in,
 	return true;
 }
 
-static bool gpio_id_events[TU_ARRAY_SIZE(gpio_pins)];
+bool pp_gpio_line_to_gpio(uint16_t line, unsigned int *gpio_id)
+{
+	TU_VERIFY(line < TU_ARRAY_SIZE(gpio_pins));
+	*gpio_id = gpio_pins[line];
+	return true;
+}
 
-static bool has_pin_event(uint16_t *pin, uint8_t *val)
+bool pp_gpio_lines_to_mask(uint32_t lines, uint32_t *gpio_mask)
 {
-	uint16_t gpio_id;
-	bool event_found = false;
+	*gpio_mask = 0;
+	for (uint16_t i = 0; i < 32; i++) {
+		if (!(lines & (1u << i)))
+			continue;
+		TU_VERIFY(i < TU_ARRAY_SIZE(gpio_pins) && !is_pwm_pin(i));
+		*gpio_mask |= 1u << gpio_pins[i];
+	}
+	return true;
+}
 
-	irq_set_enabled(IO_IRQ_BANK0, false);
+// Returns another line in PWM mode on the slice of gpio_id, preferably one
+// that conflicts with a frequency change, or PP_GPIO_PWM_NO_LINE
+static uint16_t pwm_shared_line(unsigned int gpio_id)
+{
+	uint16_t line = PP_GPIO_PWM_NO_LINE;
+
+	for (uint16_t i = 0; i < TU_ARRAY_SIZE(gpio_pins); i++) {
+		unsigned int other = gpio_pins[i];
+
+		if (other == gpio_id || !(pwm_gpios & (1u << other)) ||
+		    pwm_gpio_to_slice_num(other) !=
+			    pwm_gpio_to_slice_num(gpio_id))
+			continue;
+		if (pwm_gpio_to_channel(other) == pwm_gpio_to_channel(gpio_id))
+			return i;
+		line = i;
+	}
+	return line;
+}
 
-	for (uint16_t i = 0; i < TU_ARRAY_SIZE(gpio_id_events); i++) {
-		if (gpio_id_events[i] == true) {
-			gpio_id_events[i] = false;
-			gpio_id = i;
-			event_found = true;
-			break;
+// Chooses the smallest divider for the finest duty resolution
+static bool pwm_calc(uint32_t freq_hz, uint16_t *div16, uint16_t *top)
+{
+	uint64_t period16 = (uint64_t)clock_get_hz(clk_sys) * 16 / freq_hz;
+	uint64_t div = (period16 + 0xffff) / 0x10000;
+
+	if (div < 16)
+		div = 16;
+	TU_VERIFY(div <= 0xfff);
+	TU_VERIFY(period16 / div >= 2);
+	*div16 = (uint16_t)div;
+	*top = (uint16_t)(period16 / div - 1);
+	return true;
+}
+
+static uint32_t pwm_freq_hz(unsigned int slice)
+{
+	return (uint32_t)((uint64_t)clock_get_hz(clk_sys) * 16 /
+			  (pwm_slices[slice].div16 *
+			   (pwm_slices[slice].top + 1u)));
+}
+
+static bool pwm_enable(uint16_t pin, uint32_t freq_hz, uint16_t duty)
+{
+	unsigned int gpio_id = gpio_pins[pin];
+	unsigned int slice = pwm_gpio_to_slice_num(gpio_id);
+	uint16_t div16, top;
+
+	TU_VERIFY(freq_hz > 0);
+	TU_VERIFY(pwm_calc(freq_hz, &div16, &top));
+
+	uint16_t shared = pwm_shared_line(gpio_id);
+	if (shared != PP_GPIO_PWM_NO_LINE) {
+		unsigned int other = gpio_pins[shared];
+		if (pwm_gpio_to_channel(other) ==
+			    pwm_gpio_to_channel(gpio_id) ||
+		    div16 != pwm_slices[slice].div16 ||
+		    top != pwm_slices[slice].top) {
+			TU_LOG1("GPIO: PWM on pin %u conflicts with pin %u\r\n",
+				pin, shared);
+			return false;
 		}
 	}
 
-	irq_set_enabled(IO_IRQ_BANK0, true);
+	pwm_slices[slice].div16 = div16;
+	pwm_slices[slice].top = top;
+	pwm_duty[gpio_id] = duty;
+
+	// Rounded, 0xffff is always high with level top + 1
+	uint32_t level = ((top + 1u) * duty + 0x7fff) / 0xffff;
+	pwm_set_clkdiv_int_frac(slice, div16 >> 4, div16 & 0xf);
+	pwm_set_wrap(slice, top);
+	pwm_set_chan_level(slice, pwm_gpio_to_channel(gpio_id), level);
+	pwm_set_enabled(slice, true);
+	gpio_set_function(gpio_id, GPIO_FUNC_PWM);
+	pwm_gpios |= 1u << gpio_id;
+
+	TU_LOG2("GPIO: PWM on pin %u: %" PRIu32 " Hz, duty %u/65535\r\n", pin,
+		pwm_freq_hz(slice), duty);
+	return true;
+}
 
-	if (!event_found)
-		return false;
+static void pwm_disable(uint16_t pin)
+{
+	unsigned int gpio_id = gpio_pins[pin];
 
-	// Get pin id from gpio_id.
-	for (uint16_t i = 0; i < TU_ARRAY_SIZE(gpio_pins); i++) {
-		if (gpio_id == gpio_pins[i]) {
-			*pin = i;
-			*val = gpio_get(gpio_pins[*pin]);
+	if (!(pwm_gpios & (1u << gpio_id)))
+		return;
+
+	gpio_set_function(gpio_id, GPIO_FUNC_SIO);
+	pwm_gpios &= ~(1u << gpio_id);
+	if (pwm_shared_line(gpio_id) == PP_GPIO_PWM_NO_LINE)
+		pwm_set_enabled(pwm_gpio_to_slice_num(gpio_id), false);
+	TU_LOG2("GPIO: PWM on pin %u off\r\n", pin);
+}
+
+bool pp_gpio_handle_control_request(const tusb_control_request_t *request,
+				    uint8_t const *data_in,
+				    uint16_t data_in_len, uint8_t *data_out,
+				    uint16_t *data_out_len)
+{
+	uint16_t pin = request->wIndex;
+
+	// Not the button
+	TU_VERIFY(pin < TU_ARRAY_SIZE(gpio_pins));
+
+	switch (request->bRequest) {
+	case PP_VREQ_GPIO_SET_PWM:
+		*data_out_len = 0;
+		if (data_in_len == 0) {
+			pwm_disable(pin);
 			return true;
 		}
+		TU_VERIFY(data_in_len == 6);
+		return pwm_enable(pin, u32_from_buf_le(&data_in[0]),
+				  u16_from_buf_le(&data_in[4]));
+
+	case PP_VREQ_GPIO_GET_PWM: {
+		unsigned int gpio_id = gpio_pins[pin];
+		unsigned int slice = pwm_gpio_to_slice_num(gpio_id);
+		bool enabled = is_pwm_pin(pin);
+
+		TU_VERIFY(*data_out_len >= PP_GPIO_PWM_STATUS_LEN);
+		data_out[0] = enabled;
+		data_out[1] = (uint8_t)slice;
+		u16_to_buf_le(&data_out[2], pwm_duty[gpio_id]);
+		u32_to_buf_le(&data_out[4], enabled ? pwm_freq_hz(slice) : 0);
+		u16_to_buf_le(&data_out[8], pwm_shared_line(gpio_id));
+		*data_out_len = PP_GPIO_PWM_STATUS_LEN;
+		return true;
 	}
 
-	TU_LOG1("GPIO: Got gpio irq from unmapped GPIO pin.\r\n");
+	case PP_VREQ_GPIO_SET_COALESCE:
+		event_lines[pin].interval_ms = request->wValue;
+		TU_LOG2("GPIO: Events of pin %u at most every %u ms\r\n", pin,
+			request->wValue);
+		*data_out_len = 0;
+		return true;
+
+	case PP_VREQ_GPIO_GET_COALESCE:
+		TU_VERIFY(*data_out_len >= PP_GPIO_COALESCE_STATUS_LEN);
+		u16_to_buf_le(&data_out[0], event_lines[pin].interval_ms);
+		u16_to_buf_le(&data_out[2], event_lines[pin].pending);
+		u32_to_buf_le(&data_out[4], event_lines[pin].changes);
+		*data_out_len = PP_GPIO_COALESCE_STATUS_LEN;
+		return true;
+
+	default:
+		TU_LOG1("GPIO: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
+}
+
+static uint32_t gpio_events_sent;
+static uint32_t gpio_last_event_us;
+// Changes that were collapsed into the event of an earlier change
+static uint32_t gpio_events_collapsed;
+// Lines are checked round robin, so a noisy line can't hide the others
+static uint16_t next_event_line;
+
+static bool PP_HOT_FUNC(has_pin_event)(uint16_t *pin, uint8_t *val,
+				       uint16_t *count, uint32_t *time_us)
+{
+	uint32_t now = time_us_32();
+	uint16_t changes[TU_ARRAY_SIZE(gpio_pins)];
+	uint32_t change_us[TU_ARRAY_SIZE(gpio_pins)];
+
+	irq_set_enabled(PP_PLATFORM_GPIO_IRQ, false);
+
+	for (uint16_t i = 0; i < TU_ARRAY_SIZE(gpio_pins); i++) {
+		changes[i] = gpio_changes[gpio_pins[i]];
+		change_us[i] = gpio_change_us[gpio_pins[i]];
+		gpio_changes[gpio_pins[i]] = 0;
+	}
+
+	irq_set_enabled(PP_PLATFORM_GPIO_IRQ, true);
+
+	for (uint16_t i = 0; i < TU_ARRAY_SIZE(gpio_pins); i++) {
+		if (!event_lines[i].pending && changes[i])
+			event_lines[i].pending_us = change_us[i];
+		event_lines[i].pending =
+			TU_MIN(event_lines[i].pending + changes[i], UINT16_MAX);
+		event_lines[i].changes += changes[i];
+	}
+
+	for (uint16_t n = 0; n < TU_ARRAY_SIZE(gpio_pins); n++) {
+		uint16_t i = (next_event_line + n) % TU_ARRAY_SIZE(gpio_pins);
+
+		if (!event_lines[i].pending ||
+		    now - event_lines[i].event_us <
+			    event_lines[i].interval_ms * 1000u)
+			continue;
+
+		*pin = i;
+		*val = gpio_get(gpio_pins[i]);
+		*count = event_lines[i].pending;
+		*time_us = event_lines[i].pending_us;
+		event_lines[i].pending = 0;
+		event_lines[i].event_us = now;
+		next_event_line = i + 1;
+		return true;
+	}
 	return false;
 }
 
@@ -307,40 +544,78 @@ void check_button(void)
 #endif
 }
 
-void pp_gpio_task(void)
+void PP_HOT_FUNC(pp_gpio_task)(void)
 {
 	uint16_t pin;
 	uint8_t val;
+	uint16_t count = 1;
+	uint32_t time_us = time_us_32();
 
 	check_button();
 
-	if (!has_button_event(&pin, &val) && !has_pin_event(&pin, &val))
+	// Leave room for responses, the changes are counted meanwhile
+	if (free_message_slots() < PP_GPIO_EVENT_MIN_FREE_SLOTS)
+		return;
+
+	if (!has_button_event(&pin, &val) &&
+	    !has_pin_event(&pin, &val, &count, &time_us))
 		return;
 
-	// Event payload:
-	//   0: u16 count
-	//   2: u8 type
-	//   3: u16 pin
-	//   5: u8 value
-	//   6
-	uint8_t data[6];
-	u16_to_buf_le(&data[0], 0); // Unused by kernel driver
+	// See PP_GPIO_EVENT_LEN
+	uint8_t data[PP_GPIO_EVENT_LEN];
+	u16_to_buf_le(&data[0], count);
 	data[2] = 0; // Unused by kernel driver
 	u16_to_buf_le(&data[3], pin);
 	data[5] = val;
+	u32_to_buf_le(&data[6], time_us);
 
 	// unsolicited message, so no echo code
 	send_message_delayed(DLN2_GPIO_CONDITION_MET_EV, 0, DLN2_HANDLE_EVENT,
-			     data, 6);
+			     data, sizeof(data));
+	pp_trace(PP_TRACE_GPIO_EVENT, pin, val | (uint32_t)count << 16);
+	gpio_events_sent++;
+	gpio_events_collapsed += count - 1;
+	gpio_last_event_us = time_us_32();
 }
 
-static void gpio_callback(unsigned int gpio_id, uint32_t event_mask)
+void pp_gpio_get_state(uint32_t *levels, uint32_t *outputs)
 {
-	gpio_id_events[gpio_id] = true;
+	uint32_t in = gpio_get_all();
+	uint32_t oe = sio_hw->gpio_oe;
+
+	*levels = 0;
+	*outputs = 0;
+	for (uint16_t i = 0; i < TU_ARRAY_SIZE(gpio_pins); i++) {
+		if (in & (1u << gpio_pins[i]))
+			*levels |= 1u << i;
+		if (oe & (1u << gpio_pins[i]))
+			*outputs |= 1u << i;
+	}
+	if (is_gpio_button_pin(NUM_GPIOS - 1) && board_button_read())
+		*levels |= 1u << (NUM_GPIOS - 1);
+}
+
+void pp_gpio_get_event_stats(uint32_t *sent, uint32_t *last_us,
+			     uint32_t *collapsed)
+{
+	*sent = gpio_events_sent;
+	*last_us = gpio_last_event_us;
+	*collapsed = gpio_events_collapsed;
+}
+
+static void PP_HOT_FUNC(gpio_callback)(unsigned int gpio_id,
+				       uint32_t event_mask)
+{
+	uint16_t n = !!(event_mask & GPIO_IRQ_EDGE_RISE) +
+		     !!(event_mask & GPIO_IRQ_EDGE_FALL);
+
+	if (!gpio_changes[gpio_id])
+		gpio_change_us[gpio_id] = time_us_32();
+	if (gpio_changes[gpio_id] <= UINT16_MAX - n)
+		gpio_changes[gpio_id] += n;
 
-	TU_LOG3("GPIO: Pin %u has eventmask 0x%02" PRIx32 "\r\n", gpio_id,
-		event_mask);
-	(void)event_mask;
+	pp_trace(PP_TRACE_GPIO_IRQ, gpio_id, event_mask);
+	pp_sched_wake(PP_SCHED_GPIO);
 }
 
 void pp_gpio_init(void)
@@ -349,5 +624,5 @@ void pp_gpio_init(void)
 		gpio_init(gpio_pins[i]);
 	}
 	gpio_set_irq_callback(gpio_callback);
-	irq_set_enabled(IO_IRQ_BANK0, true);
+	irq_set_enabled(PP_PLATFORM_GPIO_IRQ, true);
 }
@@ -10,5 +10,21 @@ void pp_gpio_task(void);
 bool pp_gpio_handle_request(uint16_t cmd, uint8_t const *data_in,
 			    uint16_t data_in_len, uint8_t *data_out,
 			    uint16_t *data_out_len);
+bool pp_gpio_handle_control_request(const tusb_control_request_t *request,
+				    uint8_t const *data_in,
+				    uint16_t data_in_len, uint8_t *data_out,
+				    uint16_t *data_out_len);
+
+// Maps a gpiochip line to its GPIO number. Fails for the button.
+bool pp_gpio_line_to_gpio(uint16_t line, unsigned int *gpio_id);
+// Maps a mask of gpiochip lines to GPIO numbers. Fails for the button and
+// lines in PWM mode.
+bool pp_gpio_lines_to_mask(uint32_t lines, uint32_t *gpio_mask);
+
+// Input levels and output directions of all lines, one bit per gpiochip line
+void pp_gpio_get_state(uint32_t *levels, uint32_t *outputs);
+// CONDITION_MET events sent since boot and the time of the last one
+void pp_gpio_get_event_stats(uint32_t *sent, uint32_t *last_us,
+			     uint32_t *collapsed);
 
 #endif /* _PICOPORTS_PP_GPIO_H_ */
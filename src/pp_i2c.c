@@ -10,6 +10,7 @@
 
 #include "byte_ops.h"
 #include "dln2.h"
+#include "dln2_str.h"
 
 #ifndef PP_GPIO_ONLY
 #include "hardware/i2c.h"
@@ -19,6 +20,13 @@
 #define PP_I2C_SPEED_100KHZ (100 * 1000)
 #define PP_I2C_PIN_SDA 16
 #define PP_I2C_PIN_SCL 17
+// Abort a transfer if a byte takes longer, e.g. because a target holds SCL
+// low. A byte takes 90 us at 100 kHz.
+#define PP_I2C_TIMEOUT_PER_CHAR_US 10000
+
+// Transfers that failed, see PP_VREQ_STATS_GET
+static uint32_t i2c_naks;
+static uint32_t i2c_timeouts;
 
 // DLN2_I2C_BUF_SIZE is the maximum message size that is received and sent for
 // the i2c module. The protocol demands that we receive and send this in one
@@ -26,27 +34,15 @@
 TU_VERIFY_STATIC(DLN2_I2C_BUF_SIZE <= CFG_TUD_VENDOR_TX_BUFSIZE);
 TU_VERIFY_STATIC(DLN2_I2C_BUF_SIZE <= CFG_TUD_VENDOR_RX_BUFSIZE);
 
-TU_ATTR_UNUSED static const char *i2c_cmd2str(uint16_t cmd)
+#ifndef PP_GPIO_ONLY
+static void count_error(int ret)
 {
-	// clang-format off
-	switch (cmd) {
-	case DLN2_I2C_GET_PORT_COUNT: return "GET_PORT_COUNT";
-	case DLN2_I2C_ENABLE: return "ENABLE";
-	case DLN2_I2C_DISABLE: return "DISABLE";
-	case DLN2_I2C_IS_ENABLED: return "IS_ENABLED";
-	case DLN2_I2C_WRITE: return "WRITE";
-	case DLN2_I2C_READ: return "READ";
-	case DLN2_I2C_SCAN_DEVICES: return "SCAN_DEVICES";
-	case DLN2_I2C_PULLUP_ENABLE: return "PULLUP_ENABLE";
-	case DLN2_I2C_PULLUP_DISABLE: return "PULLUP_DISABLE";
-	case DLN2_I2C_PULLUP_IS_ENABLED: return "PULLUP_IS_ENABLED";
-	case DLN2_I2C_TRANSFER: return "TRANSFER";
-	case DLN2_I2C_SET_MAX_REPLY_COUNT: return "SET_MAX_REPLY_COUNT";
-	case DLN2_I2C_GET_MAX_REPLY_COUNT: return "GET_MAX_REPLY_COUNT";
-	default: return "???";
-	}
-	// clang-format on
+	if (ret == PICO_ERROR_TIMEOUT)
+		i2c_timeouts++;
+	else if (ret < 0)
+		i2c_naks++;
 }
+#endif
 
 bool pp_i2c_handle_request(uint16_t cmd, uint8_t const *data_in,
 			   uint16_t data_in_len, uint8_t *data_out,
@@ -86,7 +82,6 @@ bool pp_i2c_handle_request(uint16_t cmd, uint8_t const *data_in,
 		// 7: u16 buf_len
 		// 9: u8 buf[DLN2_I2C_MAX_XFER_SIZE]
 		// 9+buf_len
-		TU_VERIFY(data_in_len >= 9);
 		uint8_t addr = data_in[1];
 		uint8_t mem_addr_len = data_in[2];
 		uint32_t mem_addr = u32_from_buf_le(&data_in[3]);
@@ -100,10 +95,12 @@ bool pp_i2c_handle_request(uint16_t cmd, uint8_t const *data_in,
 		TU_LOG3("I2C: Write %u byte to 0x%02X\r\n", buf_len, addr);
 		TU_LOG3_BUF(buf, buf_len);
 
-		int num_bytes = i2c_write_blocking(PP_I2C_INST, addr, buf,
-						   buf_len, false);
+		int num_bytes = i2c_write_timeout_per_char_us(
+			PP_I2C_INST, addr, buf, buf_len, false,
+			PP_I2C_TIMEOUT_PER_CHAR_US);
 		if (num_bytes != buf_len) {
 			TU_LOG3("I2C: Write failed (%d)\r\n", num_bytes);
+			count_error(num_bytes);
 		}
 		TU_VERIFY(num_bytes == buf_len);
 		*data_out_len = 0;
@@ -116,7 +113,6 @@ bool pp_i2c_handle_request(uint16_t cmd, uint8_t const *data_in,
 		// 3: u32 mem_addr
 		// 7: u16 buf_len
 		// 9
-		TU_VERIFY(data_in_len >= 9);
 		uint8_t addr = data_in[1];
 		uint8_t mem_addr_len = data_in[2];
 		uint32_t mem_addr = u32_from_buf_le(&data_in[3]);
@@ -130,10 +126,12 @@ bool pp_i2c_handle_request(uint16_t cmd, uint8_t const *data_in,
 
 		// 0: u16 buf_len;
 		// 2: u8 buf[DLN2_I2C_MAX_XFER_SIZE]
-		int num_bytes = i2c_read_blocking(PP_I2C_INST, addr,
-						  &data_out[2], buf_len, false);
+		int num_bytes = i2c_read_timeout_per_char_us(
+			PP_I2C_INST, addr, &data_out[2], buf_len, false,
+			PP_I2C_TIMEOUT_PER_CHAR_US);
 		if (num_bytes < 0) {
 			TU_LOG3("I2C: Read failed (%d)\r\n", num_bytes);
+			count_error(num_bytes);
 		}
 		TU_VERIFY(num_bytes >= 0);
 		TU_ASSERT(num_bytes <= buf_len);
@@ -146,7 +144,7 @@ bool pp_i2c_handle_request(uint16_t cmd, uint8_t const *data_in,
 	}
 	default:
 		TU_LOG1("I2C: Command not implemented: %s (%u)\r\n",
-			i2c_cmd2str(cmd), cmd);
+			cmd2str(cmd), cmd);
 		TU_VERIFY(false);
 	}
 
@@ -168,3 +166,9 @@ int pp_i2c_init()
 #endif
 	return 0;
 }
+
+void pp_i2c_get_counters(uint32_t *naks, uint32_t *timeouts)
+{
+	*naks = i2c_naks;
+	*timeouts = i2c_timeouts;
+}
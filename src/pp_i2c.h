@@ -10,5 +10,7 @@ bool pp_i2c_handle_request(uint16_t cmd, uint8_t const *data_in,
 			   uint16_t *data_out_len);
 
 void pp_i2c_init(void);
+// Transfers that weren't acknowledged and that timed out, since boot
+void pp_i2c_get_counters(uint32_t *naks, uint32_t *timeouts);
 
 #endif /* _PICOPORTS_PP_I2C_H_ */
@@ -0,0 +1,546 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Logic analyzer. The la_sample state machine samples the pins into the RX
+ * FIFO, a DMA channel moves the words into a ring of blocks. When the data
+ * channel has filled a block, it chains to a control channel, which retriggers
+ * it with the address of the next block from a list. The capture is stopped by
+ * putting NULL into that list after the last block, which ends the chain.
+ *
+ * The la_trigger state machine runs in lock step with la_sample and counts the
+ * samples, so the trigger position is exact. It's reported in an interrupt,
+ * which schedules the stop after the post trigger samples. Pre trigger samples
+ * are what is left in the ring before the trigger. Sample and word numbers
+ * wrap around, after 2^32 samples (68 s at 62.5 MHz), so they are only
+ * compared by their differences.
+ *
+ * The capture is sent on the bulk IN endpoint of a dedicated vendor interface.
+ * Run-length encoding is done on core1, so core0 keeps serving USB.
+ */
+#include "tusb.h"
+
+#include "byte_ops.h"
+#include "pp_la.h"
+#include "pp_platform.h"
+#include "pp_vendor.h"
+
+#ifdef PP_LA
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/timer.h"
+#include "pico/multicore.h"
+
+#include "pp_la.pio.h"
+#include "ring_buf.h"
+
+#define PP_LA_PIO pio0
+#define PP_LA_PIO_IRQ PIO0_IRQ_0
+
+// The capture ring, 64 KiB on RP2040 and 128 KiB on RP2350
+#define PP_LA_BLOCK_WORDS 256
+#define PP_LA_BLOCKS (PP_PLATFORM_LA_RING_KIB * 1024 / 4 / PP_LA_BLOCK_WORDS)
+#define PP_LA_RING_WORDS (PP_LA_BLOCK_WORDS * PP_LA_BLOCKS)
+// The block being written when the stop is scheduled, and one more for the
+// interrupt latency, are not available for samples.
+#define PP_LA_SLACK_BLOCKS 2
+#define PP_LA_MAX_WORDS                                                        \
+	(PP_LA_RING_WORDS - PP_LA_SLACK_BLOCKS * PP_LA_BLOCK_WORDS)
+
+// Cycles per sample of la_sample and la_trigger
+#define PP_LA_CYCLES_PER_SAMPLE 2
+
+#define PP_LA_RLE_BUF_SIZE 4096
+#define PP_LA_RLE_MAX_RUN 0x10000
+
+struct la {
+	// Configuration
+	uint8_t pin_base;
+	uint8_t pin_count;
+	uint8_t trigger;
+	uint8_t trigger_pin;
+	uint8_t flags;
+	uint32_t rate_hz;
+	float clkdiv;
+	uint32_t pre_words;
+	uint32_t post_words;
+
+	volatile uint8_t state;
+	volatile uint8_t status;
+
+	uint sm_sample;
+	uint sm_trigger;
+	uint sample_offset;
+	uint trigger_offset;
+	uint dma_data;
+	uint dma_ctrl;
+
+	uint64_t start_us;
+	// Set by the trigger interrupt, in samples and words since the start
+	volatile uint32_t trigger_sample;
+	volatile uint32_t end_word;
+	// The sample count wrapped around before the trigger, so the whole
+	// ring holds samples
+	volatile bool wrapped;
+
+	// The data stream
+	uint32_t first_word;
+	uint32_t num_samples;
+	uint32_t stream_trigger;
+	uint32_t send_word;
+	uint32_t data_len;
+
+	// Run-length encoding on core1
+	volatile bool rle_done;
+	volatile bool rle_abort;
+	struct ring_buf rle;
+};
+
+static uint32_t ring[PP_LA_RING_WORDS];
+// Read by the control channel, which wraps around at the end of the list
+static uint32_t *block_list[PP_LA_BLOCKS]
+	__attribute__((aligned(PP_LA_BLOCKS * sizeof(uint32_t *))));
+static uint8_t rle_buf[PP_LA_RLE_BUF_SIZE];
+
+static struct la la = {
+	.rle = RING_BUF_INIT(rle_buf),
+};
+
+static inline uint32_t samples_per_word(void)
+{
+	return 32 / la.pin_count;
+}
+
+static void la_stop(void)
+{
+	pio_set_irq0_source_enabled(PP_LA_PIO,
+				    pis_sm0_rx_fifo_not_empty + la.sm_trigger,
+				    false);
+	pio_set_sm_mask_enabled(PP_LA_PIO,
+				(1u << la.sm_sample) | (1u << la.sm_trigger),
+				false);
+
+	// The data channel retriggers the control channel when aborted, so
+	// abort the control channel again afterwards.
+	dma_channel_abort(la.dma_ctrl);
+	dma_channel_abort(la.dma_data);
+	dma_channel_abort(la.dma_ctrl);
+
+	pio_sm_clear_fifos(PP_LA_PIO, la.sm_sample);
+	pio_sm_clear_fifos(PP_LA_PIO, la.sm_trigger);
+
+	// Wait until core1 has left the encoder
+	if (la.state == PP_LA_STATE_SENDING && (la.flags & PP_LA_FLAG_RLE)) {
+		la.rle_abort = true;
+		while (!la.rle_done)
+			tight_loop_contents();
+	}
+}
+
+static void la_trigger_irq(void)
+{
+	if (pio_sm_is_rx_fifo_empty(PP_LA_PIO, la.sm_trigger))
+		return;
+
+	pio_set_irq0_source_enabled(PP_LA_PIO,
+				    pis_sm0_rx_fifo_not_empty + la.sm_trigger,
+				    false);
+
+	uint32_t sample = ~pio_sm_get(PP_LA_PIO, la.sm_trigger);
+
+	// The time since the start tells how often the count wrapped around.
+	// It's late by the interrupt latency, far less than 2^31 samples.
+	uint64_t elapsed_us = time_us_64() - la.start_us;
+	uint64_t elapsed = elapsed_us / 1000000 * la.rate_hz +
+			   elapsed_us % 1000000 * la.rate_hz / 1000000;
+	int32_t late = (int32_t)((uint32_t)elapsed - sample);
+	uint64_t sample64 = elapsed - (uint64_t)(int64_t)late;
+
+	uint32_t trigger_word = sample / samples_per_word();
+	uint32_t end_word = trigger_word + la.post_words + 1;
+	uint32_t trigger_block = trigger_word / PP_LA_BLOCK_WORDS;
+	uint32_t stop_block = (end_word - 1) / PP_LA_BLOCK_WORDS;
+
+	// End the chain after the block with the last post trigger sample
+	block_list[(stop_block + 1) % PP_LA_BLOCKS] = NULL;
+
+	// The data channel is somewhere after the trigger. If it's already
+	// past the stop block, the NULL was written too late.
+	uint32_t write_addr = dma_channel_hw_addr(la.dma_data)->write_addr;
+	uint32_t cur_block =
+		(write_addr - (uintptr_t)ring) / 4 / PP_LA_BLOCK_WORDS;
+	if ((cur_block - trigger_block) % PP_LA_BLOCKS >
+	    stop_block - trigger_block)
+		la.status |= PP_LA_STATUS_OVERRUN;
+
+	la.trigger_sample = sample;
+	la.end_word = end_word;
+	la.wrapped = sample64 >> 32 != 0;
+	la.state = PP_LA_STATE_TRIGGERED;
+}
+
+static void rle_put(uint32_t value, uint32_t run)
+{
+	uint8_t rec[4];
+
+	u32_to_buf_le(rec, value | (run - 1) << 16);
+	while (ring_buf_space(&la.rle) < sizeof(rec)) {
+		if (la.rle_abort)
+			return;
+		tight_loop_contents();
+	}
+	ring_buf_write(&la.rle, rec, sizeof(rec));
+}
+
+static void rle_encode(void)
+{
+	uint32_t n = la.pin_count;
+	uint32_t mask = (1u << n) - 1;
+	uint32_t spw = samples_per_word();
+	// The value repeated in each sample of a word
+	uint32_t repeat = 0;
+	uint32_t value = ring[la.first_word % PP_LA_RING_WORDS] & mask;
+	uint32_t run = 0;
+
+	for (uint32_t i = 0; i < spw; i++)
+		repeat |= 1u << (i * n);
+
+	for (uint32_t w = la.first_word; w != la.end_word && !la.rle_abort;
+	     w++) {
+		uint32_t word = ring[w % PP_LA_RING_WORDS];
+
+		// Fast path for words without a change
+		if (word == value * repeat && run + spw <= PP_LA_RLE_MAX_RUN) {
+			run += spw;
+			continue;
+		}
+
+		for (uint32_t i = 0; i < spw; i++, word >>= n) {
+			uint32_t sample = word & mask;
+			if (sample == value && run < PP_LA_RLE_MAX_RUN) {
+				run++;
+				continue;
+			}
+			rle_put(value, run);
+			value = sample;
+			run = 1;
+		}
+	}
+
+	if (!la.rle_abort)
+		rle_put(value, run);
+}
+
+static void la_core1_main(void)
+{
+	while (true) {
+		// Started by la_start_sending()
+		multicore_fifo_pop_blocking();
+		rle_encode();
+		la.rle_done = true;
+	}
+}
+
+static void la_start_sending(void)
+{
+	uint32_t spw = samples_per_word();
+	uint32_t trigger_word = la.trigger_sample / spw;
+
+	la.first_word = trigger_word >= la.pre_words || la.wrapped ?
+				trigger_word - la.pre_words :
+				0;
+	la.num_samples = (la.end_word - la.first_word) * spw;
+	la.stream_trigger = la.trigger_sample - la.first_word * spw;
+	la.send_word = la.first_word;
+	la.data_len = 0;
+
+	TU_LOG2("LA: Trigger at sample %" PRIu32 ", sending %" PRIu32
+		" samples\r\n",
+		la.trigger_sample, la.num_samples);
+
+	la.state = PP_LA_STATE_SENDING;
+	if (la.flags & PP_LA_FLAG_RLE) {
+		la.rle.head = 0;
+		la.rle.tail = 0;
+		la.rle_done = false;
+		la.rle_abort = false;
+		multicore_fifo_push_blocking(0);
+	}
+}
+
+static void send_raw(uint32_t avail)
+{
+	while (la.send_word != la.end_word && avail >= 4) {
+		uint32_t offs = la.send_word % PP_LA_RING_WORDS;
+		uint32_t n = la.end_word - la.send_word;
+
+		if (n > PP_LA_RING_WORDS - offs)
+			n = PP_LA_RING_WORDS - offs;
+		if (n > avail / 4)
+			n = avail / 4;
+
+		n = tud_vendor_n_write(PP_VENDOR_ITF_LA, &ring[offs], n * 4) /
+		    4;
+		la.send_word += n;
+		la.data_len += n * 4;
+		avail -= n * 4;
+	}
+
+	if (la.send_word == la.end_word)
+		la.state = PP_LA_STATE_DONE;
+}
+
+static void send_rle(uint32_t avail)
+{
+	// Read before the data, so nothing produced after it is missed
+	bool done = la.rle_done;
+	const uint8_t *data;
+	uint32_t n;
+
+	while (avail && (n = ring_buf_read_ptr(&la.rle, &data))) {
+		if (n > avail)
+			n = avail;
+		n = tud_vendor_n_write(PP_VENDOR_ITF_LA, data, n);
+		ring_buf_consume(&la.rle, n);
+		la.data_len += n;
+		avail -= n;
+	}
+
+	if (done && ring_buf_is_empty(&la.rle))
+		la.state = PP_LA_STATE_DONE;
+}
+
+static bool la_configure(const uint8_t *data_in, uint16_t data_in_len)
+{
+	TU_VERIFY(data_in_len >= 17);
+	TU_VERIFY(la.state == PP_LA_STATE_IDLE ||
+		  la.state == PP_LA_STATE_DONE);
+
+	uint8_t pin_base = data_in[0];
+	uint8_t pin_count = data_in[1];
+	uint8_t trigger = data_in[2];
+	uint8_t trigger_pin = data_in[3];
+	uint32_t rate_hz = u32_from_buf_le(&data_in[4]);
+	uint32_t pre_samples = u32_from_buf_le(&data_in[8]);
+	uint32_t post_samples = u32_from_buf_le(&data_in[12]);
+	uint8_t flags = data_in[16];
+
+	TU_VERIFY(pin_count && pin_count <= 16 &&
+		  (pin_count & (pin_count - 1)) == 0);
+	TU_VERIFY(pin_base + pin_count <= NUM_BANK0_GPIOS);
+	TU_VERIFY(trigger <= PP_LA_TRIGGER_FALLING);
+	TU_VERIFY(trigger_pin < NUM_BANK0_GPIOS);
+
+	uint32_t spw = 32 / pin_count;
+	uint32_t pre_words = (pre_samples + spw - 1) / spw;
+	uint32_t post_words = (post_samples + spw - 1) / spw;
+	TU_VERIFY(pre_words <= PP_LA_MAX_WORDS &&
+		  post_words + 1 <= PP_LA_MAX_WORDS - pre_words);
+
+	uint32_t sys_hz = clock_get_hz(clk_sys);
+	TU_VERIFY(rate_hz > 0 && rate_hz <= sys_hz / PP_LA_CYCLES_PER_SAMPLE);
+	float clkdiv = (float)sys_hz / PP_LA_CYCLES_PER_SAMPLE / rate_hz;
+	TU_VERIFY(clkdiv < 65536.0f);
+
+	la.pin_base = pin_base;
+	la.pin_count = pin_count;
+	la.trigger = trigger;
+	la.trigger_pin = trigger_pin;
+	la.flags = flags;
+	la.pre_words = pre_words;
+	la.post_words = post_words;
+	la.clkdiv = clkdiv;
+	// The divider has 8 fractional bits
+	la.rate_hz = (uint32_t)((float)sys_hz / PP_LA_CYCLES_PER_SAMPLE /
+				((uint32_t)(clkdiv * 256) / 256.0f));
+	la.state = PP_LA_STATE_IDLE;
+
+	TU_LOG2("LA: GP%u-GP%u at %" PRIu32 " Hz, trigger %u on GP%u, %" PRIu32
+		"+%" PRIu32 " samples, flags 0x%02x\r\n",
+		pin_base, pin_base + pin_count - 1, la.rate_hz, trigger,
+		trigger_pin, pre_samples, post_samples, flags);
+	return true;
+}
+
+static bool la_start(void)
+{
+	static const uint8_t entry[] = {
+		[PP_LA_TRIGGER_NONE] = la_trigger_offset_trigger,
+		[PP_LA_TRIGGER_HIGH] = la_trigger_offset_high,
+		[PP_LA_TRIGGER_LOW] = la_trigger_offset_low,
+		[PP_LA_TRIGGER_RISING] = la_trigger_offset_rising,
+		[PP_LA_TRIGGER_FALLING] = la_trigger_offset_falling,
+	};
+	PIO pio = PP_LA_PIO;
+	pio_sm_config c;
+
+	TU_VERIFY(la.pin_count);
+	TU_VERIFY(la.state == PP_LA_STATE_IDLE ||
+		  la.state == PP_LA_STATE_DONE);
+
+	la.status = 0;
+	la.wrapped = false;
+
+	// Sampler, with the bit count of its IN instruction patched
+	pio->instr_mem[la.sample_offset] =
+		pio_encode_in(pio_pins, la.pin_count) |
+		pio_encode_delay(PP_LA_CYCLES_PER_SAMPLE - 1);
+	c = la_sample_program_get_default_config(la.sample_offset);
+	sm_config_set_in_pins(&c, la.pin_base);
+	sm_config_set_in_shift(&c, true, true, 32);
+	sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+	sm_config_set_clkdiv(&c, la.clkdiv);
+	pio_sm_init(pio, la.sm_sample, la.sample_offset, &c);
+
+	// Trigger, counting down from 0xffffffff
+	c = la_trigger_program_get_default_config(la.trigger_offset);
+	sm_config_set_jmp_pin(&c, la.trigger_pin);
+	sm_config_set_clkdiv(&c, la.clkdiv);
+	pio_sm_init(pio, la.sm_trigger, la.trigger_offset + entry[la.trigger],
+		    &c);
+	pio_sm_exec(pio, la.sm_trigger, pio_encode_mov_not(pio_x, pio_null));
+
+	// Data channel, started by the control channel
+	for (uint32_t i = 0; i < PP_LA_BLOCKS; i++)
+		block_list[i] = &ring[i * PP_LA_BLOCK_WORDS];
+
+	dma_channel_config dc = dma_channel_get_default_config(la.dma_data);
+	channel_config_set_transfer_data_size(&dc, DMA_SIZE_32);
+	channel_config_set_read_increment(&dc, false);
+	channel_config_set_write_increment(&dc, true);
+	channel_config_set_dreq(&dc, pio_get_dreq(pio, la.sm_sample, false));
+	channel_config_set_chain_to(&dc, la.dma_ctrl);
+	dma_channel_configure(la.dma_data, &dc, ring, &pio->rxf[la.sm_sample],
+			      PP_LA_BLOCK_WORDS, false);
+
+	dma_channel_hw_t *data_hw = dma_channel_hw_addr(la.dma_data);
+	dma_channel_config cc = dma_channel_get_default_config(la.dma_ctrl);
+	channel_config_set_transfer_data_size(&cc, DMA_SIZE_32);
+	channel_config_set_read_increment(&cc, true);
+	channel_config_set_write_increment(&cc, false);
+	channel_config_set_ring(&cc, false, __builtin_ctz(sizeof(block_list)));
+	dma_channel_configure(la.dma_ctrl, &cc, &data_hw->al2_write_addr_trig,
+			      block_list, 1, true);
+
+	la.state = PP_LA_STATE_ARMED;
+	la.start_us = time_us_64();
+	pio_set_irq0_source_enabled(pio,
+				    pis_sm0_rx_fifo_not_empty + la.sm_trigger,
+				    true);
+	pio_enable_sm_mask_in_sync(pio, (1u << la.sm_sample) |
+						(1u << la.sm_trigger));
+
+	TU_LOG2("LA: Armed\r\n");
+	return true;
+}
+#endif
+
+bool pp_la_handle_control_request(const tusb_control_request_t *request,
+				  uint8_t const *data_in, uint16_t data_in_len,
+				  uint8_t *data_out, uint16_t *data_out_len)
+{
+#ifndef PP_LA
+	(void)request;
+	(void)data_in;
+	(void)data_in_len;
+	(void)data_out;
+	(void)data_out_len;
+	return false;
+#else
+	switch (request->bRequest) {
+	case PP_VREQ_LA_CONFIGURE:
+		TU_VERIFY(la_configure(data_in, data_in_len));
+		*data_out_len = 0;
+		return true;
+
+	case PP_VREQ_LA_START:
+		TU_VERIFY(la_start());
+		*data_out_len = 0;
+		return true;
+
+	case PP_VREQ_LA_STOP:
+		if (la.state != PP_LA_STATE_IDLE)
+			la_stop();
+		la.state = PP_LA_STATE_IDLE;
+		*data_out_len = 0;
+		return true;
+
+	case PP_VREQ_LA_GET_STATUS: {
+		TU_VERIFY(*data_out_len >= PP_LA_STATUS_LEN);
+		uint32_t max_samples = 0;
+		if (la.pin_count)
+			max_samples = (PP_LA_MAX_WORDS - 1) *
+				      samples_per_word();
+		data_out[0] = la.state;
+		data_out[1] = la.status;
+		u16_to_buf_le(&data_out[2], 0);
+		u32_to_buf_le(&data_out[4], la.rate_hz);
+		u32_to_buf_le(&data_out[8], la.num_samples);
+		u32_to_buf_le(&data_out[12], la.stream_trigger);
+		u32_to_buf_le(&data_out[16], la.data_len);
+		u32_to_buf_le(&data_out[20], max_samples);
+		*data_out_len = PP_LA_STATUS_LEN;
+		return true;
+	}
+
+	default:
+		TU_LOG1("LA: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
+#endif
+}
+
+void pp_la_task(void)
+{
+#ifdef PP_LA
+	switch (la.state) {
+	case PP_LA_STATE_TRIGGERED:
+		// The chain ends after the stop block
+		if (dma_channel_is_busy(la.dma_data) ||
+		    dma_channel_is_busy(la.dma_ctrl))
+			break;
+		la_stop();
+		la_start_sending();
+		break;
+
+	case PP_LA_STATE_SENDING: {
+		uint32_t avail =
+			tud_vendor_n_write_available(PP_VENDOR_ITF_LA);
+		if (!avail)
+			break;
+		if (la.flags & PP_LA_FLAG_RLE)
+			send_rle(avail);
+		else
+			send_raw(avail);
+		tud_vendor_n_write_flush(PP_VENDOR_ITF_LA);
+		break;
+	}
+
+	default:
+		break;
+	}
+#endif
+}
+
+void pp_la_init(void)
+{
+#ifdef PP_LA
+	PIO pio = PP_LA_PIO;
+
+	la.sm_sample = pio_claim_unused_sm(pio, true);
+	la.sm_trigger = pio_claim_unused_sm(pio, true);
+	la.sample_offset = pio_add_program(pio, &la_sample_program);
+	la.trigger_offset = pio_add_program(pio, &la_trigger_program);
+	la.dma_data = dma_claim_unused_channel(true);
+	la.dma_ctrl = dma_claim_unused_channel(true);
+
+	irq_add_shared_handler(PP_LA_PIO_IRQ, la_trigger_irq,
+			       PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+	irq_set_enabled(PP_LA_PIO_IRQ, true);
+
+	multicore_launch_core1(la_core1_main);
+#endif
+}
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_PP_PLATFORM_H_
+#define _PICOPORTS_PP_PLATFORM_H_
+
+// Differences between the chips PicoPorts runs on, selected by the PLATFORM
+// build option. The Pico and the Pico 2 have the same pinout, so the modules
+// only use the macros below where the chips differ.
+
+#include "pico.h"
+
+#include "bsp/board_api.h"
+#include "hardware/irq.h"
+#include "hardware/structs/usb.h"
+
+#include "byte_ops.h"
+
+#if PICO_RP2350
+#if !PICO_RP2350A
+#error Only the RP2350A (Pico 2) is supported!
+#endif
+#define PP_PLATFORM_NAME "rp2350"
+// 128 KiB of the 520 KiB SRAM
+#define PP_PLATFORM_LA_RING_KIB 128
+#elif PICO_RP2040
+#define PP_PLATFORM_NAME "rp2040"
+// 64 KiB of the 264 KiB SRAM
+#define PP_PLATFORM_LA_RING_KIB 64
+#else
+#error Only RP2040 and RP2350 are supported!
+#endif
+
+// On-board LED and the ADC input with the 1/3 voltage divider on VSYS
+#define PP_PLATFORM_LED_GPIO 25
+#define PP_PLATFORM_VSYS_GPIO 29
+
+// ADC input n is on GPIO PP_PLATFORM_ADC_GPIO + n, the temperature sensor is
+// the last input. Both chips have 4 ADC GPIOs, GP26-GP29.
+#ifdef ADC_BASE_PIN
+#define PP_PLATFORM_ADC_GPIO ADC_BASE_PIN
+#else
+#define PP_PLATFORM_ADC_GPIO 26
+#endif
+#define PP_PLATFORM_ADC_TEMP (NUM_ADC_CHANNELS - 1)
+
+// The bank 0 GPIO interrupt. Its number differs (13 on the RP2040, 21 on the
+// RP2350), IO_IRQ_BANK0 of the SDK has the right one for each chip.
+#define PP_PLATFORM_GPIO_IRQ IO_IRQ_BANK0
+
+// The PIO blocks in the order the frequency counters claim state machines.
+// The logic analyzer uses pio0, SEQ and QUAD use pio1, so on the RP2350 the
+// counters get the third block to themselves.
+#if NUM_PIOS > 2
+#define PP_PLATFORM_COUNTER_PIOS { pio2, pio1, pio0 }
+#else
+#define PP_PLATFORM_COUNTER_PIOS { pio1, pio0 }
+#endif
+
+// Functions and data on the paths from an interrupt or a USB packet to the
+// message sent in return. Code runs from flash through the XIP cache, a cache
+// miss costs microseconds. With the build option RAM_HOT_PATHS they're copied
+// to SRAM at boot instead, see PP_VREQ_STATS_GET_XIP.
+#ifdef PP_RAM_HOT_PATHS
+#define PP_HOT_FUNC(name) __not_in_flash_func(name)
+#define PP_HOT_DATA __not_in_flash("pp_hot_data")
+#else
+#define PP_HOT_FUNC(name) name
+#define PP_HOT_DATA
+#endif
+
+// Frame number of the latest USB start of frame
+static inline uint16_t pp_platform_usb_frame(void)
+{
+	return usb_hw->sof_rd & USB_SOF_RD_BITS;
+}
+
+// The device serial number, the same call on both chips. The RP2040 has no ID
+// of its own, so the SDK reads the unique ID of the flash chip at boot. On the
+// RP2350 it returns the chip ID from OTP.
+static inline bool pp_platform_serial(uint32_t *sn)
+{
+	uint8_t uid[4];
+
+	TU_VERIFY(board_get_unique_id(uid, sizeof(uid)) == sizeof(uid));
+	*sn = u32_from_buf_le(uid);
+	return true;
+}
+
+#endif /* _PICOPORTS_PP_PLATFORM_H_ */
@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Quadrature encoder decoder. A PIO state machine per encoder samples the A/B
+ * inputs every five to nine system clock cycles and keeps the position and the
+ * error count in its Y and X registers, so no step is lost to USB or interrupt
+ * latency.
+ *
+ * To read the registers, the state machine is paused and MOV/PUSH instructions
+ * are executed on it. These clobber ISR, which the program only uses for three
+ * instructions. OSR is either dead there or holds the same value, so ISR is
+ * saved to OSR and restored afterwards. Decoding is based on states, not
+ * edges, so a pause only loses steps if both inputs change during it.
+ */
+#include "tusb.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+#include "main.h"
+#include "pp_gpio.h"
+#include "pp_quad.h"
+#include "pp_vendor.h"
+
+#ifdef PP_QUAD
+#include "hardware/pio.h"
+#include "hardware/timer.h"
+
+#include "pp_quad.pio.h"
+
+#define PP_QUAD_PIO pio1
+
+struct quad {
+	bool enabled;
+	uint sm;
+	uint16_t line_a;
+	uint16_t event_interval_ms;
+
+	int32_t position;
+	uint32_t errors;
+	uint32_t time_us;
+
+	// Last position sent as event
+	int32_t event_position;
+	uint32_t event_errors;
+	uint32_t event_us;
+};
+
+static struct quad quads[PP_QUAD_MAX_ENCODERS];
+
+static void quad_read(struct quad *q)
+{
+	PIO pio = PP_QUAD_PIO;
+
+	pio_sm_set_enabled(pio, q->sm, false);
+	// Paused after the OUT to ISR, before the MOV PC. Up to the MOV to
+	// OSR, OSR is overwritten before it's used again, after it OSR already
+	// equals ISR.
+	uint pc = pio_sm_get_pc(pio, q->sm);
+	bool isr_live = pc > quad_offset_sample && pc <= quad_offset_sample + 3;
+
+	if (isr_live)
+		pio_sm_exec(pio, q->sm, pio_encode_mov(pio_osr, pio_isr));
+	pio_sm_exec(pio, q->sm, pio_encode_mov(pio_isr, pio_y));
+	pio_sm_exec(pio, q->sm, pio_encode_push(false, false));
+	pio_sm_exec(pio, q->sm, pio_encode_mov(pio_isr, pio_x));
+	pio_sm_exec(pio, q->sm, pio_encode_push(false, false));
+	if (isr_live)
+		pio_sm_exec(pio, q->sm, pio_encode_mov(pio_isr, pio_osr));
+	pio_sm_set_enabled(pio, q->sm, true);
+
+	q->time_us = time_us_32();
+	q->position = (int32_t)pio_sm_get(pio, q->sm);
+	// Counts down from 0
+	q->errors = -pio_sm_get(pio, q->sm);
+}
+
+static void quad_stop(struct quad *q)
+{
+	if (!q->enabled)
+		return;
+	pio_sm_set_enabled(PP_QUAD_PIO, q->sm, false);
+	q->enabled = false;
+}
+
+static bool quad_start(struct quad *q, uint16_t line_a, uint16_t line_b,
+		       uint16_t event_interval_ms)
+{
+	PIO pio = PP_QUAD_PIO;
+	uint gpio_a, gpio_b;
+
+	TU_VERIFY(pp_gpio_line_to_gpio(line_a, &gpio_a));
+	TU_VERIFY(pp_gpio_line_to_gpio(line_b, &gpio_b));
+	// Sampled with a single IN instruction
+	TU_VERIFY(gpio_b == gpio_a + 1);
+
+	quad_stop(q);
+
+	pio_sm_config c = quad_program_get_default_config(0);
+	sm_config_set_in_pins(&c, gpio_a);
+	sm_config_set_in_shift(&c, false, false, 32);
+	sm_config_set_out_shift(&c, true, false, 32);
+	pio_sm_init(pio, q->sm, quad_offset_sample, &c);
+	pio_sm_clear_fifos(pio, q->sm);
+
+	// Start from the current state without counting it
+	pio_sm_exec(pio, q->sm, pio_encode_mov(pio_isr, pio_null));
+	pio_sm_exec(pio, q->sm, pio_encode_in(pio_pins, 2));
+	pio_sm_exec(pio, q->sm, pio_encode_mov(pio_osr, pio_isr));
+	pio_sm_exec(pio, q->sm, pio_encode_mov(pio_x, pio_null));
+	pio_sm_exec(pio, q->sm, pio_encode_mov(pio_y, pio_null));
+	pio_sm_set_enabled(pio, q->sm, true);
+
+	q->enabled = true;
+	q->line_a = line_a;
+	q->event_interval_ms = event_interval_ms;
+	q->position = 0;
+	q->errors = 0;
+	q->time_us = time_us_32();
+	q->event_position = 0;
+	q->event_errors = 0;
+	q->event_us = q->time_us;
+
+	TU_LOG2("QUAD: Encoder on lines %u/%u, events every %u ms\r\n", line_a,
+		line_b, event_interval_ms);
+	return true;
+}
+
+static void quad_to_buf(const struct quad *q, uint8_t *buf)
+{
+	buf[0] = q->enabled;
+	buf[1] = 0;
+	u16_to_buf_le(&buf[2], q->line_a);
+	u32_to_buf_le(&buf[4], (uint32_t)q->position);
+	u32_to_buf_le(&buf[8], q->errors);
+	u32_to_buf_le(&buf[12], q->time_us);
+}
+#endif
+
+void pp_quad_task(void)
+{
+#ifdef PP_QUAD
+	uint32_t now = time_us_32();
+
+	for (uint i = 0; i < PP_QUAD_MAX_ENCODERS; i++) {
+		struct quad *q = &quads[i];
+		uint8_t data[1 + PP_QUAD_STATUS_LEN];
+
+		if (!q->enabled || !q->event_interval_ms ||
+		    now - q->event_us < q->event_interval_ms * 1000u)
+			continue;
+		quad_read(q);
+		if (q->position == q->event_position &&
+		    q->errors == q->event_errors)
+			continue;
+
+		q->event_position = q->position;
+		q->event_errors = q->errors;
+		q->event_us = now;
+		data[0] = i;
+		quad_to_buf(q, &data[1]);
+		send_user_message_delayed(PP_QUAD_EV, 0, DLN2_HANDLE_EVENT,
+					  data, sizeof(data));
+	}
+#endif
+}
+
+bool pp_quad_handle_control_request(const tusb_control_request_t *request,
+				    uint8_t const *data_in,
+				    uint16_t data_in_len, uint8_t *data_out,
+				    uint16_t *data_out_len)
+{
+#ifndef PP_QUAD
+	(void)request;
+	(void)data_in;
+	(void)data_in_len;
+	(void)data_out;
+	(void)data_out_len;
+	return false;
+#else
+	TU_VERIFY(request->wIndex < PP_QUAD_MAX_ENCODERS);
+	struct quad *q = &quads[request->wIndex];
+
+	switch (request->bRequest) {
+	case PP_VREQ_QUAD_SET:
+		*data_out_len = 0;
+		if (data_in_len == 0) {
+			quad_stop(q);
+			return true;
+		}
+		TU_VERIFY(data_in_len == 6);
+		return quad_start(q, u16_from_buf_le(&data_in[0]),
+				  u16_from_buf_le(&data_in[2]),
+				  u16_from_buf_le(&data_in[4]));
+
+	case PP_VREQ_QUAD_GET:
+		TU_VERIFY(*data_out_len >= PP_QUAD_STATUS_LEN);
+		if (q->enabled)
+			quad_read(q);
+		quad_to_buf(q, data_out);
+		*data_out_len = PP_QUAD_STATUS_LEN;
+		return true;
+
+	default:
+		TU_LOG1("QUAD: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
+#endif
+}
+
+void pp_quad_init(void)
+{
+#ifdef PP_QUAD
+	// Loaded at offset 0, programs added later go to the remaining space
+	pio_add_program(PP_QUAD_PIO, &quad_program);
+	for (uint i = 0; i < PP_QUAD_MAX_ENCODERS; i++)
+		quads[i].sm = pio_claim_unused_sm(PP_QUAD_PIO, true);
+#endif
+}
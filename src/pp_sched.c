@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Event driven main loop. Interrupt handlers mark events as pending, the main
+ * loop runs the tasks interested in the pending events and sleeps with WFE
+ * while there are none. Time based work (intervals, timeouts, the button)
+ * runs with a periodic tick. Setting an event also sends SEV, so an event
+ * between checking for events and WFE isn't lost.
+ */
+#include "tusb.h"
+
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "pico/time.h"
+
+#include "pp_platform.h"
+#include "pp_sched.h"
+
+static volatile uint32_t pending;
+// Time each pending event was set first, for the wakeup latency
+static volatile uint32_t pending_us[PP_SCHED_SOURCES];
+
+static uint32_t slept_us;
+static uint32_t wakeups;
+static uint32_t event_count[PP_SCHED_SOURCES];
+static uint32_t event_max_us[PP_SCHED_SOURCES];
+static uint32_t event_total_us[PP_SCHED_SOURCES];
+
+static repeating_timer_t tick_timer;
+
+static bool tick_cb(repeating_timer_t *rt)
+{
+	(void)rt;
+	pp_sched_wake(PP_SCHED_TICK);
+	return true;
+}
+
+void pp_sched_init(void)
+{
+	// A negative delay keeps the rate independent of the callback time
+	add_repeating_timer_us(-PP_SCHED_TICK_US, tick_cb, NULL, &tick_timer);
+}
+
+void PP_HOT_FUNC(pp_sched_wake)(uint32_t events)
+{
+	uint32_t irq = save_and_disable_interrupts();
+	uint32_t now = time_us_32();
+
+	for (uint8_t i = 0; i < PP_SCHED_SOURCES; i++) {
+		if ((events & ~pending) & (1u << i))
+			pending_us[i] = now;
+	}
+	pending |= events;
+	restore_interrupts(irq);
+	__sev();
+}
+
+static uint32_t PP_HOT_FUNC(take_events)(void)
+{
+	uint32_t irq = save_and_disable_interrupts();
+	uint32_t events = pending;
+
+	pending = 0;
+	restore_interrupts(irq);
+
+	if (!events)
+		return 0;
+
+	uint32_t now = time_us_32();
+	for (uint8_t i = 0; i < PP_SCHED_SOURCES; i++) {
+		if (!(events & (1u << i)))
+			continue;
+
+		uint32_t latency = now - pending_us[i];
+		event_count[i]++;
+		event_total_us[i] += latency;
+		if (latency > event_max_us[i])
+			event_max_us[i] = latency;
+	}
+	return events;
+}
+
+uint32_t pp_sched_wait(void)
+{
+	uint32_t events = take_events();
+
+	if (events)
+		return events;
+
+	uint32_t start = time_us_32();
+	do {
+		__wfe();
+	} while (!(events = take_events()));
+	slept_us += time_us_32() - start;
+	wakeups++;
+	return events;
+}
+
+void pp_sched_get_stats(uint32_t *sleep_total_us, uint32_t *wakeup_count,
+			uint32_t count[PP_SCHED_SOURCES],
+			uint32_t max_latency_us[PP_SCHED_SOURCES],
+			uint32_t total_latency_us[PP_SCHED_SOURCES])
+{
+	*sleep_total_us = slept_us;
+	*wakeup_count = wakeups;
+	for (uint8_t i = 0; i < PP_SCHED_SOURCES; i++) {
+		count[i] = event_count[i];
+		max_latency_us[i] = event_max_us[i];
+		total_latency_us[i] = event_total_us[i];
+	}
+}
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_PP_SCHED_H_
+#define _PICOPORTS_PP_SCHED_H_
+
+// Events that wake the main loop, see pp_sched.c
+#define PP_SCHED_USB 0x01 // TinyUSB queued an event
+#define PP_SCHED_GPIO 0x02 // GPIO interrupt
+#define PP_SCHED_UART 0x04 // UART interrupt
+#define PP_SCHED_TICK 0x08 // Every PP_SCHED_TICK_US
+#define PP_SCHED_BUSY 0x10 // A task has more work right away
+#define PP_SCHED_SOURCES 5
+
+#define PP_SCHED_TICK_US 1000
+
+void pp_sched_init(void);
+// Marks events as pending, may be called from interrupt handlers
+void pp_sched_wake(uint32_t events);
+// Returns the pending events, sleeps until there is one
+uint32_t pp_sched_wait(void);
+// Counters for PP_VREQ_STATS_GET_SCHED
+void pp_sched_get_stats(uint32_t *sleep_total_us, uint32_t *wakeup_count,
+			uint32_t count[PP_SCHED_SOURCES],
+			uint32_t max_latency_us[PP_SCHED_SOURCES],
+			uint32_t total_latency_us[PP_SCHED_SOURCES]);
+
+#endif /* _PICOPORTS_PP_SCHED_H_ */
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Scripts of DLN2 requests, run from the main loop. A few instructions are
+ * executed per pass, so USB and the other modules are still served while a
+ * script runs, and delays don't block at all. The interpreter itself is in
+ * pp_script_vm.c, which the host tools build as well.
+ */
+#include "tusb.h"
+
+#include "dln2.h"
+#include "main.h"
+#include "pp_sched.h"
+#include "pp_script.h"
+#include "pp_vendor.h"
+
+#ifdef PP_SCRIPT
+#include "hardware/timer.h"
+
+#include "pp_script_vm.h"
+
+// Instructions per pass of the main loop
+#define PP_SCRIPT_OPS_PER_TASK 16
+
+static uint8_t script_code[PP_SCRIPT_MAX_LEN];
+static uint16_t script_flags;
+
+static bool script_request(void *ctx, uint8_t handle, uint16_t cmd,
+			   const uint8_t *data_in, uint16_t data_in_len,
+			   uint8_t *data_out, uint16_t *data_out_len)
+{
+	(void)ctx;
+	return handle_dln2_request(handle, cmd, data_in, data_in_len, data_out,
+				   data_out_len);
+}
+
+static uint32_t script_time_us(void *ctx)
+{
+	(void)ctx;
+	return time_us_32();
+}
+
+static struct pp_script_vm vm = {
+	.request = script_request,
+	.time_us = script_time_us,
+	.code = script_code,
+};
+
+static void script_ended(void)
+{
+	TU_LOG2("SCRIPT: Ended with error 0x%02x at %u\r\n", vm.error, vm.pc);
+
+	if (script_flags & PP_SCRIPT_FLAG_EVENT) {
+		uint8_t data[PP_SCRIPT_STATUS_LEN + PP_SCRIPT_RESULT_MAX];
+
+		pp_script_vm_status(&vm, data);
+		memcpy(&data[PP_SCRIPT_STATUS_LEN], vm.result, vm.result_len);
+		send_user_message_delayed(PP_SCRIPT_DONE_EV, 0,
+					  DLN2_HANDLE_EVENT, data,
+					  PP_SCRIPT_STATUS_LEN + vm.result_len);
+	}
+}
+#endif
+
+void pp_script_task(void)
+{
+#ifdef PP_SCRIPT
+	if (vm.state != PP_SCRIPT_STATE_RUNNING)
+		return;
+
+	pp_script_vm_run(&vm, PP_SCRIPT_OPS_PER_TASK);
+	if (vm.state != PP_SCRIPT_STATE_RUNNING) {
+		script_ended();
+		return;
+	}
+
+	// Delays are checked with the tick, except for their last part, which
+	// keeps them precise.
+	if (!vm.delaying ||
+	    (int32_t)(vm.wake_us - time_us_32()) < PP_SCHED_TICK_US)
+		pp_sched_wake(PP_SCHED_BUSY);
+#endif
+}
+
+bool pp_script_handle_control_request(const tusb_control_request_t *request,
+				      uint8_t const *data_in,
+				      uint16_t data_in_len, uint8_t *data_out,
+				      uint16_t *data_out_len)
+{
+#ifndef PP_SCRIPT
+	(void)request;
+	(void)data_in;
+	(void)data_in_len;
+	(void)data_out;
+	(void)data_out_len;
+	return false;
+#else
+	switch (request->bRequest) {
+	case PP_VREQ_SCRIPT_LOAD: {
+		uint16_t offset = request->wValue;
+
+		TU_VERIFY(vm.state != PP_SCRIPT_STATE_RUNNING);
+		TU_VERIFY(offset <= vm.len);
+		TU_VERIFY(data_in_len <= PP_SCRIPT_MAX_LEN - offset);
+
+		memcpy(&script_code[offset], data_in, data_in_len);
+		vm.len = offset + data_in_len;
+		vm.state = PP_SCRIPT_STATE_IDLE;
+		vm.error = PP_SCRIPT_ERR_NONE;
+		vm.pc = 0;
+		vm.result_len = 0;
+		*data_out_len = 0;
+		return true;
+	}
+
+	case PP_VREQ_SCRIPT_RUN:
+		TU_VERIFY(vm.state != PP_SCRIPT_STATE_RUNNING);
+		TU_VERIFY(vm.len > 0);
+		script_flags = request->wValue;
+		pp_script_vm_start(&vm, script_code, vm.len);
+		TU_LOG2("SCRIPT: Running %u bytes\r\n", vm.len);
+		*data_out_len = 0;
+		return true;
+
+	case PP_VREQ_SCRIPT_STOP:
+		if (vm.state == PP_SCRIPT_STATE_RUNNING) {
+			pp_script_vm_stop(&vm);
+			script_ended();
+		}
+		*data_out_len = 0;
+		return true;
+
+	case PP_VREQ_SCRIPT_GET_STATUS:
+		TU_VERIFY(*data_out_len >= PP_SCRIPT_STATUS_LEN);
+		pp_script_vm_status(&vm, data_out);
+		*data_out_len = PP_SCRIPT_STATUS_LEN;
+		return true;
+
+	case PP_VREQ_SCRIPT_GET_RESULT: {
+		uint16_t offset = request->wValue;
+
+		TU_VERIFY(offset <= vm.result_len);
+		*data_out_len = TU_MIN(*data_out_len, vm.result_len - offset);
+		memcpy(data_out, &vm.result[offset], *data_out_len);
+		return true;
+	}
+
+	default:
+		TU_LOG1("SCRIPT: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
+#endif
+}
@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#include <string.h>
+
+#include "pp_script_vm.h"
+
+#include "byte_ops.h"
+
+// Operand length of each opcode, without the data of PP_SCRIPT_OP_REQ
+static const uint8_t operand_len[] = {
+	[PP_SCRIPT_OP_END] = 0,
+	[PP_SCRIPT_OP_REQ] = 5,
+	[PP_SCRIPT_OP_DELAY] = 4,
+	[PP_SCRIPT_OP_LOAD] = 3,
+	[PP_SCRIPT_OP_SET] = 4,
+	[PP_SCRIPT_OP_AND] = 4,
+	[PP_SCRIPT_OP_SAVE] = 4,
+	[PP_SCRIPT_OP_SAVE_ACC] = 1,
+	[PP_SCRIPT_OP_JUMP] = 7,
+	[PP_SCRIPT_OP_COUNT] = 4,
+	[PP_SCRIPT_OP_LOOP] = 2,
+	[PP_SCRIPT_OP_FAIL] = 1,
+};
+
+static void vm_end(struct pp_script_vm *vm, uint8_t error)
+{
+	vm->state = error ? PP_SCRIPT_STATE_FAILED : PP_SCRIPT_STATE_DONE;
+	vm->error = error;
+	vm->delaying = false;
+	vm->end_us = vm->time_us(vm->ctx);
+}
+
+static bool vm_cond(uint32_t acc, uint8_t cond, uint32_t value, bool *met)
+{
+	switch (cond) {
+	case PP_SCRIPT_COND_ALWAYS:
+		*met = true;
+		break;
+	case PP_SCRIPT_COND_EQ:
+		*met = acc == value;
+		break;
+	case PP_SCRIPT_COND_NE:
+		*met = acc != value;
+		break;
+	case PP_SCRIPT_COND_LT:
+		*met = acc < value;
+		break;
+	case PP_SCRIPT_COND_GE:
+		*met = acc >= value;
+		break;
+	case PP_SCRIPT_COND_GT:
+		*met = acc > value;
+		break;
+	case PP_SCRIPT_COND_LE:
+		*met = acc <= value;
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+static uint32_t vm_load(const uint8_t *buf, uint8_t size)
+{
+	switch (size) {
+	case 1:
+		return buf[0];
+	case 2:
+		return u16_from_buf_le(buf);
+	default:
+		return u32_from_buf_le(buf);
+	}
+}
+
+static uint8_t vm_save(struct pp_script_vm *vm, const uint8_t *buf,
+		       uint16_t len)
+{
+	if (len > PP_SCRIPT_RESULT_MAX - vm->result_len)
+		return PP_SCRIPT_ERR_RESULT;
+	memcpy(&vm->result[vm->result_len], buf, len);
+	vm->result_len += len;
+	return PP_SCRIPT_ERR_NONE;
+}
+
+// Executes the instruction at pc. Returns an error to end the script with,
+// PP_SCRIPT_ERR_NONE otherwise. END is handled by the caller.
+static uint8_t vm_step(struct pp_script_vm *vm, uint8_t op, const uint8_t *arg,
+		       uint16_t next)
+{
+	uint16_t target = next;
+
+	switch (op) {
+	case PP_SCRIPT_OP_REQ: {
+		uint16_t len = u16_from_buf_le(&arg[3]);
+		uint16_t resp_len = sizeof(vm->resp);
+
+		if (len > vm->len - next)
+			return PP_SCRIPT_ERR_OP;
+		next += len;
+		target = next;
+		if (!vm->request(vm->ctx, arg[0], u16_from_buf_le(&arg[1]),
+				 &arg[5], len, vm->resp, &resp_len)) {
+			vm->resp_len = 0;
+			return PP_SCRIPT_ERR_REQUEST;
+		}
+		vm->resp_len = resp_len;
+		break;
+	}
+
+	case PP_SCRIPT_OP_DELAY: {
+		uint32_t us = u32_from_buf_le(arg);
+
+		if (us > INT32_MAX)
+			return PP_SCRIPT_ERR_OP;
+		vm->delaying = true;
+		vm->wake_us = vm->time_us(vm->ctx) + us;
+		break;
+	}
+
+	case PP_SCRIPT_OP_LOAD: {
+		uint16_t offset = u16_from_buf_le(arg);
+		uint8_t size = arg[2];
+
+		if (size != 1 && size != 2 && size != 4)
+			return PP_SCRIPT_ERR_OP;
+		if (offset > vm->resp_len || size > vm->resp_len - offset)
+			return PP_SCRIPT_ERR_RESPONSE;
+		vm->acc = vm_load(&vm->resp[offset], size);
+		break;
+	}
+
+	case PP_SCRIPT_OP_SET:
+		vm->acc = u32_from_buf_le(arg);
+		break;
+
+	case PP_SCRIPT_OP_AND:
+		vm->acc &= u32_from_buf_le(arg);
+		break;
+
+	case PP_SCRIPT_OP_SAVE: {
+		uint16_t offset = u16_from_buf_le(arg);
+		uint16_t len = u16_from_buf_le(&arg[2]);
+
+		if (offset > vm->resp_len || len > vm->resp_len - offset)
+			return PP_SCRIPT_ERR_RESPONSE;
+		uint8_t err = vm_save(vm, &vm->resp[offset], len);
+		if (err)
+			return err;
+		break;
+	}
+
+	case PP_SCRIPT_OP_SAVE_ACC: {
+		uint8_t buf[4];
+
+		if (arg[0] != 1 && arg[0] != 2 && arg[0] != 4)
+			return PP_SCRIPT_ERR_OP;
+		u32_to_buf_le(buf, vm->acc);
+		uint8_t err = vm_save(vm, buf, arg[0]);
+		if (err)
+			return err;
+		break;
+	}
+
+	case PP_SCRIPT_OP_JUMP: {
+		bool met;
+
+		if (!vm_cond(vm->acc, arg[0], u32_from_buf_le(&arg[1]), &met))
+			return PP_SCRIPT_ERR_OP;
+		if (met)
+			target = u16_from_buf_le(&arg[5]);
+		break;
+	}
+
+	case PP_SCRIPT_OP_COUNT:
+		vm->count = u32_from_buf_le(arg);
+		break;
+
+	case PP_SCRIPT_OP_LOOP:
+		if (vm->count && --vm->count)
+			target = u16_from_buf_le(arg);
+		break;
+
+	case PP_SCRIPT_OP_FAIL:
+		return PP_SCRIPT_ERR_FAIL | (arg[0] & 0x7f);
+
+	default:
+		return PP_SCRIPT_ERR_OP;
+	}
+
+	// A jump to the end is fine, it ends the script
+	if (target > vm->len)
+		return PP_SCRIPT_ERR_JUMP;
+	vm->pc = target;
+	return PP_SCRIPT_ERR_NONE;
+}
+
+void pp_script_vm_start(struct pp_script_vm *vm, const uint8_t *code,
+			uint16_t len)
+{
+	vm->code = code;
+	vm->len = len;
+	vm->state = PP_SCRIPT_STATE_RUNNING;
+	vm->error = PP_SCRIPT_ERR_NONE;
+	vm->pc = 0;
+	vm->acc = 0;
+	vm->count = 0;
+	vm->delaying = false;
+	vm->resp_len = 0;
+	vm->result_len = 0;
+	vm->start_us = vm->time_us(vm->ctx);
+}
+
+void pp_script_vm_run(struct pp_script_vm *vm, unsigned int max_ops)
+{
+	while (vm->state == PP_SCRIPT_STATE_RUNNING && max_ops--) {
+		if (vm->delaying) {
+			if ((int32_t)(vm->time_us(vm->ctx) - vm->wake_us) < 0)
+				return;
+			vm->delaying = false;
+		}
+
+		if (vm->pc >= vm->len || vm->code[vm->pc] == PP_SCRIPT_OP_END) {
+			vm_end(vm, PP_SCRIPT_ERR_NONE);
+			return;
+		}
+
+		uint8_t op = vm->code[vm->pc];
+		if (op >= sizeof(operand_len) ||
+		    operand_len[op] >= vm->len - vm->pc) {
+			vm_end(vm, PP_SCRIPT_ERR_OP);
+			return;
+		}
+
+		uint16_t next = vm->pc + 1 + operand_len[op];
+		uint8_t err = vm_step(vm, op, &vm->code[vm->pc + 1], next);
+		if (err) {
+			vm_end(vm, err);
+			return;
+		}
+	}
+}
+
+void pp_script_vm_stop(struct pp_script_vm *vm)
+{
+	if (vm->state == PP_SCRIPT_STATE_RUNNING)
+		vm_end(vm, PP_SCRIPT_ERR_STOPPED);
+}
+
+void pp_script_vm_status(const struct pp_script_vm *vm, uint8_t *buf)
+{
+	uint32_t run_us = 0;
+
+	if (vm->state == PP_SCRIPT_STATE_RUNNING)
+		run_us = vm->time_us(vm->ctx) - vm->start_us;
+	else if (vm->state != PP_SCRIPT_STATE_IDLE)
+		run_us = vm->end_us - vm->start_us;
+
+	buf[0] = vm->state;
+	buf[1] = vm->error;
+	u16_to_buf_le(&buf[2], vm->pc);
+	u16_to_buf_le(&buf[4], vm->len);
+	u16_to_buf_le(&buf[6], vm->result_len);
+	u32_to_buf_le(&buf[8], vm->acc);
+	u32_to_buf_le(&buf[12], run_us);
+}
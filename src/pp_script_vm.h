@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Interpreter for the script bytecode of pp_vendor.h. It has no dependencies
+ * on the hardware, requests and time come from callbacks, so the host tools
+ * can run the same code against simulated peripherals.
+ */
+#ifndef _PICOPORTS_PP_SCRIPT_VM_H_
+#define _PICOPORTS_PP_SCRIPT_VM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pp_vendor.h"
+
+// Payload of a DLN2 response, without the response code
+#define PP_SCRIPT_RESP_MAX 502
+
+struct pp_script_vm {
+	// Handles a DLN2 request like the handlers of the DLN2 interface.
+	// data_out_len is the size of data_out on entry.
+	bool (*request)(void *ctx, uint8_t handle, uint16_t cmd,
+			const uint8_t *data_in, uint16_t data_in_len,
+			uint8_t *data_out, uint16_t *data_out_len);
+	// Returns a free running microsecond time, may wrap around
+	uint32_t (*time_us)(void *ctx);
+	void *ctx;
+
+	const uint8_t *code;
+	uint16_t len;
+
+	uint8_t state;
+	uint8_t error;
+	uint16_t pc;
+	uint32_t acc;
+	uint32_t count;
+	uint32_t start_us;
+	uint32_t end_us;
+	// Set while a delay is running
+	bool delaying;
+	uint32_t wake_us;
+
+	uint16_t resp_len;
+	uint8_t resp[PP_SCRIPT_RESP_MAX];
+	uint16_t result_len;
+	uint8_t result[PP_SCRIPT_RESULT_MAX];
+};
+
+void pp_script_vm_start(struct pp_script_vm *vm, const uint8_t *code,
+			uint16_t len);
+// Executes up to max_ops instructions. Returns earlier when a delay hasn't
+// expired yet or the script has ended.
+void pp_script_vm_run(struct pp_script_vm *vm, unsigned int max_ops);
+void pp_script_vm_stop(struct pp_script_vm *vm);
+// Fills the PP_SCRIPT_STATUS_LEN bytes of PP_VREQ_SCRIPT_GET_STATUS
+void pp_script_vm_status(const struct pp_script_vm *vm, uint8_t *buf);
+
+#endif /* _PICOPORTS_PP_SCRIPT_VM_H_ */
@@ -0,0 +1,302 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * GPIO sequence playback. The SIO registers can't be written by DMA, so the
+ * lines of a sequence are switched to a PIO state machine while it runs. The
+ * steps are converted to pairs of absolute output values and cycle counts,
+ * which a DMA channel feeds into the joined TX FIFO. The FIFO holds four
+ * steps, so restarting the channel for the next pass in its interrupt doesn't
+ * delay the output.
+ */
+#include "tusb.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+#include "main.h"
+#include "pp_gpio.h"
+#include "pp_seq.h"
+#include "pp_vendor.h"
+
+#ifdef PP_SEQ
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+
+#include "pp_seq.pio.h"
+
+#define PP_SEQ_PIO pio1
+#define PP_SEQ_DMA_IRQ DMA_IRQ_1
+
+// Cycles of a step without delay, see pp_seq.pio
+#define PP_SEQ_MIN_CYCLES 3
+
+struct seq_step {
+	uint32_t lines;
+	uint32_t values;
+	uint32_t delay_ns;
+};
+
+struct seq {
+	struct seq_step steps[PP_SEQ_MAX_STEPS];
+	uint16_t num_steps;
+
+	// Output values and delays, two words per step
+	uint32_t words[2 * PP_SEQ_MAX_STEPS];
+	uint32_t gpio_mask;
+
+	volatile uint8_t state;
+	volatile uint8_t status;
+	uint16_t flags;
+	// Passes to start after the current one, UINT32_MAX to repeat forever
+	volatile uint32_t passes_left;
+	volatile uint32_t passes;
+
+	uint sm;
+	uint offset;
+	uint dma;
+};
+
+static struct seq seq;
+
+static inline bool seq_tx_stalled(void)
+{
+	uint32_t stall = 1u << (PIO_FDEBUG_TXSTALL_LSB + seq.sm);
+	bool stalled = PP_SEQ_PIO->fdebug & stall;
+
+	PP_SEQ_PIO->fdebug = stall;
+	return stalled;
+}
+
+static void seq_dma_irq(void)
+{
+	if (!dma_channel_get_irq1_status(seq.dma))
+		return;
+	dma_channel_acknowledge_irq1(seq.dma);
+
+	seq.passes++;
+	if (!seq.passes_left)
+		return;
+	if (seq.passes_left != UINT32_MAX)
+		seq.passes_left--;
+
+	if (seq_tx_stalled())
+		seq.status |= PP_SEQ_STATUS_UNDERRUN;
+	dma_channel_set_read_addr(seq.dma, seq.words, true);
+}
+
+// Converts the steps into output values and cycle counts, starting from the
+// current outputs
+static bool seq_prepare(void)
+{
+	uint32_t sys_hz = clock_get_hz(clk_sys);
+	uint32_t out = sio_hw->gpio_out;
+
+	seq.gpio_mask = 0;
+	for (uint16_t i = 0; i < seq.num_steps; i++) {
+		const struct seq_step *step = &seq.steps[i];
+		uint32_t mask;
+
+		TU_VERIFY(pp_gpio_lines_to_mask(step->lines, &mask));
+		uint32_t values;
+		TU_VERIFY(pp_gpio_lines_to_mask(step->values & step->lines,
+						&values));
+
+		uint64_t cycles =
+			((uint64_t)step->delay_ns * sys_hz + 500000000) /
+			1000000000;
+		if (cycles < PP_SEQ_MIN_CYCLES)
+			cycles = PP_SEQ_MIN_CYCLES;
+
+		out = (out & ~mask) | values;
+		seq.words[2 * i] = out;
+		seq.words[2 * i + 1] = (uint32_t)(cycles - PP_SEQ_MIN_CYCLES);
+		seq.gpio_mask |= mask;
+	}
+	return true;
+}
+
+// Hands the lines back to SIO with their current output values
+static void seq_release_pins(void)
+{
+	uint32_t mask = seq.gpio_mask;
+
+	gpio_put_masked(mask, PP_SEQ_PIO->dbg_padout);
+	gpio_set_dir_out_masked(mask);
+	for (uint i = 0; i < NUM_BANK0_GPIOS; i++) {
+		if (mask & (1u << i))
+			gpio_set_function(i, GPIO_FUNC_SIO);
+	}
+}
+
+static void seq_stop(void)
+{
+	dma_channel_set_irq1_enabled(seq.dma, false);
+	dma_channel_abort(seq.dma);
+	pio_sm_set_enabled(PP_SEQ_PIO, seq.sm, false);
+	seq_release_pins();
+	pio_sm_clear_fifos(PP_SEQ_PIO, seq.sm);
+}
+
+static bool seq_start(uint16_t passes, uint16_t flags)
+{
+	PIO pio = PP_SEQ_PIO;
+	pio_sm_config c;
+
+	TU_VERIFY(seq.num_steps > 0);
+	TU_VERIFY(seq_prepare());
+
+	seq.flags = flags;
+	seq.status = 0;
+	seq.passes = 0;
+	seq.passes_left = passes ? passes - 1u : UINT32_MAX;
+
+	c = seq_program_get_default_config(seq.offset);
+	sm_config_set_out_pins(&c, 0, 32);
+	sm_config_set_out_shift(&c, true, true, 32);
+	sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+	pio_sm_init(pio, seq.sm, seq.offset, &c);
+
+	// Take over the pins without a glitch
+	pio_sm_set_pins_with_mask(pio, seq.sm, sio_hw->gpio_out, seq.gpio_mask);
+	pio_sm_set_pindirs_with_mask(pio, seq.sm, seq.gpio_mask,
+				     seq.gpio_mask);
+	for (uint i = 0; i < NUM_BANK0_GPIOS; i++) {
+		if (seq.gpio_mask & (1u << i))
+			pio_gpio_init(pio, i);
+	}
+
+	dma_channel_config dc = dma_channel_get_default_config(seq.dma);
+	channel_config_set_transfer_data_size(&dc, DMA_SIZE_32);
+	channel_config_set_read_increment(&dc, true);
+	channel_config_set_write_increment(&dc, false);
+	channel_config_set_dreq(&dc, pio_get_dreq(pio, seq.sm, true));
+	dma_channel_configure(seq.dma, &dc, &pio->txf[seq.sm], seq.words,
+			      2 * seq.num_steps, false);
+	dma_channel_acknowledge_irq1(seq.dma);
+	dma_channel_set_irq1_enabled(seq.dma, true);
+
+	seq_tx_stalled();
+	seq.state = PP_SEQ_STATE_RUNNING;
+	dma_channel_start(seq.dma);
+	pio_sm_set_enabled(pio, seq.sm, true);
+
+	TU_LOG2("SEQ: Started %u steps on GPIOs 0x%08" PRIx32 ", %u passes\r\n",
+		seq.num_steps, seq.gpio_mask, passes);
+	return true;
+}
+
+static void seq_done(void)
+{
+	seq_stop();
+	seq.state = PP_SEQ_STATE_DONE;
+	TU_LOG2("SEQ: Done after %" PRIu32 " passes\r\n", seq.passes);
+
+	if (seq.flags & PP_SEQ_FLAG_EVENT) {
+		uint8_t data[5];
+		u32_to_buf_le(&data[0], seq.passes);
+		data[4] = seq.status;
+		send_user_message_delayed(PP_SEQ_DONE_EV, 0, DLN2_HANDLE_EVENT,
+					  data, sizeof(data));
+	}
+}
+#endif
+
+void pp_seq_task(void)
+{
+#ifdef PP_SEQ
+	if (seq.state != PP_SEQ_STATE_RUNNING)
+		return;
+
+	if (dma_channel_is_busy(seq.dma) || seq.passes_left) {
+		// The FIFO ran empty while DMA was still running
+		if (seq_tx_stalled() && dma_channel_is_busy(seq.dma))
+			seq.status |= PP_SEQ_STATUS_UNDERRUN;
+		return;
+	}
+
+	// After the last delay, the state machine waits for the next step
+	if (pio_sm_is_tx_fifo_empty(PP_SEQ_PIO, seq.sm) &&
+	    pio_sm_get_pc(PP_SEQ_PIO, seq.sm) == seq.offset)
+		seq_done();
+#endif
+}
+
+bool pp_seq_handle_control_request(const tusb_control_request_t *request,
+				   uint8_t const *data_in, uint16_t data_in_len,
+				   uint8_t *data_out, uint16_t *data_out_len)
+{
+#ifndef PP_SEQ
+	(void)request;
+	(void)data_in;
+	(void)data_in_len;
+	(void)data_out;
+	(void)data_out_len;
+	return false;
+#else
+	switch (request->bRequest) {
+	case PP_VREQ_SEQ_LOAD: {
+		uint16_t first = request->wValue;
+		uint16_t n = data_in_len / PP_SEQ_STEP_LEN;
+
+		TU_VERIFY(seq.state != PP_SEQ_STATE_RUNNING);
+		TU_VERIFY(data_in_len % PP_SEQ_STEP_LEN == 0);
+		TU_VERIFY(first <= seq.num_steps);
+		TU_VERIFY(first + n <= PP_SEQ_MAX_STEPS);
+
+		for (uint16_t i = 0; i < n; i++) {
+			const uint8_t *buf = &data_in[i * PP_SEQ_STEP_LEN];
+			struct seq_step *step = &seq.steps[first + i];
+
+			step->lines = u32_from_buf_le(&buf[0]);
+			step->values = u32_from_buf_le(&buf[4]);
+			step->delay_ns = u32_from_buf_le(&buf[8]);
+		}
+		seq.num_steps = first + n;
+		seq.state = PP_SEQ_STATE_IDLE;
+		*data_out_len = 0;
+		return true;
+	}
+
+	case PP_VREQ_SEQ_START:
+		TU_VERIFY(seq.state != PP_SEQ_STATE_RUNNING);
+		*data_out_len = 0;
+		return seq_start(request->wValue, request->wIndex);
+
+	case PP_VREQ_SEQ_STOP:
+		if (seq.state == PP_SEQ_STATE_RUNNING)
+			seq_done();
+		*data_out_len = 0;
+		return true;
+
+	case PP_VREQ_SEQ_GET_STATUS:
+		TU_VERIFY(*data_out_len >= PP_SEQ_STATUS_LEN);
+		data_out[0] = seq.state;
+		data_out[1] = seq.status;
+		u16_to_buf_le(&data_out[2], seq.num_steps);
+		u32_to_buf_le(&data_out[4], seq.passes);
+		*data_out_len = PP_SEQ_STATUS_LEN;
+		return true;
+
+	default:
+		TU_LOG1("SEQ: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
+#endif
+}
+
+void pp_seq_init(void)
+{
+#ifdef PP_SEQ
+	seq.sm = pio_claim_unused_sm(PP_SEQ_PIO, true);
+	seq.offset = pio_add_program(PP_SEQ_PIO, &seq_program);
+	seq.dma = dma_claim_unused_channel(true);
+
+	irq_add_shared_handler(PP_SEQ_DMA_IRQ, seq_dma_irq,
+			       PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+	irq_set_enabled(PP_SEQ_DMA_IRQ, true);
+#endif
+}
@@ -0,0 +1,414 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#include "tusb.h"
+
+#include "hardware/gpio.h"
+
+#include "pico/binary_info.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+#include "dln2_str.h"
+
+#ifdef PP_SPI
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/spi.h"
+#endif
+
+// Port 0, used by the kernel driver
+#define PP_SPI0_INST spi0
+#define PP_SPI0_PIN_SCK 2
+#define PP_SPI0_PIN_TX 3
+#define PP_SPI0_PIN_RX 4
+#define PP_SPI0_PIN_CS 5
+
+// Port 1
+#define PP_SPI1_INST spi1
+#define PP_SPI1_PIN_SCK 10
+#define PP_SPI1_PIN_TX 11
+#define PP_SPI1_PIN_RX 12
+#define PP_SPI1_PIN_CS 13
+
+#define PP_SPI_DEFAULT_FREQUENCY (1000 * 1000)
+#define PP_SPI_DEFAULT_FRAME_SIZE 8
+#define PP_SPI_MIN_FRAME_SIZE 4
+#define PP_SPI_MAX_FRAME_SIZE 16
+// One chip select per port, driven as GPIO
+#define PP_SPI_SS_COUNT 1
+
+// The protocol demands that we receive and send DLN2_SPI_BUF_SIZE in one
+// transmission.
+TU_VERIFY_STATIC(DLN2_SPI_BUF_SIZE <= CFG_TUD_VENDOR_TX_BUFSIZE);
+TU_VERIFY_STATIC(DLN2_SPI_BUF_SIZE <= CFG_TUD_VENDOR_RX_BUFSIZE);
+
+#ifdef PP_SPI
+
+struct spi_port {
+	spi_inst_t *inst;
+	uint8_t pin_sck;
+	uint8_t pin_tx;
+	uint8_t pin_rx;
+	uint8_t pin_cs;
+
+	bool enabled;
+	uint8_t mode; // DLN2_SPI_CPOL, DLN2_SPI_CPHA
+	uint8_t frame_size;
+	uint32_t frequency;
+	uint8_t ss_enabled; // Mask of chip selects that may be used
+	uint8_t ss_selected; // Mask of chip selects used for transfers
+};
+
+static struct spi_port ports[] = {
+	{
+		.inst = PP_SPI0_INST,
+		.pin_sck = PP_SPI0_PIN_SCK,
+		.pin_tx = PP_SPI0_PIN_TX,
+		.pin_rx = PP_SPI0_PIN_RX,
+		.pin_cs = PP_SPI0_PIN_CS,
+	},
+#ifdef PP_SPI1
+	{
+		.inst = PP_SPI1_INST,
+		.pin_sck = PP_SPI1_PIN_SCK,
+		.pin_tx = PP_SPI1_PIN_TX,
+		.pin_rx = PP_SPI1_PIN_RX,
+		.pin_cs = PP_SPI1_PIN_CS,
+	},
+#endif
+};
+
+// Transfers are handled one at a time, so both ports share the DMA channels
+// and buffers. The buffers are aligned for 16 bit frames, the request and
+// response buffers might not be.
+static uint dma_tx;
+static uint dma_rx;
+static uint16_t tx_buf[DLN2_SPI_MAX_XFER_SIZE / 2];
+static uint16_t rx_buf[DLN2_SPI_MAX_XFER_SIZE / 2];
+
+static void spi_port_apply_format(struct spi_port *port)
+{
+	spi_set_format(port->inst, port->frame_size,
+		       (port->mode & DLN2_SPI_CPOL) ? SPI_CPOL_1 : SPI_CPOL_0,
+		       (port->mode & DLN2_SPI_CPHA) ? SPI_CPHA_1 : SPI_CPHA_0,
+		       SPI_MSB_FIRST);
+}
+
+static void spi_port_set_enabled(struct spi_port *port, bool enabled)
+{
+	spi_hw_t *hw = spi_get_hw(port->inst);
+
+	if (enabled)
+		hw_set_bits(&hw->cr1, SPI_SSPCR1_SSE_BITS);
+	else
+		hw_clear_bits(&hw->cr1, SPI_SSPCR1_SSE_BITS);
+	port->enabled = enabled;
+}
+
+static void spi_port_release_ss(struct spi_port *port)
+{
+	gpio_put(port->pin_cs, 1);
+}
+
+// Full duplex transfer of len bytes. Without tx, zeros are sent; without rx,
+// the received data is discarded. Both directions are driven by DMA, so the
+// clock runs without gaps between frames.
+static bool spi_port_transfer(struct spi_port *port, const uint8_t *tx,
+			      uint8_t *rx, uint16_t len, uint8_t attr)
+{
+	static const uint16_t zero = 0;
+	static uint16_t sink;
+
+	TU_VERIFY(port->enabled);
+	TU_VERIFY(len <= DLN2_SPI_MAX_XFER_SIZE);
+
+	// Frames above 8 bit are sent as u16 in little endian order
+	bool wide = port->frame_size > 8;
+	TU_VERIFY(!wide || len % 2 == 0);
+	uint count = wide ? len / 2 : len;
+	enum dma_channel_transfer_size size = wide ? DMA_SIZE_16 : DMA_SIZE_8;
+
+	spi_hw_t *hw = spi_get_hw(port->inst);
+	dma_channel_config c;
+
+	if (tx)
+		memcpy(tx_buf, tx, len);
+
+	// Drop stale data, so it's not mistaken for the response
+	while (spi_is_readable(port->inst))
+		(void)hw->dr;
+
+	c = dma_channel_get_default_config(dma_tx);
+	channel_config_set_transfer_data_size(&c, size);
+	channel_config_set_read_increment(&c, tx != NULL);
+	channel_config_set_write_increment(&c, false);
+	channel_config_set_dreq(&c, spi_get_dreq(port->inst, true));
+	dma_channel_configure(dma_tx, &c, &hw->dr, tx ? tx_buf : &zero, count,
+			      false);
+
+	c = dma_channel_get_default_config(dma_rx);
+	channel_config_set_transfer_data_size(&c, size);
+	channel_config_set_read_increment(&c, false);
+	channel_config_set_write_increment(&c, rx != NULL);
+	channel_config_set_dreq(&c, spi_get_dreq(port->inst, false));
+	dma_channel_configure(dma_rx, &c, rx ? rx_buf : &sink, &hw->dr, count,
+			      false);
+
+	if (port->ss_enabled & port->ss_selected)
+		gpio_put(port->pin_cs, 0);
+
+	dma_start_channel_mask((1u << dma_tx) | (1u << dma_rx));
+	// The last frame has been clocked out once it has been received.
+	dma_channel_wait_for_finish_blocking(dma_rx);
+
+	if (!(attr & DLN2_SPI_ATTR_LEAVE_SS_LOW))
+		spi_port_release_ss(port);
+
+	if (rx)
+		memcpy(rx, rx_buf, len);
+
+	return true;
+}
+
+static bool spi_handle_port_request(struct spi_port *port, uint16_t cmd,
+				    uint8_t const *data_in,
+				    uint16_t data_in_len, uint8_t *data_out,
+				    uint16_t *data_out_len)
+{
+	switch (cmd) {
+	case DLN2_SPI_ENABLE:
+		TU_LOG3("SPI: Enabled\r\n");
+		spi_port_set_enabled(port, true);
+		*data_out_len = 0;
+		break;
+	case DLN2_SPI_DISABLE:
+		// 1: u8 wait_for_completion, transfers are always complete
+		TU_LOG3("SPI: Disabled\r\n");
+		spi_port_set_enabled(port, false);
+		*data_out_len = 0;
+		break;
+	case DLN2_SPI_IS_ENABLED:
+		TU_VERIFY(*data_out_len >= 1);
+		data_out[0] = port->enabled;
+		*data_out_len = 1;
+		break;
+	case DLN2_SPI_SET_MODE:
+		// 1: u8 mode
+		TU_VERIFY(!(data_in[1] & ~(DLN2_SPI_CPOL | DLN2_SPI_CPHA)));
+		TU_LOG3("SPI: Set mode %u\r\n", data_in[1]);
+		port->mode = data_in[1];
+		spi_port_apply_format(port);
+		*data_out_len = 0;
+		break;
+	case DLN2_SPI_GET_MODE:
+		TU_VERIFY(*data_out_len >= 1);
+		data_out[0] = port->mode;
+		*data_out_len = 1;
+		break;
+	case DLN2_SPI_SET_FRAME_SIZE:
+		// 1: u8 bits per word
+		TU_VERIFY(data_in[1] >= PP_SPI_MIN_FRAME_SIZE &&
+			  data_in[1] <= PP_SPI_MAX_FRAME_SIZE);
+		TU_LOG3("SPI: Set frame size %u\r\n", data_in[1]);
+		port->frame_size = data_in[1];
+		spi_port_apply_format(port);
+		*data_out_len = 0;
+		break;
+	case DLN2_SPI_GET_FRAME_SIZE:
+		TU_VERIFY(*data_out_len >= 1);
+		data_out[0] = port->frame_size;
+		*data_out_len = 1;
+		break;
+	case DLN2_SPI_SET_FREQUENCY: {
+		// 1: u32 speed
+		// Response:
+		// 0: u32 actual speed
+		TU_VERIFY(*data_out_len >= 4);
+		uint32_t speed = u32_from_buf_le(&data_in[1]);
+		TU_VERIFY(speed > 0);
+		port->frequency = spi_set_baudrate(port->inst, speed);
+		TU_LOG3("SPI: Set frequency %" PRIu32 ", frequency is %" PRIu32
+			"\r\n",
+			speed, port->frequency);
+		u32_to_buf_le(&data_out[0], port->frequency);
+		*data_out_len = 4;
+		break;
+	}
+	case DLN2_SPI_GET_FREQUENCY:
+		TU_VERIFY(*data_out_len >= 4);
+		u32_to_buf_le(&data_out[0], port->frequency);
+		*data_out_len = 4;
+		break;
+	case DLN2_SPI_GET_MIN_FREQUENCY:
+	case DLN2_SPI_GET_MAX_FREQUENCY: {
+		// The PL022 divides clk_peri by an even prescaler of 2..254 and
+		// a second divider of 1..256.
+		uint32_t clk = clock_get_hz(clk_peri);
+		TU_VERIFY(*data_out_len >= 4);
+		u32_to_buf_le(&data_out[0], cmd == DLN2_SPI_GET_MIN_FREQUENCY ?
+						    clk / (254 * 256) + 1 :
+						    clk / 2);
+		*data_out_len = 4;
+		break;
+	}
+	case DLN2_SPI_GET_SUPPORTED_FRAME_SIZES: {
+		// Response:
+		// 0: u8 count
+		// 1: u8 frame_sizes[count]
+		uint8_t count =
+			PP_SPI_MAX_FRAME_SIZE - PP_SPI_MIN_FRAME_SIZE + 1;
+		TU_VERIFY(*data_out_len >= 1 + count);
+		data_out[0] = count;
+		for (uint8_t i = 0; i < count; i++)
+			data_out[1 + i] = PP_SPI_MIN_FRAME_SIZE + i;
+		*data_out_len = 1 + count;
+		break;
+	}
+	case DLN2_SPI_GET_SS_COUNT:
+		// Response:
+		// 0: u16 count
+		TU_VERIFY(*data_out_len >= 2);
+		u16_to_buf_le(&data_out[0], PP_SPI_SS_COUNT);
+		*data_out_len = 2;
+		break;
+	case DLN2_SPI_SET_SS:
+		// 1: u8 cs, a chip select is selected by a 0 bit
+		port->ss_selected = ~data_in[1] & ((1 << PP_SPI_SS_COUNT) - 1);
+		*data_out_len = 0;
+		break;
+	case DLN2_SPI_GET_SS:
+		TU_VERIFY(*data_out_len >= 1);
+		data_out[0] = (uint8_t)~port->ss_selected;
+		*data_out_len = 1;
+		break;
+	case DLN2_SPI_RELEASE_SS:
+		spi_port_release_ss(port);
+		*data_out_len = 0;
+		break;
+	case DLN2_SPI_SS_MULTI_ENABLE:
+	case DLN2_SPI_SS_MULTI_DISABLE: {
+		// 1: u8 cs mask
+		uint8_t mask = data_in[1] & ((1 << PP_SPI_SS_COUNT) - 1);
+		if (cmd == DLN2_SPI_SS_MULTI_ENABLE) {
+			port->ss_enabled |= mask;
+		} else {
+			port->ss_enabled &= ~mask;
+			spi_port_release_ss(port);
+		}
+		*data_out_len = 0;
+		break;
+	}
+	case DLN2_SPI_SS_MULTI_IS_ENABLED:
+		TU_VERIFY(*data_out_len >= 1);
+		data_out[0] = port->ss_enabled;
+		*data_out_len = 1;
+		break;
+	case DLN2_SPI_WRITE:
+	case DLN2_SPI_READ:
+	case DLN2_SPI_READ_WRITE: {
+		// 1: u16 size
+		// 3: u8 attr
+		// 4: u8 buf[DLN2_SPI_MAX_XFER_SIZE] (not for READ)
+		// Response (not for WRITE):
+		// 0: u16 size
+		// 2: u8 buf[DLN2_SPI_MAX_XFER_SIZE]
+		uint16_t size = u16_from_buf_le(&data_in[1]);
+		uint8_t attr = data_in[3];
+		bool write = cmd != DLN2_SPI_READ;
+		bool read = cmd != DLN2_SPI_WRITE;
+		TU_VERIFY(!write || data_in_len >= 4 + size);
+		TU_VERIFY(!read || *data_out_len >= 2 + size);
+
+		TU_LOG3("SPI: %s %u byte\r\n", cmd2str(cmd), size);
+
+		TU_VERIFY(spi_port_transfer(port, write ? &data_in[4] : NULL,
+					    read ? &data_out[2] : NULL, size,
+					    attr));
+		if (read) {
+			u16_to_buf_le(&data_out[0], size);
+			*data_out_len = 2 + size;
+		} else {
+			*data_out_len = 0;
+		}
+		break;
+	}
+	default:
+		TU_LOG1("SPI: Command not implemented: %s (%u)\r\n",
+			cmd2str(cmd), cmd);
+		TU_VERIFY(false);
+	}
+
+	return true;
+}
+
+#endif
+
+bool pp_spi_handle_request(uint16_t cmd, uint8_t const *data_in,
+			   uint16_t data_in_len, uint8_t *data_out,
+			   uint16_t *data_out_len)
+{
+#ifndef PP_SPI
+	(void)cmd;
+	(void)data_in;
+	(void)data_in_len;
+	(void)data_out;
+	(void)data_out_len;
+	// Fail the requests, so the kernel driver doesn't create an SPI
+	// controller which can't be used (see pp_i2c.c).
+	return false;
+#else
+	if (cmd == DLN2_SPI_GET_PORT_COUNT) {
+		TU_VERIFY(*data_out_len >= 1);
+		data_out[0] = TU_ARRAY_SIZE(ports);
+		*data_out_len = 1;
+		return true;
+	}
+
+	TU_VERIFY(data_in_len >= 1);
+	uint8_t port = data_in[0];
+	TU_VERIFY(port < TU_ARRAY_SIZE(ports));
+
+	return spi_handle_port_request(&ports[port], cmd, data_in, data_in_len,
+				       data_out, data_out_len);
+#endif
+}
+
+void pp_spi_init(void)
+{
+#ifdef PP_SPI
+	for (size_t i = 0; i < TU_ARRAY_SIZE(ports); i++) {
+		struct spi_port *port = &ports[i];
+
+		port->mode = 0;
+		port->frame_size = PP_SPI_DEFAULT_FRAME_SIZE;
+		port->frequency =
+			spi_init(port->inst, PP_SPI_DEFAULT_FREQUENCY);
+		spi_port_apply_format(port);
+		// Enabled by the host
+		spi_port_set_enabled(port, false);
+
+		gpio_set_function(port->pin_sck, GPIO_FUNC_SPI);
+		gpio_set_function(port->pin_tx, GPIO_FUNC_SPI);
+		gpio_set_function(port->pin_rx, GPIO_FUNC_SPI);
+
+		gpio_init(port->pin_cs);
+		gpio_put(port->pin_cs, 1);
+		gpio_set_dir(port->pin_cs, GPIO_OUT);
+	}
+
+	dma_tx = dma_claim_unused_channel(true);
+	dma_rx = dma_claim_unused_channel(true);
+
+	// Make the SPI pins available to picotool
+	bi_decl(bi_4pins_with_func(PP_SPI0_PIN_RX, PP_SPI0_PIN_TX,
+				   PP_SPI0_PIN_SCK, PP_SPI0_PIN_CS,
+				   GPIO_FUNC_SPI));
+#ifdef PP_SPI1
+	bi_decl(bi_4pins_with_func(PP_SPI1_PIN_RX, PP_SPI1_PIN_TX,
+				   PP_SPI1_PIN_SCK, PP_SPI1_PIN_CS,
+				   GPIO_FUNC_SPI));
+#endif
+#endif
+}
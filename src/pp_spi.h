@@ -0,0 +1,14 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_PP_SPI_H_
+#define _PICOPORTS_PP_SPI_H_
+
+bool pp_spi_handle_request(uint16_t cmd, uint8_t const *data_in,
+			   uint16_t data_in_len, uint8_t *data_out,
+			   uint16_t *data_out_len);
+
+void pp_spi_init(void);
+
+#endif /* _PICOPORTS_PP_SPI_H_ */
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * State mirror. The main loop refreshes one block with the inputs and
+ * counters of all modules, which the host reads with a single vendor request
+ * or receives periodically as event.
+ */
+#include "tusb.h"
+
+#include "hardware/timer.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+#include "main.h"
+#include "pp_adc.h"
+#include "pp_gpio.h"
+#include "pp_state.h"
+#include "pp_uart.h"
+#include "pp_vendor.h"
+
+static uint8_t state[PP_STATE_LEN];
+static uint32_t state_seq;
+static uint32_t refresh_us;
+
+static uint16_t event_interval_ms;
+static uint32_t event_us;
+
+static void state_refresh(uint32_t now)
+{
+	uint32_t levels, outputs, events, event_time, collapsed;
+	uint16_t adc[PP_STATE_ADC_MAX] = { 0 };
+
+	pp_gpio_get_state(&levels, &outputs);
+	pp_gpio_get_event_stats(&events, &event_time, &collapsed);
+	uint8_t num_adc = pp_adc_read_all(adc, PP_STATE_ADC_MAX);
+
+	state[0] = PP_STATE_VERSION;
+	state[1] = num_adc;
+	u16_to_buf_le(&state[2], PP_STATE_LEN);
+	u32_to_buf_le(&state[4], ++state_seq);
+	u32_to_buf_le(&state[8], now);
+	u32_to_buf_le(&state[12], levels);
+	u32_to_buf_le(&state[16], outputs);
+	u32_to_buf_le(&state[20], events);
+	u32_to_buf_le(&state[24], event_time);
+	for (uint8_t itf = 0; itf < 2; itf++) {
+		uint32_t dropped, errors, overruns;
+
+		pp_uart_get_counters(itf, &dropped, &errors, &overruns);
+		u32_to_buf_le(&state[28 + 4 * itf], dropped);
+		u32_to_buf_le(&state[36 + 4 * itf], errors);
+	}
+	for (uint8_t i = 0; i < PP_STATE_ADC_MAX; i++)
+		u16_to_buf_le(&state[44 + 2 * i], adc[i]);
+	u16_to_buf_le(&state[54], 0);
+}
+
+void pp_state_task(void)
+{
+	uint32_t now = time_us_32();
+
+	if (now - refresh_us < PP_STATE_REFRESH_MS * 1000u && state_seq)
+		return;
+	state_refresh(now);
+	refresh_us = now;
+
+	if (event_interval_ms &&
+	    now - event_us >= event_interval_ms * 1000u) {
+		event_us = now;
+		send_user_message_delayed(PP_STATE_EV, 0, DLN2_HANDLE_EVENT,
+					  state, PP_STATE_LEN);
+	}
+}
+
+bool pp_state_handle_control_request(const tusb_control_request_t *request,
+				     uint8_t const *data_in,
+				     uint16_t data_in_len, uint8_t *data_out,
+				     uint16_t *data_out_len)
+{
+	(void)data_in;
+	(void)data_in_len;
+
+	switch (request->bRequest) {
+	case PP_VREQ_STATE_GET:
+		TU_VERIFY(*data_out_len >= PP_STATE_LEN);
+		memcpy(data_out, state, PP_STATE_LEN);
+		*data_out_len = PP_STATE_LEN;
+		return true;
+
+	case PP_VREQ_STATE_SET_INTERVAL:
+		event_interval_ms = request->wValue;
+		// The first event is sent with the next refresh
+		event_us = time_us_32() - event_interval_ms * 1000u;
+		TU_LOG2("STATE: Events every %u ms\r\n", event_interval_ms);
+		*data_out_len = 0;
+		return true;
+
+	default:
+		TU_LOG1("STATE: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
+}
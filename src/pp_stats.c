@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Performance counters. The DLN2 requests are counted and timed per handle
+ * and command, the other modules are asked for their counters when the host
+ * reads them.
+ */
+#include "tusb.h"
+
+#include "hardware/structs/xip_ctrl.h"
+#include "hardware/timer.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+#include "main.h"
+#include "pp_gpio.h"
+#include "pp_i2c.h"
+#include "pp_platform.h"
+#include "pp_sched.h"
+#include "pp_stats.h"
+#include "pp_uart.h"
+#include "pp_vendor.h"
+
+struct handle_stats {
+	uint32_t requests;
+	uint32_t failures;
+	uint32_t total_us;
+	uint32_t max_us;
+	uint32_t buckets[PP_STATS_BUCKETS];
+};
+
+struct command_stats {
+	uint16_t handle;
+	uint16_t cmd;
+	uint32_t requests;
+};
+
+static struct handle_stats handles[DLN2_HANDLES];
+static struct command_stats commands[PP_STATS_MAX_COMMANDS];
+static uint8_t num_commands;
+
+static uint32_t loop_max_us;
+static uint32_t loops;
+static uint32_t loops_per_s;
+static uint32_t window_us;
+
+void pp_stats_task(uint32_t start_us)
+{
+	uint32_t now = time_us_32();
+
+	if (now - start_us > loop_max_us)
+		loop_max_us = now - start_us;
+	loops++;
+
+	if (now - window_us >= 1000000u) {
+		loops_per_s = loops;
+		loops = 0;
+		window_us = now;
+	}
+}
+
+static uint8_t PP_HOT_FUNC(service_bucket)(uint32_t us)
+{
+	uint8_t bucket = 0;
+
+	while (bucket < PP_STATS_BUCKETS - 1 && us >= (1u << bucket))
+		bucket++;
+	return bucket;
+}
+
+void PP_HOT_FUNC(pp_stats_request)(uint16_t handle, uint16_t cmd, bool ok,
+				   uint32_t service_us)
+{
+	if (handle < DLN2_HANDLES) {
+		struct handle_stats *h = &handles[handle];
+
+		h->requests++;
+		if (!ok)
+			h->failures++;
+		h->total_us += service_us;
+		if (service_us > h->max_us)
+			h->max_us = service_us;
+		h->buckets[service_bucket(service_us)]++;
+	}
+
+	for (uint8_t i = 0; i < num_commands; i++) {
+		if (commands[i].handle == handle && commands[i].cmd == cmd) {
+			commands[i].requests++;
+			return;
+		}
+	}
+	if (num_commands < PP_STATS_MAX_COMMANDS) {
+		commands[num_commands++] = (struct command_stats){
+			.handle = handle, .cmd = cmd, .requests = 1
+		};
+	}
+}
+
+// The layout has room for two DLN2 interfaces
+TU_VERIFY_STATIC(PP_NUM_DLN2_ITFS == 2);
+
+static void stats_summary(uint8_t *buf)
+{
+	uint32_t requests = 0, failures = 0;
+	uint32_t events, event_us, collapsed, naks, timeouts;
+
+	for (uint8_t i = 0; i < DLN2_HANDLES; i++) {
+		requests += handles[i].requests;
+		failures += handles[i].failures;
+	}
+	pp_gpio_get_event_stats(&events, &event_us, &collapsed);
+	pp_i2c_get_counters(&naks, &timeouts);
+
+	buf[0] = PP_STATS_VERSION;
+	buf[1] = DLN2_HANDLES;
+	u16_to_buf_le(&buf[2], PP_STATS_LEN);
+	u32_to_buf_le(&buf[4], time_us_32());
+	u32_to_buf_le(&buf[8], loops_per_s);
+	u32_to_buf_le(&buf[12], loop_max_us);
+	u32_to_buf_le(&buf[16], requests);
+	u32_to_buf_le(&buf[20], failures);
+	for (uint8_t itf = 0; itf < PP_NUM_DLN2_ITFS; itf++) {
+		uint16_t max_used, rx_max;
+		uint32_t dropped;
+
+		get_message_queue_stats(itf, &max_used, &dropped, &rx_max);
+		u16_to_buf_le(&buf[24 + 2 * itf], max_used);
+		u32_to_buf_le(&buf[28 + 4 * itf], dropped);
+		u16_to_buf_le(&buf[36 + 2 * itf], rx_max);
+	}
+	u32_to_buf_le(&buf[40], events);
+	u32_to_buf_le(&buf[44], collapsed);
+	u32_to_buf_le(&buf[48], naks);
+	u32_to_buf_le(&buf[52], timeouts);
+	for (uint8_t itf = 0; itf < 2; itf++) {
+		uint32_t dropped, errors, overruns;
+
+		pp_uart_get_counters(itf, &dropped, &errors, &overruns);
+		u32_to_buf_le(&buf[56 + 4 * itf], overruns);
+	}
+}
+
+TU_VERIFY_STATIC(PP_SCHED_SOURCES == PP_STATS_SCHED_SOURCES);
+
+static void stats_sched(uint8_t *buf)
+{
+	uint32_t sleep_us, wakeups;
+	uint32_t count[PP_SCHED_SOURCES], max_us[PP_SCHED_SOURCES],
+		total_us[PP_SCHED_SOURCES];
+
+	pp_sched_get_stats(&sleep_us, &wakeups, count, max_us, total_us);
+	u32_to_buf_le(&buf[0], sleep_us);
+	u32_to_buf_le(&buf[4], wakeups);
+	for (uint8_t i = 0; i < PP_SCHED_SOURCES; i++) {
+		uint8_t *rec = &buf[8 + 12 * i];
+
+		u32_to_buf_le(&rec[0], count[i]);
+		u32_to_buf_le(&rec[4], max_us[i]);
+		u32_to_buf_le(&rec[8], total_us[i]);
+	}
+}
+
+static void stats_xip(uint8_t *buf, bool clear)
+{
+	u32_to_buf_le(&buf[0], xip_ctrl_hw->ctr_acc);
+	u32_to_buf_le(&buf[4], xip_ctrl_hw->ctr_hit);
+#ifdef PP_RAM_HOT_PATHS
+	buf[8] = PP_STATS_XIP_RAM_HOT_PATHS;
+#else
+	buf[8] = 0;
+#endif
+	memset(&buf[9], 0, PP_STATS_XIP_LEN - 9);
+
+	// Any write clears a counter
+	if (clear) {
+		xip_ctrl_hw->ctr_acc = 0;
+		xip_ctrl_hw->ctr_hit = 0;
+	}
+}
+
+bool pp_stats_handle_control_request(const tusb_control_request_t *request,
+				     uint8_t const *data_in,
+				     uint16_t data_in_len, uint8_t *data_out,
+				     uint16_t *data_out_len)
+{
+	(void)data_in;
+	(void)data_in_len;
+
+	// Read-only apart from clearing the XIP counters, so requests with a
+	// data stage from the host are refused
+	TU_VERIFY(request->bmRequestType_bit.direction == TUSB_DIR_IN);
+
+	switch (request->bRequest) {
+	case PP_VREQ_STATS_GET:
+		TU_VERIFY(*data_out_len >= PP_STATS_LEN);
+		stats_summary(data_out);
+		*data_out_len = PP_STATS_LEN;
+		return true;
+
+	case PP_VREQ_STATS_GET_HANDLES:
+		TU_VERIFY(*data_out_len >= DLN2_HANDLES * PP_STATS_HANDLE_LEN);
+		for (uint8_t i = 0; i < DLN2_HANDLES; i++) {
+			uint8_t *rec = &data_out[i * PP_STATS_HANDLE_LEN];
+
+			u32_to_buf_le(&rec[0], handles[i].requests);
+			u32_to_buf_le(&rec[4], handles[i].failures);
+			u32_to_buf_le(&rec[8], handles[i].total_us);
+			u32_to_buf_le(&rec[12], handles[i].max_us);
+		}
+		*data_out_len = DLN2_HANDLES * PP_STATS_HANDLE_LEN;
+		return true;
+
+	case PP_VREQ_STATS_GET_HISTOGRAM:
+		TU_VERIFY(request->wIndex < DLN2_HANDLES);
+		TU_VERIFY(*data_out_len >= PP_STATS_BUCKETS * 4);
+		for (uint8_t i = 0; i < PP_STATS_BUCKETS; i++)
+			u32_to_buf_le(&data_out[4 * i],
+				      handles[request->wIndex].buckets[i]);
+		*data_out_len = PP_STATS_BUCKETS * 4;
+		return true;
+
+	case PP_VREQ_STATS_GET_COMMANDS: {
+		uint8_t n = TU_MIN(num_commands,
+				   *data_out_len / PP_STATS_COMMAND_LEN);
+
+		for (uint8_t i = 0; i < n; i++) {
+			uint8_t *rec = &data_out[i * PP_STATS_COMMAND_LEN];
+
+			u16_to_buf_le(&rec[0], commands[i].handle);
+			u16_to_buf_le(&rec[2], commands[i].cmd);
+			u32_to_buf_le(&rec[4], commands[i].requests);
+		}
+		*data_out_len = n * PP_STATS_COMMAND_LEN;
+		return true;
+	}
+
+	case PP_VREQ_STATS_GET_SCHED:
+		TU_VERIFY(*data_out_len >= PP_STATS_SCHED_LEN);
+		stats_sched(data_out);
+		*data_out_len = PP_STATS_SCHED_LEN;
+		return true;
+
+	case PP_VREQ_STATS_GET_XIP:
+		TU_VERIFY(request->wValue <= 1);
+		TU_VERIFY(*data_out_len >= PP_STATS_XIP_LEN);
+		stats_xip(data_out, request->wValue);
+		*data_out_len = PP_STATS_XIP_LEN;
+		return true;
+
+	default:
+		TU_LOG1("STATS: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
+}
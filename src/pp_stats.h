@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_PP_STATS_H_
+#define _PICOPORTS_PP_STATS_H_
+
+// Called at the end of each main loop pass, with the time the pass started
+// after waking up
+void pp_stats_task(uint32_t start_us);
+// Counts a DLN2 request of the DLN2 interfaces
+void pp_stats_request(uint16_t handle, uint16_t cmd, bool ok,
+		      uint32_t service_us);
+bool pp_stats_handle_control_request(const tusb_control_request_t *request,
+				     uint8_t const *data_in,
+				     uint16_t data_in_len, uint8_t *data_out,
+				     uint16_t *data_out_len);
+
+#endif /* _PICOPORTS_PP_STATS_H_ */
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Binary trace ring, written by pp_trace() and read by the host with vendor
+ * requests. ppctl trace decodes it.
+ */
+#include "tusb.h"
+
+#include "byte_ops.h"
+#include "pp_trace.h"
+#include "pp_vendor.h"
+
+#ifdef PP_TRACE
+TU_VERIFY_STATIC((PP_TRACE_RECORDS & (PP_TRACE_RECORDS - 1)) == 0);
+
+struct pp_trace_record pp_trace_ring[PP_TRACE_RECORDS];
+uint32_t pp_trace_seq;
+bool pp_trace_running = true;
+
+static void trace_status(uint8_t *buf)
+{
+	buf[0] = PP_TRACE_VERSION;
+	buf[1] = pp_trace_running;
+	u16_to_buf_le(&buf[2], PP_TRACE_RECORD_LEN);
+	u16_to_buf_le(&buf[4], PP_TRACE_RECORDS);
+	u16_to_buf_le(&buf[6], 0);
+	u32_to_buf_le(&buf[8], pp_trace_seq);
+	u32_to_buf_le(&buf[12], time_us_32());
+}
+
+static uint16_t trace_read(uint32_t seq, uint8_t *buf, uint16_t len)
+{
+	uint8_t *rec = &buf[PP_TRACE_READ_HDR_LEN];
+	uint16_t n = 0;
+
+	// The interrupts mustn't overwrite records while they're copied
+	uint32_t irq = save_and_disable_interrupts();
+
+	uint32_t end = pp_trace_seq;
+	// Ahead of the trace
+	if ((int32_t)(end - seq) < 0)
+		seq = end;
+	// Overwritten
+	if (end - seq > PP_TRACE_RECORDS)
+		seq = end - PP_TRACE_RECORDS;
+	u32_to_buf_le(&buf[0], seq);
+
+	while (seq + n != end &&
+	       PP_TRACE_READ_HDR_LEN + (n + 1) * PP_TRACE_RECORD_LEN <= len) {
+		const struct pp_trace_record *r =
+			&pp_trace_ring[(seq + n) % PP_TRACE_RECORDS];
+
+		u32_to_buf_le(&rec[0], r->time_us);
+		u16_to_buf_le(&rec[4], r->id);
+		u16_to_buf_le(&rec[6], r->arg0);
+		u32_to_buf_le(&rec[8], r->arg1);
+		rec += PP_TRACE_RECORD_LEN;
+		n++;
+	}
+
+	restore_interrupts(irq);
+	return PP_TRACE_READ_HDR_LEN + n * PP_TRACE_RECORD_LEN;
+}
+#endif
+
+bool pp_trace_handle_control_request(const tusb_control_request_t *request,
+				     uint8_t const *data_in,
+				     uint16_t data_in_len, uint8_t *data_out,
+				     uint16_t *data_out_len)
+{
+#ifndef PP_TRACE
+	(void)request;
+	(void)data_in;
+	(void)data_in_len;
+	(void)data_out;
+	(void)data_out_len;
+	return false;
+#else
+	(void)data_in;
+	(void)data_in_len;
+
+	switch (request->bRequest) {
+	case PP_VREQ_TRACE_GET_STATUS:
+		TU_VERIFY(*data_out_len >= PP_TRACE_STATUS_LEN);
+		trace_status(data_out);
+		*data_out_len = PP_TRACE_STATUS_LEN;
+		return true;
+
+	case PP_VREQ_TRACE_SET:
+		TU_VERIFY(request->wValue <= 1);
+		pp_trace_running = request->wValue;
+		TU_LOG2("TRACE: %s\r\n",
+			pp_trace_running ? "Running" : "Stopped");
+		*data_out_len = 0;
+		return true;
+
+	case PP_VREQ_TRACE_READ: {
+		uint32_t seq = request->wValue | (uint32_t)request->wIndex << 16;
+
+		TU_VERIFY(*data_out_len >= PP_TRACE_READ_HDR_LEN);
+		*data_out_len = trace_read(seq, data_out, *data_out_len);
+		return true;
+	}
+
+	default:
+		TU_LOG1("TRACE: Vendor request 0x%02x not implemented\r\n",
+			request->bRequest);
+		return false;
+	}
+#endif
+}
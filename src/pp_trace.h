@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_PP_TRACE_H_
+#define _PICOPORTS_PP_TRACE_H_
+
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#include "pp_vendor.h"
+
+struct pp_trace_record {
+	uint32_t time_us;
+	uint16_t id;
+	uint16_t arg0;
+	uint32_t arg1;
+};
+
+#ifdef PP_TRACE
+extern struct pp_trace_record pp_trace_ring[PP_TRACE_RECORDS];
+extern uint32_t pp_trace_seq;
+extern bool pp_trace_running;
+#endif
+
+// Records an event, see PP_TRACE_* in pp_vendor.h. Safe to call from
+// interrupt handlers of core 0. Without the build option TRACE, it compiles
+// to nothing.
+static inline void pp_trace(uint16_t id, uint16_t arg0, uint32_t arg1)
+{
+#ifdef PP_TRACE
+	if (!pp_trace_running)
+		return;
+
+	uint32_t irq = save_and_disable_interrupts();
+	struct pp_trace_record *r =
+		&pp_trace_ring[pp_trace_seq++ % PP_TRACE_RECORDS];
+
+	r->time_us = time_us_32();
+	r->id = id;
+	r->arg0 = arg0;
+	r->arg1 = arg1;
+	restore_interrupts(irq);
+#else
+	(void)id;
+	(void)arg0;
+	(void)arg1;
+#endif
+}
+
+bool pp_trace_handle_control_request(const tusb_control_request_t *request,
+				     uint8_t const *data_in,
+				     uint16_t data_in_len, uint8_t *data_out,
+				     uint16_t *data_out_len);
+
+#endif /* _PICOPORTS_PP_TRACE_H_ */
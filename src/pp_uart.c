@@ -5,40 +5,660 @@
 #include "tusb.h"
 
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
 #include "hardware/uart.h"
+#include "pico/time.h"
 
+#include "byte_ops.h"
+#include "pp_platform.h"
+#include "pp_sched.h"
+#include "pp_trace.h"
+#include "pp_vendor.h"
+#include "ring_buf.h"
+
+// CDC interface 0
 #define PP_UART_INST uart1
+#define PP_UART_IRQ UART1_IRQ
 #define PP_UART_PIN_TX 20
 #define PP_UART_PIN_RX 21
+#define PP_UART_PIN_CTS 6
+#define PP_UART_PIN_RTS 7
+// Host line state outputs, active low like on other USB to UART adapters.
+#define PP_UART_PIN_DTR_OUT 18
+#define PP_UART_PIN_RTS_OUT 19
+// RS-485 transceiver driver enable, active high.
+#define PP_UART_PIN_DE 22
+
+// CDC interface 1
+#define PP_UART0_INST uart0
+#define PP_UART0_IRQ UART0_IRQ
+#define PP_UART0_PIN_TX 0
+#define PP_UART0_PIN_RX 1
+
 #define PP_UART_DEFAULT_SPEED 115200
 #define PP_UART_DEFAULT_DATA_BITS 8
 #define PP_UART_DEFAULT_STOP_BITS 1
 #define PP_UART_DEFAULT_PARITY UART_PARITY_NONE
 
+// The UART interrupt moves data between the 32 byte hardware FIFOs and these
+// rings, so the main loop only has to keep up on average. At 3 Mbaud the
+// hardware FIFO alone lasts for about 100us.
+#define PP_UART_RING_SIZE 2048
+// A partially filled CDC packet is sent once the UART has been idle for this
+// long. Full packets are sent by tud_cdc_write() as soon as they are complete.
+#define PP_UART_FLUSH_IDLE_US 500
+// With flow control, reception is paused while the RX ring is full and resumed
+// once this much space is available again.
+#define PP_UART_RX_RESUME_SPACE (PP_UART_RING_SIZE / 4)
+// Framed capture: timestamped bytes from the interrupt to the main loop, and
+// frame records until the host reads them.
+#define PP_UART_CAPTURE_EVENTS 256
+#define PP_UART_FRAME_RING_SIZE 4096
+// Longest RS-485 setup time, DE is asserted this long before the first start
+// bit.
+#define PP_UART_RS485_MAX_SETUP_US 1000
+
+#ifndef PP_GPIO_ONLY
+
+struct uart_capture_event {
+	uint32_t time_us;
+	uint16_t dr; // Data and error bits
+	uint16_t reserved;
+};
+
+struct uart_capture {
+	volatile bool enabled;
+	uint32_t gap_us;
+
+	struct ring_buf events; // struct uart_capture_event, UART -> main loop
+	struct ring_buf frames; // Complete records for the host
+	volatile uint32_t dropped;
+	uint32_t reported_dropped;
+
+	// Record being assembled, see PP_VREQ_UART_READ_FRAMES
+	uint8_t rec[PP_VREQ_MAX_DATA_LEN];
+	uint16_t rec_len;
+	uint16_t rec_flags;
+	uint32_t last_us;
+};
+
+struct uart_port {
+	uart_inst_t *inst;
+	uint irq;
+	uint8_t pin_tx;
+	uint8_t pin_rx;
+	bool hw_flow;
+
+	struct ring_buf rx_ring; // UART -> host
+	struct ring_buf tx_ring; // host -> UART
+
+	volatile uint32_t last_rx_us;
+	volatile uint32_t rx_dropped;
+	// Bytes received with a framing, parity, break or overrun error
+	volatile uint32_t rx_errors;
+	// Bytes lost because the RX FIFO was full, counted in rx_errors as well
+	volatile uint32_t rx_overruns;
+	volatile bool rx_paused;
+	uint32_t reported_dropped;
+
+	// Duration of one bit at the current baud rate, at least 1us
+	uint32_t bit_us;
+
+	struct uart_capture capture;
+
+#ifdef PP_UART_RS485
+	bool rs485;
+	uint16_t rs485_setup_us;
+	uint16_t rs485_hold_us;
+	volatile bool de_active;
+	// DE is asserted and the alarm starts sending after the setup time
+	volatile bool de_setup;
+	volatile bool de_holding;
+#endif
+};
+
+static uint8_t rx_ring_buf[CFG_TUD_CDC][PP_UART_RING_SIZE];
+static uint8_t tx_ring_buf[CFG_TUD_CDC][PP_UART_RING_SIZE];
+#define CAPTURE_EVENT_BUF_SIZE                                                 \
+	(PP_UART_CAPTURE_EVENTS * sizeof(struct uart_capture_event))
+static uint8_t capture_event_buf[CFG_TUD_CDC][CAPTURE_EVENT_BUF_SIZE];
+static uint8_t frame_ring_buf[CFG_TUD_CDC][PP_UART_FRAME_RING_SIZE];
+
+// Indexed by CDC interface
+static struct uart_port ports[CFG_TUD_CDC] = {
+	{
+		.inst = PP_UART_INST,
+		.irq = PP_UART_IRQ,
+		.pin_tx = PP_UART_PIN_TX,
+		.pin_rx = PP_UART_PIN_RX,
+#ifdef PP_UART_FLOW_CONTROL
+		.hw_flow = true,
+#endif
+#ifdef PP_UART_RS485
+		.rs485 = true,
+#endif
+		.rx_ring = RING_BUF_INIT(rx_ring_buf[0]),
+		.tx_ring = RING_BUF_INIT(tx_ring_buf[0]),
+		.capture = {
+			.events = RING_BUF_INIT(capture_event_buf[0]),
+			.frames = RING_BUF_INIT(frame_ring_buf[0]),
+		},
+	},
+#ifdef PP_UART0_CDC
+	{
+		.inst = PP_UART0_INST,
+		.irq = PP_UART0_IRQ,
+		.pin_tx = PP_UART0_PIN_TX,
+		.pin_rx = PP_UART0_PIN_RX,
+		.rx_ring = RING_BUF_INIT(rx_ring_buf[1]),
+		.tx_ring = RING_BUF_INIT(tx_ring_buf[1]),
+		.capture = {
+			.events = RING_BUF_INIT(capture_event_buf[1]),
+			.frames = RING_BUF_INIT(frame_ring_buf[1]),
+		},
+	},
+#endif
+};
+
+#define RX_IRQS (UART_UARTIMSC_RXIM_BITS | UART_UARTIMSC_RTIM_BITS)
+
+static void PP_HOT_FUNC(capture_put)(struct uart_capture *cap, uint32_t dr)
+{
+	struct uart_capture_event ev = {
+		.time_us = time_us_32(),
+		.dr = (uint16_t)dr,
+	};
+
+	if (ring_buf_space(&cap->events) < sizeof(ev)) {
+		cap->dropped++;
+		return;
+	}
+	ring_buf_write(&cap->events, (const uint8_t *)&ev, sizeof(ev));
+}
+
+static void PP_HOT_FUNC(uart_irq_handler)(struct uart_port *port)
+{
+	uart_hw_t *hw = uart_get_hw(port->inst);
+
+	if (uart_is_readable(port->inst)) {
+		do {
+			// Leave the data in the hardware FIFO. Once it reaches
+			// the RX watermark, the UART deasserts RTS.
+			if (port->hw_flow &&
+			    ring_buf_space(&port->rx_ring) == 0) {
+				hw_clear_bits(&hw->imsc, RX_IRQS);
+				port->rx_paused = true;
+				break;
+			}
+			uint32_t dr = hw->dr;
+			if (!ring_buf_put(&port->rx_ring, (uint8_t)dr))
+				port->rx_dropped++;
+			if (dr & (UART_UARTDR_OE_BITS | UART_UARTDR_BE_BITS |
+				  UART_UARTDR_PE_BITS | UART_UARTDR_FE_BITS)) {
+				port->rx_errors++;
+				pp_trace(PP_TRACE_UART_ERROR, port - ports,
+					 dr);
+			}
+			if (dr & UART_UARTDR_OE_BITS)
+				port->rx_overruns++;
+			if (port->capture.enabled)
+				capture_put(&port->capture, dr);
+		} while (uart_is_readable(port->inst));
+		port->last_rx_us = time_us_32();
+	}
+
+	while (uart_is_writable(port->inst)) {
+		uint8_t c;
+		if (!ring_buf_get(&port->tx_ring, &c)) {
+			hw_clear_bits(&hw->imsc, UART_UARTIMSC_TXIM_BITS);
+			break;
+		}
+		hw->dr = c;
+	}
+
+	// Received data or room in the TX ring for pp_uart_task()
+	pp_sched_wake(PP_SCHED_UART);
+}
+
+static void PP_HOT_FUNC(uart1_irq_handler)(void)
+{
+	uart_irq_handler(&ports[0]);
+}
+
+#ifdef PP_UART0_CDC
+static void PP_HOT_FUNC(uart0_irq_handler)(void)
+{
+	uart_irq_handler(&ports[1]);
+}
+#endif
+
+static uint32_t baud_to_bit_us(uint baud)
+{
+	return baud < 1000000 ? 1000000 / baud : 1;
+}
+
+// The TX interrupt only fires when the FIFO level drops below the threshold,
+// so the FIFO has to be primed before the interrupt can take over. All
+// interrupts are off, not only the UART one: between taking the last byte from
+// the ring and writing it to the FIFO, the RS-485 alarm would see an idle
+// UART and release DE.
+static void prime_tx(struct uart_port *port)
+{
+	uart_hw_t *hw = uart_get_hw(port->inst);
+	uint32_t irq = save_and_disable_interrupts();
+
+	uint8_t c;
+	while (uart_is_writable(port->inst) && ring_buf_get(&port->tx_ring, &c))
+		hw->dr = c;
+
+	if (!ring_buf_is_empty(&port->tx_ring))
+		hw_set_bits(&hw->imsc, UART_UARTIMSC_TXIM_BITS);
+
+	restore_interrupts(irq);
+}
+
+#ifdef PP_UART_RS485
+// Starts sending once the setup time is over, then releases DE once the last
+// character has left the shift register. BUSY stays set until the stop bit
+// has been sent, so polling it once per bit time while the FIFO is empty
+// releases DE within one bit time, plus the hold time. This runs from the
+// timer interrupt and keeps polling if more data is queued in the meantime.
+static int64_t rs485_alarm_cb(alarm_id_t id, void *user_data)
+{
+	struct uart_port *port = user_data;
+	(void)id;
+
+	if (port->de_setup) {
+		port->de_setup = false;
+		prime_tx(port);
+		return port->bit_us;
+	}
+
+	uint32_t fr = uart_get_hw(port->inst)->fr;
+
+	if (!ring_buf_is_empty(&port->tx_ring)) {
+		// The TX interrupt is still refilling the FIFO
+		port->de_holding = false;
+		return 16 * 10 * port->bit_us;
+	}
+	if (!(fr & UART_UARTFR_TXFE_BITS)) {
+		port->de_holding = false;
+		return 10 * port->bit_us;
+	}
+	if (fr & UART_UARTFR_BUSY_BITS) {
+		port->de_holding = false;
+		return port->bit_us;
+	}
+	if (port->rs485_hold_us && !port->de_holding) {
+		port->de_holding = true;
+		return port->rs485_hold_us;
+	}
+
+	gpio_put(PP_UART_PIN_DE, 0);
+	port->de_holding = false;
+	port->de_active = false;
+	return 0;
+}
+
+// Called with data in the TX ring, so the alarm can't release DE before the
+// FIFO has been primed. Returns whether the caller may send right away,
+// otherwise the alarm starts sending after the setup time.
+static bool rs485_assert_de(struct uart_port *port)
+{
+	if (port->de_active)
+		return !port->de_setup;
+
+	gpio_put(PP_UART_PIN_DE, 1);
+	port->de_active = true;
+	port->de_setup = port->rs485_setup_us != 0;
+
+	uint32_t delay_us =
+		port->de_setup ? port->rs485_setup_us : port->bit_us;
+	if (add_alarm_in_us(delay_us, rs485_alarm_cb, port, true) < 0) {
+		// Nothing would release DE and jam the bus, so don't send.
+		// pp_uart_task() tries again on the next tick.
+		TU_LOG1("UART: Failed to add RS-485 alarm\r\n");
+		port->de_setup = false;
+		port->de_active = false;
+		gpio_put(PP_UART_PIN_DE, 0);
+		return false;
+	}
+	return !port->de_setup;
+}
+#endif
+
+static void start_tx(struct uart_port *port)
+{
+	uart_hw_t *hw = uart_get_hw(port->inst);
+
+	if (hw->imsc & UART_UARTIMSC_TXIM_BITS)
+		return; // Already running
+
+#ifdef PP_UART_RS485
+	if (port->rs485 && !rs485_assert_de(port))
+		return;
+#endif
+
+	prime_tx(port);
+}
+
+static void forward_to_host(uint8_t itf, struct uart_port *port)
+{
+	const uint8_t *data;
+	uint32_t len;
+	uint32_t forwarded = 0;
+
+	while ((len = ring_buf_read_ptr(&port->rx_ring, &data)) > 0) {
+		uint32_t written = tud_cdc_n_write(itf, data, len);
+		ring_buf_consume(&port->rx_ring, written);
+		forwarded += written;
+		if (written < len)
+			break; // CDC FIFO is full
+	}
+
+	if (forwarded > 0) {
+		TU_LOG3("UART itf %u: Forwarded %" PRIu32 " bytes to host\r\n",
+			itf, forwarded);
+	}
+
+	if (port->rx_paused &&
+	    ring_buf_space(&port->rx_ring) >= PP_UART_RX_RESUME_SPACE) {
+		port->rx_paused = false;
+		hw_set_bits(&uart_get_hw(port->inst)->imsc, RX_IRQS);
+	}
+
+	if (port->rx_dropped != port->reported_dropped) {
+		TU_LOG1("UART itf %u: RX ring overflow, dropped %" PRIu32
+			" bytes\r\n",
+			itf, port->rx_dropped - port->reported_dropped);
+		port->reported_dropped = port->rx_dropped;
+	}
+
+	if (ring_buf_is_empty(&port->rx_ring) &&
+	    time_us_32() - port->last_rx_us >= PP_UART_FLUSH_IDLE_US) {
+		tud_cdc_n_write_flush(itf);
+	}
+}
+
+static uint32_t capture_gap_us(struct uart_port *port)
+{
+	// 3.5 characters of 11 bit, as defined by Modbus RTU
+	return port->capture.gap_us ? port->capture.gap_us :
+				      77 * port->bit_us / 2;
+}
+
+static void capture_end_record(struct uart_capture *cap, uint16_t flags)
+{
+	flags |= cap->rec_flags;
+	u16_to_buf_le(&cap->rec[0], cap->rec_len);
+	u16_to_buf_le(&cap->rec[2], flags);
+
+	if (ring_buf_space(&cap->frames) >= cap->rec_len) {
+		ring_buf_write(&cap->frames, cap->rec, cap->rec_len);
+		cap->rec_flags = 0;
+	} else {
+		// The host doesn't read fast enough, drop this record
+		cap->rec_flags = PP_UART_FRAME_OVERFLOW;
+	}
+	cap->rec_len = 0;
+}
+
+static void capture_task(struct uart_port *port)
+{
+	struct uart_capture *cap = &port->capture;
+	struct uart_capture_event ev;
+	uint32_t gap_us = capture_gap_us(port);
+	// Sampled before draining the events, so any byte that is not drained
+	// below is received after now.
+	uint32_t now = time_us_32();
+
+	while (ring_buf_count(&cap->events) >= sizeof(ev)) {
+		ring_buf_read(&cap->events, (uint8_t *)&ev, sizeof(ev));
+		uint32_t delta = ev.time_us - cap->last_us;
+
+		if (cap->rec_len && delta > gap_us)
+			capture_end_record(cap, 0);
+		else if ((size_t)(cap->rec_len + PP_UART_FRAME_BYTE_LEN) >
+			 sizeof(cap->rec))
+			capture_end_record(cap, PP_UART_FRAME_CONTINUED);
+
+		if (cap->rec_len == 0) {
+			u32_to_buf_le(&cap->rec[4], ev.time_us);
+			cap->rec_len = PP_UART_FRAME_HDR_LEN;
+			delta = 0;
+		}
+
+		if (cap->dropped != cap->reported_dropped ||
+		    (ev.dr & UART_UARTDR_OE_BITS)) {
+			cap->reported_dropped = cap->dropped;
+			cap->rec_flags |= PP_UART_FRAME_OVERFLOW;
+		}
+		if (ev.dr & (UART_UARTDR_BE_BITS | UART_UARTDR_PE_BITS |
+			     UART_UARTDR_FE_BITS))
+			cap->rec_flags |= PP_UART_FRAME_LINE_ERROR;
+
+		cap->rec[cap->rec_len] = (uint8_t)ev.dr;
+		u16_to_buf_le(&cap->rec[cap->rec_len + 1],
+			      TU_MIN(delta, 0xFFFF));
+		cap->rec_len += PP_UART_FRAME_BYTE_LEN;
+		cap->last_us = ev.time_us;
+	}
+
+	if (cap->rec_len && now - cap->last_us > gap_us)
+		capture_end_record(cap, 0);
+}
+
+static void capture_enable(struct uart_port *port, bool enable,
+			   uint32_t gap_us)
+{
+	struct uart_capture *cap = &port->capture;
+
+	irq_set_enabled(port->irq, false);
+
+	if (!enable && cap->enabled) {
+		capture_task(port);
+		if (cap->rec_len)
+			capture_end_record(cap, 0);
+	}
+	// Drop anything left from a previous capture
+	ring_buf_consume(&cap->events, ring_buf_count(&cap->events));
+	cap->rec_len = 0;
+	cap->rec_flags = 0;
+	cap->reported_dropped = cap->dropped;
+
+	cap->enabled = enable;
+	cap->gap_us = gap_us;
+	// Without the FIFOs, there is one interrupt per byte, so each byte is
+	// timestamped when it has been received.
+	uart_set_fifo_enabled(port->inst, !enable);
+
+	irq_set_enabled(port->irq, true);
+}
+
+static void forward_to_uart(uint8_t itf, struct uart_port *port)
+{
+	uint8_t *data;
+	uint32_t len;
+	uint32_t forwarded = 0;
+
+	while (tud_cdc_n_available(itf) &&
+	       (len = ring_buf_write_ptr(&port->tx_ring, &data)) > 0) {
+		uint32_t count = tud_cdc_n_read(itf, data, len);
+		if (count == 0)
+			break;
+		ring_buf_produce(&port->tx_ring, count);
+		forwarded += count;
+	}
+
+	if (forwarded > 0) {
+		TU_LOG3("UART itf %u: Forwarded %" PRIu32 " bytes to UART\r\n",
+			itf, forwarded);
+	}
+
+	if (!ring_buf_is_empty(&port->tx_ring))
+		start_tx(port);
+}
+
+static void port_init(struct uart_port *port, irq_handler_t handler)
+{
+	gpio_set_function(port->pin_tx, GPIO_FUNC_UART);
+	gpio_set_function(port->pin_rx, GPIO_FUNC_UART);
+	port->bit_us = baud_to_bit_us(
+		uart_init(port->inst, PP_UART_DEFAULT_SPEED));
+
+	irq_set_exclusive_handler(port->irq, handler);
+	irq_set_enabled(port->irq, true);
+	uart_set_irq_enables(port->inst, true, false);
+}
+
+#endif
+
 void pp_uart_init(void)
 {
 #ifndef PP_GPIO_ONLY
-	gpio_set_function(PP_UART_PIN_TX, GPIO_FUNC_UART);
-	gpio_set_function(PP_UART_PIN_RX, GPIO_FUNC_UART);
-	uart_init(PP_UART_INST, PP_UART_DEFAULT_SPEED);
+	port_init(&ports[0], uart1_irq_handler);
+#ifdef PP_UART0_CDC
+	port_init(&ports[1], uart0_irq_handler);
+#endif
+
+#ifdef PP_UART_FLOW_CONTROL
+	gpio_set_function(PP_UART_PIN_CTS, GPIO_FUNC_UART);
+	gpio_set_function(PP_UART_PIN_RTS, GPIO_FUNC_UART);
+	uart_set_hw_flow(PP_UART_INST, true, true);
+	// RTS is deasserted once the RX FIFO reaches the watermark, which is
+	// also the RX interrupt threshold. Raise it to half full, so RTS only
+	// toggles when reception is paused and not on every interrupt.
+	hw_write_masked(&uart_get_hw(PP_UART_INST)->ifls,
+			2 << UART_UARTIFLS_RXIFLSEL_LSB,
+			UART_UARTIFLS_RXIFLSEL_BITS);
+#endif
+
+#ifdef PP_UART_DTR_RTS
+	gpio_init(PP_UART_PIN_DTR_OUT);
+	gpio_init(PP_UART_PIN_RTS_OUT);
+	gpio_put(PP_UART_PIN_DTR_OUT, 1);
+	gpio_put(PP_UART_PIN_RTS_OUT, 1);
+	gpio_set_dir(PP_UART_PIN_DTR_OUT, GPIO_OUT);
+	gpio_set_dir(PP_UART_PIN_RTS_OUT, GPIO_OUT);
+#endif
+
+#ifdef PP_UART_RS485
+	gpio_init(PP_UART_PIN_DE);
+	gpio_put(PP_UART_PIN_DE, 0);
+	gpio_set_dir(PP_UART_PIN_DE, GPIO_OUT);
+#endif
 #endif
 }
 
 void pp_uart_task(void)
 {
 #ifndef PP_GPIO_ONLY
-	char buf[CFG_TUD_CDC_EP_BUFSIZE];
+	// Each call moves at most one ring of data per direction and port, so
+	// neither port nor the rest of the main loop is starved.
+	for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++) {
+		forward_to_host(itf, &ports[itf]);
+		forward_to_uart(itf, &ports[itf]);
+		if (ports[itf].capture.enabled)
+			capture_task(&ports[itf]);
+	}
+#endif
+}
+
+void pp_uart_get_counters(uint8_t itf, uint32_t *rx_dropped,
+			  uint32_t *rx_errors, uint32_t *rx_overruns)
+{
+#ifdef PP_GPIO_ONLY
+	(void)itf;
+	*rx_dropped = 0;
+	*rx_errors = 0;
+	*rx_overruns = 0;
+#else
+	*rx_dropped = itf < CFG_TUD_CDC ? ports[itf].rx_dropped : 0;
+	*rx_errors = itf < CFG_TUD_CDC ? ports[itf].rx_errors : 0;
+	*rx_overruns = itf < CFG_TUD_CDC ? ports[itf].rx_overruns : 0;
+#endif
+}
+
+bool pp_uart_handle_control_request(const tusb_control_request_t *request,
+				    uint8_t const *data_in,
+				    uint16_t data_in_len, uint8_t *data_out,
+				    uint16_t *data_out_len)
+{
+#ifdef PP_GPIO_ONLY
+	(void)request;
+	(void)data_in;
+	(void)data_in_len;
+	(void)data_out;
+	(void)data_out_len;
+	return false;
+#else
+	TU_VERIFY(request->wIndex < CFG_TUD_CDC);
+	struct uart_port *port = &ports[request->wIndex];
+
+	switch (request->bRequest) {
+#ifdef PP_UART_RS485
+	case PP_VREQ_UART_SET_RS485: {
+		TU_VERIFY(port->rs485);
+		TU_VERIFY(data_in_len == 4);
+		uint16_t setup_us = u16_from_buf_le(&data_in[0]);
+		uint16_t hold_us = u16_from_buf_le(&data_in[2]);
+		TU_VERIFY(setup_us <= PP_UART_RS485_MAX_SETUP_US);
 
-	uint32_t i;
-	for (i = 0; i < sizeof(buf) && uart_is_readable(PP_UART_INST); i++) {
-		buf[i] = uart_getc(PP_UART_INST);
+		TU_LOG2("UART itf %u: RS-485 setup %u us, hold %u us\r\n",
+			request->wIndex, setup_us, hold_us);
+		port->rs485_setup_us = setup_us;
+		port->rs485_hold_us = hold_us;
+		*data_out_len = 0;
+		return true;
 	}
 
-	if (i > 0) {
-		uint32_t written = tud_cdc_write(buf, i);
-		tud_cdc_write_flush();
-		TU_LOG3("Forwarded %" PRIu32 " bytes to host\r\n", written);
-		(void)written;
+	case PP_VREQ_UART_GET_RS485:
+		TU_VERIFY(port->rs485);
+		TU_VERIFY(*data_out_len >= 4);
+		u16_to_buf_le(&data_out[0], port->rs485_setup_us);
+		u16_to_buf_le(&data_out[2], port->rs485_hold_us);
+		*data_out_len = 4;
+		return true;
+#endif
+
+	case PP_VREQ_UART_SET_CAPTURE: {
+		TU_VERIFY(request->wValue <= 1);
+		TU_VERIFY(data_in_len == 0 || data_in_len == 4);
+		uint32_t gap_us = data_in_len ? u32_from_buf_le(data_in) : 0;
+
+		TU_LOG2("UART itf %u: Framed capture %s, gap %" PRIu32
+			" us\r\n",
+			request->wIndex, request->wValue ? "on" : "off",
+			gap_us);
+		capture_enable(port, request->wValue, gap_us);
+		*data_out_len = 0;
+		return true;
+	}
+
+	case PP_VREQ_UART_READ_FRAMES: {
+		struct ring_buf *frames = &port->capture.frames;
+		uint16_t len = 0;
+		uint8_t hdr[2];
+
+		// Only complete records
+		while (ring_buf_peek(frames, hdr, sizeof(hdr)) == sizeof(hdr)) {
+			uint16_t rec_len = u16_from_buf_le(hdr);
+			if (len + rec_len > *data_out_len)
+				break;
+			ring_buf_read(frames, &data_out[len], rec_len);
+			len += rec_len;
+		}
+		*data_out_len = len;
+		return true;
+	}
+
+	default:
+		TU_LOG1("UART: Vendor request 0x%02x not supported\r\n",
+			request->bRequest);
+		*data_out_len = 0;
+		return false;
 	}
 #endif
 }
@@ -47,10 +667,19 @@ void pp_uart_task(void)
 
 void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
 {
-	TU_LOG3("UART: Line state changed (DTR=%u, RTS=%u)\r\n", dtr, rts);
+	TU_LOG3("UART itf %u: Line state changed (DTR=%u, RTS=%u)\r\n", itf,
+		dtr, rts);
+
+#ifdef PP_UART_DTR_RTS
+	if (itf == 0) {
+		gpio_put(PP_UART_PIN_DTR_OUT, !dtr);
+		gpio_put(PP_UART_PIN_RTS_OUT, !rts);
+	}
+#else
 	(void)itf;
 	(void)dtr;
 	(void)rts;
+#endif
 }
 
 static uint cdc_to_pico_uart_stop_bits(cdc_line_coding_stopbits_t stop_bits)
@@ -84,18 +713,19 @@ static uart_parity_t cdc_to_pico_uart_parity(cdc_line_coding_parity_t parity)
 
 void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const *p_line_coding)
 {
-	(void)itf;
+	TU_VERIFY(itf < CFG_TUD_CDC, );
+	uart_inst_t *inst = ports[itf].inst;
 
-	TU_LOG3("UART: Line coding changed (bit_rate=%" PRIu32
+	TU_LOG3("UART itf %u: Line coding changed (bit_rate=%" PRIu32
 		", stop_bits=%" PRIu8 ", parity=%" PRIu8 ", data_bits=%" PRIu8
 		")\r\n",
-		p_line_coding->bit_rate, p_line_coding->stop_bits,
+		itf, p_line_coding->bit_rate, p_line_coding->stop_bits,
 		p_line_coding->parity, p_line_coding->data_bits);
 
-	uint baud = uart_set_baudrate(PP_UART_INST, p_line_coding->bit_rate);
-	TU_LOG3("UART: try setting baud %" PRIu32 ", baud is %u\r\n",
-		p_line_coding->bit_rate, baud);
-	(void)baud;
+	uint baud = uart_set_baudrate(inst, p_line_coding->bit_rate);
+	TU_LOG3("UART itf %u: try setting baud %" PRIu32 ", baud is %u\r\n",
+		itf, p_line_coding->bit_rate, baud);
+	ports[itf].bit_us = baud_to_bit_us(baud);
 
 	uint stop_bits = cdc_to_pico_uart_stop_bits(p_line_coding->stop_bits);
 	uart_parity_t parity = cdc_to_pico_uart_parity(p_line_coding->parity);
@@ -108,19 +738,7 @@ void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const *p_line_coding)
 		data_bits = PP_UART_DEFAULT_DATA_BITS;
 	}
 
-	uart_set_format(PP_UART_INST, data_bits, stop_bits, parity);
-}
-
-void tud_cdc_rx_cb(uint8_t itf)
-{
-	(void)itf;
-
-	while (tud_cdc_available()) {
-		uint8_t buf[CFG_TUD_CDC_EP_BUFSIZE];
-		uint32_t count = tud_cdc_read(buf, sizeof(buf));
-		uart_write_blocking(PP_UART_INST, buf, count);
-		TU_LOG3("Forwarded %" PRIu32 " bytes to UART\r\n", count);
-	}
+	uart_set_format(inst, data_bits, stop_bits, parity);
 }
 
 #endif
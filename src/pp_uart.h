@@ -7,5 +7,13 @@
 
 void pp_uart_init(void);
 void pp_uart_task(void);
+bool pp_uart_handle_control_request(const tusb_control_request_t *request,
+				    uint8_t const *data_in,
+				    uint16_t data_in_len, uint8_t *data_out,
+				    uint16_t *data_out_len);
+
+// Counters since boot of a CDC interface, 0 if it doesn't exist
+void pp_uart_get_counters(uint8_t itf, uint32_t *rx_dropped,
+			  uint32_t *rx_errors, uint32_t *rx_overruns);
 
 #endif /* _PICOPORTS_PP_UART_H_ */
@@ -0,0 +1,615 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_PP_VENDOR_H_
+#define _PICOPORTS_PP_VENDOR_H_
+
+// PicoPorts specific vendor control requests on endpoint 0, addressed to the
+// device (bmRequestType 0x40 for OUT, 0xC0 for IN). Unlike the DLN2 bulk
+// interface, they can be used with libusb while the kernel dln2 driver is
+// bound. Failing requests are stalled. This header is shared with the host
+// tools in tools/.
+//
+// The upper nibble of bRequest selects the module, all values are little
+// endian.
+
+#define PP_VENDOR_VID 0xa257
+#define PP_VENDOR_PID 0x2013
+
+// Name of the second DLN2 interface, which is not bound by the kernel driver
+// and used by the host tools with libusb.
+#define PP_DLN2_USER_IFNAME "DLN2 user"
+// Name of the interface whose bulk IN endpoint streams logic analyzer data
+#define PP_LA_IFNAME "Logic analyzer"
+
+// Maximum data stage length
+#define PP_VREQ_MAX_DATA_LEN 512
+
+#define PP_VREQ_MODULE_MASK 0xF0
+#define PP_VREQ_MODULE_UART 0x10
+#define PP_VREQ_MODULE_LA 0x20
+#define PP_VREQ_MODULE_GPIO 0x30
+#define PP_VREQ_MODULE_SEQ 0x40
+#define PP_VREQ_MODULE_COUNTER 0x50
+#define PP_VREQ_MODULE_QUAD 0x60
+#define PP_VREQ_MODULE_SCRIPT 0x70
+#define PP_VREQ_MODULE_STATE 0x80
+#define PP_VREQ_MODULE_STATS 0x90
+#define PP_VREQ_MODULE_TRACE 0xA0
+
+// RS-485 driver enable timing of the UART bridge (build option UART_RS485).
+//   wIndex: CDC interface
+//   Data (OUT for SET, IN for GET):
+//     0: u16 setup_us   DE is asserted this long before the first start bit
+//     2: u16 hold_us    DE is released this long after the last stop bit
+#define PP_VREQ_UART_SET_RS485 0x10
+#define PP_VREQ_UART_GET_RS485 0x11
+
+// Framed RX capture. Received bytes are still forwarded to the CDC interface,
+// additionally they are timestamped and split into frames at idle gaps. The
+// UART FIFOs are disabled while capturing, so every byte is timestamped when
+// its stop bit has been received. Switching modes discards bytes in flight.
+//   wIndex: CDC interface
+//   wValue: 1 to enable, 0 to disable
+//   OUT data:
+//     0: u32 gap_us     a gap longer than this ends a frame, 0 for 3.5
+//                       characters (as in Modbus RTU)
+#define PP_VREQ_UART_SET_CAPTURE 0x12
+
+// Read complete frame records, as many as fit into wLength, which should be
+// PP_VREQ_MAX_DATA_LEN. An empty response means no frame is available.
+//   wIndex: CDC interface
+//   IN data, records of:
+//     0: u16 length     of the record, including this header
+//     2: u16 flags      PP_UART_FRAME_*
+//     4: u32 time_us    device timer when the first byte was received
+//     8: { u8 data, u16 delta_us }[]
+//                       delta_us is the time since the previous byte (0 for
+//                       the first byte), saturated at 0xffff
+#define PP_VREQ_UART_READ_FRAMES 0x13
+
+#define PP_UART_FRAME_HDR_LEN 8
+#define PP_UART_FRAME_BYTE_LEN 3
+#define PP_UART_FRAME_MAX_BYTES                                                \
+	((PP_VREQ_MAX_DATA_LEN - PP_UART_FRAME_HDR_LEN) /                      \
+	 PP_UART_FRAME_BYTE_LEN)
+
+// Data was lost before or within this record
+#define PP_UART_FRAME_OVERFLOW 0x0001
+// The frame is longer than PP_UART_FRAME_MAX_BYTES and continues in the next
+// record
+#define PP_UART_FRAME_CONTINUED 0x0002
+// A framing, parity or break error occurred in this record
+#define PP_UART_FRAME_LINE_ERROR 0x0004
+
+// Logic analyzer (build option LA). pin_count consecutive pins are sampled into
+// a RAM ring by a PIO state machine, the pins keep their function. Once the
+// capture has finished, it's sent on the bulk IN endpoint of the PP_LA_IFNAME
+// interface. Drain the endpoint before starting a capture.
+//   OUT data:
+//     0: u8 pin_base
+//     1: u8 pin_count       1, 2, 4, 8 or 16
+//     2: u8 trigger         PP_LA_TRIGGER_*
+//     3: u8 trigger_pin     any GPIO, it doesn't need to be sampled
+//     4: u32 rate_hz        up to half the system clock, see the status for
+//                           the actual rate
+//     8: u32 pre_samples    before the trigger
+//    12: u32 post_samples   after the trigger
+//    16: u8 flags           PP_LA_FLAG_*
+#define PP_VREQ_LA_CONFIGURE 0x20
+// Arm the capture. Without trigger, it starts immediately.
+#define PP_VREQ_LA_START 0x21
+// Abort a capture or its transfer
+#define PP_VREQ_LA_STOP 0x22
+//   IN data:
+//     0: u8 state           PP_LA_STATE_*
+//     1: u8 flags           PP_LA_STATUS_*
+//     2: u16 reserved
+//     4: u32 rate_hz        actual sample rate
+//     8: u32 num_samples    in the data stream, valid from SENDING on
+//    12: u32 trigger_sample index of the trigger sample in the data stream
+//    16: u32 data_len       bytes queued on the endpoint, final once DONE
+//    20: u32 max_samples    pre_samples + post_samples limit for pin_count
+#define PP_VREQ_LA_GET_STATUS 0x23
+
+#define PP_LA_STATUS_LEN 24
+
+#define PP_LA_TRIGGER_NONE 0
+#define PP_LA_TRIGGER_HIGH 1
+#define PP_LA_TRIGGER_LOW 2
+#define PP_LA_TRIGGER_RISING 3
+#define PP_LA_TRIGGER_FALLING 4
+
+// Run-length encode the data on the second core. Without it, the data is sent
+// as u32 words of 32 / pin_count samples, the first sample in the low bits.
+// With it, the data is sent as u32 records:
+//   bits 0-15: sample
+//   bits 16-31: number of repetitions - 1
+#define PP_LA_FLAG_RLE 0x01
+
+#define PP_LA_STATE_IDLE 0
+// Waiting for the trigger
+#define PP_LA_STATE_ARMED 1
+// Sampling the post trigger samples
+#define PP_LA_STATE_TRIGGERED 2
+#define PP_LA_STATE_SENDING 3
+#define PP_LA_STATE_DONE 4
+
+// The ring was overwritten before the capture could be stopped, the data is
+// incomplete
+#define PP_LA_STATUS_OVERRUN 0x01
+
+// Hardware PWM output on a gpiochip line. The line stays in PWM mode without
+// any USB traffic until it's switched back. GP0-GP29 use 8 PWM slices with
+// two channels each, the channels of a slice share the frequency and GPn and
+// GPn+16 share the same channel. A request that conflicts with another line
+// in PWM mode fails, see shared_line of PP_VREQ_GPIO_GET_PWM.
+//   wIndex: gpiochip line
+//   OUT data, none to switch back to GPIO (the direction and output value are
+//   kept):
+//     0: u32 freq_hz        up to half the system clock, the actual frequency
+//                           is reported by PP_VREQ_GPIO_GET_PWM
+//     4: u16 duty           high time in 1/65535 of the period
+#define PP_VREQ_GPIO_SET_PWM 0x30
+//   wIndex: gpiochip line
+//   IN data:
+//     0: u8 enabled         1 if the line is in PWM mode
+//     1: u8 slice           PWM slice of the line
+//     2: u16 duty           as set
+//     4: u32 freq_hz        actual frequency, 0 if not enabled
+//     8: u16 shared_line    another line on the same slice in PWM mode, 0xffff
+//                           if there is none
+#define PP_VREQ_GPIO_GET_PWM 0x31
+
+#define PP_GPIO_PWM_STATUS_LEN 10
+#define PP_GPIO_PWM_NO_LINE 0xffff
+
+// Coalescing of the DLN2_GPIO_CONDITION_MET_EV events of a gpiochip line. The
+// first change after a quiet interval is sent right away, further changes
+// within the interval are collapsed into a single event at its end with the
+// level at that time. The count field of the event is the number of changes
+// it stands for, so a line sends at most one event per interval, however fast
+// it toggles. Without coalescing, changes before the previous event was sent
+// are collapsed as well.
+//   wIndex: gpiochip line
+//   wValue: minimum interval between events in ms, 0 for no minimum
+#define PP_VREQ_GPIO_SET_COALESCE 0x32
+//   wIndex: gpiochip line
+//   IN data:
+//     0: u16 interval_ms
+//     2: u16 pending        changes not sent yet
+//     4: u32 changes        changes counted since boot
+#define PP_VREQ_GPIO_GET_COALESCE 0x33
+
+#define PP_GPIO_COALESCE_STATUS_LEN 8
+
+// Data of DLN2_GPIO_CONDITION_MET_EV. The kernel driver only reads pin and
+// value, the other fields are PicoPorts specific.
+//   0: u16 count            changes the event stands for
+//   2: u8 type              0
+//   3: u16 pin              gpiochip line
+//   5: u8 value             level when the event was sent
+//   6: u32 time_us          device time of the first of the changes, see
+//                           PP_CMD_GET_TIME
+#define PP_GPIO_EVENT_LEN 10
+
+// GPIO sequence playback (build option SEQ). The steps are played back by PIO,
+// so the timing doesn't depend on USB. Like gpio_put_masked(), each step sets
+// the lines in its mask and keeps the others. Loops repeat the output values
+// of the first pass, so a looping sequence should set all its lines in the
+// first step. The lines are driven as outputs until the sequence ends, then
+// they are GPIO outputs with the last value.
+//
+// Load steps while idle:
+//   wValue: index of the first step, 0 starts a new sequence
+//   OUT data, up to PP_SEQ_MAX_STEPS in total:
+//     { u32 lines, u32 values, u32 delay_ns }[]
+//                           lines and values are masks of gpiochip lines,
+//                           delay_ns is the time until the next step,
+//                           shorter than 3 system clock cycles takes 3
+#define PP_VREQ_SEQ_LOAD 0x40
+// Start the loaded sequence
+//   wValue: number of passes, 0 to repeat until stopped
+//   wIndex: PP_SEQ_FLAG_*
+#define PP_VREQ_SEQ_START 0x41
+// Stop at the current step
+#define PP_VREQ_SEQ_STOP 0x42
+//   IN data:
+//     0: u8 state           PP_SEQ_STATE_*
+//     1: u8 flags           PP_SEQ_STATUS_*
+//     2: u16 num_steps      loaded
+//     4: u32 passes         completed
+#define PP_VREQ_SEQ_GET_STATUS 0x43
+
+#define PP_SEQ_STEP_LEN 12
+#define PP_SEQ_MAX_STEPS 256
+#define PP_SEQ_STATUS_LEN 8
+
+// Send a PP_SEQ_DONE_EV message on the PP_DLN2_USER_IFNAME interface when the
+// sequence has ended
+#define PP_SEQ_FLAG_EVENT 0x0001
+
+#define PP_SEQ_STATE_IDLE 0
+#define PP_SEQ_STATE_RUNNING 1
+#define PP_SEQ_STATE_DONE 2
+
+// DMA didn't keep up, steps took longer than their delay
+#define PP_SEQ_STATUS_UNDERRUN 0x01
+
+// DLN2 event (handle DLN2_HANDLE_EVENT, module ids from 0x40 aren't used by
+// DLN2)
+//   0: u32 passes
+//   4: u8 flags             PP_SEQ_STATUS_*
+#define PP_SEQ_DONE_EV 0x400F
+
+// Frequency and edge counter on gpiochip lines (build option COUNTER). A PIO
+// state machine counts the rising edges and the high time of the line, the
+// results of each gate period are kept until the next one ends. Signals up to
+// a fifth of the system clock (25 MHz) can be measured. The line keeps its
+// function, so e.g. a PWM output can be measured as well.
+//   wIndex: gpiochip line
+//   wValue: gate time in ms, 0 to stop measuring
+//   OUT data (optional):
+//     0: u16 flags          PP_COUNTER_FLAG_*
+#define PP_VREQ_COUNTER_SET 0x50
+// Results of the last complete gate period
+//   wIndex: gpiochip line
+//   IN data:
+//     0: u8 valid           0 until the first gate period has ended
+//     1: u8 reserved[3]
+//     4: u32 gate_us        actual length of the gate period
+//     8: u32 edges          rising edges in the gate period
+//    12: u32 freq_mhz       frequency in mHz, saturated
+//    16: u32 period_ns      mean period, 0 without edges
+//    20: u32 high_ns        mean high time per period, 0 without edges
+//    24: u16 duty           high time in 1/65535 of the gate period
+//    26: u16 line
+//    28: u64 total_edges    since the measurement was started
+#define PP_VREQ_COUNTER_GET 0x51
+
+#define PP_COUNTER_RESULT_LEN 36
+#define PP_COUNTER_MAX_LINES 2
+
+// Send the result as PP_COUNTER_EV message on the PP_DLN2_USER_IFNAME interface
+// after every gate period
+#define PP_COUNTER_FLAG_EVENT 0x0001
+
+// DLN2 event with the data of PP_VREQ_COUNTER_GET
+#define PP_COUNTER_EV 0x500F
+
+// Quadrature encoder decoder on two gpiochip lines (build option QUAD). A PIO
+// state machine counts every step of the A/B inputs, which must be consecutive
+// GPIOs (A on the lower one). Steps where A leads B count up, swapping the
+// lines inverts the direction. Transitions where both inputs changed at once
+// can't be decoded and are counted as errors. Encoders up to several MHz step
+// rate are decoded without losing steps.
+//   wIndex: encoder, 0 to PP_QUAD_MAX_ENCODERS - 1
+//   OUT data (none to disable the encoder):
+//     0: u16 line_a
+//     2: u16 line_b
+//     4: u16 event_ms       minimum interval of PP_QUAD_EV, 0 for no events
+// (Re-)enabling resets the position and the error count to 0.
+#define PP_VREQ_QUAD_SET 0x60
+//   wIndex: encoder
+//   IN data:
+//     0: u8 enabled
+//     1: u8 reserved
+//     2: u16 line_a
+//     4: i32 position
+//     8: u32 errors
+//    12: u32 time_us        device time of the reading, wraps around
+#define PP_VREQ_QUAD_GET 0x61
+
+#define PP_QUAD_STATUS_LEN 16
+#define PP_QUAD_MAX_ENCODERS 2
+
+// DLN2 event, sent when the position or error count has changed, at most every
+// event_ms
+//   0: u8 encoder
+//   1: data of PP_VREQ_QUAD_GET
+#define PP_QUAD_EV 0x600F
+
+// Scripts of DLN2 requests, delays and branches, run by the device without a
+// USB round trip per step (build option SCRIPT). The script calls the same
+// handlers as the DLN2 interfaces. It runs between USB requests, which are
+// still served, and keeps the main loop responsive by executing a limited
+// number of instructions per pass. See PP_SCRIPT_OP_* for the bytecode.
+//
+// Load the bytecode while not running:
+//   wValue: offset, 0 starts a new script
+//   OUT data, up to PP_SCRIPT_MAX_LEN in total
+#define PP_VREQ_SCRIPT_LOAD 0x70
+// Run the loaded script from the start
+//   wValue: PP_SCRIPT_FLAG_*
+#define PP_VREQ_SCRIPT_RUN 0x71
+// Stop a running script, it fails with PP_SCRIPT_ERR_STOPPED
+#define PP_VREQ_SCRIPT_STOP 0x72
+//   IN data:
+//     0: u8 state           PP_SCRIPT_STATE_*
+//     1: u8 error           PP_SCRIPT_ERR_*
+//     2: u16 pc             offset of the current or failed instruction
+//     4: u16 len            of the loaded script
+//     6: u16 result_len
+//     8: u32 acc            accumulator
+//    12: u32 time_us        run time
+#define PP_VREQ_SCRIPT_GET_STATUS 0x73
+//   wValue: offset into the result
+//   IN data: result bytes from offset, up to wLength
+#define PP_VREQ_SCRIPT_GET_RESULT 0x74
+
+#define PP_SCRIPT_MAX_LEN 2048
+#define PP_SCRIPT_RESULT_MAX 480
+#define PP_SCRIPT_STATUS_LEN 16
+
+// Send a PP_SCRIPT_DONE_EV message on the PP_DLN2_USER_IFNAME interface when
+// the script has ended
+#define PP_SCRIPT_FLAG_EVENT 0x0001
+
+#define PP_SCRIPT_STATE_IDLE 0
+#define PP_SCRIPT_STATE_RUNNING 1
+#define PP_SCRIPT_STATE_DONE 2
+#define PP_SCRIPT_STATE_FAILED 3
+
+#define PP_SCRIPT_ERR_NONE 0
+// Unknown or truncated instruction
+#define PP_SCRIPT_ERR_OP 1
+// Jump target outside of the script
+#define PP_SCRIPT_ERR_JUMP 2
+// A DLN2 request failed
+#define PP_SCRIPT_ERR_REQUEST 3
+// LOAD or SAVE outside of the last response
+#define PP_SCRIPT_ERR_RESPONSE 4
+// The result exceeds PP_SCRIPT_RESULT_MAX
+#define PP_SCRIPT_ERR_RESULT 5
+#define PP_SCRIPT_ERR_STOPPED 6
+// 0x80 | code of PP_SCRIPT_OP_FAIL
+#define PP_SCRIPT_ERR_FAIL 0x80
+
+// DLN2 event
+//   0: data of PP_VREQ_SCRIPT_GET_STATUS
+//  16: u8 result[result_len]
+#define PP_SCRIPT_DONE_EV 0x700F
+
+// Script bytecode. Each instruction is an opcode followed by its operands.
+// There is a 32-bit accumulator, a loop counter, the payload of the last DLN2
+// response (without the response code) and the result buffer. Jump targets
+// are byte offsets into the script.
+//
+// End the script successfully. Running past the end does the same.
+#define PP_SCRIPT_OP_END 0x00
+// DLN2 request, failing requests fail the script
+//   u8 handle, u16 cmd, u16 len, u8 data[len]
+#define PP_SCRIPT_OP_REQ 0x01
+//   u32 us                  up to 2^31 us
+#define PP_SCRIPT_OP_DELAY 0x02
+// acc = response bytes at offset, zero-extended
+//   u16 offset, u8 size     1, 2 or 4
+#define PP_SCRIPT_OP_LOAD 0x03
+// acc = value
+//   u32 value
+#define PP_SCRIPT_OP_SET 0x04
+// acc &= mask
+//   u32 mask
+#define PP_SCRIPT_OP_AND 0x05
+// Append response bytes to the result
+//   u16 offset, u16 len
+#define PP_SCRIPT_OP_SAVE 0x06
+// Append the lower bytes of acc to the result
+//   u8 size                 1, 2 or 4
+#define PP_SCRIPT_OP_SAVE_ACC 0x07
+// Jump if acc compared to value meets the condition
+//   u8 cond, u32 value, u16 target
+#define PP_SCRIPT_OP_JUMP 0x08
+//   u32 count
+#define PP_SCRIPT_OP_COUNT 0x09
+// Decrement the loop counter, jump if it isn't 0 then
+//   u16 target
+#define PP_SCRIPT_OP_LOOP 0x0A
+// Fail the script with PP_SCRIPT_ERR_FAIL | code
+//   u8 code                 0 to 0x7f
+#define PP_SCRIPT_OP_FAIL 0x0B
+
+// Conditions of PP_SCRIPT_OP_JUMP, unsigned comparisons of acc with value
+#define PP_SCRIPT_COND_ALWAYS 0
+#define PP_SCRIPT_COND_EQ 1
+#define PP_SCRIPT_COND_NE 2
+#define PP_SCRIPT_COND_LT 3
+#define PP_SCRIPT_COND_GE 4
+#define PP_SCRIPT_COND_GT 5
+#define PP_SCRIPT_COND_LE 6
+
+// State mirror: the inputs and counters of the whole device in one block,
+// refreshed by the device every PP_STATE_REFRESH_MS. A monitor fetches it with
+// one request instead of one DLN2 request per line and channel.
+//   IN data:
+//     0: u8 version         PP_STATE_VERSION, changes with the layout
+//     1: u8 num_adc         valid entries of adc
+//     2: u16 len            of the block
+//     4: u32 seq            incremented on every refresh
+//     8: u32 time_us        device time of the refresh
+//    12: u32 levels         input levels, bit per gpiochip line
+//    16: u32 outputs        lines configured as outputs
+//    20: u32 gpio_events    DLN2_GPIO_CONDITION_MET_EV sent since boot
+//    24: u32 gpio_event_us  device time of the last one
+//    28: u32 uart_rx_dropped[2]  per CDC interface, since boot
+//    36: u32 uart_rx_errors[2]   framing, parity, break or overrun errors
+//    44: u16 adc[PP_STATE_ADC_MAX]  in DLN2 resolution (10 bit)
+//    54: u16 reserved
+#define PP_VREQ_STATE_GET 0x80
+// Send the block as PP_STATE_EV message on the PP_DLN2_USER_IFNAME interface
+// periodically
+//   wValue: interval in ms, 0 to stop
+#define PP_VREQ_STATE_SET_INTERVAL 0x81
+
+#define PP_STATE_VERSION 1
+#define PP_STATE_LEN 56
+#define PP_STATE_ADC_MAX 5
+#define PP_STATE_REFRESH_MS 1
+
+// DLN2 event with the data of PP_VREQ_STATE_GET
+#define PP_STATE_EV 0x800F
+
+// Performance counters, read-only. They tell a slow target (long service
+// times of the I2C or SPI requests) apart from a saturated adapter (full TX
+// queues, a slow main loop). Service times are measured with the 1 us device
+// timer from the complete request until its response is queued. The counters
+// run since boot and wrap around.
+//   IN data:
+//     0: u8 version         PP_STATS_VERSION, changes with the layout
+//     1: u8 num_handles     entries of PP_VREQ_STATS_GET_HANDLES
+//     2: u16 len            of the block
+//     4: u32 time_us        device time of the reading
+//     8: u32 loops_per_s    main loop wakeups in the last full second
+//    12: u32 loop_max_us    longest main loop pass, without the sleep
+//    16: u32 requests       DLN2 requests of both DLN2 interfaces
+//    20: u32 failures       requests with a failure response
+//    24: u16 tx_max_used[2] most messages queued at once, per DLN2 interface
+//    28: u32 tx_dropped[2]  messages dropped for a full queue
+//    36: u16 rx_max_bytes[2] most bytes waiting in the RX FIFO
+//    40: u32 gpio_events    DLN2_GPIO_CONDITION_MET_EV sent
+//    44: u32 gpio_collapsed changes that didn't get an event of their own
+//    48: u32 i2c_naks       transfers not acknowledged
+//    52: u32 i2c_timeouts   transfers aborted, e.g. by clock stretching
+//    56: u32 uart_overruns[2] bytes lost in the UART RX FIFO, per CDC
+//                           interface
+#define PP_VREQ_STATS_GET 0x90
+// Per DLN2 handle, indexed by handle
+//   IN data, num_handles records of:
+//     0: u32 requests
+//     4: u32 failures
+//     8: u32 total_us       sum of the service times
+//    12: u32 max_us         longest service time
+#define PP_VREQ_STATS_GET_HANDLES 0x91
+// Service time histogram of a handle
+//   wIndex: DLN2 handle
+//   IN data:
+//     0: u32 buckets[PP_STATS_BUCKETS]
+//                           bucket n counts the requests that took less than
+//                           2^n us (and at least 2^(n-1) us), the last one all
+//                           longer ones
+#define PP_VREQ_STATS_GET_HISTOGRAM 0x92
+// Requests per command, in order of their first use
+//   IN data, records of:
+//     0: u16 handle
+//     2: u16 cmd
+//     4: u32 requests
+// Once PP_STATS_MAX_COMMANDS commands have been seen, further ones are only
+// counted per handle.
+#define PP_VREQ_STATS_GET_COMMANDS 0x93
+// Main loop scheduler. The loop sleeps until an interrupt marks an event as
+// pending, the latency is the time from then until the loop handles it.
+//   IN data:
+//     0: u32 sleep_us       time spent sleeping, wraps around
+//     4: u32 wakeups        from sleep
+//     8: records per event source (USB, GPIO, UART, tick, busy task) of:
+//          0: u32 events
+//          4: u32 max_latency_us
+//          8: u32 total_latency_us
+#define PP_VREQ_STATS_GET_SCHED 0x94
+// XIP cache counters of the flash the firmware runs from. A miss stalls the
+// core until the cache line is read over QSPI, which the build option
+// RAM_HOT_PATHS avoids for the interrupt and request paths. The hardware
+// counters saturate instead of wrapping, so unlike the other counters these
+// can be cleared, e.g. before a measurement.
+//   wValue: 1 to clear the counters after reading
+//   IN data:
+//     0: u32 accesses       cacheable reads from flash
+//     4: u32 hits           reads served from the cache
+//     8: u8 flags           PP_STATS_XIP_*
+#define PP_VREQ_STATS_GET_XIP 0x95
+
+#define PP_STATS_VERSION 1
+#define PP_STATS_LEN 64
+#define PP_STATS_HANDLE_LEN 16
+#define PP_STATS_BUCKETS 16
+#define PP_STATS_COMMAND_LEN 8
+#define PP_STATS_MAX_COMMANDS 48
+#define PP_STATS_SCHED_SOURCES 5
+#define PP_STATS_SCHED_LEN (8 + PP_STATS_SCHED_SOURCES * 12)
+#define PP_STATS_XIP_LEN 12
+// Built with RAM_HOT_PATHS
+#define PP_STATS_XIP_RAM_HOT_PATHS 0x01
+
+// Binary trace (build option TRACE). The hot paths write fixed size records
+// into a RAM ring instead of formatting log messages, which is cheap enough
+// to stay enabled. The ring keeps the last PP_TRACE_RECORDS records, each
+// record has a sequence number counting from boot.
+//   IN data:
+//     0: u8 version         PP_TRACE_VERSION, changes with the record layout
+//     1: u8 running         records are only written while running
+//     2: u16 record_len     PP_TRACE_RECORD_LEN
+//     4: u16 records        capacity of the ring
+//     6: u16 reserved
+//     8: u32 seq            sequence number of the next record
+//    12: u32 time_us        device time of the reading
+#define PP_VREQ_TRACE_GET_STATUS 0xA0
+// Stop the trace, e.g. to keep the records around an error, or restart it.
+// Records are kept either way.
+//   wValue: 1 to run, 0 to stop
+#define PP_VREQ_TRACE_SET 0xA1
+// Read records, as many as fit into wLength
+//   wValue: lower half of the sequence number of the first record
+//   wIndex: upper half
+//   IN data:
+//     0: u32 seq            of the first record, later than requested if
+//                           records have been overwritten
+//     4: records of:
+//          0: u32 time_us   device timer
+//          4: u16 id        PP_TRACE_*
+//          6: u16 arg0
+//          8: u32 arg1
+#define PP_VREQ_TRACE_READ 0xA2
+
+#define PP_TRACE_VERSION 1
+#define PP_TRACE_STATUS_LEN 16
+#define PP_TRACE_READ_HDR_LEN 4
+#define PP_TRACE_RECORD_LEN 12
+#define PP_TRACE_RECORDS 512
+
+// A complete DLN2 request was received
+//   arg0: handle, arg1: cmd | echo << 16
+#define PP_TRACE_REQUEST 0x0001
+// Its response was queued
+//   arg0: handle, arg1: cmd | response code << 16
+#define PP_TRACE_RESPONSE 0x0002
+// A message was dropped for a full TX queue
+//   arg0: DLN2 interface, arg1: cmd | handle << 16
+#define PP_TRACE_QUEUE_FULL 0x0003
+// A message was written to the IN endpoint
+//   arg0: DLN2 interface, arg1: size
+#define PP_TRACE_SENT 0x0004
+// Requests are left in the RX FIFO for lack of a TX slot
+//   arg0: DLN2 interface, arg1: bytes in the FIFO
+#define PP_TRACE_RX_HELD 0x0005
+// GPIO interrupt
+//   arg0: GPIO, arg1: GPIO_IRQ_* event mask
+#define PP_TRACE_GPIO_IRQ 0x0010
+// DLN2_GPIO_CONDITION_MET_EV queued
+//   arg0: gpiochip line, arg1: value | count << 16
+#define PP_TRACE_GPIO_EVENT 0x0011
+// Byte received with an error
+//   arg0: CDC interface, arg1: UART data register with the error bits
+#define PP_TRACE_UART_ERROR 0x0020
+
+// Device clock, a DLN2 command of the generic module (handle
+// DLN2_HANDLE_CTRL) added by PicoPorts. The host uses it as a ping to
+// estimate the offset and drift of the device timer, see tools/ppdln2.h.
+// The u32 time_us fields of the other requests and events are the lower half
+// of the same 1 us timer.
+//
+// The first request enables the USB start of frame (SOF) interrupt, which
+// timestamps every SOF. Devices on the same bus see a SOF at the same time,
+// so the frame numbers tie the timers of several devices together to a few
+// microseconds, independent of the round trip time of the request.
+//   Response data:
+//     0: u64 time_us        device timer when the request was handled
+//     8: u64 sof_us         device timer at the latest SOF, 0 if there was
+//                           none in the last PP_TIME_SOF_MAX_AGE_US
+//    16: u16 frame          USB frame number of that SOF (11 bits)
+#define PP_CMD_GET_TIME 0x0040
+
+#define PP_TIME_LEN 18
+#define PP_TIME_SOF_MAX_AGE_US 10000
+
+#endif /* _PICOPORTS_PP_VENDOR_H_ */
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#ifndef _PICOPORTS_RING_BUF_H_
+#define _PICOPORTS_RING_BUF_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Single producer, single consumer byte ring. The producer only modifies head,
+// the consumer only modifies tail, so one side may run in an interrupt handler
+// (or on the other core) without locking. size must be a power of two.
+struct ring_buf {
+	uint8_t *buf;
+	uint32_t size;
+	volatile uint32_t head;
+	volatile uint32_t tail;
+};
+
+#define RING_BUF_INIT(storage)                                                 \
+	{ .buf = (storage), .size = sizeof(storage), .head = 0, .tail = 0 }
+
+static inline uint32_t ring_buf_count(const struct ring_buf *rb)
+{
+	return rb->head - rb->tail;
+}
+
+static inline uint32_t ring_buf_space(const struct ring_buf *rb)
+{
+	return rb->size - ring_buf_count(rb);
+}
+
+static inline bool ring_buf_is_empty(const struct ring_buf *rb)
+{
+	return rb->head == rb->tail;
+}
+
+static inline bool ring_buf_put(struct ring_buf *rb, uint8_t c)
+{
+	uint32_t head = rb->head;
+
+	if (head - rb->tail >= rb->size)
+		return false;
+
+	rb->buf[head & (rb->size - 1)] = c;
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	rb->head = head + 1;
+	return true;
+}
+
+static inline bool ring_buf_get(struct ring_buf *rb, uint8_t *c)
+{
+	uint32_t tail = rb->tail;
+
+	if (rb->head == tail)
+		return false;
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	*c = rb->buf[tail & (rb->size - 1)];
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	rb->tail = tail + 1;
+	return true;
+}
+
+// Contiguous free space at the write position. Fill it and commit with
+// ring_buf_produce().
+static inline uint32_t ring_buf_write_ptr(struct ring_buf *rb, uint8_t **data)
+{
+	uint32_t offs = rb->head & (rb->size - 1);
+	uint32_t space = ring_buf_space(rb);
+
+	*data = &rb->buf[offs];
+	return space < rb->size - offs ? space : rb->size - offs;
+}
+
+static inline void ring_buf_produce(struct ring_buf *rb, uint32_t len)
+{
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	rb->head += len;
+}
+
+// Contiguous data at the read position. Consume it with ring_buf_consume().
+static inline uint32_t ring_buf_read_ptr(struct ring_buf *rb,
+					 const uint8_t **data)
+{
+	uint32_t offs = rb->tail & (rb->size - 1);
+	uint32_t count = ring_buf_count(rb);
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	*data = &rb->buf[offs];
+	return count < rb->size - offs ? count : rb->size - offs;
+}
+
+static inline void ring_buf_consume(struct ring_buf *rb, uint32_t len)
+{
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	rb->tail += len;
+}
+
+static inline uint32_t ring_buf_write(struct ring_buf *rb, const uint8_t *data,
+				      uint32_t len)
+{
+	uint32_t written = 0;
+
+	while (written < len) {
+		uint8_t *dst;
+		uint32_t n = ring_buf_write_ptr(rb, &dst);
+		if (n == 0)
+			break;
+		if (n > len - written)
+			n = len - written;
+		memcpy(dst, &data[written], n);
+		ring_buf_produce(rb, n);
+		written += n;
+	}
+
+	return written;
+}
+
+// Copies up to len bytes from the read position without consuming them.
+static inline uint32_t ring_buf_peek(const struct ring_buf *rb, uint8_t *data,
+				     uint32_t len)
+{
+	uint32_t count = ring_buf_count(rb);
+	uint32_t tail = rb->tail;
+
+	if (len > count)
+		len = count;
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	for (uint32_t i = 0; i < len; i++)
+		data[i] = rb->buf[(tail + i) & (rb->size - 1)];
+
+	return len;
+}
+
+static inline uint32_t ring_buf_read(struct ring_buf *rb, uint8_t *data,
+				     uint32_t len)
+{
+	uint32_t read = 0;
+
+	while (read < len) {
+		const uint8_t *src;
+		uint32_t n = ring_buf_read_ptr(rb, &src);
+		if (n == 0)
+			break;
+		if (n > len - read)
+			n = len - read;
+		memcpy(&data[read], src, n);
+		ring_buf_consume(rb, n);
+		read += n;
+	}
+
+	return read;
+}
+
+#endif /* _PICOPORTS_RING_BUF_H_ */
@@ -7,24 +7,44 @@
 
 #include "dln2.h"
 
+// TinyUSB's rp2040 port drives the USB controller of the RP2350 as well, the
+// other differences between the chips are in pp_platform.h.
 #if CFG_TUSB_MCU != OPT_MCU_RP2040
-#error Only rp2040 is supported!
+#error Only RP2040 and RP2350 are supported!
 #endif
 
 #define BOARD_TUD_RHPORT 0
 #define CFG_TUD_ENABLED 1
 
-#define CFG_TUD_VENDOR 1
+// Vendor interfaces in descriptor order: DLN2 for the kernel driver, a second
+// DLN2 interface for libusb and the logic analyzer data stream.
+#define PP_VENDOR_ITF_DLN2 0
+#define PP_VENDOR_ITF_USER 1
+#define PP_NUM_DLN2_ITFS 2
+#ifdef PP_LA
+#define PP_VENDOR_ITF_LA 2
+#define CFG_TUD_VENDOR 3
+#else
+#define CFG_TUD_VENDOR 2
+#endif
 
 #define CFG_TUD_VENDOR_RX_BUFSIZE DLN2_RX_BUF_SIZE
 #define CFG_TUD_VENDOR_TX_BUFSIZE DLN2_RX_BUF_SIZE
 #define CFG_TUD_VENDOR_EPSIZE 64
 
 #ifndef PP_GPIO_ONLY
+#ifdef PP_UART0_CDC
+#define CFG_TUD_CDC 2
+#else
 #define CFG_TUD_CDC 1
+#endif
 
-#define CFG_TUD_CDC_RX_BUFSIZE 64
-#define CFG_TUD_CDC_TX_BUFSIZE 64
+// Large FIFOs so the UART bridge can buffer a few milliseconds of data at
+// 3 Mbaud in both directions.
+#define CFG_TUD_CDC_RX_BUFSIZE 4096
+#define CFG_TUD_CDC_TX_BUFSIZE 4096
+// One full-speed packet. Larger OUT transfers would only complete on a short
+// packet, and cdc-acm doesn't send zero-length packets.
 #define CFG_TUD_CDC_EP_BUFSIZE 64
 #endif
 
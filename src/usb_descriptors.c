@@ -6,6 +6,8 @@
 
 #include "bsp/board_api.h"
 
+#include "pp_vendor.h"
+
 // String Descriptors
 
 enum {
@@ -15,6 +17,9 @@ enum {
 	STRID_SERIALNUMBER,
 	STRID_DLN_IFNAME,
 	STRID_CDC_IFNAME,
+	STRID_CDC1_IFNAME,
+	STRID_DLN_USER_IFNAME,
+	STRID_LA_IFNAME,
 	STRIDS,
 };
 
@@ -27,6 +32,9 @@ char const *string_desc_arr[] = {
 	[STRID_SERIALNUMBER] = NULL, // read from pico hw
 	[STRID_DLN_IFNAME] = "DLN2",
 	[STRID_CDC_IFNAME] = "CDC",
+	[STRID_CDC1_IFNAME] = "CDC UART0",
+	[STRID_DLN_USER_IFNAME] = PP_DLN2_USER_IFNAME,
+	[STRID_LA_IFNAME] = PP_LA_IFNAME,
 };
 
 static uint16_t _desc_str[MAX_CHARS + 1]; // +1 for header: length and type
@@ -101,15 +109,33 @@ const uint8_t *tud_descriptor_device_cb(void)
 #define TU_EDPT_ADDR(num, dir)                                                 \
 	(uint8_t)(num | (dir == TUSB_DIR_IN ? TUSB_DIR_IN_MASK : 0))
 
-#ifdef PP_GPIO_ONLY
-#define NUM_IFS 1
-#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_VENDOR_DESC_LEN)
+// The user space DLN2 interface and the logic analyzer interface come last, so
+// the interface numbers used by existing setups don't change.
+#ifdef PP_LA
+#define NUM_LA_IFS 1
 #else
+#define NUM_LA_IFS 0
+#endif
+
+#ifdef PP_GPIO_ONLY
+#define NUM_IFS (2 + NUM_LA_IFS)
+#define CONFIG_TOTAL_LEN                                                       \
+	(TUD_CONFIG_DESC_LEN + (2 + NUM_LA_IFS) * TUD_VENDOR_DESC_LEN)
+#elif !defined(PP_UART0_CDC)
 // CDC occupies two interface numbers (ID 1 and ID 2)
-#define NUM_IFS 3
+#define NUM_IFS (4 + NUM_LA_IFS)
 #define CONFIG_TOTAL_LEN                                                       \
-	(TUD_CONFIG_DESC_LEN + TUD_VENDOR_DESC_LEN + TUD_CDC_DESC_LEN)
+	(TUD_CONFIG_DESC_LEN + (2 + NUM_LA_IFS) * TUD_VENDOR_DESC_LEN +        \
+	 TUD_CDC_DESC_LEN)
+#else
+// Second CDC for uart0 (ID 3 and ID 4)
+#define NUM_IFS (6 + NUM_LA_IFS)
+#define CONFIG_TOTAL_LEN                                                       \
+	(TUD_CONFIG_DESC_LEN + (2 + NUM_LA_IFS) * TUD_VENDOR_DESC_LEN +        \
+	 2 * TUD_CDC_DESC_LEN)
 #endif
+#define ITF_NUM_DLN2_USER (NUM_IFS - 1 - NUM_LA_IFS)
+#define ITF_NUM_LA (NUM_IFS - 1)
 
 #define EPNUM_VENDOR_OUT TU_EDPT_ADDR(0x01, TUSB_DIR_OUT)
 #define EPNUM_VENDOR_IN TU_EDPT_ADDR(0x02, TUSB_DIR_IN)
@@ -118,6 +144,17 @@ const uint8_t *tud_descriptor_device_cb(void)
 #define EPNUM_CDC_OUT TU_EDPT_ADDR(0x04, TUSB_DIR_OUT)
 #define EPNUM_CDC_IN TU_EDPT_ADDR(0x05, TUSB_DIR_IN)
 
+#define EPNUM_CDC1_NOTIF TU_EDPT_ADDR(0x06, TUSB_DIR_IN)
+#define EPNUM_CDC1_OUT TU_EDPT_ADDR(0x07, TUSB_DIR_OUT)
+#define EPNUM_CDC1_IN TU_EDPT_ADDR(0x08, TUSB_DIR_IN)
+
+#define EPNUM_VENDOR_USER_OUT TU_EDPT_ADDR(0x09, TUSB_DIR_OUT)
+#define EPNUM_VENDOR_USER_IN TU_EDPT_ADDR(0x0A, TUSB_DIR_IN)
+
+// Only IN is used, the vendor class needs both
+#define EPNUM_LA_OUT TU_EDPT_ADDR(0x0B, TUSB_DIR_OUT)
+#define EPNUM_LA_IN TU_EDPT_ADDR(0x0C, TUSB_DIR_IN)
+
 const uint8_t desc_configuration[] = {
 	TUD_CONFIG_DESCRIPTOR(1, NUM_IFS, STRID_LANGID, CONFIG_TOTAL_LEN, 0x00,
 			      100),
@@ -127,6 +164,18 @@ const uint8_t desc_configuration[] = {
 	TUD_CDC_DESCRIPTOR(1, STRID_CDC_IFNAME, EPNUM_CDC_NOTIF, 8,
 			   EPNUM_CDC_OUT, EPNUM_CDC_IN, CFG_TUD_CDC_EP_BUFSIZE),
 #endif
+#ifdef PP_UART0_CDC
+	TUD_CDC_DESCRIPTOR(3, STRID_CDC1_IFNAME, EPNUM_CDC1_NOTIF, 8,
+			   EPNUM_CDC1_OUT, EPNUM_CDC1_IN,
+			   CFG_TUD_CDC_EP_BUFSIZE),
+#endif
+	TUD_VENDOR_DESCRIPTOR(ITF_NUM_DLN2_USER, STRID_DLN_USER_IFNAME,
+			      EPNUM_VENDOR_USER_OUT, EPNUM_VENDOR_USER_IN,
+			      CFG_TUD_VENDOR_EPSIZE),
+#ifdef PP_LA
+	TUD_VENDOR_DESCRIPTOR(ITF_NUM_LA, STRID_LA_IFNAME, EPNUM_LA_OUT,
+			      EPNUM_LA_IN, CFG_TUD_VENDOR_EPSIZE),
+#endif
 };
 
 const uint8_t *tud_descriptor_configuration_cb(uint8_t index)
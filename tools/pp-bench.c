@@ -0,0 +1,912 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Round trip benchmark of the DLN2 request families. Each operation is timed
+ * from its submission to its response, or for GPIO events from setting an
+ * output to the event of an input wired to it. The DLN2 backend keeps up to
+ * DEPTH requests in flight with libppdln2, with -b the completed requests are
+ * reaped from the completion queue and sent again as one batch. The kernel
+ * backend goes through the gpio character device, i2c-dev and IIO sysfs, one
+ * operation at a time.
+ *
+ * Each run prints one JSON object per line: throughput, latency percentiles
+ * and a histogram with power of two buckets in microseconds.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/gpio.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ppdln2.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+
+#define DEFAULT_COUNT 2000
+#define DEFAULT_DEPTHS "1,2,4,8,16"
+#define DEFAULT_PIN 4
+#define DEFAULT_I2C_ADDR 0x50
+#define DEFAULT_I2C_LEN 8
+#define MAX_DEPTH 64
+#define HIST_BUCKETS 24
+#define POLL_TIMEOUT_MS 1000
+
+enum bench_op {
+	OP_GPIO_SET,
+	OP_GPIO_GET,
+	OP_I2C_WRITE,
+	OP_I2C_READ,
+	OP_ADC_GET,
+	OP_GPIO_EVENT,
+	NUM_OPS
+};
+
+static const char *const op_names[NUM_OPS] = {
+	[OP_GPIO_SET] = "gpio-set",	[OP_GPIO_GET] = "gpio-get",
+	[OP_I2C_WRITE] = "i2c-write",	[OP_I2C_READ] = "i2c-read",
+	[OP_ADC_GET] = "adc-get",	[OP_GPIO_EVENT] = "gpio-event",
+};
+
+struct config {
+	const char *device;
+	bool kernel;
+	bool batch;
+	const char *gpiochip;
+	const char *i2cdev;
+	const char *iiodir;
+
+	unsigned int count;
+	uint16_t pin;
+	uint16_t event_out;
+	uint16_t event_in;
+	uint8_t i2c_addr;
+	uint16_t i2c_len;
+	uint8_t adc_channel;
+};
+
+struct stats {
+	double *lat_us;
+	unsigned int n;
+	unsigned int errors;
+	double seconds;
+};
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void record(struct stats *s, double start, double end)
+{
+	s->lat_us[s->n++] = (end - start) * 1e6;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+// Nearest rank, the latencies are sorted
+static double percentile(const struct stats *s, double p)
+{
+	return s->lat_us[(size_t)(p * (s->n - 1) + 0.5)];
+}
+
+static void print_result(const char *backend, enum bench_op op,
+			 unsigned int depth, struct stats *s)
+{
+	unsigned int hist[HIST_BUCKETS] = { 0 };
+	int first = HIST_BUCKETS;
+	int last = -1;
+
+	printf("{\"backend\":\"%s\",\"op\":\"%s\",\"depth\":%u,"
+	       "\"count\":%u,\"errors\":%u,\"seconds\":%.6f,"
+	       "\"ops_per_s\":%.1f",
+	       backend, op_names[op], depth, s->n, s->errors, s->seconds,
+	       s->seconds > 0 ? s->n / s->seconds : 0);
+
+	if (s->n) {
+		qsort(s->lat_us, s->n, sizeof(*s->lat_us), cmp_double);
+		printf(",\"lat_us\":{\"min\":%.1f,\"p50\":%.1f,\"p90\":%.1f,"
+		       "\"p99\":%.1f,\"max\":%.1f}",
+		       s->lat_us[0], percentile(s, 0.5), percentile(s, 0.9),
+		       percentile(s, 0.99), s->lat_us[s->n - 1]);
+	}
+
+	// Bucket i counts latencies below 2^i us, the last one all others
+	for (unsigned int i = 0; i < s->n; i++) {
+		int b = 0;
+		while (b < HIST_BUCKETS - 1 &&
+		       s->lat_us[i] >= (double)(1u << b))
+			b++;
+		hist[b]++;
+		if (b < first)
+			first = b;
+		if (b > last)
+			last = b;
+	}
+	printf(",\"hist_us\":[");
+	for (int b = first; b <= last; b++)
+		printf("%s[%u,%u]", b > first ? "," : "", 1u << b, hist[b]);
+	printf("]}\n");
+	fflush(stdout);
+}
+
+//--------------------------------------------------------------------+
+// DLN2 backend
+//--------------------------------------------------------------------+
+
+static int gpio_setup(struct ppdln2 *d, uint16_t pin, bool out)
+{
+	uint8_t req[3];
+
+	u16_to_buf_le(req, pin);
+	int ret = ppdln2_request(d, DLN2_HANDLE_GPIO, DLN2_GPIO_PIN_ENABLE, req,
+				 2, NULL, 0);
+	if (ret)
+		return ret;
+
+	req[2] = out ? DLN2_GPIO_DIRECTION_OUT : DLN2_GPIO_DIRECTION_IN;
+	return ppdln2_request(d, DLN2_HANDLE_GPIO, DLN2_GPIO_PIN_SET_DIRECTION,
+			      req, 3, NULL, 0);
+}
+
+static int dln2_setup(struct ppdln2 *d, const struct config *cfg,
+		      enum bench_op op)
+{
+	uint8_t req[2] = { 0, cfg->adc_channel };
+	int ret;
+
+	switch (op) {
+	case OP_GPIO_SET:
+	case OP_GPIO_GET:
+		return gpio_setup(d, cfg->pin, op == OP_GPIO_SET);
+	case OP_I2C_WRITE:
+	case OP_I2C_READ:
+		return ppdln2_request(d, DLN2_HANDLE_I2C, DLN2_I2C_ENABLE, req,
+				      1, NULL, 0);
+	case OP_ADC_GET:
+		ret = ppdln2_request(d, DLN2_HANDLE_ADC, DLN2_ADC_ENABLE, req,
+				     1, NULL, 0);
+		if (ret)
+			return ret;
+		return ppdln2_request(d, DLN2_HANDLE_ADC,
+				      DLN2_ADC_CHANNEL_ENABLE, req, 2, NULL, 0);
+	case OP_GPIO_EVENT:
+		ret = gpio_setup(d, cfg->event_out, true);
+		if (ret == 0)
+			ret = gpio_setup(d, cfg->event_in, false);
+		if (ret)
+			return ret;
+
+		// 0: u16 pin, 2: u8 type, 3: u16 period
+		uint8_t ev[5] = { 0 };
+		u16_to_buf_le(ev, cfg->event_in);
+		ev[2] = DLN2_GPIO_EVENT_CHANGE;
+		return ppdln2_request(d, DLN2_HANDLE_GPIO,
+				      DLN2_GPIO_PIN_SET_EVENT_CFG, ev,
+				      sizeof(ev), NULL, 0);
+	default:
+		return -EINVAL;
+	}
+}
+
+static void dln2_prepare(const struct config *cfg, enum bench_op op,
+			 struct ppdln2_xfer *x, unsigned int seq)
+{
+	uint8_t *p = ppdln2_xfer_payload(x);
+
+	switch (op) {
+	case OP_GPIO_SET:
+		x->handle = DLN2_HANDLE_GPIO;
+		x->cmd = DLN2_GPIO_PIN_SET_OUT_VAL;
+		u16_to_buf_le(p, cfg->pin);
+		p[2] = seq & 1;
+		x->tx_len = 3;
+		break;
+	case OP_GPIO_GET:
+		x->handle = DLN2_HANDLE_GPIO;
+		x->cmd = DLN2_GPIO_PIN_GET_VAL;
+		u16_to_buf_le(p, cfg->pin);
+		x->tx_len = 2;
+		break;
+	case OP_I2C_WRITE:
+	case OP_I2C_READ:
+		// 0: u8 port, 1: u8 addr, 2: u8 mem_addr_len, 3: u32 mem_addr,
+		// 7: u16 buf_len, 9: u8 buf[buf_len] (write only)
+		x->handle = DLN2_HANDLE_I2C;
+		memset(p, 0, 9);
+		p[1] = cfg->i2c_addr;
+		u16_to_buf_le(&p[7], cfg->i2c_len);
+		x->tx_len = 9;
+		if (op == OP_I2C_READ) {
+			x->cmd = DLN2_I2C_READ;
+			break;
+		}
+		x->cmd = DLN2_I2C_WRITE;
+		for (uint16_t i = 0; i < cfg->i2c_len; i++)
+			p[9 + i] = (uint8_t)(seq + i);
+		x->tx_len += cfg->i2c_len;
+		break;
+	case OP_ADC_GET:
+		x->handle = DLN2_HANDLE_ADC;
+		x->cmd = DLN2_ADC_CHANNEL_GET_VAL;
+		p[0] = 0;
+		p[1] = cfg->adc_channel;
+		x->tx_len = 2;
+		break;
+	default:
+		break;
+	}
+}
+
+struct dln2_run;
+
+struct dln2_slot {
+	struct ppdln2_xfer x;
+	double submitted;
+	struct dln2_run *run;
+};
+
+struct dln2_run {
+	struct ppdln2 *d;
+	const struct config *cfg;
+	enum bench_op op;
+	struct stats *stats;
+	unsigned int to_submit;
+	unsigned int seq;
+	int status;
+};
+
+static void dln2_submit(struct dln2_run *r, struct dln2_slot *slot)
+{
+	dln2_prepare(r->cfg, r->op, &slot->x, r->seq++);
+	r->to_submit--;
+	slot->submitted = now_s();
+
+	int ret = ppdln2_submit(r->d, &slot->x);
+	if (ret < 0 && r->status == 0)
+		r->status = ret;
+}
+
+static void dln2_complete(struct ppdln2_xfer *x)
+{
+	struct dln2_slot *slot = x->user_data;
+	struct dln2_run *r = slot->run;
+
+	if (x->status < 0) {
+		if (r->status == 0)
+			r->status = x->status;
+		return;
+	}
+	// Failed by the device, still a round trip but not a timed one
+	if (x->status > 0)
+		r->stats->errors++;
+	else
+		record(r->stats, slot->submitted, now_s());
+
+	if (r->to_submit)
+		dln2_submit(r, slot);
+}
+
+static int dln2_run_requests(struct ppdln2 *d, const struct config *cfg,
+			     enum bench_op op, unsigned int depth,
+			     struct stats *s)
+{
+	struct dln2_run r = {
+		.d = d,
+		.cfg = cfg,
+		.op = op,
+		.stats = s,
+		.to_submit = cfg->count,
+	};
+	struct dln2_slot *slots = calloc(depth, sizeof(*slots));
+
+	if (!slots)
+		return -ENOMEM;
+
+	double start = now_s();
+
+	for (unsigned int i = 0; i < depth && r.to_submit; i++) {
+		slots[i].run = &r;
+		slots[i].x.complete = dln2_complete;
+		slots[i].x.user_data = &slots[i];
+		dln2_submit(&r, &slots[i]);
+	}
+
+	while (r.status == 0 && ppdln2_pending(d)) {
+		int ret = ppdln2_poll(d, POLL_TIMEOUT_MS);
+		if (ret < 0)
+			r.status = ret;
+	}
+
+	s->seconds = now_s() - start;
+	free(slots);
+	return r.status;
+}
+
+// The requests completed by a poll are queued again and go out together
+static int dln2_run_batched(struct ppdln2 *d, const struct config *cfg,
+			    enum bench_op op, unsigned int depth,
+			    struct stats *s)
+{
+	struct dln2_slot *slots = calloc(depth, sizeof(*slots));
+	struct ppdln2_xfer *done[MAX_DEPTH];
+	unsigned int to_submit = cfg->count;
+	unsigned int seq = 0;
+	int status = 0;
+
+	if (!slots)
+		return -ENOMEM;
+
+	double start = now_s();
+
+	for (unsigned int i = 0; i < depth && to_submit; i++, to_submit--) {
+		slots[i].x.user_data = &slots[i];
+		dln2_prepare(cfg, op, &slots[i].x, seq++);
+		slots[i].submitted = now_s();
+		ppdln2_queue(d, &slots[i].x);
+	}
+	status = ppdln2_flush(d);
+
+	while (status == 0 && ppdln2_pending(d)) {
+		int ret = ppdln2_poll(d, POLL_TIMEOUT_MS);
+		if (ret < 0) {
+			status = ret;
+			break;
+		}
+
+		unsigned int n = ppdln2_reap(d, done, MAX_DEPTH);
+		double now = now_s();
+		for (unsigned int i = 0; i < n; i++) {
+			struct dln2_slot *slot = done[i]->user_data;
+
+			if (done[i]->status < 0) {
+				status = done[i]->status;
+				break;
+			}
+			if (done[i]->status > 0)
+				s->errors++;
+			else
+				record(s, slot->submitted, now);
+
+			if (to_submit) {
+				to_submit--;
+				dln2_prepare(cfg, op, &slot->x, seq++);
+				slot->submitted = now;
+				ppdln2_queue(d, &slot->x);
+			}
+		}
+		if (status == 0)
+			status = ppdln2_flush(d);
+	}
+
+	s->seconds = now_s() - start;
+	free(slots);
+	return status;
+}
+
+struct dln2_event_wait {
+	uint16_t pin;
+	int val;
+	double at;
+};
+
+static void dln2_event(void *user_data, uint16_t cmd, const uint8_t *data,
+		       uint16_t len)
+{
+	struct dln2_event_wait *w = user_data;
+
+	// 0: u16 count, 2: u8 type, 3: u16 pin, 5: u8 value
+	if (cmd != DLN2_GPIO_CONDITION_MET_EV || len < 6 ||
+	    u16_from_buf_le(&data[3]) != w->pin || data[5] != w->val)
+		return;
+	w->at = now_s();
+}
+
+// Toggles the output and waits for the event of the input each time, so
+// there is never more than one change in flight.
+static int dln2_run_events(struct ppdln2 *d, const struct config *cfg,
+			   struct stats *s)
+{
+	struct dln2_event_wait w = { .pin = cfg->event_in };
+	uint8_t req[3];
+	uint8_t resp[3];
+
+	// Starts with a change of the input
+	u16_to_buf_le(req, cfg->event_in);
+	int ret = ppdln2_request(d, DLN2_HANDLE_GPIO, DLN2_GPIO_PIN_GET_VAL,
+				 req, 2, resp, sizeof(resp));
+	if (ret)
+		return ret;
+	uint8_t level = resp[2];
+
+	ppdln2_set_event_handler(d, dln2_event, &w);
+	u16_to_buf_le(req, cfg->event_out);
+
+	double start = now_s();
+
+	for (unsigned int i = 0; i < cfg->count && ret == 0; i++) {
+		double t0 = now_s();
+
+		level = !level;
+		req[2] = level;
+		w.val = level;
+		w.at = 0;
+		ret = ppdln2_request(d, DLN2_HANDLE_GPIO,
+				     DLN2_GPIO_PIN_SET_OUT_VAL, req,
+				     sizeof(req), NULL, 0);
+		if (ret > 0 || ret == -EIO) {
+			s->errors++;
+			ret = 0;
+			continue;
+		}
+
+		while (ret == 0 && !w.at) {
+			ret = ppdln2_poll(d, POLL_TIMEOUT_MS);
+			if (ret > 0)
+				ret = 0;
+		}
+		if (w.at)
+			record(s, t0, w.at);
+	}
+
+	s->seconds = now_s() - start;
+	ppdln2_set_event_handler(d, NULL, NULL);
+	return ret;
+}
+
+static struct ppdln2_transport *open_transport(const char *device)
+{
+	if (device && strcmp(device, "loopback") == 0)
+		return ppdln2_loopback_open();
+	if (device && strncmp(device, "unix:", 5) == 0)
+		return ppdln2_socket_open(&device[5]);
+	return ppdln2_usb_open(device);
+}
+
+static int run_dln2(const struct config *cfg, enum bench_op op,
+		    unsigned int depth, struct stats *s)
+{
+	struct ppdln2 *d = ppdln2_open(open_transport(cfg->device), depth);
+	if (!d)
+		return -ENODEV;
+
+	int ret = dln2_setup(d, cfg, op);
+	if (ret == 0) {
+		if (op == OP_GPIO_EVENT)
+			ret = dln2_run_events(d, cfg, s);
+		else if (cfg->batch)
+			ret = dln2_run_batched(d, cfg, op, depth, s);
+		else
+			ret = dln2_run_requests(d, cfg, op, depth, s);
+	} else {
+		fprintf(stderr, "%s: Setup failed: %s\n", op_names[op],
+			ret > 0 ? "request failed" : strerror(-ret));
+	}
+
+	ppdln2_close(d);
+	return ret;
+}
+
+//--------------------------------------------------------------------+
+// Kernel backend
+//--------------------------------------------------------------------+
+
+static int gpio_request_line(int chip, uint16_t line, uint64_t flags)
+{
+	struct gpio_v2_line_request req = {
+		.offsets = { line },
+		.num_lines = 1,
+		.config.flags = flags,
+		.consumer = "pp-bench",
+	};
+
+	if (ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &req) < 0)
+		return -errno;
+	return req.fd;
+}
+
+static int gpio_set(int fd, bool val)
+{
+	struct gpio_v2_line_values v = { .bits = val, .mask = 1 };
+
+	return ioctl(fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &v) < 0 ? -errno : 0;
+}
+
+static int gpio_get(int fd)
+{
+	struct gpio_v2_line_values v = { .mask = 1 };
+
+	if (ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &v) < 0)
+		return -errno;
+	return v.bits & 1;
+}
+
+static int gpio_event(int out, int in, bool val)
+{
+	struct gpio_v2_line_event ev;
+	struct pollfd pfd = { .fd = in, .events = POLLIN };
+
+	int ret = gpio_set(out, val);
+	if (ret)
+		return ret;
+
+	ret = poll(&pfd, 1, POLL_TIMEOUT_MS);
+	if (ret <= 0)
+		return ret ? -errno : -ETIMEDOUT;
+	if (read(in, &ev, sizeof(ev)) != sizeof(ev))
+		return -EIO;
+	return 0;
+}
+
+static int i2c_xfer(int fd, const struct config *cfg, bool read,
+		    unsigned int seq)
+{
+	uint8_t buf[DLN2_I2C_MAX_XFER_SIZE];
+	struct i2c_msg msg = {
+		.addr = cfg->i2c_addr,
+		.flags = read ? I2C_M_RD : 0,
+		.len = cfg->i2c_len,
+		.buf = buf,
+	};
+	struct i2c_rdwr_ioctl_data data = { .msgs = &msg, .nmsgs = 1 };
+
+	if (!read) {
+		for (uint16_t i = 0; i < cfg->i2c_len; i++)
+			buf[i] = (uint8_t)(seq + i);
+	}
+	return ioctl(fd, I2C_RDWR, &data) < 0 ? -errno : 0;
+}
+
+static int adc_get(int fd)
+{
+	char buf[16];
+
+	return pread(fd, buf, sizeof(buf), 0) > 0 ? 0 : -errno;
+}
+
+// Requests the line of the operation, for events also the input line
+static int gpio_open(const struct config *cfg, enum bench_op op, int *in)
+{
+	const uint64_t edges = GPIO_V2_LINE_FLAG_EDGE_RISING |
+			       GPIO_V2_LINE_FLAG_EDGE_FALLING;
+	int fd;
+
+	int chip = open(cfg->gpiochip, O_RDWR | O_CLOEXEC);
+	if (chip < 0)
+		return -1;
+
+	if (op == OP_GPIO_EVENT) {
+		fd = gpio_request_line(chip, cfg->event_out,
+				       GPIO_V2_LINE_FLAG_OUTPUT);
+		*in = gpio_request_line(chip, cfg->event_in,
+					GPIO_V2_LINE_FLAG_INPUT | edges);
+		if (fd >= 0 && *in < 0) {
+			close(fd);
+			fd = *in;
+		} else if (fd < 0 && *in >= 0) {
+			close(*in);
+			*in = -1;
+		}
+	} else {
+		fd = gpio_request_line(chip, cfg->pin,
+				       op == OP_GPIO_SET ?
+					       GPIO_V2_LINE_FLAG_OUTPUT :
+					       GPIO_V2_LINE_FLAG_INPUT);
+	}
+	close(chip);
+
+	if (fd < 0) {
+		errno = -fd;
+		return -1;
+	}
+	return fd;
+}
+
+static int run_kernel(const struct config *cfg, enum bench_op op,
+		      struct stats *s)
+{
+	char path[256];
+	int fd = -1;
+	int in = -1;
+	int ret = 0;
+
+	switch (op) {
+	case OP_GPIO_SET:
+	case OP_GPIO_GET:
+	case OP_GPIO_EVENT:
+		fd = gpio_open(cfg, op, &in);
+		break;
+	case OP_I2C_WRITE:
+	case OP_I2C_READ:
+		fd = open(cfg->i2cdev, O_RDWR | O_CLOEXEC);
+		break;
+	case OP_ADC_GET:
+		snprintf(path, sizeof(path), "%s/in_voltage%u_raw",
+			 cfg->iiodir, cfg->adc_channel);
+		fd = open(path, O_RDONLY | O_CLOEXEC);
+		break;
+	default:
+		errno = EINVAL;
+	}
+	if (fd < 0) {
+		ret = -errno;
+		fprintf(stderr, "%s: Setup failed: %s\n", op_names[op],
+			strerror(-ret));
+		return ret;
+	}
+
+	// Starts with a change of the input
+	bool level = op == OP_GPIO_EVENT && gpio_get(in) > 0;
+	double start = now_s();
+
+	for (unsigned int i = 0; i < cfg->count; i++) {
+		double t0 = now_s();
+
+		switch (op) {
+		case OP_GPIO_SET:
+			ret = gpio_set(fd, i & 1);
+			break;
+		case OP_GPIO_GET:
+			ret = gpio_get(fd);
+			if (ret > 0)
+				ret = 0;
+			break;
+		case OP_GPIO_EVENT:
+			level = !level;
+			ret = gpio_event(fd, in, level);
+			break;
+		case OP_I2C_WRITE:
+		case OP_I2C_READ:
+			ret = i2c_xfer(fd, cfg, op == OP_I2C_READ, i);
+			break;
+		case OP_ADC_GET:
+			ret = adc_get(fd);
+			break;
+		default:
+			break;
+		}
+
+		if (ret == -ETIMEDOUT)
+			break;
+		if (ret)
+			s->errors++;
+		else
+			record(s, t0, now_s());
+		ret = 0;
+	}
+
+	s->seconds = now_s() - start;
+	if (in >= 0)
+		close(in);
+	close(fd);
+	return ret;
+}
+
+//--------------------------------------------------------------------+
+// Main
+//--------------------------------------------------------------------+
+
+static bool parse_ops(const char *arg, bool *ops)
+{
+	char *list = strdup(arg);
+	char *save;
+	bool ok = list != NULL;
+
+	for (char *t = strtok_r(list, ",", &save); t && ok;
+	     t = strtok_r(NULL, ",", &save)) {
+		int op = 0;
+		while (op < NUM_OPS && strcmp(t, op_names[op]) != 0)
+			op++;
+		ok = op < NUM_OPS;
+		if (ok)
+			ops[op] = true;
+	}
+	free(list);
+	return ok;
+}
+
+static int parse_depths(const char *arg, unsigned int *depths)
+{
+	char *list = strdup(arg);
+	char *save;
+	int n = 0;
+
+	for (char *t = strtok_r(list, ",", &save); t && n >= 0;
+	     t = strtok_r(NULL, ",", &save)) {
+		unsigned int depth = strtoul(t, NULL, 0);
+		if (depth == 0 || depth > MAX_DEPTH || n == MAX_DEPTH)
+			n = -1;
+		else
+			depths[n++] = depth;
+	}
+	free(list);
+	return n;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-D DEVICE | -k [-g GPIOCHIP] [-i I2CDEV] [-a IIODIR]]\n"
+		"          [-o OPS] [-q DEPTHS] [-n COUNT] [-p PIN] [-e OUT:IN]\n"
+		"          [-A ADDR] [-l LEN] [-c CHANNEL] [-b]\n"
+		"\n"
+		"  -D DEVICE   serial number of the device or unix:PATH for a\n"
+		"              socket of pp-sim (default: first device)\n"
+		"  -k          use the kernel drivers instead of libusb\n"
+		"  -g GPIOCHIP gpio character device (default: /dev/gpiochip0)\n"
+		"  -i I2CDEV   i2c-dev device (default: /dev/i2c-0)\n"
+		"  -a IIODIR   IIO device directory\n"
+		"              (default: /sys/bus/iio/devices/iio:device0)\n"
+		"  -o OPS      comma separated: gpio-set, gpio-get, i2c-write,\n"
+		"              i2c-read, adc-get, gpio-event (default: all but\n"
+		"              gpio-event, which needs -e)\n"
+		"  -q DEPTHS   comma separated requests in flight, DLN2 only\n"
+		"              (default: %s)\n"
+		"  -b          send the requests completed by a poll again as\n"
+		"              one batch, DLN2 only\n"
+		"  -n COUNT    operations per run (default: %d)\n"
+		"  -p PIN      GPIO line (default: %d)\n"
+		"  -e OUT:IN   GPIO lines wired together for gpio-event\n"
+		"  -A ADDR     I2C address (default: 0x%02x)\n"
+		"  -l LEN      I2C transfer length (default: %d)\n"
+		"  -c CHANNEL  ADC channel (default: 0)\n",
+		prog, DEFAULT_DEPTHS, DEFAULT_COUNT, DEFAULT_PIN,
+		DEFAULT_I2C_ADDR, DEFAULT_I2C_LEN);
+}
+
+int main(int argc, char **argv)
+{
+	struct config cfg = {
+		.gpiochip = "/dev/gpiochip0",
+		.i2cdev = "/dev/i2c-0",
+		.iiodir = "/sys/bus/iio/devices/iio:device0",
+		.count = DEFAULT_COUNT,
+		.pin = DEFAULT_PIN,
+		.i2c_addr = DEFAULT_I2C_ADDR,
+		.i2c_len = DEFAULT_I2C_LEN,
+	};
+	bool ops[NUM_OPS] = { false };
+	bool have_ops = false;
+	bool have_event = false;
+	const char *depth_arg = DEFAULT_DEPTHS;
+	unsigned int depths[MAX_DEPTH];
+	unsigned int out, in;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "D:kg:i:a:o:q:bn:p:e:A:l:c:h")) !=
+	       -1) {
+		switch (opt) {
+		case 'D':
+			cfg.device = optarg;
+			break;
+		case 'k':
+			cfg.kernel = true;
+			break;
+		case 'g':
+			cfg.gpiochip = optarg;
+			break;
+		case 'i':
+			cfg.i2cdev = optarg;
+			break;
+		case 'a':
+			cfg.iiodir = optarg;
+			break;
+		case 'o':
+			if (!parse_ops(optarg, ops)) {
+				usage(argv[0]);
+				return 1;
+			}
+			have_ops = true;
+			break;
+		case 'q':
+			depth_arg = optarg;
+			break;
+		case 'b':
+			cfg.batch = true;
+			break;
+		case 'n':
+			cfg.count = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			cfg.pin = strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			if (sscanf(optarg, "%u:%u", &out, &in) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			cfg.event_out = out;
+			cfg.event_in = in;
+			have_event = true;
+			break;
+		case 'A':
+			cfg.i2c_addr = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			cfg.i2c_len = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			cfg.adc_channel = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	int num_depths = parse_depths(depth_arg, depths);
+	if (num_depths <= 0 || cfg.count == 0 || cfg.i2c_addr > 0x7f ||
+	    cfg.i2c_len == 0 || cfg.i2c_len > DLN2_I2C_MAX_XFER_SIZE ||
+	    (ops[OP_GPIO_EVENT] && !have_event)) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (!have_ops) {
+		for (int op = 0; op < NUM_OPS; op++)
+			ops[op] = op != OP_GPIO_EVENT || have_event;
+	}
+	// The kernel interfaces are synchronous
+	if (cfg.kernel) {
+		depths[0] = 1;
+		num_depths = 1;
+	}
+
+	struct stats s = { .lat_us = calloc(cfg.count, sizeof(double)) };
+	if (!s.lat_us)
+		return 1;
+
+	const char *backend = cfg.kernel ? "kernel" :
+			      cfg.batch	 ? "dln2-batch" :
+					   "dln2";
+	int status = 0;
+
+	for (int op = 0; op < NUM_OPS; op++) {
+		if (!ops[op])
+			continue;
+
+		// An event needs the previous one to arrive first
+		int n = op == OP_GPIO_EVENT ? 1 : num_depths;
+		for (int i = 0; i < n; i++) {
+			unsigned int depth = op == OP_GPIO_EVENT ? 1 :
+								    depths[i];
+			s.n = 0;
+			s.errors = 0;
+			s.seconds = 0;
+
+			int ret = cfg.kernel ? run_kernel(&cfg, op, &s) :
+					       run_dln2(&cfg, op, depth, &s);
+			if (ret < 0)
+				fprintf(stderr, "%s at depth %u: %s\n",
+					op_names[op], depth, strerror(-ret));
+			if (ret)
+				status = 1;
+			if (s.n || s.errors)
+				print_result(backend, op, depth, &s);
+			if (ret)
+				break;
+		}
+	}
+
+	free(s.lat_us);
+	return status;
+}
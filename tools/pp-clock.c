@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Clock synchronization with the device timer of one or more devices, see
+ * ppdln2_clock_sync(). Each round prints one JSON object per device and line
+ * with the offset and drift of its timer against CLOCK_MONOTONIC and the
+ * shortest round trip. With several devices on the same bus, the others are
+ * aligned to the first one by their start of frame timestamps, align_us is
+ * how far that moved their estimate from the one of the round trips.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ppdln2.h"
+
+#define MAX_DEVICES 8
+#define DEFAULT_PINGS 16
+#define DEFAULT_ROUNDS 10
+#define DEFAULT_INTERVAL_MS 1000
+
+struct device {
+	const char *name;
+	struct ppdln2 *d;
+	struct ppdln2_clock *clock;
+};
+
+static struct ppdln2_transport *open_transport(const char *device)
+{
+	if (device && strcmp(device, "loopback") == 0)
+		return ppdln2_loopback_open();
+	if (device && strncmp(device, "unix:", 5) == 0)
+		return ppdln2_socket_open(&device[5]);
+	return ppdln2_usb_open(device);
+}
+
+static void sleep_ms(unsigned long ms)
+{
+	struct timespec ts = { .tv_sec = ms / 1000,
+			       .tv_nsec = (ms % 1000) * 1000000 };
+
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+		;
+}
+
+static void print_clock(const struct device *dev, unsigned int round,
+			const struct ppdln2_clock_info *info,
+			const struct ppdln2_clock_info *aligned)
+{
+	printf("{\"device\":\"%s\",\"round\":%u,\"offset_us\":%.3f,"
+	       "\"drift_ppm\":%.3f,\"rtt_us\":%.1f,\"rounds\":%u,"
+	       "\"frame_us\":%.4f",
+	       dev->name, round, info->offset_ns / 1e3, info->drift_ppm,
+	       info->rtt_ns / 1e3, info->rounds, info->frame_us);
+	if (aligned)
+		printf(",\"align_us\":%.3f",
+		       (aligned->offset_ns - info->offset_ns) / 1e3);
+	printf("}\n");
+	fflush(stdout);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-D DEVICE]... [-n PINGS] [-r ROUNDS] "
+		"[-i INTERVAL_MS]\n"
+		"\n"
+		"  -D DEVICE       serial number or unix:PATH of a pp-sim\n"
+		"                  socket, up to %d times for devices on the\n"
+		"                  same bus (default: first device)\n"
+		"  -n PINGS        requests per round (default: %d)\n"
+		"  -r ROUNDS       rounds, 0 to run until interrupted\n"
+		"                  (default: %d)\n"
+		"  -i INTERVAL_MS  time between rounds (default: %d)\n",
+		prog, MAX_DEVICES, DEFAULT_PINGS, DEFAULT_ROUNDS,
+		DEFAULT_INTERVAL_MS);
+}
+
+int main(int argc, char **argv)
+{
+	struct device devs[MAX_DEVICES] = { 0 };
+	unsigned int num_devs = 0;
+	unsigned long pings = DEFAULT_PINGS;
+	unsigned long rounds = DEFAULT_ROUNDS;
+	unsigned long interval_ms = DEFAULT_INTERVAL_MS;
+	int ret = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "D:n:r:i:h")) != -1) {
+		switch (opt) {
+		case 'D':
+			if (num_devs == MAX_DEVICES) {
+				fprintf(stderr, "At most %d devices\n",
+					MAX_DEVICES);
+				return 1;
+			}
+			devs[num_devs++].name = optarg;
+			break;
+		case 'n':
+			pings = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			rounds = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			interval_ms = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (!num_devs)
+		num_devs = 1;
+
+	for (unsigned int i = 0; i < num_devs; i++) {
+		devs[i].d = ppdln2_open(open_transport(devs[i].name), 1);
+		if (devs[i].d)
+			devs[i].clock = ppdln2_clock_open(devs[i].d);
+		if (!devs[i].clock) {
+			ret = -ENODEV;
+			goto out;
+		}
+		if (!devs[i].name)
+			devs[i].name = "usb";
+	}
+
+	for (unsigned int round = 1; !rounds || round <= rounds; round++) {
+		for (unsigned int i = 0; i < num_devs; i++) {
+			ret = ppdln2_clock_sync(devs[i].clock,
+						(unsigned int)pings);
+			if (ret) {
+				fprintf(stderr, "%s: Sync failed: %s\n",
+					devs[i].name, strerror(-ret));
+				goto out;
+			}
+		}
+
+		for (unsigned int i = 0; i < num_devs; i++) {
+			struct ppdln2_clock_info info, aligned;
+			bool is_aligned = false;
+
+			ppdln2_clock_get_info(devs[i].clock, &info);
+			if (i > 0 && ppdln2_clock_align(devs[i].clock,
+							devs[0].clock) == 0) {
+				ppdln2_clock_get_info(devs[i].clock, &aligned);
+				is_aligned = true;
+			}
+			print_clock(&devs[i], round, &info,
+				    is_aligned ? &aligned : NULL);
+		}
+
+		if (!rounds || round < rounds)
+			sleep_ms(interval_ms);
+	}
+
+out:
+	for (unsigned int i = 0; i < num_devs; i++) {
+		ppdln2_clock_close(devs[i].clock);
+		ppdln2_close(devs[i].d);
+	}
+	return ret ? 1 : 0;
+}
@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * DLN2 request fuzzer. Sends random requests generated from the command
+ * tables of src/dln2_spec.h: the known commands with lengths at and around
+ * their limits, unknown commands and handles. Every request must get a
+ * response, requests outside the tables must fail, and the device must keep
+ * answering. The requests change GPIO directions and outputs and transfer on
+ * I2C and SPI, so run it against pp-sim or a device with nothing attached.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ppdln2.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+#include "dln2_spec.h"
+#include "dln2_str.h"
+
+#define DEFAULT_COUNT 10000
+// A request for the device version after this many requests
+#define ALIVE_INTERVAL 100
+
+struct fuzz {
+	struct ppdln2 *d;
+	uint32_t rng;
+	bool verbose;
+
+	unsigned int requests;
+	unsigned int ok;
+	unsigned int failed;
+	unsigned int rejected;
+	unsigned int errors;
+};
+
+// xorshift32, so a seed gives the same requests everywhere
+static uint32_t rnd(struct fuzz *f)
+{
+	f->rng ^= f->rng << 13;
+	f->rng ^= f->rng >> 17;
+	f->rng ^= f->rng << 5;
+	return f->rng;
+}
+
+static uint32_t rnd_below(struct fuzz *f, uint32_t n)
+{
+	return n ? rnd(f) % n : 0;
+}
+
+// Mostly a command of the tables, sometimes an unknown one
+static void pick_request(struct fuzz *f, uint16_t *handle, uint16_t *cmd)
+{
+	uint32_t kind = rnd_below(f, 16);
+
+	// The response to a request on the event handle would look like an
+	// event to the library
+	if (kind == 0) {
+		*handle = (uint16_t)(1 + rnd_below(f, DLN2_HANDLES + 1));
+		*cmd = (uint16_t)rnd(f);
+		return;
+	}
+
+	const struct dln2_handle_spec *h;
+	do {
+		*handle = (uint16_t)rnd_below(f, DLN2_HANDLES);
+		h = dln2_handle_spec(*handle);
+	} while (!h);
+
+	uint16_t i;
+	if (kind == 1) {
+		// Unused entries and commands past the end of the table
+		i = (uint16_t)rnd_below(f, 0x100);
+	} else {
+		do {
+			i = (uint16_t)rnd_below(f, h->num_cmds);
+		} while (!h->cmds[i].name);
+	}
+	*cmd = (uint16_t)(h->module_id << 8 | i);
+}
+
+static uint16_t pick_len(struct fuzz *f, uint16_t handle, uint16_t cmd)
+{
+	const struct dln2_cmd_spec *spec = dln2_cmd_spec(handle, cmd);
+	uint32_t min = spec ? spec->min_len : 0;
+	uint32_t max = spec ? spec->max_len : 16;
+	uint32_t len;
+
+	if (max > PPDLN2_DATA_MAX)
+		max = PPDLN2_DATA_MAX;
+
+	switch (rnd_below(f, 5)) {
+	case 0:
+		len = min ? min - 1 : 0;
+		break;
+	case 1:
+		len = min;
+		break;
+	case 2:
+		len = max;
+		break;
+	case 3:
+		len = max + 1;
+		break;
+	default:
+		len = min + rnd_below(f, max - min + 1);
+	}
+	return (uint16_t)(len > PPDLN2_DATA_MAX ? PPDLN2_DATA_MAX : len);
+}
+
+// Random data, but often with port 0 or a low GPIO line and a length field
+// that fits, so the requests get past the first checks of the modules
+static void fill_data(struct fuzz *f, uint16_t handle, uint16_t cmd,
+		      uint8_t *data, uint16_t len)
+{
+	for (uint16_t i = 0; i < len; i++)
+		data[i] = (uint8_t)rnd(f);
+	if (!len || rnd_below(f, 4) == 0)
+		return;
+
+	if (handle == DLN2_HANDLE_GPIO && len >= 2) {
+		u16_to_buf_le(data, (uint16_t)rnd_below(f, 32));
+		if (len >= 3)
+			data[2] = (uint8_t)rnd_below(f, 3);
+		return;
+	}
+
+	data[0] = (uint8_t)rnd_below(f, 2);
+	if (handle == DLN2_HANDLE_I2C && len >= 9) {
+		// u8 port, u8 addr, u8 mem_addr_len, u32 mem_addr, u16 len
+		data[1] = 0x50;
+		memset(&data[2], 0, 5);
+		u16_to_buf_le(&data[7], cmd == DLN2_I2C_READ ?
+						(uint16_t)rnd_below(f, 64) :
+						len - 9);
+	} else if (handle == DLN2_HANDLE_SPI && len >= 4) {
+		// u8 port, u16 size, u8 attr
+		u16_to_buf_le(&data[1], cmd == DLN2_SPI_READ ?
+						(uint16_t)rnd_below(f, 64) :
+						len - 4);
+	}
+}
+
+static int fuzz_one(struct fuzz *f)
+{
+	struct ppdln2_xfer x = { 0 };
+
+	pick_request(f, &x.handle, &x.cmd);
+	x.tx_len = pick_len(f, x.handle, x.cmd);
+	fill_data(f, x.handle, x.cmd, ppdln2_xfer_payload(&x), x.tx_len);
+
+	bool valid = dln2_request_valid(x.handle, x.cmd, x.tx_len);
+	int ret = ppdln2_transfer(f->d, &x);
+
+	f->requests++;
+	if (f->verbose)
+		printf("%s %s (0x%04x) len %u: %s\n", handle2str(x.handle),
+		       cmd2str(x.cmd), x.cmd, x.tx_len,
+		       ret < 0 ? strerror(-ret) : ret ? "failed" : "ok");
+	if (ret < 0) {
+		fprintf(stderr, "%s %s (0x%04x) len %u: No response: %s\n",
+			handle2str(x.handle), cmd2str(x.cmd), x.cmd,
+			x.tx_len, strerror(-ret));
+		f->errors++;
+		return ret;
+	}
+
+	if (!valid && ret == 0) {
+		fprintf(stderr, "%s %s (0x%04x) len %u: Accepted\n",
+			handle2str(x.handle), cmd2str(x.cmd), x.cmd,
+			x.tx_len);
+		f->errors++;
+	}
+	if (!valid)
+		f->rejected++;
+	else if (ret == 0)
+		f->ok++;
+	else
+		f->failed++;
+	return 0;
+}
+
+static int check_alive(struct fuzz *f)
+{
+	uint8_t ver[4];
+	int ret = ppdln2_request(f->d, DLN2_HANDLE_CTRL, CMD_GET_DEVICE_VER,
+				 NULL, 0, ver, sizeof(ver));
+
+	if (ret < 0) {
+		fprintf(stderr, "No answer after %u requests: %s\n",
+			f->requests, strerror(-ret));
+		f->errors++;
+	}
+	return ret;
+}
+
+static struct ppdln2_transport *open_transport(const char *device)
+{
+	if (device && strcmp(device, "loopback") == 0)
+		return ppdln2_loopback_open();
+	if (device && strncmp(device, "unix:", 5) == 0)
+		return ppdln2_socket_open(&device[5]);
+	return ppdln2_usb_open(device);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-D DEVICE] [-n COUNT] [-s SEED] [-v]\n"
+		"\n"
+		"  -D DEVICE   serial number of the device or unix:PATH for a\n"
+		"              socket of pp-sim (default: first device)\n"
+		"  -n COUNT    requests (default: %d)\n"
+		"  -s SEED     seed of the requests (default: time)\n"
+		"  -v          print every request\n",
+		prog, DEFAULT_COUNT);
+}
+
+int main(int argc, char **argv)
+{
+	const char *device = NULL;
+	unsigned long count = DEFAULT_COUNT;
+	uint32_t seed = (uint32_t)time(NULL);
+	struct fuzz f = { 0 };
+	int opt;
+
+	while ((opt = getopt(argc, argv, "D:n:s:vh")) != -1) {
+		switch (opt) {
+		case 'D':
+			device = optarg;
+			break;
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = (uint32_t)strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			f.verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	f.d = ppdln2_open(open_transport(device), 1);
+	if (!f.d)
+		return 1;
+	// xorshift gets stuck at 0
+	f.rng = seed ? seed : 1;
+	printf("seed %u\n", seed);
+
+	for (unsigned long i = 0; i < count; i++) {
+		if (fuzz_one(&f) < 0)
+			break;
+		if ((i + 1) % ALIVE_INTERVAL == 0 && check_alive(&f) < 0)
+			break;
+	}
+	if (!f.errors)
+		check_alive(&f);
+
+	printf("%u requests: %u ok, %u failed, %u rejected as invalid, "
+	       "%u errors\n",
+	       f.requests, f.ok, f.failed, f.rejected, f.errors);
+	ppdln2_close(f.d);
+	return f.errors ? 1 : 0;
+}
@@ -0,0 +1,456 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Logic analyzer capture (build option LA). Configures and starts a capture
+ * with vendor control requests, reads the data from the bulk IN endpoint of
+ * the logic analyzer interface and writes it as VCD or as raw samples for
+ * sigrok's binary input.
+ */
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libusb.h>
+
+#include "byte_ops.h"
+#include "pp_vendor.h"
+
+#define TIMEOUT_MS 1000
+#define READ_TIMEOUT_MS 100
+#define FLUSH_TIMEOUT_MS 10
+#define READ_SIZE 16384
+
+#define DEFAULT_PIN_COUNT 8
+#define DEFAULT_RATE_HZ 10000000
+#define DEFAULT_SAMPLES 10000
+
+struct la {
+	libusb_context *ctx;
+	libusb_device_handle *dev;
+	int itf;
+	uint8_t ep_in;
+};
+
+static const char *const trigger_names[] = {
+	[PP_LA_TRIGGER_NONE] = "none",
+	[PP_LA_TRIGGER_HIGH] = "high",
+	[PP_LA_TRIGGER_LOW] = "low",
+	[PP_LA_TRIGGER_RISING] = "rising",
+	[PP_LA_TRIGGER_FALLING] = "falling",
+};
+
+static int vreq(struct la *la, uint8_t dir, uint8_t request, uint8_t *data,
+		uint16_t len)
+{
+	int ret = libusb_control_transfer(la->dev,
+					  dir | LIBUSB_REQUEST_TYPE_VENDOR |
+						  LIBUSB_RECIPIENT_DEVICE,
+					  request, 0, 0, data, len, TIMEOUT_MS);
+	if (ret < 0) {
+		fprintf(stderr, "Request 0x%02x failed: %s\n", request,
+			libusb_strerror(ret));
+		return -1;
+	}
+	return ret;
+}
+
+static bool find_interface(struct la *la, libusb_device *usb_dev)
+{
+	struct libusb_config_descriptor *config;
+	bool found = false;
+
+	if (libusb_get_active_config_descriptor(usb_dev, &config) < 0)
+		return false;
+
+	for (int i = 0; i < config->bNumInterfaces && !found; i++) {
+		const struct libusb_interface_descriptor *alt =
+			&config->interface[i].altsetting[0];
+		unsigned char name[64];
+
+		if (alt->bInterfaceClass != LIBUSB_CLASS_VENDOR_SPEC ||
+		    !alt->iInterface)
+			continue;
+		int len = libusb_get_string_descriptor_ascii(
+			la->dev, alt->iInterface, name, sizeof(name));
+		if (len < 0 || strcmp((char *)name, PP_LA_IFNAME) != 0)
+			continue;
+
+		la->itf = alt->bInterfaceNumber;
+		for (int e = 0; e < alt->bNumEndpoints; e++) {
+			uint8_t addr = alt->endpoint[e].bEndpointAddress;
+			if (addr & LIBUSB_ENDPOINT_IN)
+				la->ep_in = addr;
+		}
+		found = la->ep_in != 0;
+	}
+
+	libusb_free_config_descriptor(config);
+	return found;
+}
+
+static bool open_device(struct la *la, const char *serial)
+{
+	libusb_device **list;
+	ssize_t n = libusb_get_device_list(la->ctx, &list);
+
+	for (ssize_t i = 0; i < n && !la->dev; i++) {
+		struct libusb_device_descriptor desc;
+
+		if (libusb_get_device_descriptor(list[i], &desc) < 0 ||
+		    desc.idVendor != PP_VENDOR_VID ||
+		    desc.idProduct != PP_VENDOR_PID)
+			continue;
+		if (libusb_open(list[i], &la->dev) < 0)
+			continue;
+
+		if (serial) {
+			unsigned char s[64];
+			int len = libusb_get_string_descriptor_ascii(
+				la->dev, desc.iSerialNumber, s, sizeof(s));
+			if (len < 0 || strcmp((char *)s, serial) != 0) {
+				libusb_close(la->dev);
+				la->dev = NULL;
+				continue;
+			}
+		}
+
+		if (!find_interface(la, list[i])) {
+			fprintf(stderr,
+				"No \"%s\" interface, firmware built without LA?\n",
+				PP_LA_IFNAME);
+			libusb_close(la->dev);
+			la->dev = NULL;
+		}
+	}
+
+	if (n >= 0)
+		libusb_free_device_list(list, 1);
+	return la->dev != NULL;
+}
+
+struct status {
+	uint8_t state;
+	uint8_t flags;
+	uint32_t rate_hz;
+	uint32_t num_samples;
+	uint32_t trigger_sample;
+	uint32_t data_len;
+	uint32_t max_samples;
+};
+
+static int get_status(struct la *la, struct status *s)
+{
+	uint8_t buf[PP_LA_STATUS_LEN];
+
+	if (vreq(la, LIBUSB_ENDPOINT_IN, PP_VREQ_LA_GET_STATUS, buf,
+		 sizeof(buf)) != sizeof(buf))
+		return -1;
+	s->state = buf[0];
+	s->flags = buf[1];
+	s->rate_hz = u32_from_buf_le(&buf[4]);
+	s->num_samples = u32_from_buf_le(&buf[8]);
+	s->trigger_sample = u32_from_buf_le(&buf[12]);
+	s->data_len = u32_from_buf_le(&buf[16]);
+	s->max_samples = u32_from_buf_le(&buf[20]);
+	return 0;
+}
+
+// Reads the capture, returns the data or NULL
+static uint8_t *capture(struct la *la, const uint8_t *config,
+			struct status *s, size_t *len)
+{
+	uint8_t *data = NULL;
+	size_t size = 0;
+	int transferred;
+
+	*len = 0;
+
+	// Data of an aborted capture may still be queued on the endpoint
+	data = malloc(READ_SIZE);
+	if (!data)
+		return NULL;
+	while (libusb_bulk_transfer(la->dev, la->ep_in, data, READ_SIZE,
+				    &transferred, FLUSH_TIMEOUT_MS) == 0)
+		;
+
+	if (vreq(la, LIBUSB_ENDPOINT_OUT, PP_VREQ_LA_CONFIGURE,
+		 (uint8_t *)config, 17) < 0 ||
+	    vreq(la, LIBUSB_ENDPOINT_OUT, PP_VREQ_LA_START, NULL, 0) < 0)
+		goto err;
+	fprintf(stderr, "Waiting for trigger...\n");
+
+	while (true) {
+		if (get_status(la, s) < 0)
+			goto err;
+		if (s->state == PP_LA_STATE_DONE && *len >= s->data_len)
+			break;
+		if (s->state == PP_LA_STATE_IDLE) {
+			fprintf(stderr, "Capture aborted\n");
+			goto err;
+		}
+
+		if (size - *len < READ_SIZE) {
+			size = size ? size * 2 : 4 * READ_SIZE;
+			uint8_t *p = realloc(data, size);
+			if (!p)
+				goto err;
+			data = p;
+		}
+
+		int ret = libusb_bulk_transfer(la->dev, la->ep_in,
+					       &data[*len], READ_SIZE,
+					       &transferred, READ_TIMEOUT_MS);
+		if (ret < 0 && ret != LIBUSB_ERROR_TIMEOUT) {
+			fprintf(stderr, "Read failed: %s\n",
+				libusb_strerror(ret));
+			goto err;
+		}
+		*len += transferred;
+	}
+
+	return data;
+
+err:
+	free(data);
+	return NULL;
+}
+
+// Expands the data into one u16 per sample. Returns the number of samples.
+static size_t decode(const uint8_t *data, size_t len, unsigned int pin_count,
+		     bool rle, uint16_t **samples)
+{
+	unsigned int spw = 32 / pin_count;
+	uint32_t mask = (1u << pin_count) - 1;
+	size_t n = 0, size = 0;
+
+	*samples = NULL;
+	for (size_t i = 0; i + 4 <= len; i += 4) {
+		uint32_t word = u32_from_buf_le(&data[i]);
+		size_t count = rle ? (word >> 16) + 1 : spw;
+
+		if (n + count > size) {
+			size = (n + count) * 2;
+			uint16_t *p = realloc(*samples, size * sizeof(*p));
+			if (!p) {
+				free(*samples);
+				*samples = NULL;
+				return 0;
+			}
+			*samples = p;
+		}
+
+		for (size_t j = 0; j < count; j++) {
+			if (rle) {
+				(*samples)[n++] = (uint16_t)word;
+			} else {
+				(*samples)[n++] = (uint16_t)(word & mask);
+				word >>= pin_count;
+			}
+		}
+	}
+	return n;
+}
+
+static void write_vcd(FILE *f, const uint16_t *samples, size_t n,
+		      unsigned int pin_base, unsigned int pin_count,
+		      uint32_t rate_hz, uint32_t trigger_sample, bool triggered)
+{
+	double ps_per_sample = 1e12 / rate_hz;
+
+	fprintf(f, "$comment PicoPorts logic analyzer, %u Hz $end\n", rate_hz);
+	fprintf(f, "$timescale 1 ps $end\n");
+	fprintf(f, "$scope module picoports $end\n");
+	for (unsigned int i = 0; i < pin_count; i++)
+		fprintf(f, "$var wire 1 %c GP%u $end\n", '!' + i,
+			pin_base + i);
+	fprintf(f, "$upscope $end\n$enddefinitions $end\n");
+
+	for (size_t i = 0; i < n; i++) {
+		uint16_t changed = i ? samples[i] ^ samples[i - 1] : 0xffff;
+
+		if (triggered && i == trigger_sample)
+			fprintf(f, "$comment trigger $end\n");
+		if (!changed)
+			continue;
+		fprintf(f, "#%.0f\n", i * ps_per_sample);
+		for (unsigned int p = 0; p < pin_count; p++) {
+			if (changed & (1u << p))
+				fprintf(f, "%u%c\n", (samples[i] >> p) & 1,
+					'!' + p);
+		}
+	}
+	fprintf(f, "#%.0f\n", n * ps_per_sample);
+}
+
+// One byte per sample for up to 8 pins, otherwise u16 little endian
+static void write_bin(FILE *f, const uint16_t *samples, size_t n,
+		      unsigned int pin_count)
+{
+	for (size_t i = 0; i < n; i++) {
+		fputc(samples[i] & 0xff, f);
+		if (pin_count > 8)
+			fputc(samples[i] >> 8, f);
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-s SERIAL] [-p PIN] [-n COUNT] [-r RATE] [-t TRIGGER] [-T PIN]\n"
+		"          [-b PRE] [-a POST] [-c] [-f vcd|bin] [-o FILE]\n"
+		"\n"
+		"  -s SERIAL   select the device by serial number\n"
+		"  -p PIN      first pin to sample (default: 0)\n"
+		"  -n COUNT    number of pins, 1, 2, 4, 8 or 16 (default: %d)\n"
+		"  -r RATE     sample rate in Hz (default: %d)\n"
+		"  -t TRIGGER  none, high, low, rising or falling (default: none)\n"
+		"  -T PIN      trigger pin (default: first pin)\n"
+		"  -b PRE      samples before the trigger (default: 0)\n"
+		"  -a POST     samples after the trigger (default: %d)\n"
+		"  -c          run-length encode on the device\n"
+		"  -f FORMAT   vcd, or bin for sigrok's binary input (default: vcd)\n"
+		"  -o FILE     output file (default: stdout)\n",
+		prog, DEFAULT_PIN_COUNT, DEFAULT_RATE_HZ, DEFAULT_SAMPLES);
+}
+
+int main(int argc, char **argv)
+{
+	const char *serial = NULL, *output = NULL;
+	unsigned long pin_base = 0, pin_count = DEFAULT_PIN_COUNT;
+	unsigned long trigger_pin = ~0ul;
+	unsigned long rate_hz = DEFAULT_RATE_HZ;
+	unsigned long pre = 0, post = DEFAULT_SAMPLES;
+	uint8_t trigger = PP_LA_TRIGGER_NONE;
+	bool rle = false, vcd = true;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:p:n:r:t:T:b:a:cf:o:h")) != -1) {
+		switch (opt) {
+		case 's':
+			serial = optarg;
+			break;
+		case 'p':
+			pin_base = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			pin_count = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			rate_hz = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			for (trigger = 0; trigger < 5; trigger++) {
+				if (strcmp(optarg, trigger_names[trigger]) == 0)
+					break;
+			}
+			break;
+		case 'T':
+			trigger_pin = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			pre = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			post = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			rle = true;
+			break;
+		case 'f':
+			vcd = strcmp(optarg, "vcd") == 0;
+			if (!vcd && strcmp(optarg, "bin") != 0)
+				pin_count = 0;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (trigger_pin == ~0ul)
+		trigger_pin = pin_base;
+	if (optind != argc || pin_base > 29 || trigger_pin > 29 ||
+	    trigger >= 5 || rate_hz == 0 || rate_hz > UINT32_MAX ||
+	    pre > UINT32_MAX || post > UINT32_MAX ||
+	    (pin_count != 1 && pin_count != 2 && pin_count != 4 &&
+	     pin_count != 8 && pin_count != 16)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	uint8_t config[17];
+	config[0] = (uint8_t)pin_base;
+	config[1] = (uint8_t)pin_count;
+	config[2] = trigger;
+	config[3] = (uint8_t)trigger_pin;
+	u32_to_buf_le(&config[4], (uint32_t)rate_hz);
+	u32_to_buf_le(&config[8], (uint32_t)pre);
+	u32_to_buf_le(&config[12], (uint32_t)post);
+	config[16] = rle ? PP_LA_FLAG_RLE : 0;
+
+	struct la la = { 0 };
+	if (libusb_init(&la.ctx) < 0) {
+		fprintf(stderr, "Failed to initialize libusb\n");
+		return 1;
+	}
+	if (!open_device(&la, serial)) {
+		fprintf(stderr, "No PicoPorts device found\n");
+		libusb_exit(la.ctx);
+		return 1;
+	}
+	if (libusb_claim_interface(la.dev, la.itf) < 0) {
+		fprintf(stderr, "Failed to claim interface %d\n", la.itf);
+		libusb_close(la.dev);
+		libusb_exit(la.ctx);
+		return 1;
+	}
+
+	struct status s;
+	size_t len;
+	uint8_t *data = capture(&la, config, &s, &len);
+
+	// Don't leave the capture running if reading failed
+	if (!data)
+		vreq(&la, LIBUSB_ENDPOINT_OUT, PP_VREQ_LA_STOP, NULL, 0);
+	libusb_release_interface(la.dev, la.itf);
+	libusb_close(la.dev);
+	libusb_exit(la.ctx);
+	if (!data)
+		return 1;
+
+	uint16_t *samples;
+	size_t n = decode(data, len, pin_count, rle, &samples);
+	free(data);
+	if (n != s.num_samples)
+		fprintf(stderr, "Received %zu of %u samples\n", n,
+			s.num_samples);
+	if (s.flags & PP_LA_STATUS_OVERRUN)
+		fprintf(stderr, "Overrun, the capture is incomplete\n");
+	fprintf(stderr, "%zu samples at %u Hz, trigger at sample %u\n", n,
+		s.rate_hz, s.trigger_sample);
+
+	FILE *f = output ? fopen(output, vcd ? "w" : "wb") : stdout;
+	if (!f) {
+		perror(output);
+		free(samples);
+		return 1;
+	}
+	if (vcd)
+		write_vcd(f, samples, n, pin_base, pin_count, s.rate_hz,
+			  s.trigger_sample, trigger != PP_LA_TRIGGER_NONE);
+	else
+		write_bin(f, samples, n, pin_count);
+	if (f != stdout)
+		fclose(f);
+
+	free(samples);
+	return 0;
+}
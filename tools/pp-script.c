@@ -0,0 +1,756 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Assembler and simulator for device scripts (PP_VREQ_SCRIPT_* of
+ * pp_vendor.h). The script is assembled from a text file and either written
+ * as bytecode for "ppctl script", or run by the firmware's interpreter
+ * (src/pp_script_vm.c) against simulated GPIO, I2C and ADC peripherals. Delays
+ * advance a simulated clock, so the simulation runs instantly.
+ *
+ * Script syntax, one instruction per line, "#" starts a comment and "NAME:"
+ * defines a label:
+ *   gpio_dir LINE in|out        gpio_out LINE 0|1
+ *   gpio_get LINE               acc = line value
+ *   i2c_write ADDR BYTE...      i2c_read ADDR LEN     response: u16 len, data
+ *   adc_get CHANNEL             acc = 10-bit value
+ *   req HANDLE CMD BYTE...      any DLN2 request, HANDLE gpio, i2c, spi, adc,
+ *                               ctrl or a number, CMD a name of dln2_spec.h
+ *                               like PIN_GET_VAL or a number
+ *   delay_us US                 delay_ms MS
+ *   load OFFSET SIZE            set VALUE             and MASK
+ *   save OFFSET LEN             save_acc SIZE
+ *   jump LABEL                  jeq|jne|jlt|jge|jgt|jle VALUE LABEL
+ *   count N                     loop LABEL            fail CODE
+ *   end
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "byte_ops.h"
+#include "dln2.h"
+#include "dln2_spec.h"
+#include "dln2_str.h"
+#include "pp_script_vm.h"
+#include "pp_vendor.h"
+
+#define MAX_ARGS 300
+#define MAX_LABELS 256
+#define MAX_LABEL_LEN 32
+// Executed instructions after which the simulation gives up
+#define SIM_MAX_OPS 10000000u
+
+#define SIM_GPIO_LINES 32
+// GP26-GP29 and the temperature sensor
+#define SIM_ADC_CHANNELS 5
+#define SIM_I2C_MEM_SIZE 256
+
+struct label {
+	char name[MAX_LABEL_LEN];
+	uint16_t offset;
+};
+
+struct assembler {
+	uint8_t code[PP_SCRIPT_MAX_LEN];
+	uint16_t len;
+	int line;
+	bool failed;
+
+	struct label labels[MAX_LABELS];
+	unsigned int num_labels;
+	// Jump targets to fill in once all labels are known
+	struct label fixups[MAX_LABELS];
+	int fixup_lines[MAX_LABELS];
+	unsigned int num_fixups;
+};
+
+static void asm_error(struct assembler *a, const char *msg, const char *arg)
+{
+	fprintf(stderr, "line %d: %s%s%s\n", a->line, msg, arg ? ": " : "",
+		arg ? arg : "");
+	a->failed = true;
+}
+
+static bool parse_num(struct assembler *a, const char *s, uint32_t max,
+		      uint32_t *val)
+{
+	char *end;
+	unsigned long v;
+
+	errno = 0;
+	v = strtoul(s, &end, 0);
+	if (errno || *end || end == s || v > max) {
+		asm_error(a, "invalid number", s);
+		return false;
+	}
+	*val = (uint32_t)v;
+	return true;
+}
+
+static void emit(struct assembler *a, const uint8_t *buf, size_t len)
+{
+	if (len > sizeof(a->code) - a->len) {
+		if (!a->failed)
+			asm_error(a, "script too long", NULL);
+		return;
+	}
+	memcpy(&a->code[a->len], buf, len);
+	a->len += len;
+}
+
+static void emit8(struct assembler *a, uint8_t val)
+{
+	emit(a, &val, 1);
+}
+
+static void emit16(struct assembler *a, uint16_t val)
+{
+	uint8_t buf[2];
+
+	u16_to_buf_le(buf, val);
+	emit(a, buf, sizeof(buf));
+}
+
+static void emit32(struct assembler *a, uint32_t val)
+{
+	uint8_t buf[4];
+
+	u32_to_buf_le(buf, val);
+	emit(a, buf, sizeof(buf));
+}
+
+static void emit_target(struct assembler *a, const char *name)
+{
+	if (a->num_fixups == MAX_LABELS || strlen(name) >= MAX_LABEL_LEN) {
+		asm_error(a, "too many jumps or label too long", name);
+		return;
+	}
+	struct label *f = &a->fixups[a->num_fixups];
+	strcpy(f->name, name);
+	f->offset = a->len;
+	a->fixup_lines[a->num_fixups++] = a->line;
+	emit16(a, 0);
+}
+
+static void emit_req(struct assembler *a, uint8_t handle, uint16_t cmd,
+		     const uint8_t *data, uint16_t len)
+{
+	emit8(a, PP_SCRIPT_OP_REQ);
+	emit8(a, handle);
+	emit16(a, cmd);
+	emit16(a, len);
+	emit(a, data, len);
+}
+
+static void emit_load(struct assembler *a, uint16_t offset, uint8_t size)
+{
+	emit8(a, PP_SCRIPT_OP_LOAD);
+	emit16(a, offset);
+	emit8(a, size);
+}
+
+static bool parse_handle(struct assembler *a, const char *s, uint32_t *handle)
+{
+#define HANDLE_NAME(NAME, name, module_id, commands) \
+	[DLN2_HANDLE_##NAME] = #name,
+	static const char *const names[DLN2_HANDLES] = {
+		DLN2_HANDLE_SPECS(HANDLE_NAME)
+	};
+#undef HANDLE_NAME
+
+	for (uint32_t i = 0; i < DLN2_HANDLES; i++) {
+		if (names[i] && strcmp(s, names[i]) == 0) {
+			*handle = i;
+			return true;
+		}
+	}
+	return parse_num(a, s, UINT8_MAX, handle);
+}
+
+static bool parse_cmd(struct assembler *a, uint32_t handle, const char *s,
+		      uint32_t *cmd)
+{
+	const struct dln2_handle_spec *h = dln2_handle_spec((uint16_t)handle);
+
+	for (uint16_t i = 0; h && i < h->num_cmds; i++) {
+		if (h->cmds[i].name && strcmp(s, h->cmds[i].name) == 0) {
+			*cmd = (uint32_t)h->module_id << 8 | i;
+			return true;
+		}
+	}
+	return parse_num(a, s, UINT16_MAX, cmd);
+}
+
+static const struct {
+	const char *name;
+	uint8_t cond;
+} jumps[] = {
+	{ "jeq", PP_SCRIPT_COND_EQ }, { "jne", PP_SCRIPT_COND_NE },
+	{ "jlt", PP_SCRIPT_COND_LT }, { "jge", PP_SCRIPT_COND_GE },
+	{ "jgt", PP_SCRIPT_COND_GT }, { "jle", PP_SCRIPT_COND_LE },
+};
+
+static void assemble_insn(struct assembler *a, int argc, char **argv)
+{
+	const char *op = argv[0];
+	uint32_t v[2] = { 0, 0 };
+	// I2C write header and data
+	uint8_t data[9 + MAX_ARGS];
+	int n = argc - 1;
+
+	// Bail out on a wrong operand count or an invalid number
+#define ARGS(min, max)                                                \
+	do {                                                          \
+		if (n < (min) || n > (max)) {                         \
+			asm_error(a, "wrong number of operands", op); \
+			return;                                       \
+		}                                                     \
+	} while (0)
+#define NUM(i, max)                                           \
+	do {                                                  \
+		if (!parse_num(a, argv[(i) + 1], max, &v[i])) \
+			return;                               \
+	} while (0)
+
+	if (strcmp(op, "end") == 0) {
+		ARGS(0, 0);
+		emit8(a, PP_SCRIPT_OP_END);
+	} else if (strcmp(op, "req") == 0 || strcmp(op, "i2c_write") == 0) {
+		bool i2c = op[0] == 'i';
+		uint32_t handle = DLN2_HANDLE_I2C, cmd = DLN2_I2C_WRITE;
+		int first = 1;
+		uint16_t len = 0;
+
+		ARGS(i2c ? 1 : 2, i2c ? 1 + DLN2_I2C_MAX_XFER_SIZE :
+				       MAX_ARGS - 1);
+		if (!i2c) {
+			if (!parse_handle(a, argv[1], &handle) ||
+			    !parse_cmd(a, handle, argv[2], &cmd))
+				return;
+			first = 3;
+		} else {
+			NUM(0, 0x7f);
+			// u8 port, u8 addr, u8 mem_addr_len, u32 mem_addr,
+			// u16 buf_len
+			memset(data, 0, 9);
+			data[1] = (uint8_t)v[0];
+			u16_to_buf_le(&data[7], (uint16_t)(argc - 2));
+			len = 9;
+			first = 2;
+		}
+		for (int i = first; i < argc; i++) {
+			uint32_t byte;
+
+			if (!parse_num(a, argv[i], UINT8_MAX, &byte))
+				return;
+			data[len++] = (uint8_t)byte;
+		}
+		// The firmware would fail it without running the command
+		if (!dln2_request_valid((uint16_t)handle, (uint16_t)cmd, len)) {
+			asm_error(a, "invalid request length or command", op);
+			return;
+		}
+		emit_req(a, (uint8_t)handle, (uint16_t)cmd, data, len);
+	} else if (strcmp(op, "i2c_read") == 0) {
+		ARGS(2, 2);
+		NUM(0, 0x7f);
+		NUM(1, DLN2_I2C_MAX_XFER_SIZE);
+		memset(data, 0, 9);
+		data[1] = (uint8_t)v[0];
+		u16_to_buf_le(&data[7], (uint16_t)v[1]);
+		emit_req(a, DLN2_HANDLE_I2C, DLN2_I2C_READ, data, 9);
+	} else if (strcmp(op, "gpio_out") == 0) {
+		ARGS(2, 2);
+		NUM(0, UINT16_MAX - 1);
+		NUM(1, 1);
+		u16_to_buf_le(data, (uint16_t)v[0]);
+		data[2] = (uint8_t)v[1];
+		emit_req(a, DLN2_HANDLE_GPIO, DLN2_GPIO_PIN_SET_OUT_VAL, data,
+			 3);
+	} else if (strcmp(op, "gpio_dir") == 0) {
+		ARGS(2, 2);
+		NUM(0, UINT16_MAX - 1);
+		if (strcmp(argv[2], "in") != 0 && strcmp(argv[2], "out") != 0) {
+			asm_error(a, "expected in or out", argv[2]);
+			return;
+		}
+		u16_to_buf_le(data, (uint16_t)v[0]);
+		data[2] = strcmp(argv[2], "out") == 0 ?
+				  DLN2_GPIO_DIRECTION_OUT :
+				  DLN2_GPIO_DIRECTION_IN;
+		emit_req(a, DLN2_HANDLE_GPIO, DLN2_GPIO_PIN_SET_DIRECTION, data,
+			 3);
+	} else if (strcmp(op, "gpio_get") == 0) {
+		ARGS(1, 1);
+		NUM(0, UINT16_MAX - 1);
+		u16_to_buf_le(data, (uint16_t)v[0]);
+		emit_req(a, DLN2_HANDLE_GPIO, DLN2_GPIO_PIN_GET_VAL, data, 2);
+		// Response: u16 pin, u8 value
+		emit_load(a, 2, 1);
+	} else if (strcmp(op, "adc_get") == 0) {
+		ARGS(1, 1);
+		NUM(0, UINT8_MAX);
+		data[0] = 0;
+		data[1] = (uint8_t)v[0];
+		emit_req(a, DLN2_HANDLE_ADC, DLN2_ADC_CHANNEL_GET_VAL, data, 2);
+		emit_load(a, 0, 2);
+	} else if (strcmp(op, "delay_us") == 0 || strcmp(op, "delay_ms") == 0) {
+		bool ms = op[6] == 'm';
+
+		ARGS(1, 1);
+		NUM(0, ms ? INT32_MAX / 1000 : INT32_MAX);
+		emit8(a, PP_SCRIPT_OP_DELAY);
+		emit32(a, ms ? v[0] * 1000 : v[0]);
+	} else if (strcmp(op, "load") == 0) {
+		ARGS(2, 2);
+		NUM(0, UINT16_MAX);
+		NUM(1, 4);
+		emit_load(a, (uint16_t)v[0], (uint8_t)v[1]);
+	} else if (strcmp(op, "set") == 0 || strcmp(op, "and") == 0 ||
+		   strcmp(op, "count") == 0) {
+		ARGS(1, 1);
+		NUM(0, UINT32_MAX);
+		emit8(a, op[0] == 's' ? PP_SCRIPT_OP_SET :
+			 op[0] == 'a' ? PP_SCRIPT_OP_AND :
+					PP_SCRIPT_OP_COUNT);
+		emit32(a, v[0]);
+	} else if (strcmp(op, "save") == 0) {
+		ARGS(2, 2);
+		NUM(0, UINT16_MAX);
+		NUM(1, PP_SCRIPT_RESULT_MAX);
+		emit8(a, PP_SCRIPT_OP_SAVE);
+		emit16(a, (uint16_t)v[0]);
+		emit16(a, (uint16_t)v[1]);
+	} else if (strcmp(op, "save_acc") == 0) {
+		ARGS(1, 1);
+		NUM(0, 4);
+		emit8(a, PP_SCRIPT_OP_SAVE_ACC);
+		emit8(a, (uint8_t)v[0]);
+	} else if (strcmp(op, "jump") == 0) {
+		ARGS(1, 1);
+		emit8(a, PP_SCRIPT_OP_JUMP);
+		emit8(a, PP_SCRIPT_COND_ALWAYS);
+		emit32(a, 0);
+		emit_target(a, argv[1]);
+	} else if (strcmp(op, "loop") == 0) {
+		ARGS(1, 1);
+		emit8(a, PP_SCRIPT_OP_LOOP);
+		emit_target(a, argv[1]);
+	} else if (strcmp(op, "fail") == 0) {
+		ARGS(1, 1);
+		NUM(0, 0x7f);
+		emit8(a, PP_SCRIPT_OP_FAIL);
+		emit8(a, (uint8_t)v[0]);
+	} else {
+		for (size_t i = 0; i < sizeof(jumps) / sizeof(jumps[0]); i++) {
+			if (strcmp(op, jumps[i].name) != 0)
+				continue;
+			ARGS(2, 2);
+			NUM(0, UINT32_MAX);
+			emit8(a, PP_SCRIPT_OP_JUMP);
+			emit8(a, jumps[i].cond);
+			emit32(a, v[0]);
+			emit_target(a, argv[2]);
+			return;
+		}
+		asm_error(a, "unknown instruction", op);
+	}
+
+#undef ARGS
+#undef NUM
+}
+
+static void define_label(struct assembler *a, const char *name)
+{
+	if (a->num_labels == MAX_LABELS || strlen(name) >= MAX_LABEL_LEN) {
+		asm_error(a, "too many labels or label too long", name);
+		return;
+	}
+	for (unsigned int i = 0; i < a->num_labels; i++) {
+		if (strcmp(a->labels[i].name, name) == 0) {
+			asm_error(a, "duplicate label", name);
+			return;
+		}
+	}
+	strcpy(a->labels[a->num_labels].name, name);
+	a->labels[a->num_labels++].offset = a->len;
+}
+
+static bool assemble(struct assembler *a, FILE *f)
+{
+	char line[4096];
+
+	while (fgets(line, sizeof(line), f)) {
+		char *argv[MAX_ARGS];
+		int argc = 0;
+
+		a->line++;
+		line[strcspn(line, "#\n")] = '\0';
+		for (char *tok = strtok(line, " \t\r"); tok;
+		     tok = strtok(NULL, " \t\r")) {
+			if (argc == MAX_ARGS) {
+				asm_error(a, "too many operands", NULL);
+				break;
+			}
+			argv[argc++] = tok;
+		}
+
+		if (argc && argv[0][strlen(argv[0]) - 1] == ':') {
+			argv[0][strlen(argv[0]) - 1] = '\0';
+			define_label(a, argv[0]);
+			argc--;
+			memmove(argv, &argv[1], argc * sizeof(argv[0]));
+		}
+		if (argc)
+			assemble_insn(a, argc, argv);
+	}
+
+	for (unsigned int i = 0; i < a->num_fixups; i++) {
+		struct label *f = &a->fixups[i];
+		unsigned int l;
+
+		for (l = 0; l < a->num_labels; l++) {
+			if (strcmp(a->labels[l].name, f->name) == 0)
+				break;
+		}
+		a->line = a->fixup_lines[i];
+		if (l == a->num_labels)
+			asm_error(a, "undefined label", f->name);
+		else
+			u16_to_buf_le(&a->code[f->offset], a->labels[l].offset);
+	}
+	return !a->failed;
+}
+
+// Simulated peripherals, with the request formats of src/pp_gpio.c,
+// src/pp_i2c.c and src/pp_adc.c
+struct sim {
+	uint32_t now_us;
+	bool verbose;
+
+	uint32_t gpio_out;
+	uint32_t gpio_dir;
+	uint32_t gpio_in;
+	uint16_t adc[SIM_ADC_CHANNELS];
+	// I2C devices are memories with an address pointer set by the first
+	// byte written, like a 24C02 EEPROM
+	bool i2c_present[128];
+	uint8_t i2c_ptr[128];
+	uint8_t i2c_mem[128][SIM_I2C_MEM_SIZE];
+};
+
+static bool sim_gpio(struct sim *s, uint16_t cmd, const uint8_t *in,
+		     uint16_t in_len, uint8_t *out, uint16_t *out_len)
+{
+	if (in_len < 2 || u16_from_buf_le(in) >= SIM_GPIO_LINES)
+		return false;
+	uint16_t line = u16_from_buf_le(in);
+	uint32_t bit = 1u << line;
+
+	memcpy(out, in, 2);
+	*out_len = 2;
+	switch (cmd) {
+	case DLN2_GPIO_PIN_ENABLE:
+	case DLN2_GPIO_PIN_DISABLE:
+		return true;
+	case DLN2_GPIO_PIN_GET_VAL:
+		out[2] = !!((s->gpio_dir & bit ? s->gpio_out : s->gpio_in) &
+			    bit);
+		break;
+	case DLN2_GPIO_PIN_SET_OUT_VAL:
+		if (in_len < 3 || in[2] > 1)
+			return false;
+		s->gpio_out = in[2] ? s->gpio_out | bit : s->gpio_out & ~bit;
+		out[2] = in[2];
+		break;
+	case DLN2_GPIO_PIN_SET_DIRECTION:
+		if (in_len < 3 || in[2] > DLN2_GPIO_DIRECTION_OUT)
+			return false;
+		s->gpio_dir = in[2] ? s->gpio_dir | bit : s->gpio_dir & ~bit;
+		out[2] = in[2];
+		break;
+	case DLN2_GPIO_PIN_GET_DIRECTION:
+		out[2] = !!(s->gpio_dir & bit);
+		break;
+	default:
+		return false;
+	}
+	*out_len = 3;
+	return true;
+}
+
+static bool sim_i2c(struct sim *s, uint16_t cmd, const uint8_t *in,
+		    uint16_t in_len, uint8_t *out, uint16_t *out_len)
+{
+	if (in_len < 1 || in[0] != 0)
+		return false;
+	if (cmd == DLN2_I2C_ENABLE || cmd == DLN2_I2C_DISABLE) {
+		*out_len = 0;
+		return true;
+	}
+	if ((cmd != DLN2_I2C_WRITE && cmd != DLN2_I2C_READ) || in_len < 9)
+		return false;
+
+	uint8_t addr = in[1];
+	uint16_t len = u16_from_buf_le(&in[7]);
+	// Not acknowledged
+	if (addr > 0x7f || !s->i2c_present[addr])
+		return false;
+
+	uint8_t *mem = s->i2c_mem[addr];
+	uint8_t *ptr = &s->i2c_ptr[addr];
+
+	if (cmd == DLN2_I2C_WRITE) {
+		if (in_len < 9 + len)
+			return false;
+		for (uint16_t i = 0; i < len; i++) {
+			if (i == 0)
+				*ptr = in[9];
+			else
+				mem[(*ptr)++] = in[9 + i];
+		}
+		*out_len = 0;
+		return true;
+	}
+
+	if (len + 2 > *out_len)
+		return false;
+	u16_to_buf_le(out, len);
+	for (uint16_t i = 0; i < len; i++)
+		out[2 + i] = mem[(*ptr)++];
+	*out_len = 2 + len;
+	return true;
+}
+
+static bool sim_adc(struct sim *s, uint16_t cmd, const uint8_t *in,
+		    uint16_t in_len, uint8_t *out, uint16_t *out_len)
+{
+	switch (cmd) {
+	case DLN2_ADC_ENABLE:
+	case DLN2_ADC_DISABLE:
+		u16_to_buf_le(out, 0);
+		*out_len = 2;
+		return true;
+	case DLN2_ADC_CHANNEL_ENABLE:
+	case DLN2_ADC_CHANNEL_DISABLE:
+		*out_len = 0;
+		return in_len == 2 && in[1] < SIM_ADC_CHANNELS;
+	case DLN2_ADC_CHANNEL_GET_VAL:
+		if (in_len != 2 || in[0] != 0 || in[1] >= SIM_ADC_CHANNELS)
+			return false;
+		u16_to_buf_le(out, s->adc[in[1]]);
+		*out_len = 2;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool sim_handle(struct sim *s, uint8_t handle, uint16_t cmd,
+		       const uint8_t *data_in, uint16_t data_in_len,
+		       uint8_t *data_out, uint16_t *data_out_len)
+{
+	switch (handle) {
+	case DLN2_HANDLE_GPIO:
+		return sim_gpio(s, cmd, data_in, data_in_len, data_out,
+				data_out_len);
+	case DLN2_HANDLE_I2C:
+		return sim_i2c(s, cmd, data_in, data_in_len, data_out,
+			       data_out_len);
+	case DLN2_HANDLE_ADC:
+		return sim_adc(s, cmd, data_in, data_in_len, data_out,
+			       data_out_len);
+	default:
+		return false;
+	}
+}
+
+static bool sim_request(void *ctx, uint8_t handle, uint16_t cmd,
+			const uint8_t *data_in, uint16_t data_in_len,
+			uint8_t *data_out, uint16_t *data_out_len)
+{
+	struct sim *s = ctx;
+	// Checked like the firmware does before it passes the request on
+	bool ok = dln2_request_valid(handle, cmd, data_in_len) &&
+		  sim_handle(s, handle, cmd, data_in, data_in_len, data_out,
+			     data_out_len);
+
+	if (s->verbose) {
+		printf("%10u us  %s %s:", s->now_us, handle2str(handle),
+		       cmd2str(cmd));
+		for (uint16_t i = 0; i < data_in_len; i++)
+			printf(" %02x", data_in[i]);
+		if (ok) {
+			printf(" ->");
+			for (uint16_t i = 0; i < *data_out_len; i++)
+				printf(" %02x", data_out[i]);
+			printf("\n");
+		} else {
+			printf(" failed\n");
+		}
+	}
+	return ok;
+}
+
+static uint32_t sim_time_us(void *ctx)
+{
+	return ((struct sim *)ctx)->now_us;
+}
+
+static void print_status(const uint8_t *status, const uint8_t *result)
+{
+	static const char *const states[] = { "idle", "running", "done",
+					      "failed" };
+	uint16_t result_len = u16_from_buf_le(&status[6]);
+
+	printf("%s", status[0] < 4 ? states[status[0]] : "?");
+	if (status[0] == PP_SCRIPT_STATE_FAILED)
+		printf(" (error 0x%02x at %u)", status[1],
+		       u16_from_buf_le(&status[2]));
+	printf(" after %u us, acc %u, %u result bytes\n",
+	       u32_from_buf_le(&status[12]), u32_from_buf_le(&status[8]),
+	       result_len);
+	for (uint16_t i = 0; i < result_len; i++)
+		printf("%02x%s", result[i],
+		       i % 16 == 15 || i + 1 == result_len ? "\n" : " ");
+}
+
+static int simulate(struct sim *s, const uint8_t *code, uint16_t len)
+{
+	struct pp_script_vm vm = {
+		.request = sim_request,
+		.time_us = sim_time_us,
+		.ctx = s,
+	};
+	uint8_t status[PP_SCRIPT_STATUS_LEN];
+	unsigned long ops = 0;
+
+	pp_script_vm_start(&vm, code, len);
+	while (vm.state == PP_SCRIPT_STATE_RUNNING) {
+		if (vm.delaying)
+			s->now_us = vm.wake_us;
+		// One instruction at a time, so the count is exact
+		pp_script_vm_run(&vm, 1);
+		if (++ops == SIM_MAX_OPS) {
+			fprintf(stderr, "Stopped after %u instructions\n",
+				SIM_MAX_OPS);
+			pp_script_vm_stop(&vm);
+		}
+	}
+
+	pp_script_vm_status(&vm, status);
+	print_status(status, vm.result);
+	return vm.state == PP_SCRIPT_STATE_DONE ? 0 : 1;
+}
+
+static bool parse_assignment(const char *arg, unsigned long max_key,
+			     unsigned long max_val, unsigned long *key,
+			     unsigned long *val)
+{
+	char *end;
+
+	*key = strtoul(arg, &end, 0);
+	if (end == arg || *end != '=' || *key > max_key)
+		return false;
+	arg = end + 1;
+	*val = strtoul(arg, &end, 0);
+	return end != arg && !*end && *val <= max_val;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-o OUTPUT | [-i LINE=VALUE] [-a CHANNEL=VALUE] [-d ADDR]\n"
+		"          [-v]] SCRIPT\n"
+		"\n"
+		"Assembles SCRIPT (- for stdin) and runs it with simulated peripherals.\n"
+		"\n"
+		"  -o OUTPUT        write the bytecode to OUTPUT instead, for\n"
+		"                   \"ppctl script\"\n"
+		"  -i LINE=VALUE    level of a GPIO input line (default: 0)\n"
+		"  -a CHAN=VALUE    10-bit ADC value of a channel (default: 0)\n"
+		"  -d ADDR          simulate an I2C memory at ADDR\n"
+		"  -v               print the requests\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	static struct assembler a;
+	static struct sim s;
+	const char *output = NULL;
+	unsigned long key, val;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:i:a:d:vh")) != -1) {
+		switch (opt) {
+		case 'o':
+			output = optarg;
+			break;
+		case 'i':
+			if (!parse_assignment(optarg, SIM_GPIO_LINES - 1, 1,
+					      &key, &val)) {
+				usage(argv[0]);
+				return 1;
+			}
+			s.gpio_in = val ? s.gpio_in | 1u << key :
+					  s.gpio_in & ~(1u << key);
+			break;
+		case 'a':
+			if (!parse_assignment(optarg, SIM_ADC_CHANNELS - 1,
+					      (1u << DLN2_ADC_DATA_BITS) - 1,
+					      &key, &val)) {
+				usage(argv[0]);
+				return 1;
+			}
+			s.adc[key] = (uint16_t)val;
+			break;
+		case 'd':
+			key = strtoul(optarg, NULL, 0);
+			if (key > 0x7f) {
+				usage(argv[0]);
+				return 1;
+			}
+			s.i2c_present[key] = true;
+			break;
+		case 'v':
+			s.verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	FILE *f = strcmp(argv[optind], "-") == 0 ? stdin :
+						   fopen(argv[optind], "r");
+	if (!f) {
+		perror(argv[optind]);
+		return 1;
+	}
+	bool ok = assemble(&a, f);
+	if (f != stdin)
+		fclose(f);
+	if (!ok)
+		return 1;
+
+	if (!output)
+		return simulate(&s, a.code, a.len);
+
+	FILE *out = fopen(output, "wb");
+	if (!out || fwrite(a.code, 1, a.len, out) != a.len ||
+	    fclose(out) != 0) {
+		perror(output);
+		return 1;
+	}
+	return 0;
+}
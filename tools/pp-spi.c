@@ -0,0 +1,326 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * SPI transfers from user space, similar to spidev_test. Uses the second DLN2
+ * interface of the device with libusb, so it doesn't need the kernel driver.
+ * With -S and -I, it measures the throughput with up to -q transfers in
+ * flight. Connect GP3 (TX) to GP4 (RX) to verify the received data with -l.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ppdln2.h"
+
+#include "dln2.h"
+
+#define DEFAULT_SPEED_HZ 1000000
+#define DEFAULT_DEPTH 4
+#define POLL_TIMEOUT_MS 1000
+
+struct bench {
+	struct ppdln2 *d;
+	uint16_t size;
+	bool verify;
+	uint64_t to_submit;
+	uint64_t completed;
+	uint64_t errors;
+	uint32_t seq;
+	int status;
+};
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill_pattern(struct bench *b, struct ppdln2_xfer *x)
+{
+	uint8_t *tx = ppdln2_spi_tx_buf(x);
+
+	for (uint16_t i = 0; i < b->size; i++)
+		tx[i] = (uint8_t)(b->seq + i * 7);
+	b->seq++;
+}
+
+static void bench_submit(struct bench *b, struct ppdln2_xfer *x)
+{
+	// Only the data changes, the header is rewritten by the library
+	fill_pattern(b, x);
+	b->to_submit--;
+
+	int ret = ppdln2_submit(b->d, x);
+	if (ret < 0 && b->status == 0)
+		b->status = ret;
+}
+
+static void bench_complete(struct ppdln2_xfer *x)
+{
+	struct bench *b = x->user_data;
+
+	b->completed++;
+	if (x->status != 0 || x->rx_len != 2 + b->size) {
+		if (b->status == 0)
+			b->status = x->status ? x->status : -EPROTO;
+		return;
+	}
+	// Still holds the data sent, until it is resubmitted
+	if (b->verify && memcmp(ppdln2_spi_rx_buf(x), ppdln2_spi_tx_buf(x),
+				b->size) != 0)
+		b->errors++;
+
+	if (b->to_submit)
+		bench_submit(b, x);
+}
+
+static int run_bench(struct ppdln2 *d, uint8_t port, uint16_t size,
+		     uint64_t iterations, unsigned int depth, bool verify)
+{
+	struct bench b = {
+		.d = d,
+		.size = size,
+		.verify = verify,
+		.to_submit = iterations,
+	};
+	struct ppdln2_xfer *xfers = calloc(depth, sizeof(*xfers));
+
+	if (!xfers)
+		return -ENOMEM;
+
+	double start = now_s();
+
+	for (unsigned int i = 0; i < depth && b.to_submit; i++) {
+		ppdln2_spi_prepare(&xfers[i], port, size, false);
+		xfers[i].complete = bench_complete;
+		xfers[i].user_data = &b;
+		bench_submit(&b, &xfers[i]);
+	}
+
+	while (b.status == 0 && ppdln2_pending(d)) {
+		int ret = ppdln2_poll(d, POLL_TIMEOUT_MS);
+		if (ret < 0)
+			b.status = ret;
+	}
+
+	double seconds = now_s() - start;
+	free(xfers);
+
+	if (b.status < 0) {
+		fprintf(stderr, "Transfer failed: %s\n", strerror(-b.status));
+		return b.status;
+	}
+	if (b.status > 0) {
+		fprintf(stderr, "Transfer failed with response code 0x%04x\n",
+			b.status);
+		return -EIO;
+	}
+
+	double kbytes = b.completed * size / 1024.0;
+	printf("total: tx %.1fKB, rx %.1fKB\n", kbytes, kbytes);
+	printf("rate: tx %.1fkbps, rx %.1fkbps, %.0f transfers/s\n",
+	       kbytes * 8 / seconds, kbytes * 8 / seconds,
+	       b.completed / seconds);
+	if (verify)
+		printf("errors: %llu\n", (unsigned long long)b.errors);
+
+	return b.errors ? -EIO : 0;
+}
+
+static int parse_hex(const char *s, uint8_t *buf, size_t max)
+{
+	size_t n = 0;
+
+	while (*s) {
+		unsigned int v;
+
+		if (*s == ' ' || *s == ':') {
+			s++;
+			continue;
+		}
+		if (n == max || sscanf(s, "%2x", &v) != 1 || !s[1])
+			return -1;
+		buf[n++] = (uint8_t)v;
+		s += 2;
+	}
+	return (int)n;
+}
+
+static void hex_dump(const char *prefix, const uint8_t *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (i % 16 == 0)
+			printf("%s%s", i ? "\n" : "", prefix);
+		printf(" %02x", buf[i]);
+	}
+	printf("\n");
+}
+
+static int run_single(struct ppdln2 *d, uint8_t port, const char *hex,
+		      bool verbose)
+{
+	struct ppdln2_xfer x;
+
+	int len = parse_hex(hex, ppdln2_spi_tx_buf(&x), PPDLN2_SPI_MAX_XFER);
+	if (len <= 0) {
+		fprintf(stderr, "Invalid data: %s\n", hex);
+		return -EINVAL;
+	}
+
+	ppdln2_spi_prepare(&x, port, len, false);
+	x.complete = NULL;
+
+	int ret = ppdln2_transfer(d, &x);
+	if (ret != 0) {
+		fprintf(stderr, "Transfer failed: %d\n", ret);
+		return ret < 0 ? ret : -EIO;
+	}
+
+	if (verbose)
+		hex_dump("TX |", ppdln2_spi_tx_buf(&x), len);
+	hex_dump("RX |", ppdln2_spi_rx_buf(&x), len);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-D DEVICE] [-P PORT] [-C CS] [-s SPEED] [-b BITS] [-H] [-O]\n"
+		"          [-p HEX | -S SIZE -I ITERATIONS [-q DEPTH] [-l]] [-v]\n"
+		"\n"
+		"  -D DEVICE   serial number of the device, \"loopback\" for the\n"
+		"              built-in stand-in or unix:PATH for a socket of\n"
+		"              pp-sim (default: first device)\n"
+		"  -P PORT     SPI port (default: 0)\n"
+		"  -C CS       chip select (default: 0)\n"
+		"  -s SPEED    clock in Hz (default: %d)\n"
+		"  -b BITS     bits per word, 4 to 16 (default: 8)\n"
+		"  -H          clock phase\n"
+		"  -O          clock polarity\n"
+		"  -p HEX      send the bytes and print the received ones\n"
+		"  -S SIZE     benchmark transfer size, up to %d bytes\n"
+		"  -I ITER     number of benchmark transfers\n"
+		"  -q DEPTH    transfers in flight (default: %d)\n"
+		"  -l          verify the received data (MOSI looped back to MISO)\n"
+		"  -v          verbose\n",
+		prog, DEFAULT_SPEED_HZ, PPDLN2_SPI_MAX_XFER, DEFAULT_DEPTH);
+}
+
+int main(int argc, char **argv)
+{
+	const char *device = NULL;
+	const char *hex = NULL;
+	unsigned long port = 0, cs = 0, bits = 8, size = 0;
+	unsigned long depth = DEFAULT_DEPTH;
+	unsigned long long iterations = 0;
+	uint32_t speed = DEFAULT_SPEED_HZ;
+	uint8_t mode = 0;
+	bool verify = false, verbose = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "D:P:C:s:b:HOp:S:I:q:lvh")) != -1) {
+		switch (opt) {
+		case 'D':
+			device = optarg;
+			break;
+		case 'P':
+			port = strtoul(optarg, NULL, 0);
+			break;
+		case 'C':
+			cs = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			speed = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			bits = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			mode |= DLN2_SPI_CPHA;
+			break;
+		case 'O':
+			mode |= DLN2_SPI_CPOL;
+			break;
+		case 'p':
+			hex = optarg;
+			break;
+		case 'S':
+			size = strtoul(optarg, NULL, 0);
+			break;
+		case 'I':
+			iterations = strtoull(optarg, NULL, 0);
+			break;
+		case 'q':
+			depth = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			verify = true;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	bool bench = size || iterations;
+	if (port > UINT8_MAX || cs > 7 || bits < 4 || bits > 16 ||
+	    depth == 0 || !!hex == bench ||
+	    (bench && (size == 0 || size > PPDLN2_SPI_MAX_XFER ||
+		       iterations == 0))) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	struct ppdln2_transport *t;
+	if (device && strcmp(device, "loopback") == 0)
+		t = ppdln2_loopback_open();
+	else if (device && strncmp(device, "unix:", 5) == 0)
+		t = ppdln2_socket_open(&device[5]);
+	else
+		t = ppdln2_usb_open(device);
+	struct ppdln2 *d = ppdln2_open(t, depth);
+	if (!d)
+		return 1;
+
+	int ret = ppdln2_spi_set_mode(d, port, mode);
+	if (ret == 0)
+		ret = ppdln2_spi_set_frame_size(d, port, bits);
+	if (ret == 0)
+		ret = ppdln2_spi_set_frequency(d, port, &speed);
+	if (ret == 0)
+		ret = ppdln2_spi_select(d, port, cs);
+	if (ret == 0)
+		ret = ppdln2_spi_enable(d, port, true);
+	if (ret != 0) {
+		fprintf(stderr, "Failed to configure SPI port %lu: %d\n", port,
+			ret);
+		ppdln2_close(d);
+		return 1;
+	}
+
+	if (verbose || bench) {
+		printf("spi mode: 0x%x\n", mode);
+		printf("bits per word: %lu\n", bits);
+		printf("max speed: %u Hz (%u kHz)\n", speed, speed / 1000);
+	}
+	fflush(stdout);
+
+	if (bench)
+		ret = run_bench(d, port, size, iterations, depth, verify);
+	else
+		ret = run_single(d, port, hex, verbose);
+
+	ppdln2_close(d);
+	return ret < 0 ? 1 : 0;
+}
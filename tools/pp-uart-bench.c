@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * UART bridge loopback benchmark. Connect GP20 (TX) to GP21 (RX), then data
+ * written to the CDC ACM device is looped back by the UART. Writer and reader
+ * run concurrently, so both directions are measured at the same time.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_DEVICE "/dev/ttyACM0"
+#define DEFAULT_DURATION_S 5
+#define DEFAULT_CHUNK_SIZE 4096
+// Once the writer is done, wait this long for outstanding data.
+#define DRAIN_TIMEOUT_MS 500
+
+struct bench {
+	int fd;
+	size_t chunk_size;
+	double duration_s;
+
+	atomic_bool writer_done;
+	uint64_t tx_bytes;
+	double tx_seconds;
+
+	uint64_t rx_bytes;
+	uint64_t rx_errors;
+	double rx_seconds;
+};
+
+static const struct {
+	unsigned int baud;
+	speed_t speed;
+} speeds[] = {
+	{ 9600, B9600 },	 { 19200, B19200 },	  { 38400, B38400 },
+	{ 57600, B57600 },	 { 115200, B115200 },	  { 230400, B230400 },
+	{ 460800, B460800 },	 { 500000, B500000 },	  { 921600, B921600 },
+	{ 1000000, B1000000 }, { 1500000, B1500000 }, { 2000000, B2000000 },
+	{ 3000000, B3000000 }, { 4000000, B4000000 },
+};
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int set_baud(int fd, unsigned int baud)
+{
+	struct termios tio;
+	speed_t speed = 0;
+
+	for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+		if (speeds[i].baud == baud)
+			speed = speeds[i].speed;
+	}
+	if (!speed) {
+		fprintf(stderr, "Unsupported baud rate %u\n", baud);
+		return -1;
+	}
+
+	if (tcgetattr(fd, &tio) < 0) {
+		perror("tcgetattr");
+		return -1;
+	}
+
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~CRTSCTS;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+
+	if (tcsetattr(fd, TCSANOW, &tio) < 0) {
+		perror("tcsetattr");
+		return -1;
+	}
+
+	/* Give the device a moment to apply the line coding. */
+	usleep(100 * 1000);
+	tcflush(fd, TCIOFLUSH);
+
+	return 0;
+}
+
+static void *writer(void *arg)
+{
+	struct bench *b = arg;
+	uint8_t *buf = malloc(b->chunk_size);
+	uint8_t seq = 0;
+
+	double start = now_s();
+	double end = start + b->duration_s;
+
+	while (buf && now_s() < end) {
+		for (size_t i = 0; i < b->chunk_size; i++)
+			buf[i] = seq++;
+
+		size_t off = 0;
+		while (off < b->chunk_size) {
+			struct pollfd pfd = { .fd = b->fd, .events = POLLOUT };
+			if (poll(&pfd, 1, 100) <= 0)
+				continue;
+
+			ssize_t n = write(b->fd, &buf[off], b->chunk_size - off);
+			if (n < 0) {
+				if (errno == EAGAIN || errno == EINTR)
+					continue;
+				perror("write");
+				goto out;
+			}
+			off += n;
+			b->tx_bytes += n;
+		}
+	}
+
+out:
+	/* Count the time until the data has actually left the host. */
+	tcdrain(b->fd);
+	b->tx_seconds = now_s() - start;
+	atomic_store(&b->writer_done, true);
+	free(buf);
+	return NULL;
+}
+
+static void *reader(void *arg)
+{
+	struct bench *b = arg;
+	uint8_t buf[4096];
+	uint8_t expected = 0;
+	double start = 0;
+	double last = 0;
+
+	while (true) {
+		struct pollfd pfd = { .fd = b->fd, .events = POLLIN };
+		int timeout = atomic_load(&b->writer_done) ? DRAIN_TIMEOUT_MS :
+							      100;
+		int ret = poll(&pfd, 1, timeout);
+		if (ret < 0 && errno != EINTR) {
+			perror("poll");
+			break;
+		}
+		if (ret <= 0) {
+			if (atomic_load(&b->writer_done) &&
+			    now_s() - last >= DRAIN_TIMEOUT_MS / 1000.0)
+				break;
+			continue;
+		}
+
+		ssize_t n = read(b->fd, buf, sizeof(buf));
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			perror("read");
+			break;
+		}
+
+		last = now_s();
+		if (b->rx_bytes == 0)
+			start = last;
+
+		for (ssize_t i = 0; i < n; i++) {
+			/* Resynchronize on the received byte after an error. */
+			if (buf[i] != expected)
+				b->rx_errors++;
+			expected = buf[i] + 1;
+		}
+		b->rx_bytes += n;
+	}
+
+	b->rx_seconds = last - start;
+	return NULL;
+}
+
+static int run(int fd, unsigned int baud, double duration_s,
+	       size_t chunk_size)
+{
+	struct bench b = {
+		.fd = fd,
+		.chunk_size = chunk_size,
+		.duration_s = duration_s,
+	};
+	pthread_t tw, tr;
+
+	if (set_baud(fd, baud) < 0)
+		return -1;
+
+	pthread_create(&tr, NULL, reader, &b);
+	pthread_create(&tw, NULL, writer, &b);
+	pthread_join(tw, NULL);
+	pthread_join(tr, NULL);
+
+	double tx_rate = b.tx_seconds > 0 ? b.tx_bytes / b.tx_seconds : 0;
+	double rx_rate = b.rx_seconds > 0 ? b.rx_bytes / b.rx_seconds : 0;
+	/* 8N1: 10 bit per byte on the wire */
+	double line_rate = baud / 10.0;
+
+	printf("%9u %12.0f %12.0f %12.0f %12llu %12llu %9llu\n", baud,
+	       line_rate, tx_rate, rx_rate, (unsigned long long)b.tx_bytes,
+	       (unsigned long long)b.rx_bytes,
+	       (unsigned long long)b.rx_errors);
+	fflush(stdout);
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-d DEVICE] [-b BAUD[,BAUD...]] [-t SECONDS] [-c CHUNK]\n"
+		"\n"
+		"Measures sustained throughput of the PicoPorts UART bridge.\n"
+		"Connect GP20 (TX) to GP21 (RX) before running.\n"
+		"\n"
+		"  -d DEVICE   CDC ACM device (default: %s)\n"
+		"  -b BAUD     comma separated baud rates (default: 115200,1000000,3000000)\n"
+		"  -t SECONDS  duration per baud rate (default: %d)\n"
+		"  -c CHUNK    write size in bytes (default: %d)\n",
+		prog, DEFAULT_DEVICE, DEFAULT_DURATION_S, DEFAULT_CHUNK_SIZE);
+}
+
+int main(int argc, char **argv)
+{
+	const char *device = DEFAULT_DEVICE;
+	char bauds_default[] = "115200,1000000,3000000";
+	char *bauds = bauds_default;
+	double duration_s = DEFAULT_DURATION_S;
+	size_t chunk_size = DEFAULT_CHUNK_SIZE;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:b:t:c:h")) != -1) {
+		switch (opt) {
+		case 'd':
+			device = optarg;
+			break;
+		case 'b':
+			bauds = optarg;
+			break;
+		case 't':
+			duration_s = atof(optarg);
+			break;
+		case 'c':
+			chunk_size = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (duration_s <= 0 || chunk_size == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	int fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0) {
+		perror(device);
+		return 1;
+	}
+
+	printf("%9s %12s %12s %12s %12s %12s %9s\n", "baud", "line_B/s",
+	       "tx_B/s", "rx_B/s", "tx_bytes", "rx_bytes", "errors");
+
+	int ret = 0;
+	for (char *tok = strtok(bauds, ","); tok; tok = strtok(NULL, ",")) {
+		if (run(fd, strtoul(tok, NULL, 0), duration_s, chunk_size) <
+		    0) {
+			ret = 1;
+			break;
+		}
+	}
+
+	close(fd);
+	return ret;
+}
@@ -0,0 +1,945 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Sends PicoPorts vendor control requests (see src/pp_vendor.h). These go to
+ * the device on EP0, so the kernel drivers can stay bound to the interfaces.
+ */
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libusb.h>
+
+#include "byte_ops.h"
+#include "dln2_str.h"
+#include "pp_vendor.h"
+
+#define TIMEOUT_MS 1000
+#define POLL_INTERVAL_US 1000
+
+struct command {
+	const char *name;
+	const char *args;
+	const char *help;
+	int (*fn)(libusb_device_handle *dev, int argc, char **argv);
+};
+
+static int vreq_out(libusb_device_handle *dev, uint8_t request, uint16_t value,
+		    uint16_t index, uint8_t *data, uint16_t len)
+{
+	int ret = libusb_control_transfer(
+		dev,
+		LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR |
+			LIBUSB_RECIPIENT_DEVICE,
+		request, value, index, data, len, TIMEOUT_MS);
+	if (ret < 0) {
+		fprintf(stderr, "Request 0x%02x failed: %s\n", request,
+			libusb_strerror(ret));
+		return -1;
+	}
+	return 0;
+}
+
+// Returns the number of bytes received or -1
+static int vreq_in(libusb_device_handle *dev, uint8_t request, uint16_t value,
+		   uint16_t index, uint8_t *data, uint16_t len)
+{
+	int ret = libusb_control_transfer(
+		dev,
+		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR |
+			LIBUSB_RECIPIENT_DEVICE,
+		request, value, index, data, len, TIMEOUT_MS);
+	if (ret < 0) {
+		fprintf(stderr, "Request 0x%02x failed: %s\n", request,
+			libusb_strerror(ret));
+		return -1;
+	}
+	return ret;
+}
+
+static bool parse_uint(const char *s, unsigned long max, unsigned long *value)
+{
+	char *end;
+	unsigned long v = strtoul(s, &end, 0);
+
+	if (*s == '\0' || *end != '\0' || v > max) {
+		fprintf(stderr, "Invalid value: %s\n", s);
+		return false;
+	}
+	*value = v;
+	return true;
+}
+
+static bool parse_u16(const char *s, uint16_t *value)
+{
+	unsigned long v;
+
+	if (!parse_uint(s, UINT16_MAX, &v))
+		return false;
+	*value = (uint16_t)v;
+	return true;
+}
+
+static bool parse_u32(const char *s, uint32_t *value)
+{
+	unsigned long v;
+
+	if (!parse_uint(s, UINT32_MAX, &v))
+		return false;
+	*value = (uint32_t)v;
+	return true;
+}
+
+static bool parse_on_off(const char *s, bool *value)
+{
+	if (strcmp(s, "on") == 0) {
+		*value = true;
+		return true;
+	}
+	if (strcmp(s, "off") == 0) {
+		*value = false;
+		return true;
+	}
+	fprintf(stderr, "Expected on or off: %s\n", s);
+	return false;
+}
+
+static int cmd_rs485(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint16_t itf = 0;
+	uint8_t buf[4];
+
+	if (argc != 0 && argc != 1 && argc != 3)
+		return -2;
+	if (argc >= 1 && !parse_u16(argv[0], &itf))
+		return -1;
+
+	if (argc == 3) {
+		uint16_t setup_us, hold_us;
+		if (!parse_u16(argv[1], &setup_us) ||
+		    !parse_u16(argv[2], &hold_us))
+			return -1;
+		u16_to_buf_le(&buf[0], setup_us);
+		u16_to_buf_le(&buf[2], hold_us);
+		return vreq_out(dev, PP_VREQ_UART_SET_RS485, 0, itf, buf,
+				sizeof(buf));
+	}
+
+	if (vreq_in(dev, PP_VREQ_UART_GET_RS485, 0, itf, buf, sizeof(buf)) !=
+	    sizeof(buf))
+		return -1;
+	printf("setup_us=%u hold_us=%u\n", u16_from_buf_le(&buf[0]),
+	       u16_from_buf_le(&buf[2]));
+	return 0;
+}
+
+static int cmd_capture(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint16_t itf;
+	bool enable;
+	uint32_t gap_us = 0;
+	uint8_t buf[4];
+
+	if (argc < 2 || argc > 3)
+		return -2;
+	if (!parse_u16(argv[0], &itf) || !parse_on_off(argv[1], &enable))
+		return -1;
+	if (argc == 3 && !parse_u32(argv[2], &gap_us))
+		return -1;
+
+	u32_to_buf_le(buf, gap_us);
+	return vreq_out(dev, PP_VREQ_UART_SET_CAPTURE, enable, itf, buf,
+			enable ? sizeof(buf) : 0);
+}
+
+static void print_frame(const uint8_t *rec, uint16_t len)
+{
+	uint16_t flags = u16_from_buf_le(&rec[2]);
+	uint32_t max_gap = 0;
+
+	printf("%10u us %c%c%c", u32_from_buf_le(&rec[4]),
+	       flags & PP_UART_FRAME_OVERFLOW ? 'O' : '-',
+	       flags & PP_UART_FRAME_LINE_ERROR ? 'E' : '-',
+	       flags & PP_UART_FRAME_CONTINUED ? '+' : '-');
+
+	for (uint16_t i = PP_UART_FRAME_HDR_LEN; i < len;
+	     i += PP_UART_FRAME_BYTE_LEN) {
+		uint16_t delta = u16_from_buf_le(&rec[i + 1]);
+		if (delta > max_gap)
+			max_gap = delta;
+		printf(" %02x", rec[i]);
+	}
+
+	printf("  (%u bytes, max gap %u us)\n",
+	       (len - PP_UART_FRAME_HDR_LEN) / PP_UART_FRAME_BYTE_LEN,
+	       max_gap);
+}
+
+static int cmd_frames(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint16_t itf = 0;
+	uint8_t buf[PP_VREQ_MAX_DATA_LEN];
+
+	if (argc > 1)
+		return -2;
+	if (argc == 1 && !parse_u16(argv[0], &itf))
+		return -1;
+
+	// Runs until interrupted
+	while (true) {
+		int n = vreq_in(dev, PP_VREQ_UART_READ_FRAMES, 0, itf, buf,
+				sizeof(buf));
+		if (n < 0)
+			return -1;
+		if (n == 0) {
+			usleep(POLL_INTERVAL_US);
+			continue;
+		}
+
+		for (int offs = 0; offs + PP_UART_FRAME_HDR_LEN <= n;) {
+			uint16_t len = u16_from_buf_le(&buf[offs]);
+			if (len < PP_UART_FRAME_HDR_LEN || offs + len > n) {
+				fprintf(stderr, "Invalid frame record\n");
+				return -1;
+			}
+			print_frame(&buf[offs], len);
+			offs += len;
+		}
+		fflush(stdout);
+	}
+}
+
+static void print_pwm(uint16_t line, const uint8_t *buf)
+{
+	uint16_t shared = u16_from_buf_le(&buf[8]);
+
+	printf("line %u: slice %u, ", line, buf[1]);
+	if (buf[0])
+		printf("%u Hz, duty %.2f%%", u32_from_buf_le(&buf[4]),
+		       u16_from_buf_le(&buf[2]) * 100.0 / 0xffff);
+	else
+		printf("off");
+	if (shared != PP_GPIO_PWM_NO_LINE)
+		printf(", shared with line %u", shared);
+	printf("\n");
+}
+
+static int cmd_pwm(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint16_t line;
+	uint8_t buf[PP_GPIO_PWM_STATUS_LEN];
+
+	if (argc < 1 || argc > 3)
+		return -2;
+	if (!parse_u16(argv[0], &line))
+		return -1;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "off") != 0)
+			return -2;
+		return vreq_out(dev, PP_VREQ_GPIO_SET_PWM, 0, line, NULL, 0);
+	}
+
+	if (argc == 3) {
+		uint32_t freq_hz;
+		char *end;
+		double duty = strtod(argv[2], &end);
+
+		if (!parse_u32(argv[1], &freq_hz))
+			return -1;
+		if (*end != '\0' || duty < 0 || duty > 100) {
+			fprintf(stderr, "Invalid duty cycle: %s\n", argv[2]);
+			return -1;
+		}
+		u32_to_buf_le(&buf[0], freq_hz);
+		u16_to_buf_le(&buf[4], (uint16_t)(duty * 0xffff / 100 + 0.5));
+		if (vreq_out(dev, PP_VREQ_GPIO_SET_PWM, 0, line, buf, 6) < 0) {
+			// Show what else uses the slice
+			if (vreq_in(dev, PP_VREQ_GPIO_GET_PWM, 0, line, buf,
+				    sizeof(buf)) == sizeof(buf))
+				print_pwm(line, buf);
+			return -1;
+		}
+	}
+
+	if (vreq_in(dev, PP_VREQ_GPIO_GET_PWM, 0, line, buf, sizeof(buf)) !=
+	    sizeof(buf))
+		return -1;
+	print_pwm(line, buf);
+	return 0;
+}
+
+static int cmd_events(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint16_t line, interval_ms;
+	uint8_t buf[PP_GPIO_COALESCE_STATUS_LEN];
+
+	if (argc < 1 || argc > 2)
+		return -2;
+	if (!parse_u16(argv[0], &line))
+		return -1;
+
+	if (argc == 2) {
+		if (!parse_u16(argv[1], &interval_ms))
+			return -1;
+		if (vreq_out(dev, PP_VREQ_GPIO_SET_COALESCE, interval_ms, line,
+			     NULL, 0) < 0)
+			return -1;
+	}
+
+	if (vreq_in(dev, PP_VREQ_GPIO_GET_COALESCE, 0, line, buf,
+		    sizeof(buf)) != sizeof(buf))
+		return -1;
+	interval_ms = u16_from_buf_le(&buf[0]);
+	printf("line %u: ", line);
+	if (interval_ms)
+		printf("at most one event every %u ms", interval_ms);
+	else
+		printf("no minimum interval");
+	printf(", %u changes pending, %u since boot\n",
+	       u16_from_buf_le(&buf[2]), u32_from_buf_le(&buf[4]));
+	return 0;
+}
+
+// Steps are lines of "LINES VALUES DELAY_NS", # starts a comment
+static int load_steps(libusb_device_handle *dev, FILE *f)
+{
+	uint8_t buf[PP_VREQ_MAX_DATA_LEN];
+	char line[256];
+	uint16_t first = 0, n = 0;
+	unsigned int lineno = 0;
+	int max = sizeof(buf) / PP_SEQ_STEP_LEN;
+
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long lines, values, delay_ns;
+		char *comment = strchr(line, '#');
+
+		lineno++;
+		if (comment)
+			*comment = '\0';
+		if (line[strspn(line, " \t\r\n")] == '\0')
+			continue;
+		if (sscanf(line, "%li %li %lu", &lines, &values, &delay_ns) !=
+			    3 ||
+		    delay_ns > UINT32_MAX) {
+			fprintf(stderr, "Invalid step in line %u\n", lineno);
+			return -1;
+		}
+		if (first + n == PP_SEQ_MAX_STEPS) {
+			fprintf(stderr, "More than %d steps\n",
+				PP_SEQ_MAX_STEPS);
+			return -1;
+		}
+
+		uint8_t *step = &buf[n * PP_SEQ_STEP_LEN];
+		u32_to_buf_le(&step[0], (uint32_t)lines);
+		u32_to_buf_le(&step[4], (uint32_t)values);
+		u32_to_buf_le(&step[8], (uint32_t)delay_ns);
+		if (++n == max) {
+			if (vreq_out(dev, PP_VREQ_SEQ_LOAD, first, 0, buf,
+				     n * PP_SEQ_STEP_LEN) < 0)
+				return -1;
+			first += n;
+			n = 0;
+		}
+	}
+
+	if (n && vreq_out(dev, PP_VREQ_SEQ_LOAD, first, 0, buf,
+			  n * PP_SEQ_STEP_LEN) < 0)
+		return -1;
+	return first + n;
+}
+
+static int cmd_seq(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint16_t passes = 1;
+	uint8_t status[PP_SEQ_STATUS_LEN];
+
+	if (argc < 1 || argc > 2)
+		return -2;
+	if (strcmp(argv[0], "stop") == 0) {
+		if (argc != 1)
+			return -2;
+		return vreq_out(dev, PP_VREQ_SEQ_STOP, 0, 0, NULL, 0);
+	}
+	if (argc == 2 && !parse_u16(argv[1], &passes))
+		return -1;
+
+	FILE *f = strcmp(argv[0], "-") == 0 ? stdin : fopen(argv[0], "r");
+	if (!f) {
+		perror(argv[0]);
+		return -1;
+	}
+	int steps = load_steps(dev, f);
+	if (f != stdin)
+		fclose(f);
+	if (steps < 0)
+		return -1;
+	if (steps == 0) {
+		fprintf(stderr, "No steps\n");
+		return -1;
+	}
+
+	if (vreq_out(dev, PP_VREQ_SEQ_START, passes, 0, NULL, 0) < 0)
+		return -1;
+	if (!passes)
+		return 0;
+
+	do {
+		usleep(POLL_INTERVAL_US);
+		if (vreq_in(dev, PP_VREQ_SEQ_GET_STATUS, 0, 0, status,
+			    sizeof(status)) != sizeof(status))
+			return -1;
+	} while (status[0] == PP_SEQ_STATE_RUNNING);
+
+	printf("%d steps, %u passes%s\n", steps, u32_from_buf_le(&status[4]),
+	       status[1] & PP_SEQ_STATUS_UNDERRUN ? ", underrun" : "");
+	return 0;
+}
+
+static void print_counter(const uint8_t *buf)
+{
+	if (!buf[0]) {
+		printf("line %u: no result yet\n", u16_from_buf_le(&buf[26]));
+		return;
+	}
+	printf("line %u: %.3f Hz, period %u ns, high %u ns, duty %.2f%%, "
+	       "%u edges in %u us, %llu total\n",
+	       u16_from_buf_le(&buf[26]), u32_from_buf_le(&buf[12]) / 1000.0,
+	       u32_from_buf_le(&buf[16]), u32_from_buf_le(&buf[20]),
+	       u16_from_buf_le(&buf[24]) * 100.0 / 0xffff,
+	       u32_from_buf_le(&buf[8]), u32_from_buf_le(&buf[4]),
+	       (unsigned long long)u64_from_buf_le(&buf[28]));
+}
+
+static int cmd_counter(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint16_t line, gate_ms = 0;
+	uint8_t buf[PP_COUNTER_RESULT_LEN];
+
+	if (argc < 1 || argc > 2)
+		return -2;
+	if (!parse_u16(argv[0], &line))
+		return -1;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "off") != 0 &&
+		    (!parse_u16(argv[1], &gate_ms) || !gate_ms))
+			return -1;
+		if (vreq_out(dev, PP_VREQ_COUNTER_SET, gate_ms, line, NULL,
+			     0) < 0)
+			return -1;
+		if (!gate_ms)
+			return 0;
+		// Wait for the first result
+		usleep(gate_ms * 1000 + 100000);
+	}
+
+	if (vreq_in(dev, PP_VREQ_COUNTER_GET, 0, line, buf, sizeof(buf)) !=
+	    sizeof(buf))
+		return -1;
+	print_counter(buf);
+	return 0;
+}
+
+static int cmd_quad(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint16_t encoder, line_a, line_b;
+	uint8_t buf[PP_QUAD_STATUS_LEN];
+
+	if (argc != 1 && argc != 2 && argc != 3)
+		return -2;
+	if (!parse_u16(argv[0], &encoder))
+		return -1;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "off") != 0)
+			return -2;
+		return vreq_out(dev, PP_VREQ_QUAD_SET, 0, encoder, NULL, 0);
+	}
+	if (argc == 3) {
+		if (!parse_u16(argv[1], &line_a) ||
+		    !parse_u16(argv[2], &line_b))
+			return -1;
+		u16_to_buf_le(&buf[0], line_a);
+		u16_to_buf_le(&buf[2], line_b);
+		// No events, ppctl polls
+		u16_to_buf_le(&buf[4], 0);
+		return vreq_out(dev, PP_VREQ_QUAD_SET, 0, encoder, buf, 6);
+	}
+
+	if (vreq_in(dev, PP_VREQ_QUAD_GET, 0, encoder, buf, sizeof(buf)) !=
+	    sizeof(buf))
+		return -1;
+	if (!buf[0]) {
+		printf("encoder %u: off\n", encoder);
+		return 0;
+	}
+	printf("encoder %u: position %d, %u errors\n", encoder,
+	       (int32_t)u32_from_buf_le(&buf[4]), u32_from_buf_le(&buf[8]));
+	return 0;
+}
+
+static int cmd_script(libusb_device_handle *dev, int argc, char **argv)
+{
+	static const char *const states[] = { "idle", "running", "done",
+					      "failed" };
+	uint8_t buf[PP_VREQ_MAX_DATA_LEN];
+	uint8_t status[PP_SCRIPT_STATUS_LEN];
+	uint16_t len = 0;
+	size_t n;
+
+	if (argc != 1)
+		return -2;
+	if (strcmp(argv[0], "stop") == 0)
+		return vreq_out(dev, PP_VREQ_SCRIPT_STOP, 0, 0, NULL, 0);
+
+	FILE *f = strcmp(argv[0], "-") == 0 ? stdin : fopen(argv[0], "rb");
+	if (!f) {
+		perror(argv[0]);
+		return -1;
+	}
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		if (len + n > PP_SCRIPT_MAX_LEN) {
+			fprintf(stderr, "Script longer than %d bytes\n",
+				PP_SCRIPT_MAX_LEN);
+			len = 0;
+			break;
+		}
+		if (vreq_out(dev, PP_VREQ_SCRIPT_LOAD, len, 0, buf, n) < 0) {
+			len = 0;
+			break;
+		}
+		len += n;
+	}
+	if (f != stdin)
+		fclose(f);
+	if (!len)
+		return -1;
+
+	if (vreq_out(dev, PP_VREQ_SCRIPT_RUN, 0, 0, NULL, 0) < 0)
+		return -1;
+	do {
+		usleep(POLL_INTERVAL_US);
+		if (vreq_in(dev, PP_VREQ_SCRIPT_GET_STATUS, 0, 0, status,
+			    sizeof(status)) != sizeof(status))
+			return -1;
+	} while (status[0] == PP_SCRIPT_STATE_RUNNING);
+
+	uint16_t result_len = u16_from_buf_le(&status[6]);
+	if (vreq_in(dev, PP_VREQ_SCRIPT_GET_RESULT, 0, 0, buf, result_len) !=
+	    result_len)
+		return -1;
+
+	printf("%s", status[0] < 4 ? states[status[0]] : "?");
+	if (status[0] == PP_SCRIPT_STATE_FAILED)
+		printf(" (error 0x%02x at %u)", status[1],
+		       u16_from_buf_le(&status[2]));
+	printf(" after %u us, acc %u, %u result bytes\n",
+	       u32_from_buf_le(&status[12]), u32_from_buf_le(&status[8]),
+	       result_len);
+	for (uint16_t i = 0; i < result_len; i++)
+		printf("%02x%s", buf[i],
+		       i % 16 == 15 || i + 1 == result_len ? "\n" : " ");
+	return status[0] == PP_SCRIPT_STATE_DONE ? 0 : -1;
+}
+
+static int cmd_state(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint8_t buf[PP_STATE_LEN];
+
+	(void)argv;
+	if (argc != 0)
+		return -2;
+	if (vreq_in(dev, PP_VREQ_STATE_GET, 0, 0, buf, sizeof(buf)) !=
+	    sizeof(buf))
+		return -1;
+	if (buf[0] != PP_STATE_VERSION) {
+		fprintf(stderr, "Unknown state version %u\n", buf[0]);
+		return -1;
+	}
+
+	printf("seq %u at %u us\n", u32_from_buf_le(&buf[4]),
+	       u32_from_buf_le(&buf[8]));
+	printf("levels  0x%08x\noutputs 0x%08x\n", u32_from_buf_le(&buf[12]),
+	       u32_from_buf_le(&buf[16]));
+	printf("gpio events %u, last at %u us\n", u32_from_buf_le(&buf[20]),
+	       u32_from_buf_le(&buf[24]));
+	for (int itf = 0; itf < 2; itf++)
+		printf("uart %d: %u dropped, %u errors\n", itf,
+		       u32_from_buf_le(&buf[28 + 4 * itf]),
+		       u32_from_buf_le(&buf[36 + 4 * itf]));
+	printf("adc");
+	for (int i = 0; i < buf[1] && i < PP_STATE_ADC_MAX; i++)
+		printf(" %u", u16_from_buf_le(&buf[44 + 2 * i]));
+	printf("\n");
+	return 0;
+}
+
+static int cmd_stats(libusb_device_handle *dev, int argc, char **argv)
+{
+	static const char *const handle_names[] = { "event", "ctrl", "gpio",
+						    "i2c",   "spi",  "adc" };
+	uint8_t buf[PP_VREQ_MAX_DATA_LEN];
+	uint8_t num_handles;
+	int len;
+
+	(void)argv;
+	if (argc != 0)
+		return -2;
+	if (vreq_in(dev, PP_VREQ_STATS_GET, 0, 0, buf, PP_STATS_LEN) !=
+	    PP_STATS_LEN)
+		return -1;
+	if (buf[0] != PP_STATS_VERSION) {
+		fprintf(stderr, "Unknown stats version %u\n", buf[0]);
+		return -1;
+	}
+	num_handles = buf[1];
+
+	printf("at %u us: %u main loop wakeups/s, longest pass %u us\n",
+	       u32_from_buf_le(&buf[4]), u32_from_buf_le(&buf[8]),
+	       u32_from_buf_le(&buf[12]));
+	printf("requests %u, failed %u\n", u32_from_buf_le(&buf[16]),
+	       u32_from_buf_le(&buf[20]));
+	for (int itf = 0; itf < 2; itf++)
+		printf("dln2 itf %d: tx queue max %u, dropped %u, rx max %u "
+		       "bytes\n",
+		       itf, u16_from_buf_le(&buf[24 + 2 * itf]),
+		       u32_from_buf_le(&buf[28 + 4 * itf]),
+		       u16_from_buf_le(&buf[36 + 2 * itf]));
+	printf("gpio events %u, collapsed changes %u\n",
+	       u32_from_buf_le(&buf[40]), u32_from_buf_le(&buf[44]));
+	printf("i2c naks %u, timeouts %u\n", u32_from_buf_le(&buf[48]),
+	       u32_from_buf_le(&buf[52]));
+	printf("uart overruns %u %u\n", u32_from_buf_le(&buf[56]),
+	       u32_from_buf_le(&buf[60]));
+
+	len = vreq_in(dev, PP_VREQ_STATS_GET_HANDLES, 0, 0, buf,
+		      num_handles * PP_STATS_HANDLE_LEN);
+	if (len != num_handles * PP_STATS_HANDLE_LEN)
+		return -1;
+	for (uint8_t h = 0; h < num_handles; h++) {
+		const uint8_t *rec = &buf[h * PP_STATS_HANDLE_LEN];
+		uint32_t requests = u32_from_buf_le(&rec[0]);
+		uint8_t hist[PP_STATS_BUCKETS * 4];
+
+		if (!requests)
+			continue;
+		printf("%s: %u requests, %u failed, mean %u us, max %u us\n",
+		       h < sizeof(handle_names) / sizeof(handle_names[0]) ?
+			       handle_names[h] :
+			       "?",
+		       requests, u32_from_buf_le(&rec[4]),
+		       u32_from_buf_le(&rec[8]) / requests,
+		       u32_from_buf_le(&rec[12]));
+
+		if (vreq_in(dev, PP_VREQ_STATS_GET_HISTOGRAM, 0, h, hist,
+			    sizeof(hist)) != sizeof(hist))
+			return -1;
+		printf("   ");
+		for (int i = 0; i < PP_STATS_BUCKETS; i++) {
+			uint32_t n = u32_from_buf_le(&hist[4 * i]);
+
+			if (!n)
+				continue;
+			if (i == PP_STATS_BUCKETS - 1)
+				printf(" >=%uus:%u", 1u << (i - 1), n);
+			else
+				printf(" <%uus:%u", 1u << i, n);
+		}
+		printf("\n");
+	}
+
+	len = vreq_in(dev, PP_VREQ_STATS_GET_COMMANDS, 0, 0, buf, sizeof(buf));
+	if (len < 0)
+		return -1;
+	for (int i = 0; i + PP_STATS_COMMAND_LEN <= len;
+	     i += PP_STATS_COMMAND_LEN)
+		printf("handle %u cmd 0x%04x: %u\n", u16_from_buf_le(&buf[i]),
+		       u16_from_buf_le(&buf[i + 2]),
+		       u32_from_buf_le(&buf[i + 4]));
+
+	if (vreq_in(dev, PP_VREQ_STATS_GET_SCHED, 0, 0, buf,
+		    PP_STATS_SCHED_LEN) != PP_STATS_SCHED_LEN)
+		return -1;
+	printf("slept %u us, %u wakeups\n", u32_from_buf_le(&buf[0]),
+	       u32_from_buf_le(&buf[4]));
+	for (int i = 0; i < PP_STATS_SCHED_SOURCES; i++) {
+		static const char *const sources[PP_STATS_SCHED_SOURCES] = {
+			"usb", "gpio", "uart", "tick", "busy"
+		};
+		const uint8_t *rec = &buf[8 + 12 * i];
+		uint32_t n = u32_from_buf_le(&rec[0]);
+
+		printf("%s events %u, latency max %u us, mean %u us\n",
+		       sources[i], n, u32_from_buf_le(&rec[4]),
+		       n ? u32_from_buf_le(&rec[8]) / n : 0);
+	}
+	return 0;
+}
+
+static int cmd_xip(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint8_t buf[PP_STATS_XIP_LEN];
+	uint32_t accesses, hits;
+	bool clear = argc == 1 && !strcmp(argv[0], "clear");
+
+	if (argc != 0 && !clear)
+		return -2;
+	if (vreq_in(dev, PP_VREQ_STATS_GET_XIP, clear, 0, buf, sizeof(buf)) !=
+	    sizeof(buf))
+		return -1;
+
+	accesses = u32_from_buf_le(&buf[0]);
+	hits = u32_from_buf_le(&buf[4]);
+	printf("xip cache: %u accesses, %u hits, %u misses (%.2f%%)\n",
+	       accesses, hits, accesses - hits,
+	       accesses ? 100.0 * (accesses - hits) / accesses : 0.0);
+	printf("hot paths in %s\n",
+	       buf[8] & PP_STATS_XIP_RAM_HOT_PATHS ? "SRAM" : "flash");
+	return 0;
+}
+
+static void print_trace_record(const uint8_t *rec)
+{
+	uint16_t id = u16_from_buf_le(&rec[4]);
+	uint16_t arg0 = u16_from_buf_le(&rec[6]);
+	uint32_t arg1 = u32_from_buf_le(&rec[8]);
+
+	printf("%10u ", u32_from_buf_le(&rec[0]));
+	switch (id) {
+	case PP_TRACE_REQUEST:
+		printf("request %s %s echo %u\n", handle2str(arg0),
+		       cmd2str(arg1 & 0xffff), arg1 >> 16);
+		break;
+	case PP_TRACE_RESPONSE:
+		printf("response %s %s %s\n", handle2str(arg0),
+		       cmd2str(arg1 & 0xffff), arg1 >> 16 ? "failed" : "ok");
+		break;
+	case PP_TRACE_QUEUE_FULL:
+		printf("queue of itf %u full, dropped %s %s\n", arg0,
+		       handle2str(arg1 >> 16), cmd2str(arg1 & 0xffff));
+		break;
+	case PP_TRACE_SENT:
+		printf("sent %u bytes on itf %u\n", arg1, arg0);
+		break;
+	case PP_TRACE_RX_HELD:
+		printf("holding %u bytes on itf %u\n", arg1, arg0);
+		break;
+	case PP_TRACE_GPIO_IRQ:
+		printf("gpio irq GP%u mask 0x%x\n", arg0, arg1);
+		break;
+	case PP_TRACE_GPIO_EVENT:
+		printf("gpio event line %u value %u count %u\n", arg0,
+		       arg1 & 0xffff, arg1 >> 16);
+		break;
+	case PP_TRACE_UART_ERROR:
+		printf("uart error itf %u dr 0x%03x\n", arg0, arg1);
+		break;
+	default:
+		printf("id 0x%04x 0x%04x 0x%08x\n", id, arg0, arg1);
+		break;
+	}
+}
+
+static int cmd_trace(libusb_device_handle *dev, int argc, char **argv)
+{
+	uint8_t buf[PP_VREQ_MAX_DATA_LEN];
+	uint32_t seq = 0, end;
+
+	if (argc == 1 && !strcmp(argv[0], "start"))
+		return vreq_out(dev, PP_VREQ_TRACE_SET, 1, 0, NULL, 0);
+	if (argc == 1 && !strcmp(argv[0], "stop"))
+		return vreq_out(dev, PP_VREQ_TRACE_SET, 0, 0, NULL, 0);
+	if (argc != 0)
+		return -2;
+
+	if (vreq_in(dev, PP_VREQ_TRACE_GET_STATUS, 0, 0, buf,
+		    PP_TRACE_STATUS_LEN) != PP_TRACE_STATUS_LEN)
+		return -1;
+	if (buf[0] != PP_TRACE_VERSION) {
+		fprintf(stderr, "Unknown trace version %u\n", buf[0]);
+		return -1;
+	}
+	if (!buf[1])
+		printf("(stopped)\n");
+	// Records written while reading are left for the next call
+	end = u32_from_buf_le(&buf[8]);
+
+	while ((int32_t)(end - seq) > 0) {
+		int len = vreq_in(dev, PP_VREQ_TRACE_READ, seq & 0xffff,
+				  seq >> 16, buf, sizeof(buf));
+		if (len < PP_TRACE_READ_HDR_LEN)
+			return -1;
+
+		uint32_t first = u32_from_buf_le(&buf[0]);
+		int n = (len - PP_TRACE_READ_HDR_LEN) / PP_TRACE_RECORD_LEN;
+		if (first != seq)
+			printf("(%u records overwritten)\n", first - seq);
+		for (int i = 0; i < n && first + i != end; i++)
+			print_trace_record(&buf[PP_TRACE_READ_HDR_LEN +
+						i * PP_TRACE_RECORD_LEN]);
+		if (!n)
+			break;
+		seq = first + (uint32_t)n;
+	}
+	return 0;
+}
+
+static const struct command commands[] = {
+	{ "rs485", "[ITF [SETUP_US HOLD_US]]",
+	  "Get or set the RS-485 DE setup and hold time", cmd_rs485 },
+	{ "capture", "ITF on|off [GAP_US]",
+	  "Enable framed RX capture, frames end after GAP_US idle time",
+	  cmd_capture },
+	{ "frames", "[ITF]",
+	  "Print captured frames: time, flags (Overflow, Error, +continued), "
+	  "data",
+	  cmd_frames },
+	{ "pwm", "LINE [off | FREQ_HZ DUTY_PERCENT]",
+	  "Output hardware PWM on a gpiochip line, or show its PWM state",
+	  cmd_pwm },
+	{ "events", "LINE [INTERVAL_MS]",
+	  "Collapse the GPIO change events of a line into at most one per "
+	  "INTERVAL_MS (0 for no minimum), or show its event counters",
+	  cmd_events },
+	{ "seq", "FILE [PASSES] | stop",
+	  "Play back GPIO steps \"LINES VALUES DELAY_NS\" from FILE (- for "
+	  "stdin), PASSES 0 repeats until stopped",
+	  cmd_seq },
+	{ "counter", "LINE [GATE_MS | off]",
+	  "Measure frequency and duty cycle of a gpiochip line over GATE_MS, "
+	  "or show the last result",
+	  cmd_counter },
+	{ "quad", "ENCODER [off | LINE_A LINE_B]",
+	  "Decode a quadrature encoder on two consecutive GPIOs (resets the "
+	  "position), or show its position",
+	  cmd_quad },
+	{ "script", "FILE | stop",
+	  "Run a script assembled by pp-script -o on the device and print its "
+	  "result",
+	  cmd_script },
+	{ "state", "", "Print the state mirror: line levels, counters, ADC",
+	  cmd_state },
+	{ "stats", "",
+	  "Print the performance counters: request counts and service "
+	  "times, queue high-water marks, error counters",
+	  cmd_stats },
+	{ "xip", "[clear]",
+	  "Print the XIP cache counters of the flash, clear them after "
+	  "reading",
+	  cmd_xip },
+	{ "trace", "[start | stop]",
+	  "Print the trace records of the device, or start or stop tracing",
+	  cmd_trace },
+};
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-s SERIAL] COMMAND [ARGS...]\n"
+		"\n"
+		"  -s SERIAL   select the device by serial number\n"
+		"\n"
+		"Commands:\n",
+		prog);
+	for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+		fprintf(stderr, "  %s %s\n      %s\n", commands[i].name,
+			commands[i].args, commands[i].help);
+	}
+}
+
+static libusb_device_handle *open_device(libusb_context *ctx,
+					 const char *serial)
+{
+	libusb_device **list;
+	libusb_device_handle *found = NULL;
+	ssize_t n = libusb_get_device_list(ctx, &list);
+
+	for (ssize_t i = 0; i < n && !found; i++) {
+		struct libusb_device_descriptor desc;
+		libusb_device_handle *dev;
+
+		if (libusb_get_device_descriptor(list[i], &desc) < 0 ||
+		    desc.idVendor != PP_VENDOR_VID ||
+		    desc.idProduct != PP_VENDOR_PID)
+			continue;
+		if (libusb_open(list[i], &dev) < 0)
+			continue;
+
+		if (serial) {
+			unsigned char s[64];
+			int len = libusb_get_string_descriptor_ascii(
+				dev, desc.iSerialNumber, s, sizeof(s));
+			if (len < 0 || strcmp((char *)s, serial) != 0) {
+				libusb_close(dev);
+				continue;
+			}
+		}
+		found = dev;
+	}
+
+	if (n >= 0)
+		libusb_free_device_list(list, 1);
+	return found;
+}
+
+int main(int argc, char **argv)
+{
+	const char *serial = NULL;
+	const struct command *cmd = NULL;
+	libusb_context *ctx;
+	libusb_device_handle *dev;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "+s:h")) != -1) {
+		switch (opt) {
+		case 's':
+			serial = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+		if (strcmp(argv[optind], commands[i].name) == 0)
+			cmd = &commands[i];
+	}
+	if (!cmd) {
+		fprintf(stderr, "Unknown command: %s\n", argv[optind]);
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (libusb_init(&ctx) < 0) {
+		fprintf(stderr, "Failed to initialize libusb\n");
+		return 1;
+	}
+
+	dev = open_device(ctx, serial);
+	if (!dev) {
+		fprintf(stderr, "No PicoPorts device found\n");
+		libusb_exit(ctx);
+		return 1;
+	}
+
+	int ret = cmd->fn(dev, argc - optind - 1, &argv[optind + 1]);
+	if (ret == -2)
+		fprintf(stderr, "Usage: %s %s %s\n", argv[0], cmd->name,
+			cmd->args);
+
+	libusb_close(dev);
+	libusb_exit(ctx);
+	return ret < 0 ? 1 : 0;
+}
@@ -0,0 +1,492 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ppdln2.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+
+#define SYNC_TIMEOUT_MS 1000
+// Requests sent in one write. The device's RX FIFO holds that much, so a
+// batch doesn't wait for the device to read it.
+#define BATCH_MAX DLN2_RX_BUF_SIZE
+
+struct ppdln2 {
+	struct ppdln2_transport *t;
+	unsigned int max_in_flight;
+	unsigned int in_flight;
+	uint16_t echo;
+
+	// Submitted, not sent yet
+	struct ppdln2_xfer *queue_head;
+	struct ppdln2_xfer *queue_tail;
+	// Sent, in order
+	struct ppdln2_xfer *sent_head;
+	struct ppdln2_xfer *sent_tail;
+	// Completed transfers of ppdln2_queue() without a callback, in order
+	struct ppdln2_xfer *done_head;
+	struct ppdln2_xfer *done_tail;
+
+	uint8_t batch[BATCH_MAX];
+
+	// Data that didn't arrive as exactly one response for the oldest
+	// transfer: several responses in one read, partial responses or
+	// responses out of order.
+	uint8_t stream[2 * PPDLN2_MSG_MAX];
+	size_t stream_len;
+
+	ppdln2_event_fn event;
+	void *event_data;
+};
+
+struct ppdln2 *ppdln2_open(struct ppdln2_transport *t,
+			   unsigned int max_in_flight)
+{
+	struct ppdln2 *d;
+
+	if (!t)
+		return NULL;
+
+	d = calloc(1, sizeof(*d));
+	if (!d) {
+		t->close(t);
+		return NULL;
+	}
+
+	d->t = t;
+	d->max_in_flight = max_in_flight ? max_in_flight : 1;
+	return d;
+}
+
+void ppdln2_close(struct ppdln2 *d)
+{
+	if (!d)
+		return;
+	d->t->close(d->t);
+	free(d);
+}
+
+void ppdln2_set_event_handler(struct ppdln2 *d, ppdln2_event_fn fn,
+			      void *user_data)
+{
+	d->event = fn;
+	d->event_data = user_data;
+}
+
+unsigned int ppdln2_pending(const struct ppdln2 *d)
+{
+	unsigned int n = d->in_flight;
+
+	for (struct ppdln2_xfer *x = d->queue_head; x; x = x->next)
+		n++;
+	return n;
+}
+
+static struct ppdln2_xfer *take_sent(struct ppdln2 *d, uint16_t echo)
+{
+	struct ppdln2_xfer *prev = NULL;
+
+	for (struct ppdln2_xfer *x = d->sent_head; x; prev = x, x = x->next) {
+		if (x->echo != echo)
+			continue;
+
+		if (prev)
+			prev->next = x->next;
+		else
+			d->sent_head = x->next;
+		if (d->sent_tail == x)
+			d->sent_tail = prev;
+		x->next = NULL;
+		d->in_flight--;
+		return x;
+	}
+
+	return NULL;
+}
+
+static void finish(struct ppdln2 *d, struct ppdln2_xfer *xfer, int status)
+{
+	xfer->status = status;
+	xfer->done = true;
+	if (xfer->complete) {
+		xfer->complete(xfer);
+	} else if (xfer->reap) {
+		if (d->done_tail)
+			d->done_tail->next = xfer;
+		else
+			d->done_head = xfer;
+		d->done_tail = xfer;
+	}
+}
+
+// Takes the first transfer of the submission queue and fills in its header
+static struct ppdln2_xfer *take_queued(struct ppdln2 *d)
+{
+	struct ppdln2_xfer *x = d->queue_head;
+	uint16_t size = PPDLN2_HDR_LEN + x->tx_len;
+
+	d->queue_head = x->next;
+	if (!d->queue_head)
+		d->queue_tail = NULL;
+	x->next = NULL;
+
+	x->echo = d->echo++;
+	u16_to_buf_le(&x->tx[0], size);
+	u16_to_buf_le(&x->tx[2], x->cmd);
+	u16_to_buf_le(&x->tx[4], x->echo);
+	u16_to_buf_le(&x->tx[6], x->handle);
+	return x;
+}
+
+static void add_sent(struct ppdln2 *d, struct ppdln2_xfer *x)
+{
+	if (d->sent_tail)
+		d->sent_tail->next = x;
+	else
+		d->sent_head = x;
+	d->sent_tail = x;
+	d->in_flight++;
+}
+
+// Whether the next queued transfer can be sent and fits into the batch
+static bool fits_batch(const struct ppdln2 *d, size_t len)
+{
+	return d->queue_head && d->in_flight < d->max_in_flight &&
+	       len + PPDLN2_HDR_LEN + d->queue_head->tx_len <= BATCH_MAX;
+}
+
+// Sends the queued transfers that fit into max_in_flight. Consecutive ones are
+// packed into one write, the device reads the requests from a byte stream.
+// A transfer that is sent alone goes out from its own buffer.
+static int send_queued(struct ppdln2 *d)
+{
+	while (d->queue_head && d->in_flight < d->max_in_flight) {
+		struct ppdln2_xfer *first = take_queued(d);
+		uint16_t size = u16_from_buf_le(&first->tx[0]);
+		struct ppdln2_xfer *last = first;
+		const uint8_t *buf = first->tx;
+		size_t len = size;
+		int ret;
+
+		add_sent(d, first);
+		if (fits_batch(d, len)) {
+			memcpy(d->batch, first->tx, size);
+			buf = d->batch;
+			do {
+				last = take_queued(d);
+				size = u16_from_buf_le(&last->tx[0]);
+				memcpy(&d->batch[len], last->tx, size);
+				len += size;
+				add_sent(d, last);
+			} while (fits_batch(d, len));
+		}
+
+		ret = d->t->write(d->t, buf, len);
+		if (ret < 0) {
+			// None of the batch was sent
+			for (struct ppdln2_xfer *x = first, *next; x != NULL;
+			     x = next) {
+				next = x == last ? NULL : x->next;
+				finish(d, take_sent(d, x->echo), ret);
+			}
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int enqueue(struct ppdln2 *d, struct ppdln2_xfer *xfer, bool reap)
+{
+	if (xfer->tx_len > PPDLN2_DATA_MAX)
+		return -EINVAL;
+
+	xfer->next = NULL;
+	xfer->done = false;
+	xfer->reap = reap;
+	xfer->status = 0;
+	xfer->rx_len = 0;
+
+	if (d->queue_tail)
+		d->queue_tail->next = xfer;
+	else
+		d->queue_head = xfer;
+	d->queue_tail = xfer;
+	return 0;
+}
+
+int ppdln2_submit(struct ppdln2 *d, struct ppdln2_xfer *xfer)
+{
+	int ret = enqueue(d, xfer, false);
+
+	return ret < 0 ? ret : send_queued(d);
+}
+
+int ppdln2_queue(struct ppdln2 *d, struct ppdln2_xfer *xfer)
+{
+	return enqueue(d, xfer, true);
+}
+
+int ppdln2_flush(struct ppdln2 *d)
+{
+	return send_queued(d);
+}
+
+unsigned int ppdln2_reap(struct ppdln2 *d, struct ppdln2_xfer **xfers,
+			 unsigned int max)
+{
+	unsigned int n = 0;
+
+	while (n < max && d->done_head) {
+		struct ppdln2_xfer *x = d->done_head;
+
+		d->done_head = x->next;
+		if (!d->done_head)
+			d->done_tail = NULL;
+		x->next = NULL;
+		xfers[n++] = x;
+	}
+	return n;
+}
+
+// Completes the transfer matching the response in msg. Returns 1 if a transfer
+// was completed, 0 for unsolicited messages.
+static int handle_response(struct ppdln2 *d, const uint8_t *msg, uint16_t size)
+{
+	uint16_t echo = u16_from_buf_le(&msg[4]);
+	uint16_t handle = u16_from_buf_le(&msg[6]);
+
+	if (handle == DLN2_HANDLE_EVENT) {
+		if (d->event)
+			d->event(d->event_data, u16_from_buf_le(&msg[2]),
+				 &msg[PPDLN2_HDR_LEN], size - PPDLN2_HDR_LEN);
+		return 0;
+	}
+
+	struct ppdln2_xfer *x = take_sent(d, echo);
+	if (!x)
+		return 0;
+
+	if (msg != x->rx)
+		memcpy(x->rx, msg, size);
+
+	if (size < PPDLN2_HDR_LEN + 2) {
+		finish(d, x, -EPROTO);
+		return 1;
+	}
+
+	x->rx_len = size - PPDLN2_HDR_LEN - 2;
+	finish(d, x, u16_from_buf_le(&x->rx[PPDLN2_HDR_LEN]));
+	return 1;
+}
+
+static void fail_sent(struct ppdln2 *d, int status)
+{
+	while (d->sent_head)
+		finish(d, take_sent(d, d->sent_head->echo), status);
+}
+
+static int drain_stream(struct ppdln2 *d)
+{
+	size_t offs = 0;
+	int completed = 0;
+
+	while (d->stream_len - offs >= PPDLN2_HDR_LEN) {
+		uint16_t size = u16_from_buf_le(&d->stream[offs]);
+
+		if (size < PPDLN2_HDR_LEN || size > PPDLN2_MSG_MAX) {
+			// Lost track of the message boundaries
+			d->stream_len = 0;
+			fail_sent(d, -EPROTO);
+			return -EPROTO;
+		}
+		if (d->stream_len - offs < size)
+			break;
+
+		completed += handle_response(d, &d->stream[offs], size);
+		offs += size;
+	}
+
+	memmove(d->stream, &d->stream[offs], d->stream_len - offs);
+	d->stream_len -= offs;
+	return completed;
+}
+
+int ppdln2_poll(struct ppdln2 *d, int timeout_ms)
+{
+	struct ppdln2_xfer *head = d->sent_head;
+	int completed = 0;
+	int n;
+
+	// Events may also arrive while no transfer is pending
+	if (!head && !d->event)
+		return send_queued(d);
+
+	if (head && d->stream_len == 0) {
+		// Read straight into the buffer of the oldest transfer, which
+		// is where its response is expected.
+		n = d->t->read(d->t, head->rx, PPDLN2_MSG_MAX, timeout_ms);
+		if (n < 0)
+			return n;
+		if (n == 0)
+			return -ETIMEDOUT;
+
+		if (n >= PPDLN2_HDR_LEN && u16_from_buf_le(&head->rx[0]) == n &&
+		    u16_from_buf_le(&head->rx[4]) == head->echo) {
+			completed = handle_response(d, head->rx, n);
+		} else {
+			memcpy(d->stream, head->rx, n);
+			d->stream_len = n;
+			completed = drain_stream(d);
+		}
+	} else {
+		n = d->t->read(d->t, &d->stream[d->stream_len], PPDLN2_MSG_MAX,
+			       timeout_ms);
+		if (n < 0)
+			return n;
+		if (n == 0)
+			return -ETIMEDOUT;
+		d->stream_len += n;
+		completed = drain_stream(d);
+	}
+
+	if (completed < 0)
+		return completed;
+
+	int ret = send_queued(d);
+	return ret < 0 ? ret : completed;
+}
+
+static int64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int ppdln2_transfer(struct ppdln2 *d, struct ppdln2_xfer *xfer)
+{
+	int64_t deadline = now_ms() + SYNC_TIMEOUT_MS;
+	int ret = ppdln2_submit(d, xfer);
+	if (ret < 0)
+		return ret;
+
+	// Events and responses to other transfers may arrive first
+	while (!xfer->done) {
+		int64_t left = deadline - now_ms();
+		if (left <= 0)
+			return -ETIMEDOUT;
+
+		ret = ppdln2_poll(d, (int)left);
+		if (ret < 0)
+			return ret;
+	}
+
+	return xfer->status;
+}
+
+int ppdln2_request(struct ppdln2 *d, uint16_t handle, uint16_t cmd,
+		   const void *data, uint16_t len, void *resp,
+		   uint16_t resp_len)
+{
+	struct ppdln2_xfer x = {
+		.handle = handle,
+		.cmd = cmd,
+		.tx_len = len,
+	};
+
+	if (len > PPDLN2_DATA_MAX)
+		return -EINVAL;
+	memcpy(ppdln2_xfer_payload(&x), data, len);
+
+	int ret = ppdln2_transfer(d, &x);
+	if (ret != 0)
+		return ret < 0 ? ret : -EIO;
+
+	if (resp) {
+		if (x.rx_len < resp_len)
+			return -EPROTO;
+		memcpy(resp, ppdln2_xfer_data(&x), resp_len);
+	}
+	return 0;
+}
+
+static int spi_request(struct ppdln2 *d, uint16_t cmd, const uint8_t *data,
+		       uint16_t len, uint8_t *resp, uint16_t resp_len)
+{
+	return ppdln2_request(d, DLN2_HANDLE_SPI, cmd, data, len, resp,
+			      resp_len);
+}
+
+int ppdln2_spi_enable(struct ppdln2 *d, uint8_t port, bool enable)
+{
+	// u8 port, u8 wait_for_completion (disable only)
+	uint8_t req[2] = { port, 1 };
+
+	return spi_request(d, enable ? DLN2_SPI_ENABLE : DLN2_SPI_DISABLE,
+			   req, enable ? 1 : 2, NULL, 0);
+}
+
+int ppdln2_spi_set_mode(struct ppdln2 *d, uint8_t port, uint8_t mode)
+{
+	uint8_t req[2] = { port, mode };
+
+	return spi_request(d, DLN2_SPI_SET_MODE, req, sizeof(req), NULL, 0);
+}
+
+int ppdln2_spi_set_frame_size(struct ppdln2 *d, uint8_t port, uint8_t bits)
+{
+	uint8_t req[2] = { port, bits };
+
+	return spi_request(d, DLN2_SPI_SET_FRAME_SIZE, req, sizeof(req), NULL,
+			   0);
+}
+
+int ppdln2_spi_set_frequency(struct ppdln2 *d, uint8_t port, uint32_t *hz)
+{
+	uint8_t req[5] = { port };
+	uint8_t resp[4];
+
+	u32_to_buf_le(&req[1], *hz);
+	int ret = spi_request(d, DLN2_SPI_SET_FREQUENCY, req, sizeof(req),
+			      resp, sizeof(resp));
+	if (ret == 0)
+		*hz = u32_from_buf_le(resp);
+	return ret;
+}
+
+int ppdln2_spi_select(struct ppdln2 *d, uint8_t port, uint8_t cs)
+{
+	// A chip select is selected by a 0 bit
+	uint8_t req[2] = { port, (uint8_t)~(1 << cs) };
+
+	int ret = spi_request(d, DLN2_SPI_SET_SS, req, sizeof(req), NULL, 0);
+	if (ret < 0)
+		return ret;
+
+	req[1] = 1 << cs;
+	return spi_request(d, DLN2_SPI_SS_MULTI_ENABLE, req, sizeof(req), NULL,
+			   0);
+}
+
+void ppdln2_spi_prepare(struct ppdln2_xfer *xfer, uint8_t port, uint16_t len,
+			bool leave_ss_low)
+{
+	uint8_t *p = ppdln2_xfer_payload(xfer);
+
+	xfer->handle = DLN2_HANDLE_SPI;
+	xfer->cmd = DLN2_SPI_READ_WRITE;
+	xfer->tx_len = 4 + len;
+
+	// 0: u8 port, 1: u16 size, 3: u8 attr, 4: u8 buf[size]
+	p[0] = port;
+	u16_to_buf_le(&p[1], len);
+	p[3] = leave_ss_low ? DLN2_SPI_ATTR_LEAVE_SS_LOW : 0;
+}
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Host library for the DLN2 protocol on the PicoPorts user space interface.
+ *
+ * Transfers are queued with ppdln2_submit() and completed by ppdln2_poll().
+ * Up to max_in_flight requests are sent before their responses are read, so
+ * USB transfers and device processing overlap. Responses are matched by the
+ * DLN2 echo field. Each transfer carries its own request and response
+ * buffers, which are sent and received in place and can be reused by
+ * resubmitting the transfer from its completion callback.
+ *
+ * Alternatively, transfers are put on the submission queue with
+ * ppdln2_queue() and sent together by ppdln2_flush() or ppdln2_poll(): the
+ * requests that fit into max_in_flight go out in as few writes (USB bulk
+ * transfers) as possible. Queued transfers without a completion callback are
+ * put on the completion queue when their response arrives, where
+ * ppdln2_reap() takes them from. Independent operations, e.g. reading several
+ * GPIOs and an ADC channel, then cost one round trip instead of one each.
+ *
+ * The library is not thread safe, use one struct ppdln2 per thread.
+ */
+#ifndef _PICOPORTS_PPDLN2_H_
+#define _PICOPORTS_PPDLN2_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PPDLN2_MSG_MAX 512
+#define PPDLN2_HDR_LEN 8
+// Request payload space
+#define PPDLN2_DATA_MAX (PPDLN2_MSG_MAX - PPDLN2_HDR_LEN)
+
+struct ppdln2_transport {
+	// Sends one complete message
+	int (*write)(struct ppdln2_transport *t, const uint8_t *buf,
+		     size_t len);
+	// Returns the number of bytes read, 0 on timeout or a negative errno.
+	// Like a USB bulk transfer, this may return several messages at once.
+	int (*read)(struct ppdln2_transport *t, uint8_t *buf, size_t len,
+		    int timeout_ms);
+	void (*close)(struct ppdln2_transport *t);
+};
+
+// Opens the first PicoPorts device, or the one with the given serial number.
+struct ppdln2_transport *ppdln2_usb_open(const char *serial);
+// In-process stand-in for the device, the SPI ports loop MOSI back to MISO.
+struct ppdln2_transport *ppdln2_loopback_open(void);
+// Connects to a DLN2 interface socket of the firmware simulator (pp-sim).
+struct ppdln2_transport *ppdln2_socket_open(const char *path);
+
+struct ppdln2_xfer;
+typedef void (*ppdln2_complete_fn)(struct ppdln2_xfer *xfer);
+
+struct ppdln2_xfer {
+	// Request: tx_len payload bytes at &tx[PPDLN2_HDR_LEN]
+	uint16_t handle;
+	uint16_t cmd;
+	uint16_t tx_len;
+	uint8_t tx[PPDLN2_MSG_MAX];
+
+	// Response: 0 on success, the DLN2 response code or a negative errno
+	int status;
+	// Response payload after the response code, see ppdln2_xfer_data()
+	uint16_t rx_len;
+	uint8_t rx[PPDLN2_MSG_MAX];
+
+	ppdln2_complete_fn complete;
+	void *user_data;
+
+	// Private
+	uint16_t echo;
+	bool done;
+	bool reap;
+	struct ppdln2_xfer *next;
+};
+
+static inline uint8_t *ppdln2_xfer_payload(struct ppdln2_xfer *xfer)
+{
+	return &xfer->tx[PPDLN2_HDR_LEN];
+}
+
+static inline const uint8_t *ppdln2_xfer_data(const struct ppdln2_xfer *xfer)
+{
+	return &xfer->rx[PPDLN2_HDR_LEN + 2];
+}
+
+struct ppdln2;
+
+// Takes ownership of the transport.
+struct ppdln2 *ppdln2_open(struct ppdln2_transport *t,
+			   unsigned int max_in_flight);
+void ppdln2_close(struct ppdln2 *d);
+
+// Queues the transfer and sends it right away if max_in_flight allows
+int ppdln2_submit(struct ppdln2 *d, struct ppdln2_xfer *xfer);
+// Puts the transfer on the submission queue without sending it
+int ppdln2_queue(struct ppdln2 *d, struct ppdln2_xfer *xfer);
+// Sends the queued transfers that fit into max_in_flight, batched
+int ppdln2_flush(struct ppdln2 *d);
+// Takes up to max transfers from the completion queue, in the order they
+// completed. Returns the number of transfers.
+unsigned int ppdln2_reap(struct ppdln2 *d, struct ppdln2_xfer **xfers,
+			 unsigned int max);
+// Completes responses as they arrive, waits up to timeout_ms for the first
+// read. Returns the number of completed transfers, which is 0 if only events
+// or unmatched responses were read, -ETIMEDOUT if nothing arrived or another
+// negative errno.
+int ppdln2_poll(struct ppdln2 *d, int timeout_ms);
+// Number of submitted transfers that have not completed yet
+unsigned int ppdln2_pending(const struct ppdln2 *d);
+// Submits the transfer and waits for its completion. Returns its status.
+int ppdln2_transfer(struct ppdln2 *d, struct ppdln2_xfer *xfer);
+
+// Synchronous request, copies resp_len bytes of the response payload to resp.
+// Returns 0, -EIO if the device failed the request or a negative errno.
+int ppdln2_request(struct ppdln2 *d, uint16_t handle, uint16_t cmd,
+		   const void *data, uint16_t len, void *resp,
+		   uint16_t resp_len);
+
+// Called from ppdln2_poll() for events, e.g. PP_SEQ_DONE_EV of pp_vendor.h.
+// With a handler, ppdln2_poll() also waits for events if nothing is pending.
+typedef void (*ppdln2_event_fn)(void *user_data, uint16_t cmd,
+				const uint8_t *data, uint16_t len);
+void ppdln2_set_event_handler(struct ppdln2 *d, ppdln2_event_fn fn,
+			      void *user_data);
+
+// SPI helpers. The configuration requests are synchronous.
+int ppdln2_spi_enable(struct ppdln2 *d, uint8_t port, bool enable);
+int ppdln2_spi_set_mode(struct ppdln2 *d, uint8_t port, uint8_t mode);
+int ppdln2_spi_set_frame_size(struct ppdln2 *d, uint8_t port, uint8_t bits);
+int ppdln2_spi_set_frequency(struct ppdln2 *d, uint8_t port, uint32_t *hz);
+int ppdln2_spi_select(struct ppdln2 *d, uint8_t port, uint8_t cs);
+
+#define PPDLN2_SPI_MAX_XFER 256
+
+// Prepares a full duplex SPI transfer. Fill ppdln2_spi_tx_buf() with len
+// bytes before submitting, the received bytes are at ppdln2_spi_rx_buf().
+void ppdln2_spi_prepare(struct ppdln2_xfer *xfer, uint8_t port, uint16_t len,
+			bool leave_ss_low);
+
+static inline uint8_t *ppdln2_spi_tx_buf(struct ppdln2_xfer *xfer)
+{
+	// u8 port, u16 size, u8 attr
+	return &ppdln2_xfer_payload(xfer)[4];
+}
+
+static inline const uint8_t *ppdln2_spi_rx_buf(const struct ppdln2_xfer *xfer)
+{
+	// u16 size
+	return &ppdln2_xfer_data(xfer)[2];
+}
+
+// Clock synchronization: converts device timestamps (GPIO events, UART
+// frames, traces) to host time, CLOCK_MONOTONIC in ns like the timestamps of
+// gpiod line events. Each ppdln2_clock_sync() sends a burst of
+// PP_CMD_GET_TIME requests and keeps the response with the shortest round
+// trip, the midpoint of which is the best estimate of the host time of its
+// device timestamp. A line through the rounds of the last
+// PPDLN2_CLOCK_ROUNDS calls gives the offset and the drift of the device
+// timer, so calling it every few seconds keeps the estimate current. Its
+// error is bounded by half the round trip time.
+//
+// On the same USB bus, ppdln2_clock_align() replaces the round trips of a
+// device by the start of frame timestamps of both devices, which leaves an
+// error of a few microseconds between them. Align again after every sync.
+#define PPDLN2_CLOCK_ROUNDS 32
+
+struct ppdln2_clock;
+
+struct ppdln2_clock_info {
+	// Host time minus device time at the latest sync
+	int64_t offset_ns;
+	// How much faster the device timer runs than the host clock
+	double drift_ppm;
+	// Shortest round trip of the latest sync
+	uint32_t rtt_ns;
+	// Rounds the estimate was fitted from
+	unsigned int rounds;
+	// Device time per USB frame, 0 without start of frame timestamps
+	double frame_us;
+	// Aligned to another device since the latest sync
+	bool aligned;
+};
+
+// The clock uses the device's DLN2 interface while syncing, with no other
+// transfers pending.
+struct ppdln2_clock *ppdln2_clock_open(struct ppdln2 *d);
+void ppdln2_clock_close(struct ppdln2_clock *c);
+// Sends pings requests and updates the estimate. Returns 0 or a negative
+// errno.
+int ppdln2_clock_sync(struct ppdln2_clock *c, unsigned int pings);
+// Puts the device on the host time of ref via the start of frame timestamps,
+// both devices must be on the same bus. Returns -ENODATA if either has no
+// start of frame timestamps yet.
+int ppdln2_clock_align(struct ppdln2_clock *c,
+		       const struct ppdln2_clock *ref);
+int64_t ppdln2_clock_to_host(const struct ppdln2_clock *c, uint64_t dev_us);
+// Extends a 32 bit device timestamp within 35 minutes of the latest sync
+uint64_t ppdln2_clock_extend(const struct ppdln2_clock *c, uint32_t dev_us);
+void ppdln2_clock_get_info(const struct ppdln2_clock *c,
+			   struct ppdln2_clock_info *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PICOPORTS_PPDLN2_H_ */
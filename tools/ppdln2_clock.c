@@ -0,0 +1,329 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Clock synchronization with the device timer, see ppdln2.h and
+ * PP_CMD_GET_TIME in src/pp_vendor.h.
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ppdln2.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+#include "pp_vendor.h"
+
+// USB frame numbers have 11 bits
+#define FRAME_MASK 0x7ff
+#define FRAME_HALF 0x400
+// Nominal device time per frame
+#define FRAME_US 1000.0
+// Rounds with a longer round trip than this times the shortest one of the
+// window are left out of the fit, e.g. when the host was busy
+#define RTT_MAX_FACTOR 2
+// The drift is only fitted once the rounds span this much device time,
+// before that the device timer is assumed to run at the nominal rate
+#define MIN_FIT_SPAN_US 100000
+
+struct clock_round {
+	// The response with the shortest round trip of the round: device time
+	// and the midpoint of the round trip on the host
+	uint64_t dev_us;
+	int64_t host_ns;
+	uint32_t rtt_ns;
+
+	// Latest SOF of the round, frame counts from the first one
+	bool sof;
+	uint64_t sof_us;
+	int64_t frame;
+};
+
+struct ppdln2_clock {
+	struct ppdln2 *d;
+
+	struct clock_round rounds[PPDLN2_CLOCK_ROUNDS];
+	unsigned int num_rounds;
+	unsigned int next_round;
+	// Latest SOF, also when its round has left the window
+	bool sof;
+	uint64_t sof_us;
+	int64_t frame;
+
+	// host_ns = host_ns0 + (dev_us - dev_us0) * ns_per_us
+	uint64_t dev_us0;
+	double host_ns0;
+	double ns_per_us;
+	// Device time per frame, 0 without SOF timestamps
+	double frame_us;
+	unsigned int fit_rounds;
+	bool aligned;
+};
+
+static int64_t host_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static double host_at(const struct ppdln2_clock *c, double dev_us)
+{
+	return c->host_ns0 + (dev_us - (double)c->dev_us0) * c->ns_per_us;
+}
+
+// The frame count of an 11 bit frame number, expected_frames after the frame
+// count base
+static int64_t unwrap_frame(int64_t base, uint16_t frame,
+			    int64_t expected_frames)
+{
+	int64_t d = ((int64_t)frame - (base & FRAME_MASK) - expected_frames) &
+		    FRAME_MASK;
+
+	if (d >= FRAME_HALF)
+		d -= FRAME_MASK + 1;
+	return base + expected_frames + d;
+}
+
+struct clock_ping {
+	uint64_t dev_us;
+	int64_t host_ns;
+	uint32_t rtt_ns;
+	uint64_t sof_us;
+	uint16_t frame;
+};
+
+static int ping(struct ppdln2_clock *c, struct clock_ping *p)
+{
+	uint8_t resp[PP_TIME_LEN];
+
+	int64_t t0 = host_now_ns();
+	int ret = ppdln2_request(c->d, DLN2_HANDLE_CTRL, PP_CMD_GET_TIME, NULL,
+				 0, resp, sizeof(resp));
+	int64_t t1 = host_now_ns();
+
+	if (ret)
+		return ret;
+
+	p->dev_us = u64_from_buf_le(&resp[0]);
+	p->sof_us = u64_from_buf_le(&resp[8]);
+	p->frame = u16_from_buf_le(&resp[16]) & FRAME_MASK;
+	p->host_ns = t0 + (t1 - t0) / 2;
+	p->rtt_ns = (uint32_t)(t1 - t0);
+	return 0;
+}
+
+// Least squares line y = a + b * x through n points, x and y relative to the
+// first point to keep the precision of doubles
+struct line_fit {
+	double n, sx, sy, sxx, sxy;
+};
+
+static void fit_add(struct line_fit *f, double x, double y)
+{
+	f->n++;
+	f->sx += x;
+	f->sy += y;
+	f->sxx += x * x;
+	f->sxy += x * y;
+}
+
+static double fit_slope(const struct line_fit *f)
+{
+	return (f->n * f->sxy - f->sx * f->sy) /
+	       (f->n * f->sxx - f->sx * f->sx);
+}
+
+// Device time per frame from the SOF timestamps of the window
+static void fit_frames(struct ppdln2_clock *c)
+{
+	const struct clock_round *first = NULL, *last = NULL;
+	struct line_fit f = { 0 };
+
+	c->frame_us = 0;
+	for (unsigned int i = 0; i < c->num_rounds; i++) {
+		const struct clock_round *r =
+			&c->rounds[(c->next_round + PPDLN2_CLOCK_ROUNDS -
+				    c->num_rounds + i) %
+				   PPDLN2_CLOCK_ROUNDS];
+
+		if (!r->sof)
+			continue;
+		if (!first)
+			first = r;
+		last = r;
+		fit_add(&f, (double)(r->frame - first->frame),
+			(double)(r->sof_us - first->sof_us));
+	}
+	if (!first)
+		return;
+
+	c->frame_us = FRAME_US;
+	if (last->sof_us - first->sof_us >= MIN_FIT_SPAN_US)
+		c->frame_us = fit_slope(&f);
+}
+
+// Offset and drift from the rounds of the window with a short round trip
+static void fit_host(struct ppdln2_clock *c)
+{
+	const struct clock_round *latest =
+		&c->rounds[(c->next_round + PPDLN2_CLOCK_ROUNDS - 1) %
+			   PPDLN2_CLOCK_ROUNDS];
+	uint32_t min_rtt = UINT32_MAX;
+	uint64_t min_dev_us = latest->dev_us;
+	struct line_fit f = { 0 };
+
+	for (unsigned int i = 0; i < c->num_rounds; i++) {
+		if (c->rounds[i].rtt_ns < min_rtt)
+			min_rtt = c->rounds[i].rtt_ns;
+	}
+
+	for (unsigned int i = 0; i < c->num_rounds; i++) {
+		const struct clock_round *r = &c->rounds[i];
+
+		if (r->rtt_ns > (uint64_t)min_rtt * RTT_MAX_FACTOR)
+			continue;
+		if (r->dev_us < min_dev_us)
+			min_dev_us = r->dev_us;
+		fit_add(&f, (double)(int64_t)(r->dev_us - latest->dev_us),
+			(double)(r->host_ns - latest->host_ns));
+	}
+
+	c->ns_per_us = 1000;
+	if (latest->dev_us - min_dev_us >= MIN_FIT_SPAN_US)
+		c->ns_per_us = fit_slope(&f);
+	c->dev_us0 = latest->dev_us;
+	c->host_ns0 = (double)latest->host_ns +
+		      (f.sy - c->ns_per_us * f.sx) / f.n;
+	c->fit_rounds = (unsigned int)f.n;
+	c->aligned = false;
+}
+
+struct ppdln2_clock *ppdln2_clock_open(struct ppdln2 *d)
+{
+	struct ppdln2_clock *c = calloc(1, sizeof(*c));
+
+	if (!c)
+		return NULL;
+	c->d = d;
+	c->ns_per_us = 1000;
+	return c;
+}
+
+void ppdln2_clock_close(struct ppdln2_clock *c)
+{
+	free(c);
+}
+
+int ppdln2_clock_sync(struct ppdln2_clock *c, unsigned int pings)
+{
+	struct clock_round *r = &c->rounds[c->next_round];
+	struct clock_ping best = { .rtt_ns = UINT32_MAX };
+	struct clock_ping sof = { 0 };
+
+	if (!pings)
+		return -EINVAL;
+	// Responses to other requests would lengthen the round trips
+	if (ppdln2_pending(c->d))
+		return -EBUSY;
+
+	for (unsigned int i = 0; i < pings; i++) {
+		struct clock_ping p;
+		int ret = ping(c, &p);
+
+		if (ret)
+			return ret;
+		if (p.rtt_ns < best.rtt_ns)
+			best = p;
+		if (p.sof_us)
+			sof = p;
+	}
+
+	memset(r, 0, sizeof(*r));
+	r->dev_us = best.dev_us;
+	r->host_ns = best.host_ns;
+	r->rtt_ns = best.rtt_ns;
+	if (sof.sof_us) {
+		int64_t frame = sof.frame;
+
+		if (c->sof) {
+			double frame_us = c->frame_us ? c->frame_us : FRAME_US;
+			int64_t expected = llround(
+				(double)(sof.sof_us - c->sof_us) / frame_us);
+
+			frame = unwrap_frame(c->frame, sof.frame, expected);
+		}
+		r->sof = c->sof = true;
+		r->sof_us = c->sof_us = sof.sof_us;
+		r->frame = c->frame = frame;
+	}
+
+	c->next_round = (c->next_round + 1) % PPDLN2_CLOCK_ROUNDS;
+	if (c->num_rounds < PPDLN2_CLOCK_ROUNDS)
+		c->num_rounds++;
+
+	fit_frames(c);
+	fit_host(c);
+	return 0;
+}
+
+int ppdln2_clock_align(struct ppdln2_clock *c, const struct ppdln2_clock *ref)
+{
+	if (!c->sof || !ref->sof || !c->frame_us || !ref->frame_us)
+		return -ENODATA;
+
+	// The round trips place both SOFs on the host clock closely enough to
+	// tell how many frames they are apart, which the 11 bit frame numbers
+	// alone can't
+	double frame_ns = ref->frame_us * ref->ns_per_us;
+	int64_t expected = llround((host_at(c, (double)c->sof_us) -
+				    host_at(ref, (double)ref->sof_us)) /
+				   frame_ns);
+	int64_t frames = unwrap_frame(ref->frame,
+				      (uint16_t)(c->frame & FRAME_MASK),
+				      expected) -
+			 ref->frame;
+
+	// The device time of ref at the SOF this device timestamped
+	double ref_dev_us =
+		(double)ref->sof_us + (double)frames * ref->frame_us;
+
+	c->dev_us0 = c->sof_us;
+	c->host_ns0 = host_at(ref, ref_dev_us);
+	c->ns_per_us = ref->ns_per_us * ref->frame_us / c->frame_us;
+	c->aligned = true;
+	return 0;
+}
+
+int64_t ppdln2_clock_to_host(const struct ppdln2_clock *c, uint64_t dev_us)
+{
+	return llround(host_at(c, (double)dev_us));
+}
+
+uint64_t ppdln2_clock_extend(const struct ppdln2_clock *c, uint32_t dev_us)
+{
+	return c->dev_us0 + (int64_t)(int32_t)(dev_us - (uint32_t)c->dev_us0);
+}
+
+void ppdln2_clock_get_info(const struct ppdln2_clock *c,
+			   struct ppdln2_clock_info *info)
+{
+	const struct clock_round *latest =
+		&c->rounds[(c->next_round + PPDLN2_CLOCK_ROUNDS - 1) %
+			   PPDLN2_CLOCK_ROUNDS];
+
+	memset(info, 0, sizeof(*info));
+	if (!c->num_rounds)
+		return;
+
+	info->offset_ns = llround(c->host_ns0 - (double)c->dev_us0 * 1000);
+	info->drift_ppm = (1000 / c->ns_per_us - 1) * 1e6;
+	info->rtt_ns = latest->rtt_ns;
+	info->rounds = c->fit_rounds;
+	info->frame_us = c->frame_us;
+	info->aligned = c->aligned;
+}
@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Software stand-in for a PicoPorts device, so the library and tools can be
+ * tested without hardware. It implements the SPI commands of src/pp_spi.c with
+ * MISO connected to MOSI and returns the responses the way the USB bulk IN
+ * endpoint does.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ppdln2.h"
+
+#include "byte_ops.h"
+#include "dln2.h"
+
+#define LOOPBACK_PORTS 2
+// The device sends 64 byte packets, a shorter one ends a bulk transfer
+#define LOOPBACK_PACKET_SIZE 64
+#define LOOPBACK_MIN_FREQUENCY 1000
+#define LOOPBACK_MAX_FREQUENCY 62500000
+
+struct loopback_port {
+	bool enabled;
+	uint8_t mode;
+	uint8_t frame_size;
+	uint32_t frequency;
+	uint8_t ss_enabled;
+};
+
+struct loopback {
+	struct ppdln2_transport t;
+	struct loopback_port ports[LOOPBACK_PORTS];
+
+	// Responses not read yet
+	uint8_t out[64 * PPDLN2_MSG_MAX];
+	size_t out_len;
+	// Rest of a response that didn't fit into the previous read
+	size_t partial_len;
+	bool partial_short;
+};
+
+// Handles one SPI request like pp_spi_handle_request(). Returns false to fail
+// the request.
+static bool handle_spi(struct loopback *lb, uint16_t cmd, const uint8_t *in,
+		       uint16_t in_len, uint8_t *out, uint16_t *out_len)
+{
+	if (cmd == DLN2_SPI_GET_PORT_COUNT) {
+		out[0] = LOOPBACK_PORTS;
+		*out_len = 1;
+		return true;
+	}
+
+	if (in_len < 1 || in[0] >= LOOPBACK_PORTS)
+		return false;
+	struct loopback_port *port = &lb->ports[in[0]];
+	*out_len = 0;
+
+	switch (cmd) {
+	case DLN2_SPI_ENABLE:
+		port->enabled = true;
+		break;
+	case DLN2_SPI_DISABLE:
+		port->enabled = false;
+		break;
+	case DLN2_SPI_SET_MODE:
+		if (in_len < 2 || in[1] > 3)
+			return false;
+		port->mode = in[1];
+		break;
+	case DLN2_SPI_SET_FRAME_SIZE:
+		if (in_len < 2 || in[1] < 4 || in[1] > 16)
+			return false;
+		port->frame_size = in[1];
+		break;
+	case DLN2_SPI_SET_FREQUENCY: {
+		if (in_len < 5)
+			return false;
+		uint32_t hz = u32_from_buf_le(&in[1]);
+		if (hz < LOOPBACK_MIN_FREQUENCY)
+			hz = LOOPBACK_MIN_FREQUENCY;
+		if (hz > LOOPBACK_MAX_FREQUENCY)
+			hz = LOOPBACK_MAX_FREQUENCY;
+		port->frequency = hz;
+		u32_to_buf_le(out, hz);
+		*out_len = 4;
+		break;
+	}
+	case DLN2_SPI_SET_SS:
+	case DLN2_SPI_RELEASE_SS:
+		break;
+	case DLN2_SPI_SS_MULTI_ENABLE:
+		if (in_len < 2)
+			return false;
+		port->ss_enabled |= in[1];
+		break;
+	case DLN2_SPI_SS_MULTI_DISABLE:
+		if (in_len < 2)
+			return false;
+		port->ss_enabled &= ~in[1];
+		break;
+	case DLN2_SPI_WRITE:
+	case DLN2_SPI_READ:
+	case DLN2_SPI_READ_WRITE: {
+		if (in_len < 4 || !port->enabled)
+			return false;
+		uint16_t size = u16_from_buf_le(&in[1]);
+		bool write = cmd != DLN2_SPI_READ;
+		if (size > DLN2_SPI_MAX_XFER_SIZE ||
+		    (port->frame_size > 8 && size % 2) ||
+		    (write && in_len < 4 + size))
+			return false;
+		if (cmd == DLN2_SPI_WRITE)
+			break;
+
+		u16_to_buf_le(out, size);
+		if (write)
+			memcpy(&out[2], &in[4], size);
+		else
+			memset(&out[2], 0, size);
+		*out_len = 2 + size;
+		break;
+	}
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+static void handle_message(struct loopback *lb, const uint8_t *msg,
+			   uint16_t size)
+{
+	uint8_t *resp = &lb->out[lb->out_len];
+	uint16_t data_len = PPDLN2_MSG_MAX - PPDLN2_HDR_LEN - 2;
+
+	uint16_t cmd = u16_from_buf_le(&msg[2]);
+	uint16_t handle = u16_from_buf_le(&msg[6]);
+	bool ok = handle == DLN2_HANDLE_SPI &&
+		  handle_spi(lb, cmd, &msg[PPDLN2_HDR_LEN],
+			     size - PPDLN2_HDR_LEN,
+			     &resp[PPDLN2_HDR_LEN + 2], &data_len);
+	if (!ok)
+		data_len = 0;
+
+	// Same header, only the size differs
+	memcpy(resp, msg, PPDLN2_HDR_LEN);
+	u16_to_buf_le(&resp[0], PPDLN2_HDR_LEN + 2 + data_len);
+	u16_to_buf_le(&resp[PPDLN2_HDR_LEN], ok ? 0 : 0xFFFF);
+	lb->out_len += PPDLN2_HDR_LEN + 2 + data_len;
+}
+
+// Like the device, takes several requests in one write
+static int loopback_write(struct ppdln2_transport *t, const uint8_t *buf,
+			  size_t len)
+{
+	struct loopback *lb = (struct loopback *)t;
+	size_t offs = 0, num_msgs = 0;
+
+	while (offs < len) {
+		uint16_t size;
+
+		if (len - offs < PPDLN2_HDR_LEN)
+			return -EINVAL;
+		size = u16_from_buf_le(&buf[offs]);
+		if (size < PPDLN2_HDR_LEN || size > len - offs)
+			return -EINVAL;
+		offs += size;
+		num_msgs++;
+	}
+	// The device would stop reading requests
+	if (sizeof(lb->out) - lb->out_len < num_msgs * PPDLN2_MSG_MAX)
+		return -ENOSPC;
+
+	for (offs = 0; offs < len; offs += u16_from_buf_le(&buf[offs]))
+		handle_message(lb, &buf[offs], u16_from_buf_le(&buf[offs]));
+	return 0;
+}
+
+static int loopback_read(struct ppdln2_transport *t, uint8_t *buf, size_t len,
+			 int timeout_ms)
+{
+	struct loopback *lb = (struct loopback *)t;
+	size_t n = 0;
+
+	(void)timeout_ms;
+
+	// Responses are queued back to back. A bulk transfer ends with a short
+	// packet, that is after a response whose size is not a multiple of the
+	// packet size, or when the buffer is full.
+	while (n < lb->out_len && n < len) {
+		size_t size;
+		bool short_end;
+
+		if (lb->partial_len) {
+			size = lb->partial_len;
+			short_end = lb->partial_short;
+			lb->partial_len = 0;
+		} else {
+			size = u16_from_buf_le(&lb->out[n]);
+			short_end = size % LOOPBACK_PACKET_SIZE;
+		}
+
+		n += size;
+		if (n > len) {
+			lb->partial_len = n - len;
+			lb->partial_short = short_end;
+			n = len;
+		} else if (short_end) {
+			break;
+		}
+	}
+
+	memcpy(buf, lb->out, n);
+	memmove(lb->out, &lb->out[n], lb->out_len - n);
+	lb->out_len -= n;
+	return (int)n;
+}
+
+static void loopback_close(struct ppdln2_transport *t)
+{
+	free(t);
+}
+
+struct ppdln2_transport *ppdln2_loopback_open(void)
+{
+	struct loopback *lb = calloc(1, sizeof(*lb));
+
+	if (!lb)
+		return NULL;
+
+	lb->t.write = loopback_write;
+	lb->t.read = loopback_read;
+	lb->t.close = loopback_close;
+	for (int i = 0; i < LOOPBACK_PORTS; i++) {
+		lb->ports[i].frame_size = 8;
+		lb->ports[i].frequency = 1000000;
+	}
+	return &lb->t;
+}
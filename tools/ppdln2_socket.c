@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * Unix socket transport, connects to a DLN2 interface of the firmware
+ * simulator (pp-sim). The socket is a byte stream, so a read can end in the
+ * middle of a message like a bulk transfer into a short buffer.
+ */
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ppdln2.h"
+
+struct socket_transport {
+	struct ppdln2_transport t;
+	int fd;
+};
+
+static int socket_write(struct ppdln2_transport *t, const uint8_t *buf,
+			size_t len)
+{
+	struct socket_transport *s = (struct socket_transport *)t;
+
+	while (len) {
+		ssize_t n = send(s->fd, buf, len, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -EIO;
+		buf += n;
+		len -= (size_t)n;
+	}
+	return 0;
+}
+
+static int socket_read(struct ppdln2_transport *t, uint8_t *buf, size_t len,
+		       int timeout_ms)
+{
+	struct socket_transport *s = (struct socket_transport *)t;
+	struct pollfd pfd = { .fd = s->fd, .events = POLLIN };
+
+	int ret = poll(&pfd, 1, timeout_ms);
+	if (ret < 0)
+		return errno == EINTR ? 0 : -errno;
+	if (ret == 0)
+		return 0;
+
+	ssize_t n = recv(s->fd, buf, len, 0);
+	if (n < 0)
+		return errno == EINTR ? 0 : -errno;
+	// The simulator went away
+	if (n == 0)
+		return -EPIPE;
+	return (int)n;
+}
+
+static void socket_close(struct ppdln2_transport *t)
+{
+	struct socket_transport *s = (struct socket_transport *)t;
+
+	close(s->fd);
+	free(s);
+}
+
+struct ppdln2_transport *ppdln2_socket_open(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", path);
+		return NULL;
+	}
+	strcpy(addr.sun_path, path);
+
+	struct socket_transport *s = calloc(1, sizeof(*s));
+	if (!s)
+		return NULL;
+
+	s->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (s->fd < 0 ||
+	    connect(s->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "Failed to connect to %s: %s\n", path,
+			strerror(errno));
+		if (s->fd >= 0)
+			close(s->fd);
+		free(s);
+		return NULL;
+	}
+
+	s->t.write = socket_write;
+	s->t.read = socket_read;
+	s->t.close = socket_close;
+	return &s->t;
+}
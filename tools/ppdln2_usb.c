@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2025 sevenlab engineering GmbH
+ *
+ * libusb transport, uses the DLN2 interface named PP_DLN2_USER_IFNAME, which
+ * the kernel dln2 driver doesn't bind.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ppdln2.h"
+
+#include "pp_vendor.h"
+
+#ifdef PPDLN2_HAVE_LIBUSB
+
+#include <libusb.h>
+
+#define WRITE_TIMEOUT_MS 1000
+#define FLUSH_TIMEOUT_MS 10
+
+struct usb_transport {
+	struct ppdln2_transport t;
+	libusb_context *ctx;
+	libusb_device_handle *dev;
+	int itf;
+	uint8_t ep_out;
+	uint8_t ep_in;
+};
+
+static int usb_write(struct ppdln2_transport *t, const uint8_t *buf,
+		     size_t len)
+{
+	struct usb_transport *u = (struct usb_transport *)t;
+	int transferred;
+
+	// The device reassembles messages by their size field, so no zero
+	// length packet is needed after a multiple of the packet size.
+	int ret = libusb_bulk_transfer(u->dev, u->ep_out, (uint8_t *)buf,
+				       (int)len, &transferred,
+				       WRITE_TIMEOUT_MS);
+	if (ret < 0 || (size_t)transferred != len)
+		return -EIO;
+	return 0;
+}
+
+static int usb_read(struct ppdln2_transport *t, uint8_t *buf, size_t len,
+		    int timeout_ms)
+{
+	struct usb_transport *u = (struct usb_transport *)t;
+	int transferred = 0;
+
+	int ret = libusb_bulk_transfer(u->dev, u->ep_in, buf, (int)len,
+				       &transferred, timeout_ms);
+	if (ret < 0 && ret != LIBUSB_ERROR_TIMEOUT)
+		return -EIO;
+	return transferred;
+}
+
+static void usb_close(struct ppdln2_transport *t)
+{
+	struct usb_transport *u = (struct usb_transport *)t;
+
+	libusb_release_interface(u->dev, u->itf);
+	libusb_close(u->dev);
+	libusb_exit(u->ctx);
+	free(u);
+}
+
+// Finds the user space DLN2 interface and its endpoints
+static bool find_interface(struct usb_transport *u, libusb_device *usb_dev)
+{
+	struct libusb_config_descriptor *config;
+	bool found = false;
+
+	if (libusb_get_active_config_descriptor(usb_dev, &config) < 0)
+		return false;
+
+	for (int i = 0; i < config->bNumInterfaces && !found; i++) {
+		const struct libusb_interface_descriptor *alt =
+			&config->interface[i].altsetting[0];
+		unsigned char name[64];
+
+		if (alt->bInterfaceClass != LIBUSB_CLASS_VENDOR_SPEC ||
+		    !alt->iInterface)
+			continue;
+		int len = libusb_get_string_descriptor_ascii(
+			u->dev, alt->iInterface, name, sizeof(name));
+		if (len < 0 || strcmp((char *)name, PP_DLN2_USER_IFNAME) != 0)
+			continue;
+
+		u->itf = alt->bInterfaceNumber;
+		for (int e = 0; e < alt->bNumEndpoints; e++) {
+			uint8_t addr = alt->endpoint[e].bEndpointAddress;
+			if (addr & LIBUSB_ENDPOINT_IN)
+				u->ep_in = addr;
+			else
+				u->ep_out = addr;
+		}
+		found = u->ep_in && u->ep_out;
+	}
+
+	libusb_free_config_descriptor(config);
+	return found;
+}
+
+static bool open_device(struct usb_transport *u, const char *serial)
+{
+	libusb_device **list;
+	ssize_t n = libusb_get_device_list(u->ctx, &list);
+
+	for (ssize_t i = 0; i < n && !u->dev; i++) {
+		struct libusb_device_descriptor desc;
+
+		if (libusb_get_device_descriptor(list[i], &desc) < 0 ||
+		    desc.idVendor != PP_VENDOR_VID ||
+		    desc.idProduct != PP_VENDOR_PID)
+			continue;
+		if (libusb_open(list[i], &u->dev) < 0)
+			continue;
+
+		if (serial) {
+			unsigned char s[64];
+			int len = libusb_get_string_descriptor_ascii(
+				u->dev, desc.iSerialNumber, s, sizeof(s));
+			if (len < 0 || strcmp((char *)s, serial) != 0) {
+				libusb_close(u->dev);
+				u->dev = NULL;
+				continue;
+			}
+		}
+
+		if (!find_interface(u, list[i])) {
+			fprintf(stderr,
+				"No \"%s\" interface, firmware too old?\n",
+				PP_DLN2_USER_IFNAME);
+			libusb_close(u->dev);
+			u->dev = NULL;
+		}
+	}
+
+	if (n >= 0)
+		libusb_free_device_list(list, 1);
+	return u->dev != NULL;
+}
+
+struct ppdln2_transport *ppdln2_usb_open(const char *serial)
+{
+	struct usb_transport *u = calloc(1, sizeof(*u));
+	uint8_t buf[PPDLN2_MSG_MAX];
+	int transferred;
+
+	if (!u)
+		return NULL;
+
+	if (libusb_init(&u->ctx) < 0) {
+		fprintf(stderr, "Failed to initialize libusb\n");
+		free(u);
+		return NULL;
+	}
+
+	if (!open_device(u, serial)) {
+		fprintf(stderr, "No PicoPorts device found\n");
+		goto err_exit;
+	}
+
+	if (libusb_claim_interface(u->dev, u->itf) < 0) {
+		fprintf(stderr, "Failed to claim interface %d\n", u->itf);
+		goto err_close;
+	}
+
+	// Drop responses left over from a previous user
+	while (libusb_bulk_transfer(u->dev, u->ep_in, buf, sizeof(buf),
+				    &transferred, FLUSH_TIMEOUT_MS) == 0)
+		;
+
+	u->t.write = usb_write;
+	u->t.read = usb_read;
+	u->t.close = usb_close;
+	return &u->t;
+
+err_close:
+	libusb_close(u->dev);
+err_exit:
+	libusb_exit(u->ctx);
+	free(u);
+	return NULL;
+}
+
+#else
+
+struct ppdln2_transport *ppdln2_usb_open(const char *serial)
+{
+	(void)serial;
+	fprintf(stderr,
+		"Built without libusb, only the loopback is available\n");
+	return NULL;
+}
+
+#endif